@@ -0,0 +1,185 @@
+/* File: fft_bench.c
+ * Descr: compares speed and accuracy of built-in FFT of ADDA with that of FFTW3 (see README)
+ *
+ * Copyright (C) 2014 ADDA contributors
+ * This file is part of ADDA.
+ *
+ * ADDA is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * ADDA is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with ADDA. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#include "const.h" // keep this first
+#include "fft_builtin.h"
+// project headers
+#include "fft.h" // for FFT_FORWARD and FFT_BACKWARD
+// system headers
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef NO_FFTW
+#	include <fftw3.h> // types.h should be included before (to match C99 complex type)
+#endif
+
+#define BATCH 65536 // total number of complex elements in a batch of lines (1 MB)
+#define MIN_TIME 0.2 // minimum duration of each measurement (in seconds)
+
+static const int defSizes[]={16,20,24,28,30,32,40,42,48,56,60,64,70,80,84,96,112,120,128,140,160,168,192,210,224,240,
+	256,280,320,336,384,420,448,480,512,560,640,672,768,840,896,960,1024};
+
+//======================================================================================================================
+
+static void *SafeMalloc(const size_t size)
+// malloc with check for errors
+{
+	void *ptr=malloc(size);
+
+	if (ptr==NULL) {
+		fprintf(stderr,"ERROR: could not allocate %zu bytes\n",size);
+		exit(EXIT_FAILURE);
+	}
+	return ptr;
+}
+
+//======================================================================================================================
+
+static void FillRandom(doublecomplex * restrict data,const size_t size)
+// fills data with pseudo-random values in [-0.5,0.5] (both real and imaginary parts)
+{
+	size_t i;
+
+	srand(1);
+	for (i=0;i<size;i++) data[i]=(rand()/(double)RAND_MAX-0.5) + I*(rand()/(double)RAND_MAX-0.5);
+}
+
+//======================================================================================================================
+
+static double TimeBuiltin(const int n,const int lot,doublecomplex * restrict data)
+/* returns the time (in seconds) of a pair of forward and backward built-in transforms per line; data is left
+ * transformed
+ */
+{
+	struct fftbPlan plan;
+	doublecomplex *tw,*work;
+	clock_t start;
+	double elapsed;
+	int count=0;
+
+	tw=SafeMalloc(fftbTwiddleSize(n)*sizeof(doublecomplex));
+	work=SafeMalloc(n*sizeof(doublecomplex));
+	fftbInit(&plan,n,tw);
+	start=clock();
+	do {
+		fftbExec(&plan,data,n,lot,FFT_FORWARD,work);
+		fftbExec(&plan,data,n,lot,FFT_BACKWARD,work);
+		count++;
+		elapsed=(double)(clock()-start)/CLOCKS_PER_SEC;
+	} while (elapsed<MIN_TIME);
+	// final forward transform to compare the results
+	FillRandom(data,n*(size_t)lot);
+	fftbExec(&plan,data,n,lot,FFT_FORWARD,work);
+	free(tw);
+	free(work);
+	return elapsed/((double)count*lot);
+}
+
+//======================================================================================================================
+
+#ifndef NO_FFTW
+static double TimeFFTW(const int n,const int lot,doublecomplex * restrict data)
+// same as TimeBuiltin, but for FFTW3
+{
+	fftw_plan pf,pb;
+	clock_t start;
+	double elapsed;
+	int count=0,nn=n;
+
+	pf=fftw_plan_many_dft(1,&nn,lot,data,NULL,1,n,data,NULL,1,n,FFT_FORWARD,FFTW_MEASURE);
+	pb=fftw_plan_many_dft(1,&nn,lot,data,NULL,1,n,data,NULL,1,n,FFT_BACKWARD,FFTW_MEASURE);
+	FillRandom(data,n*(size_t)lot); // planning overwrites the data
+	start=clock();
+	do {
+		fftw_execute(pf);
+		fftw_execute(pb);
+		count++;
+		elapsed=(double)(clock()-start)/CLOCKS_PER_SEC;
+	} while (elapsed<MIN_TIME);
+	FillRandom(data,n*(size_t)lot);
+	fftw_execute(pf);
+	fftw_destroy_plan(pf);
+	fftw_destroy_plan(pb);
+	return elapsed/((double)count*lot);
+}
+#endif
+
+//======================================================================================================================
+
+int main(int argc,char **argv)
+{
+	int i,n,lot,nsizes;
+	const int *sizes;
+	int *argSizes=NULL;
+	double tb;
+	doublecomplex *data;
+#ifndef NO_FFTW
+	size_t j;
+	double tf,diff,norm;
+	doublecomplex *ref;
+#endif
+
+	if (argc>1) {
+		nsizes=argc-1;
+		argSizes=SafeMalloc(nsizes*sizeof(int));
+		for (i=0;i<nsizes;i++) if ((argSizes[i]=atoi(argv[i+1]))<1) {
+			fprintf(stderr,"ERROR: invalid length of transform '%s'\n",argv[i+1]);
+			return EXIT_FAILURE;
+		}
+		sizes=argSizes;
+	}
+	else {
+		nsizes=sizeof(defSizes)/sizeof(int);
+		sizes=defSizes;
+	}
+	printf("Built-in FFT uses %s kernels\n",fftbKernel());
+#ifdef NO_FFTW
+	printf("%6s %12s\n","n","builtin(ns)");
+#else
+	printf("%6s %12s %12s %8s %10s\n","n","builtin(ns)","FFTW3(ns)","ratio","max.diff");
+#endif
+	for (i=0;i<nsizes;i++) {
+		n=sizes[i];
+		lot=(BATCH>n) ? BATCH/n : 1;
+		data=SafeMalloc(n*(size_t)lot*sizeof(doublecomplex));
+		FillRandom(data,n*(size_t)lot);
+		tb=TimeBuiltin(n,lot,data);
+#ifdef NO_FFTW
+		printf("%6d %12.1f\n",n,1e9*tb);
+#else
+		ref=SafeMalloc(n*(size_t)lot*sizeof(doublecomplex));
+		tf=TimeFFTW(n,lot,ref);
+		// maximum difference over lines, relative to the norm of the line
+		diff=0;
+		for (j=0;j<(size_t)lot;j++) {
+			double d2=0,n2=0;
+			int k;
+			for (k=0;k<n;k++) {
+				d2+=pow(cabs(data[j*n+k]-ref[j*n+k]),2);
+				n2+=pow(cabs(ref[j*n+k]),2);
+			}
+			norm=sqrt(d2/n2);
+			if (norm>diff) diff=norm;
+		}
+		printf("%6d %12.1f %12.1f %8.2f %10.2e\n",n,1e9*tb,1e9*tf,tb/tf,diff);
+		free(ref);
+#endif
+		free(data);
+	}
+	free(argSizes);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+#!/bin/bash
+# Compares the timing of the stages of FFT-based MatVec (as reported by ADDA compiled with PRECISE_TIMING) between two
+# revisions of ADDA source, e.g. before and after a change of fft.c or matvec.c. Usage:
+#   ./matvec_timing.sh <rev1> <rev2> [<grid1> <grid2> ...]
+# where <rev1> and <rev2> are git revisions (commits, branches, or tags) of the repository, containing this script.
+# Default grids are 32, 64, and 96. For each revision and grid, ADDA is run NREP times and the minimum time of each
+# stage is shown (in seconds) for a single MatVec: forward and backward fftY and y-z transposes, total FFT (including
+# transposes), and total MatVec. The last column shows the ratio of total MatVec times (rev1/rev2).
+#
+# Look below for "!!!", which mark the places where adjustments are probably need to be done
+
+#---------------- Set parameters ---------------------------------------------------------------------------------------
+
+# Compilation options of ADDA (as in src/Makefile), PRECISE_TIMING is added automatically !!!
+OPTIONS="${OPTIONS-FFT_TEMPERTON}"
+# Number of repetitions of each run !!!
+NREP=${NREP-5}
+# Additional command line arguments of ADDA (e.g. shape) !!!
+ADDAARGS="${ADDAARGS-}"
+# Temporary directory for builds and runs
+TMPDIR=$(mktemp -d)
+
+#---------------- Build ------------------------------------------------------------------------------------------------
+
+if [ $# -lt 2 ]; then
+  echo "Usage: $0 <rev1> <rev2> [<grid1> <grid2> ...]" >&2
+  exit 1
+fi
+REV1=$1
+REV2=$2
+shift 2
+GRIDS="${@:-32 64 96}"
+REPO=$(git rev-parse --show-toplevel) || exit 1
+trap 'for i in 1 2; do git -C "$REPO" worktree remove --force "$TMPDIR/rev$i" 2>/dev/null; done; rm -rf "$TMPDIR"' EXIT
+
+for i in 1 2; do
+  rev=REV$i
+  git -C "$REPO" worktree add --detach "$TMPDIR/rev$i" "${!rev}" >/dev/null 2>&1 || {
+    echo "Failed to check out revision ${!rev}" >&2
+    exit 1
+  }
+  if ! make -C "$TMPDIR/rev$i/src" seq OPTIONS="$OPTIONS PRECISE_TIMING" >"$TMPDIR/make$i.log" 2>&1; then
+    echo "Failed to compile revision ${!rev} (see $TMPDIR/make$i.log)" >&2
+    trap - EXIT
+    exit 1
+  fi
+done
+
+#---------------- Run --------------------------------------------------------------------------------------------------
+
+# extracts the value of timing entry $1 from file $2
+function getval {
+  sed -n "s/.*\b$1 *= *\([0-9.]*\).*/\1/p" "$2" | tail -n 1
+}
+
+printf "%6s %4s %8s %8s %8s %8s %8s %8s %7s\n" grid rev FFTYf TYZf FFTYb TYZb FFT Total ratio
+for grid in $GRIDS; do
+  for i in 1 2; do
+    best=""
+    for ((r=0;r<NREP;r++)); do
+      out="$TMPDIR/out$i"
+      (cd "$TMPDIR" && "$TMPDIR/rev$i/src/seq/adda" -grid $grid $ADDAARGS -dir "$TMPDIR/run" >"$out" 2>&1)
+      rm -rf "$TMPDIR/run"
+      vals=""
+      for name in FFTYf TYZf FFTYb TYZb FFT Total; do
+        vals="$vals $(getval $name "$out")"
+      done
+      # keep the run with the smallest total time
+      if [ -z "$best" ] || awk "BEGIN{exit !(${vals##* }<${best##* })}"; then
+        best="$vals"
+      fi
+    done
+    total[$i]=${best##* }
+    printf "%6s %4s" $grid $i
+    printf " %8s" $best
+    if [ $i -eq 2 ]; then
+      awk "BEGIN{printf \" %7.3f\n\",${total[1]}/${total[2]}}"
+    else
+      echo
+    fi
+  done
+done
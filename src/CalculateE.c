@@ -50,7 +50,7 @@ extern const double ezLab[3],exSP[3];
 extern const double C0dipole,C0dipole_refl;
 // defined and initialized in param.c
 extern const bool store_int_field,store_dip_pol,store_beam,store_scat_grid,calc_Cext,calc_Cabs,
-	calc_Csca,calc_vec,calc_asym,calc_mat_force,store_force,store_ampl;
+	calc_Csca,calc_vec,calc_asym,calc_mat_force,store_force,store_ampl,store_int_bin;
 extern const int phi_int_type;
 // defined and initialized in timing.c
 extern TIME_TYPE Timing_EPlane,Timing_EPlaneComm,Timing_IntField,Timing_IntFieldOne,Timing_ScatQuan,Timing_IncBeam;
@@ -831,36 +831,64 @@ static void CalcIntegralScatQuantities(const enum incpol which)
 //======================================================================================================================
 
 static void StoreIntFields(const enum incpol which)
-// Write actual internal fields (not exciting) on each dipole to file
+// Write actual internal fields (not exciting) on each dipole to file (text or binary)
 {
+	char fname[MAX_FNAME];
+
 	// calculate fields; e_field=P/(V*chi)=chi_inv*P; for anisotropic - by components
 	nMult_mat(xvec,pvec,chi_inv);
 	// save fields to file
-	StoreFields(which,xvec,NULL,F_INTFLD,F_INTFLD_TMP,"E","Internal fields");
+	if (store_int_bin) {
+		SnprintfErr(ALL_POS,fname,MAX_FNAME,"%s/"F_INTFLD"%s"F_BINSUF,directory,(which==INCPOL_Y) ? F_YSUF : F_XSUF);
+		WriteFieldBin(fname,xvec);
+		if (IFROOT) printf("Internal fields saved to binary file\n");
+	}
+	else StoreFields(which,xvec,NULL,F_INTFLD,F_INTFLD_TMP,"E","Internal fields");
 }
 
 //======================================================================================================================
 
 int CalculateE(const enum incpol which,const enum Eftype type)
 /* Calculate everything for x or y polarized incident light; or one and use symmetry to determine the rest (determined
- * by type)
+ * by type). For block iterative solvers (nrhs>1) both polarizations are solved at the first call (for y), then the
+ * solution for x is stored in the second columns of the vectors, which are moved to the first ones at the second call.
  */
 {
 	int exit_status;
+	size_t i;
 	TIME_TYPE tstart;
 
 	tstart=GET_TIME();
-	// calculate the incident field Einc; vector b=Einc*cc_sqrt
-	D("Generating B");
-	GenerateB (which,Einc);
-	if (store_beam) StoreFields(which,Einc,NULL,F_BEAM,F_BEAM_TMP,"Einc","Incident beam");
-	Timing_IncBeam = GET_TIME() - tstart;
-	// calculate solution vector x
-	D("Iterative solver started");
-	exit_status=IterativeSolver(IterMethod,which);
-	D("Iterative solver finished");
-	Timing_IntFieldOne = GET_TIME() - tstart;
-	Timing_IntField += Timing_IntFieldOne;
+	if (nrhs>1 && which==INCPOL_X) {
+		// Einc, xvec, and pvec have been obtained together with the ones for INCPOL_Y
+		for (i=0;i<local_nRows;i++) {
+			Einc[i]=Einc[local_nRows+i];
+			xvec[i]=xvec[local_nRows+i];
+			pvec[i]=pvec[local_nRows+i];
+		}
+		if (store_beam) StoreFields(which,Einc,NULL,F_BEAM,F_BEAM_TMP,"Einc","Incident beam");
+		exit_status=0;
+	}
+	else {
+		// calculate the incident field Einc; vector b=Einc*cc_sqrt
+		D("Generating B");
+		GenerateB (which,Einc);
+		if (store_beam) StoreFields(which,Einc,NULL,F_BEAM,F_BEAM_TMP,"Einc","Incident beam");
+		if (nrhs>1) GenerateB(INCPOL_X,Einc+local_nRows); // the second column for the block iterative solver
+		Timing_IncBeam = GET_TIME() - tstart;
+		// calculate solution vector x
+		D("Iterative solver started");
+		exit_status=IterativeSolver(IterMethod,which);
+		D("Iterative solver finished");
+	}
+	/* for block solvers, the call for x only moves the solution, then Timing_IntFieldOne is kept equal to the time of
+	 * the joint solution for both polarizations
+	 */
+	if (nrhs>1 && which==INCPOL_X) Timing_IntField += GET_TIME() - tstart;
+	else {
+		Timing_IntFieldOne = GET_TIME() - tstart;
+		Timing_IntField += Timing_IntFieldOne;
+	}
 	// return if checkpoint (normal) occurred
 	if (exit_status==CHP_EXIT) return CHP_EXIT;
 
@@ -26,6 +26,7 @@
 #include "io.h"
 #include "memory.h"
 #include "oclcore.h"
+#include "precond.h"
 #include "Romberg.h"
 #include "timing.h"
 #include "vars.h"
@@ -43,12 +44,21 @@ extern const angle_set beta_int,gamma_int,theta_int,phi_int;
 extern const int avg_inc_pol;
 extern const double polNlocRp;
 extern const char *alldir_parms,*scat_grid_parms;
+extern const int gmres_m,idr_s,recycle_k;
+extern const enum prec Precond;
+extern const enum init_field InitField;
+extern const bool recycle_ref;
 // defined and initialized in timing.c
 extern TIME_TYPE Timing_Init,Timing_Init_Int;
 #ifdef OPENCL
 extern TIME_TYPE Timing_OCL_Init;
 #endif
 extern size_t TotalEval;
+extern long TotalRecycleSaved;
+#if !defined(SPARSE) && !defined(OPENCL)
+// defined and initialized in fft.c
+extern const double memLean,memPeakDm;
+#endif
 
 #ifdef ACCIMEXP
 extern doublecomplex * restrict imexptable;
@@ -76,6 +86,8 @@ doublecomplex *rvec;                 // current residual
 doublecomplex * restrict Avecbuffer; // used to hold the result of matrix-vector products
 // auxiliary vectors, used in some iterative solvers (with more meaningful names)
 doublecomplex * restrict vec1,* restrict vec2,* restrict vec3,* restrict vec4;
+doublecomplex * restrict precvec; // argument of MatVec, when the preconditioner is used
+doublecomplex * restrict Eprev;   // internal fields for the previous orientation (for two polarizations)
 // used in matvec.c
 #ifdef SPARSE
 doublecomplex * restrict arg_full; // vector to hold argvec for all dipoles
@@ -94,6 +106,11 @@ int CalculateE(enum incpol which,enum Eftype type);
 bool TestExtendThetaRange(void);
 void MuellerMatrix(void);
 void SaveMuellerAndCS(double * restrict in);
+#ifdef SPARSE
+// matvec.c
+void InitSparseMatVec(void);
+void FreeSparseMatVec(void);
+#endif
 
 //======================================================================================================================
 
@@ -294,6 +311,7 @@ static void calculate_one_orientation(double * restrict res)
 // performs calculation for one orientation; may do orientation averaging and put the result in res
 {
 	TIME_TYPE tstart;
+	const long rec_saved=TotalRecycleSaved;
 
 	if (orient_avg) {
 		alph_deg=0;
@@ -332,6 +350,8 @@ static void calculate_one_orientation(double * restrict res)
 	D("CalculateE finished");
 	MuellerMatrix();
 	D("MuellerMatrix finished");
+	if (IFROOT && orient_avg && recycle_ref) fprintf(logfile,"MatVecs saved by Krylov recycling (compared to reference "
+		"solves): %ld\n",TotalRecycleSaved-rec_saved);
 	if (IFROOT && orient_avg) {
 		tstart=GET_TIME();
 		if (store_mueller) printf("\nError of alpha integration (Mueller) is "GFORMDEF"\n",
@@ -375,19 +395,22 @@ static void AllocateEverything(void)
 	 */
 	// allocate all the memory
 	tmp=sizeof(doublecomplex)*(double)local_nRows;
+	// for block iterative solvers (nrhs>1) the main vectors, used in the iterative solver, contain nrhs columns
+	const size_t nRows_all=nrhs*local_nRows;
 	if (!prognosis) { // main 5 vectors, some of them are used in the iterative solver
-		MALLOC_VECTOR(xvec,complex,local_nRows,ALL);
-		MALLOC_VECTOR(rvec,complex,local_nRows,ALL);
-		MALLOC_VECTOR(pvec,complex,local_nRows,ALL);
-		MALLOC_VECTOR(Einc,complex,local_nRows,ALL);
-		MALLOC_VECTOR(Avecbuffer,complex,local_nRows,ALL);
+		MALLOC_VECTOR(xvec,complex,nRows_all,ALL);
+		MALLOC_VECTOR(rvec,complex,nRows_all,ALL);
+		MALLOC_VECTOR(pvec,complex,nRows_all,ALL);
+		MALLOC_VECTOR(Einc,complex,nRows_all,ALL);
+		MALLOC_VECTOR(Avecbuffer,complex,nRows_all,ALL);
 	}
-	memory+=5*tmp;
+	memory+=5*nrhs*tmp;
 #ifdef SPARSE
 	if (!prognosis) { // overflow of 3*nvoid_Ndip is tested in MakeParticle()
 		MALLOC_VECTOR(arg_full,complex,3*nvoid_Ndip,ALL);
 	}
 	memory+=3*nvoid_Ndip*sizeof(doublecomplex);
+	InitSparseMatVec();
 #endif // !SPARSE
 	/* additional vectors for iterative methods. Potentially, this procedure can be fully automated for any new
 	 * iterative solver, based on the information contained in structure array 'params' in file iterative.c. However,
@@ -416,6 +439,14 @@ static void AllocateEverything(void)
 			}
 			memory+=3*tmp;
 			break;
+		case IT_BICGSTAB_B:
+			if (!prognosis) {
+				MALLOC_VECTOR(vec1,complex,nRows_all,ALL);
+				MALLOC_VECTOR(vec2,complex,nRows_all,ALL);
+				MALLOC_VECTOR(vec3,complex,nRows_all,ALL);
+			}
+			memory+=3*nrhs*tmp;
+			break;
 		case IT_CSYM:
 		case IT_QMR_CS_2:
 			if (!prognosis) {
@@ -424,6 +455,30 @@ static void AllocateEverything(void)
 			}
 			memory+=2*tmp;
 			break;
+		/* Krylov basis of m+1 vectors is stored as a single block, followed by the recycled subspace (2k vectors);
+		 * another 2k vectors are used as a workspace for updating the latter
+		 */
+		case IT_GMRES:
+			if (!prognosis) {
+				MALLOC_VECTOR(vec1,complex,(gmres_m+1+2*recycle_k)*local_nRows,ALL);
+				if (recycle_k>0) MALLOC_VECTOR(vec2,complex,2*recycle_k*local_nRows,ALL);
+			}
+			memory+=(gmres_m+1+4*recycle_k)*tmp;
+			break;
+		case IT_IDR: // three blocks of s vectors each
+			if (!prognosis) {
+				MALLOC_VECTOR(vec1,complex,idr_s*local_nRows,ALL);
+				MALLOC_VECTOR(vec2,complex,idr_s*local_nRows,ALL);
+				MALLOC_VECTOR(vec3,complex,idr_s*local_nRows,ALL);
+			}
+			memory+=3*idr_s*tmp;
+			break;
+		case IT_PBICGSTAB: // six vectors are stored as a single block
+			if (!prognosis) {
+				MALLOC_VECTOR(vec1,complex,6*local_nRows,ALL);
+			}
+			memory+=6*tmp;
+			break;
 	}
 	/* TO ADD NEW ITERATIVE SOLVER
 	 * Add here a case corresponding to the new iterative solver. If the new iterative solver requires any extra vectors
@@ -431,6 +486,20 @@ static void AllocateEverything(void)
 	 * iterative.c is non-zero, then allocate memory for these vectors here. Variable memory should be incremented to
 	 * reflect the total allocated memory.
 	 */
+	// argument of MatVec for preconditioned solvers and LU factors of the diagonal blocks
+	if (Precond!=PREC_NONE) {
+		if (!prognosis) {
+			MALLOC_VECTOR(precvec,complex,nRows_all,ALL);
+		}
+		memory+=nrhs*tmp+InitPreconditioner();
+	}
+	// internal fields, used as initial ones for the next orientation (Y- and X-polarizations)
+	if (InitField==IF_PREV || InitField==IF_PREV_INC) {
+		if (!prognosis) {
+			MALLOC_VECTOR(Eprev,complex,2*local_nRows,ALL);
+		}
+		memory+=2*tmp;
+	}
 #ifndef SPARSE
 	MALLOC_VECTOR(expsX,complex,boxX,ALL);
 	MALLOC_VECTOR(expsY,complex,boxY,ALL);
@@ -538,12 +607,29 @@ static void AllocateEverything(void)
 	 *               Part of the memory is currently not distributed among processors - see issues 160,175.
 	 */
 	MAXIMIZE(memPeak,memory);
+#if !defined(SPARSE) && !defined(OPENCL)
+	/* in lean mode memPeak is tracked only after the initialization of Dmatrix (see InitDmatrix), so the peak
+	 * for '-opt speed' (all later peaks are larger by memLean) can be determined exactly
+	 */
+	double memGain=0;
+	if (lean_matvec) {
+		memGain=MAX(memPeakDm,memPeak+memLean);
+		MAXIMIZE(memPeak,memPeakDm);
+		memGain-=memPeak;
+	}
+#endif
 	double memSum=AccumulateMax(memPeak,&memmax);
+#if !defined(SPARSE) && !defined(OPENCL)
+	if (lean_matvec) memGain=AccumulateMax(memGain,&tmp);
+#endif
 	if (IFROOT) {
 		PrintBoth(logfile,"Total memory usage: "FFORMM" MB\n",memSum/MBYTE);
 #ifdef PARALLEL
 		PrintBoth(logfile,"Maximum memory usage of single processor: "FFORMM" MB\n",memmax/MBYTE);
 #endif
+#if !defined(SPARSE) && !defined(OPENCL)
+		if (lean_matvec) PrintBoth(logfile,"  decreased (in total) by "FFORMM" MB due to '-opt lean'\n",memGain/MBYTE);
+#endif
 #ifdef OPENCL
 		PrintBoth(logfile,"OpenCL memory usage: peak total - "FFORMM" MB, maximum object - "FFORMM" MB\n",
 			oclMemPeak/MBYTE,oclMemMaxObj/MBYTE);
@@ -568,6 +654,7 @@ void FreeEverything(void)
 #else	
 	Free_general(position_full); // allocated in MakeParticle();
 	Free_cVector(arg_full);
+	FreeSparseMatVec();
 #endif // SPARSE
 #ifdef ACCIMEXP
 	Free_cVector(imexptable);
@@ -593,6 +680,8 @@ void FreeEverything(void)
 		case IT_BICG_CS:
 			break;
 		case IT_BICGSTAB:
+		case IT_BICGSTAB_B:
+		case IT_IDR:
 		case IT_QMR_CS:
 			Free_cVector(vec1);
 			Free_cVector(vec2);
@@ -603,11 +692,23 @@ void FreeEverything(void)
 			Free_cVector(vec1);
 			Free_cVector(vec2);
 			break;
+		case IT_GMRES:
+			Free_cVector(vec1);
+			if (recycle_k>0) Free_cVector(vec2);
+			break;
+		case IT_PBICGSTAB:
+			Free_cVector(vec1);
+			break;
 	}
 	/* TO ADD NEW ITERATIVE SOLVER
 	 * Add here a case corresponding to the new iterative solver. It should free the extra vectors that were allocated
 	 * in AllocateEverything() above.
 	 */
+	if (Precond!=PREC_NONE) {
+		Free_cVector(precvec);
+		FreePreconditioner();
+	}
+	if (InitField==IF_PREV || InitField==IF_PREV_INC) Free_cVector(Eprev);
 	if (yzplane) {
 		Free_cVector(EyzplX);
 		Free_cVector(EyzplY);
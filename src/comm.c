@@ -28,6 +28,7 @@
 #include "timing.h"
 #include "vars.h"
 // system headers
+#include <inttypes.h> // for PRIu64
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -36,6 +37,9 @@
 MPI_Datatype mpi_dcomplex,mpi_int3,mpi_double3,mpi_dcomplex3; // combined datatypes
 int *recvcounts,*displs; // arrays of size ringid required for AllGather operations
 bool displs_init=false;  // whether arrays above are initialized
+#	ifdef SUPPORT_MPI_IALLREDUCE
+static MPI_Request ipr_request=MPI_REQUEST_NULL; // request of the non-blocking reduction (MyInnerProductStart)
+#	endif
 #endif
 
 /* whether a synchronize call should be performed before parallel timing. It makes communication timing more accurate,
@@ -265,12 +269,24 @@ void InitComm(int *argc_p UOIP,char ***argv_p UOIP)
 	 * MPICH 1.2.5, for example, just replaces corresponding parameters by NULLs. To incorporate it we introduce special
 	 * function to restore the command line
 	 */
+#	ifdef OPENMP
+	/* In hybrid mode all MPI calls are made from the master thread outside of parallel regions, so 'funneled' level of
+	 * thread support is sufficient.
+	 */
+	int thr_provided;
+	MPI_Init_thread(argc_p,argv_p,MPI_THREAD_FUNNELED,&thr_provided);
+#	else
 	MPI_Init(argc_p,argv_p);
+#	endif
 	tstart_main = GET_TIME(); // initialize program time
 	RecoverCommandLine(argc_p,argv_p);
 	// initialize ringid and nprocs
 	MPI_Comm_rank(MPI_COMM_WORLD,&ringid);
 	MPI_Comm_size(MPI_COMM_WORLD,&nprocs);
+#	ifdef OPENMP
+	if (thr_provided<MPI_THREAD_FUNNELED) LogWarning(EC_WARN,ONE_POS,"MPI library does not guarantee support of calls "
+		"from multithreaded process (level MPI_THREAD_FUNNELED). Hybrid MPI+OpenMP mode may fail.");
+#	endif
 #ifndef SPARSE
 	// initialize Ntrans
 	if (IS_EVEN(nprocs)) Ntrans=nprocs-1;
@@ -478,6 +494,50 @@ void MyInnerProduct(void * restrict data UOIP,const var_type type UOIP,size_t n
 
 //======================================================================================================================
 
+void MyInnerProductStart(void * restrict data UOIP,const var_type type UOIP,size_t n UOIP,TIME_TYPE *timing UOIP)
+/* Non-blocking analogue of MyInnerProduct. Starts the reduction of values stored in *data, the results are available
+ * only after the call to MyInnerProductWait (data should not be accessed before that). Thus, the reduction can be
+ * overlapped with computations, e.g. MatVec (which may perform its own communications in the meantime). Only one such
+ * reduction can be active at a time. 'timing' (should not be NULL) is incremented by the time used. If non-blocking
+ * collectives are not supported by MPI, the blocking reduction is performed.
+ */
+{
+#ifdef ADDA_MPI
+#	ifdef SUPPORT_MPI_IALLREDUCE
+	MPI_Datatype mes_type;
+	int mult;
+	TIME_TYPE tstart;
+
+	if (n>INT_MAX) LogError(ONE_POS,"int overflow in MPI function (%zu)",n);
+	// no synchronization here, since it would defeat the overlap
+	tstart=GET_TIME();
+	mes_type=MPIVarType(type,true,&mult);
+	n*=mult;
+	MPI_Iallreduce(MPI_IN_PLACE,data,n,mes_type,MPI_SUM,MPI_COMM_WORLD,&ipr_request);
+	(*timing)+=GET_TIME()-tstart;
+#	else
+	MyInnerProduct(data,type,n,timing);
+#	endif
+#endif
+}
+
+//======================================================================================================================
+
+void MyInnerProductWait(TIME_TYPE *timing UOIP)
+/* completes the reduction started by MyInnerProductStart; 'timing' is incremented by the time of waiting, i.e. by the
+ * part of communication, which has not been overlapped with computations
+ */
+{
+#if defined(ADDA_MPI) && defined(SUPPORT_MPI_IALLREDUCE)
+	TIME_TYPE tstart=GET_TIME();
+
+	MPI_Wait(&ipr_request,MPI_STATUS_IGNORE);
+	(*timing)+=GET_TIME()-tstart;
+#endif
+}
+
+//======================================================================================================================
+
 void ParSetup(void)
 // initialize common parameters; need to do in the beginning to enable call to MakeParticle
 {
@@ -489,6 +549,9 @@ void ParSetup(void)
 	gridX=fftFit(2*boxX,nprocs);
 	gridY=fftFit(2*boxY,1);
 	gridZ=fftFit(2*boxZ,2*nprocs);
+#	ifndef OPENCL
+	TuneGrid(); // may replace the above values by larger ones, if requested
+#	endif
 	// initialize some variables
 	smallY=gridY/2;
 	smallZ=gridZ/2;
@@ -627,11 +690,72 @@ void ReadField(const char * restrict fname,doublecomplex *restrict field)
 
 //======================================================================================================================
 
+/* Binary field file consists of a header (FLD_BIN_MAGIC and the number of dipoles as uint64_t) followed by the complex
+ * field (3 components per dipole) in the global order of dipoles. Hence, it doesn't depend on the number of processors,
+ * and each processor reads or writes only its own part of the file. However, it is not portable between machines with
+ * different endianness or representation of double.
+ *
+ * !!! fseek uses long for offsets, so files larger than 2 GB require 64-bit long
+ */
+#define FLD_BIN_MAGIC "ADDAfld" // 8 bytes, including the terminating null character
+#define FLD_BIN_HEAD (sizeof(FLD_BIN_MAGIC)+sizeof(uint64_t))
+
+void ReadFieldBin(const char * restrict fname,doublecomplex *restrict field)
+// Reads a complex field from binary file 'fname' (see above) and stores into 'field'
+{
+	char magic[sizeof(FLD_BIN_MAGIC)];
+	uint64_t n;
+	TIME_TYPE tstart=GET_TIME();
+	FILE *file=FOpenErr(fname,"rb",ALL_POS);
+
+	if (fread(magic,sizeof(magic),1,file)!=1 || fread(&n,sizeof(n),1,file)!=1
+		|| memcmp(magic,FLD_BIN_MAGIC,sizeof(magic))!=0)
+		LogError(ALL_POS,"File %s is not a binary field file (produced by '-store_int_field bin')",fname);
+	if (n!=nvoid_Ndip) LogError(ALL_POS,"Binary field file %s contains data for %"PRIu64" dipoles, while the particle "
+		"contains %zu dipoles",fname,n,nvoid_Ndip);
+	if (fseek(file,(long)(FLD_BIN_HEAD+3*local_nvoid_d0*sizeof(doublecomplex)),SEEK_SET)!=0
+		|| fread(field,sizeof(doublecomplex),local_nRows,file)!=local_nRows)
+		LogError(ALL_POS,"Failed reading from file '%s'",fname);
+	FCloseErr(file,fname,ALL_POS);
+	Timing_FileIO+=GET_TIME()-tstart;
+}
+
+//======================================================================================================================
+
+void WriteFieldBin(const char * restrict fname,const doublecomplex *restrict field)
+/* Writes a complex field to binary file 'fname' (see above). The file is created (and the header is written) by the
+ * root, afterwards all processors write their parts in place.
+ */
+{
+	FILE *file;
+	const uint64_t n=nvoid_Ndip;
+	TIME_TYPE tstart=GET_TIME();
+
+	if (IFROOT) {
+		file=FOpenErr(fname,"wb",ONE_POS);
+		if (fwrite(FLD_BIN_MAGIC,sizeof(FLD_BIN_MAGIC),1,file)!=1 || fwrite(&n,sizeof(n),1,file)!=1)
+			LogError(ONE_POS,"Failed writing to file '%s'",fname);
+		FCloseErr(file,fname,ONE_POS);
+	}
+	Synchronize(); // wait for the file to be created
+	file=FOpenErr(fname,"r+b",ALL_POS);
+	if (fseek(file,(long)(FLD_BIN_HEAD+3*local_nvoid_d0*sizeof(doublecomplex)),SEEK_SET)!=0
+		|| fwrite(field,sizeof(doublecomplex),local_nRows,file)!=local_nRows)
+		LogError(ALL_POS,"Failed writing to file '%s'",fname);
+	FCloseErr(file,fname,ALL_POS);
+	Synchronize(); // ensure that the file is complete
+	Timing_FileIO+=GET_TIME()-tstart;
+}
+
+//======================================================================================================================
+
 #ifndef SPARSE
 
-void BlockTranspose(doublecomplex * restrict X UOIP,TIME_TYPE *timing UOIP)
-/* do the data-transposition, i.e. exchange, between fftX and fftY&fftZ; specializes at Xmatrix; do 3 components in one
- * message; increments 'timing' (if not NULL) by the time used
+void BlockTranspose(void * restrict X UOIP,const size_t el_size UOIP,TIME_TYPE *timing UOIP)
+/* do the data-transposition, i.e. exchange, between fftX and fftY&fftZ; specializes at Xmatrix; do all mv_ncomp
+ * components (3 of each of nrhs right-hand sides, or 1 in lean mode) in one message; increments 'timing' (if
+ * not NULL) by the time used. el_size is the size of one element of X (complex number in double or single precision),
+ * it must be a multiple of sizeof(double)
  *
  *  !!! TODO: Although size_t is used for bufsize,etc., MPI functions take int as arguments. This limits the largest
  *  possible size to some extent. Moreover, the size of int is not really well predicted. The exact implications of this
@@ -642,7 +766,9 @@ void BlockTranspose(doublecomplex * restrict X UOIP,TIME_TYPE *timing UOIP)
 	TIME_TYPE tstart;
 	size_t bufsize,msize,posit,step,y,z;
 	int transmission,part,Xpos,Xcomp;
+	const int ncomp=mv_ncomp;
 	MPI_Status status;
+	char * restrict Xb=X;
 
 	// redundant initialization to remove warnings
 	tstart=0;
@@ -653,9 +779,9 @@ void BlockTranspose(doublecomplex * restrict X UOIP,TIME_TYPE *timing UOIP)
 #endif
 		tstart=GET_TIME();
 	}
-	step=2*local_Nx;
-	msize=local_Nx*sizeof(doublecomplex);
-	bufsize=6*local_Nz*smallY*local_Nx;
+	step=local_Nx*(el_size/sizeof(double)); // in doubles
+	msize=local_Nx*el_size;
+	bufsize=mv_ncomp*local_Nz*smallY*step;
 	if (bufsize>INT_MAX)
 		LogError(ALL_POS,"int overflow in MPI function for BT buffer (%zu)",bufsize);
 
@@ -664,8 +790,8 @@ void BlockTranspose(doublecomplex * restrict X UOIP,TIME_TYPE *timing UOIP)
 		if ((part=CalcPartner(transmission))!=nprocs) {
 			posit=0;
 			Xpos=local_Nx*part;
-			for(Xcomp=0;Xcomp<3;Xcomp++) for(z=0;z<local_Nz;z++) for(y=0;y<smallY;y++) {
-				memcpy(BT_buffer+posit,X+Xcomp*local_Nsmall+IndexBlock(Xpos,y,z,smallY),msize);
+			for(Xcomp=0;Xcomp<ncomp;Xcomp++) for(z=0;z<local_Nz;z++) for(y=0;y<smallY;y++) {
+				memcpy(BT_buffer+posit,Xb+el_size*(Xcomp*local_Nsmall+IndexBlock(Xpos,y,z,smallY)),msize);
 				posit+=step;
 			}
 
@@ -675,8 +801,8 @@ void BlockTranspose(doublecomplex * restrict X UOIP,TIME_TYPE *timing UOIP)
 
 			posit=0;
 			Xpos=local_Nx*part;
-			for(Xcomp=0;Xcomp<3;Xcomp++) for(z=0;z<local_Nz;z++) for(y=0;y<smallY;y++) {
-				memcpy(X+Xcomp*local_Nsmall+IndexBlock(Xpos,y,z,smallY),BT_rbuffer+posit,msize);
+			for(Xcomp=0;Xcomp<ncomp;Xcomp++) for(z=0;z<local_Nz;z++) for(y=0;y<smallY;y++) {
+				memcpy(Xb+el_size*(Xcomp*local_Nsmall+IndexBlock(Xpos,y,z,smallY)),BT_rbuffer+posit,msize);
 				posit+=step;
 			}
 		}
@@ -36,15 +36,19 @@ void Synchronize(void);
 double AccumulateMax(double data,double *max);
 void Accumulate(void * restrict data UOIP,const var_type type UOIP,size_t n UOIP,TIME_TYPE *timing UOIP);
 void MyInnerProduct(void * restrict data,const var_type type,size_t n,TIME_TYPE *timing);
+void MyInnerProductStart(void * restrict data,const var_type type,size_t n,TIME_TYPE *timing);
+void MyInnerProductWait(TIME_TYPE *timing);
 void InitComm(int *argc_p,char ***argv_p);
 void ParSetup(void);
 void SetupLocalD(void);
 void MyBcast(void * restrict data,const var_type type,const size_t n_elem,TIME_TYPE *timing);
 void BcastOrient(int *i,int *j,int *k);
 void ReadField(const char * restrict fname,doublecomplex *restrict field);
+void ReadFieldBin(const char * restrict fname,doublecomplex *restrict field);
+void WriteFieldBin(const char * restrict fname,const doublecomplex *restrict field);
 
 #ifndef SPARSE
-void BlockTranspose(doublecomplex * restrict X,TIME_TYPE *timing);
+void BlockTranspose(void * restrict X,size_t el_size,TIME_TYPE *timing);
 void BlockTranspose_DRm(doublecomplex * restrict X,size_t lengthY,size_t lengthZ);
 // used by granule generator
 void SetGranulComm(double z0,double z1,double gdZ,int gZ,size_t gXY,size_t buf_size,int *lz0,int *lz1,int sm_gr);
@@ -38,7 +38,7 @@ LDFLAGS  += $(LDLIBS)
 # The following are used to track whether recompilation of corresponding parts is required
 LDCMD  := $(MYCC) $(LDFLAGS)
 CCMD   := $(MYCC) $(CFLAGS)
-FCMD   := $(MYCF) $(FFLAGS)
+FCMD   := $(MYCF) $(FFLAGS) $(FOMPFLAG)
 CPPCMD := $(MYCCPP) $(CPPFLAGS)
 
 READ_FILE = $(shell if [ -f $(1) ]; then cat $(1); fi)
@@ -79,6 +79,9 @@ $(COBJECTS): %.o: %.c $(COPTSFILE)
 # all of the files from dependent set are compiled at once.
 $(FOBJECTS): %.o: %.f $(FOPTSFILE)
 	$(MYCF) -c $(FFLAGS) $<
+
+# only Temperton FFT is called from parallel regions (OpenMP), see the main Makefile
+cfft99D.o: FFLAGS += $(FOMPFLAG)
 	
 $(F90OBJECTS): %.o: %.f90 $(FOPTSFILE)
 	$(MYCF) -c $(FFLAGS) $<
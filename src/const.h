@@ -106,6 +106,10 @@
 #define MAX_NMAT         15   // maximum number of different refractive indices (<256)
 #define MAX_N_SH_PARMS   25   // maximum number of shape parameters
 #define MAX_N_BEAM_PARMS 10   // maximum number of beam parameters
+#define MAX_NRHS         2    // maximum number of right-hand sides, solved simultaneously by block iterative solvers
+#define MAX_GMRES_M      200  // maximum restart length of GMRES(m)
+#define MAX_IDR_S        16   // maximum dimension of the shadow space of IDR(s)
+#define MAX_PREC_SIZE    3    // maximum size (in dipoles) of cubical blocks of the block-Jacobi preconditioner
 
 // sizes of filenames and other strings
 /* There is MAX_PATH constant that equals 260 on Windows. However, even this OS allows ways to override this limit. On
@@ -252,8 +256,12 @@ enum iter { // iterative methods
 	IT_BCGS2,    // Enhanced Bi-Conjugate Gradient Stabilized (2)
 	IT_BICG_CS,  // Bi-Conjugate Gradient for Complex-Symmetric matrices
 	IT_BICGSTAB, // Bi-Conjugate Gradient Stabilized
+	IT_BICGSTAB_B, // Block Bi-Conjugate Gradient Stabilized (both incident polarizations at once)
 	IT_CGNR,     // Conjugate Gradient for Normalized equations minimizing Residual norm
 	IT_CSYM,     // Algorithm CSYM
+	IT_GMRES,    // Generalized Minimal Residual, restarted after m iterations
+	IT_IDR,      // Induced Dimension Reduction (s), bi-orthogonal variant
+	IT_PBICGSTAB, // Pipelined Bi-Conjugate Gradient Stabilized (reductions are overlapped with MatVec)
 	IT_QMR_CS,   // Quasi-minimal residual for Complex-Symmetric matrices
 	IT_QMR_CS_2  // 2-term QMR (better roundoff properties)
 	/* TO ADD NEW ITERATIVE SOLVER
@@ -261,6 +269,11 @@ enum iter { // iterative methods
 	 */
 };
 
+enum prec { // preconditioners of the iterative solver
+	PREC_NONE,   // no preconditioner
+	PREC_BJACOBI // near-field block-Jacobi (inverse of the interaction matrix restricted to small cubes of dipoles)
+};
+
 enum Eftype { // type of E field calculation
 	CE_NORMAL, // normal
 	CE_PARPER  // use symmetry to calculate both incident polarizations from one calculation of internal fields
@@ -323,7 +336,17 @@ enum init_field { // how to calculate initial field to be used in the iterative
 	IF_ZERO, // zero
 	IF_INC,  // equal to incident field
 	IF_READ, // read from file
-	IF_WKB   // from WKB approximation (incident field corrected for phase shift in the particle)
+	IF_FILE, // read from binary file (saved by '-store_int_field bin')
+	IF_WKB,  // from WKB approximation (incident field corrected for phase shift in the particle)
+	IF_PREV, // internal field from the previous orientation (for the same polarization)
+	IF_PREV_INC // PREV corrected for the change of the incident field
+};
+
+enum fftplan { // level of planning for FFTW3 plans used in MatVec (corresponds to FFTW planner flags)
+	FP_ESTIMATE,  // heuristics, no measurements
+	FP_MEASURE,   // measure a few candidate plans
+	FP_PATIENT,   // measure many more candidate plans
+	FP_EXHAUSTIVE // measure all possible plans
 };
 
 // return values for functions
@@ -349,6 +372,7 @@ enum init_field { // how to calculate initial field to be used in the iterative
 	// suffixes
 #define F_XSUF          "-X"
 #define F_YSUF          "-Y"
+#define F_BINSUF        ".bin"
 	// logs
 #define F_LOG           "log"
 #define F_LOG_ERR       "logerr.%d"    // ringid as argument
@@ -21,17 +21,36 @@
 #include "cmplx.h"
 #include "comm.h"
 #include "debug.h"
+#include "fft_ops.h"
 #include "function.h"
 #include "io.h"
 #include "interaction.h"
 #include "memory.h"
 #include "oclcore.h"
+#include "ooc.h"
+#include "os.h"
 #include "prec_time.h"
 #include "vars.h"
 // system headers
+#include <inttypes.h> // for PRIx64
 #include <math.h>
+#include <stdint.h> // for uint64_t
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef OPENMP
+#	include <omp.h>
+#endif
+#if !defined(OPENCL) && defined(POSIX) // for mapping of Dmatrix cache
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	define DMC_MMAP
+#endif
+#ifdef __AVX__
+#	include <immintrin.h>
+#endif
 
 #ifdef CLFFT_AMD
 	IGNORE_WARNING(-Wstrict-prototypes) // no way to change the library header
@@ -45,16 +64,22 @@
 #		error "Apple clFFT relies on C++ sources, hence is incompatible with NO_CPP option"
 #	endif
 #endif
-/* standard FFT routines (FFTW3 of FFT_TEMPERTON) are required even when OpenCL is used, since they are used for Fourier
- * transform of the D-matrix
+/* standard FFT routines (FFTW3, FFT_TEMPERTON, or FFT_BUILTIN) are required even when OpenCL is used, since they are
+ * used for Fourier transform of the D-matrix
  */
 #ifdef FFTW3
 #	include <fftw3.h> // types.h or cmplx.h should be defined before (to match C99 complex type)
-/* define level of planning for usual and Dmatrix (DM) FFT: FFTW_ESTIMATE (heuristics), FFTW_MEASURE (default),
- * FTW_PATIENT, or FFTW_EXHAUSTIVE
+/* define level of planning for Dmatrix (DM) FFT: FFTW_ESTIMATE (heuristics), FFTW_MEASURE, FFTW_PATIENT, or
+ * FFTW_EXHAUSTIVE. Level for usual (MatVec) FFT is set by command line option -fft_plan
  */
-#	define PLAN_FFTW FFTW_MEASURE
 #	define PLAN_FFTW_DM FFTW_ESTIMATE
+#	ifdef FFTW_THREADS
+#		define FFTW_CLEANUP() fftw_cleanup_threads()
+#		define FFTWF_CLEANUP() fftwf_cleanup_threads()
+#	else
+#		define FFTW_CLEANUP() fftw_cleanup()
+#		define FFTWF_CLEANUP() fftwf_cleanup()
+#	endif
 #	define ONLY_FOR_FFTW3 // this is used in function argument declarations
 #else
 #	define ONLY_FOR_FFTW3 ATT_UNUSED
@@ -65,25 +90,99 @@
 #else
 #	define ONLY_FOR_TEMPERTON ATT_UNUSED
 #endif
+#ifdef FFT_BUILTIN
+#	include "fft_builtin.h"
+#endif
+
+#ifdef OPENCL
+#	define ONLY_FOR_CPU ATT_UNUSED
+#else
+#	define ONLY_FOR_CPU // this is used in function argument declarations
+#endif
+#ifdef OOC
+#	define ONLY_FOR_OOC // this is used in function argument declarations
+#else
+#	define ONLY_FOR_OOC ATT_UNUSED
+#endif
+
+#ifdef OPENMP
+#	define THREAD_ID ((size_t)omp_get_thread_num())
+#else
+#	define THREAD_ID 0
+#endif
+/* Without multithreaded FFTW3 plans, fftX is parallelized by executing single-plane plans for different z-planes in
+ * parallel. Otherwise, a single (multithreaded) plan for the whole Xmatrix is used.
+ */
+#if defined(OPENMP) && !(defined(FFTW3) && defined(FFTW_THREADS))
+#	define FFTX_BY_PLANES
+#endif
+/* size of square tiles (in complex numbers) used in transpose; 2 tiles of 32x32 elements take 32 kB, i.e. fit into
+ * typical L1 data cache. Should be even, so that only the last tiles may have odd sizes
+ */
+#define TR_BLOCK 32
+/* size of the header of the cache files for Dmatrix (in bytes), it contains the text description of all the parameters,
+ * which define Dmatrix and Rmatrix. It is a multiple of the page size (on most systems), so the data is well aligned
+ */
+#define DMC_HEADER 4096
+/* parameters of time measurements for auto-tuning of FFT grid: number of elements in test arrays (16 MB for interaction
+ * matrix in TimeArith) and minimum duration of each measurement (in seconds)
+ */
+#define TUNE_BATCH 65536
+#define TUNE_TIME 0.02
 
 // SEMI-GLOBAL VARIABLES
 
 // defined and initialized in interaction.c
 extern const int local_Nz_Rm;
+// defined and initialized in make_particle.c
+extern const double ZsumShift;
+// defined and initialized in param.c
+extern const double igt_lim,igt_eps,nloc_Rp;
+extern const char *dmatrix_cache_dir;
+extern const int grid_tune;
+extern const bool ooc_Dm;
+#if defined(FFTW3) && !defined(OPENCL)
+// defined and initialized in param.c
+extern const enum fftplan fft_plan;
+extern const char *fft_wisdom_fname;
+#endif
+#ifdef MIXED_PREC
+// defined and initialized in param.c
+extern const bool mixed_prec;
+#endif
 // defined and initialized in timing.c
 extern TIME_TYPE Timing_FFT_Init,Timing_Dm_Init;
 
 // used in comm.c
 double * restrict BT_buffer, * restrict BT_rbuffer; // buffers for BlockTranspose
+#ifndef OPENCL
+// used in calculator.c; both are zero unless lean mode is used (see InitDmatrix)
+double memLean;   // decrease of memory usage after the initialization of Dmatrix due to lean mode
+double memPeakDm; // memory peak during the initialization of Dmatrix
+#endif
 // used in matvec.c; in OpenCL mode some of those are not used at all, others - only locally
 doublecomplex * restrict Dmatrix; // holds FFT of the interaction matrix
 doublecomplex * restrict Rmatrix; // holds FFT of the reflection matrix
 #ifndef OPENCL
 	// holds input vector (on expanded grid) to matvec, also used as storage space in iterative.c
 doublecomplex * restrict Xmatrix;
-doublecomplex * restrict slices; // used in inner cycle of matvec - holds 3 components (for fixed x)
+/* slices are used in inner cycle of matvec - each holds 3 components (for fixed x) of each of nrhs right-hand sides,
+ * or a single component in lean mode (mv_ncomp in total). There is a separate batch of slice_batch slices
+ * (each of size mv_ncomp*gridYZ) for each thread, the one for thread th starts at index th*slice_batch*mv_ncomp*gridYZ.
+ * FFTs and transposes always process the whole batch.
+ */
+doublecomplex * restrict slices;
 doublecomplex * restrict slices_tr; // additional storage space for slices to accelerate transpose
-doublecomplex * restrict slicesR,* restrict slicesR_tr; // same as above, but for reflected interaction
+/* precomputed indices for MatVec: Xindex - position of each local non-void dipole in Xmatrix, garbledYZ - position of
+ * each (y,z) with y<boxY and z<boxZ (for x=local_x0) in Xmatrix after BlockTranspose (see IndexGarbledX in matvec.c)
+ */
+size_t * restrict Xindex,* restrict garbledYZ;
+#	ifdef MIXED_PREC
+/* the same arrays (Xmatrix, slices, and slices_tr) used as arrays of floatcomplex in single-precision MatVec, with the
+ * same indexing (i.e. only the first half of allocated memory is used)
+ */
+floatcomplex * restrict Xmatrix_sp,* restrict slices_sp,* restrict slices_tr_sp;
+#	endif
 #endif
 size_t DsizeY,DsizeZ,DsizeYZ; // size of the 'matrix' D
 size_t RsizeY; // size of the 'matrix' R; in OpenCL mode it is used in oclmatvec.c
@@ -109,6 +208,47 @@ static size_t lz_Dm,lz_Rm; // local sizes along z for D(2) and R(2) matrices
 static size_t Rsize,R2sizeTot; // sizes of R and R2 matrices
 static int jstartR;            // starting index for y
 static bool weird_nprocs;      // whether weird number of processors is used
+#ifndef OPENCL
+/* twiddle factors exp(-2*pi*i*y/gridY) for y<boxY; used in fftY, which is split into two transforms of size smallY (see
+ * comments before PrepareHalvesY)
+ */
+static doublecomplex * restrict twiddleY;
+/* description of rows of Dmatrix and Rmatrix for the product in MatVec (see fft_ops.h), the second one is for
+ * transposed matrices (used only for G_SO); posY, posYT, and sgnY are the corresponding arrays of indices and signs
+ */
+static struct rowMult rowDR,rowDR_T;
+static size_t * restrict posY,* restrict posYT;
+static double * restrict sgnY;
+static rowMultFunc RowMult; // kernel for the product, selected at runtime
+// cache of Dmatrix and Rmatrix in a file (see OpenDmatrixCache)
+static char *dmcName; // name of the cache file (NULL if cache is not used)
+static size_t dmcSize; // total size of the cache file (in bytes)
+#	ifdef DMC_MMAP
+static void *dmcMap; // memory-mapped cache file
+#	endif
+#endif
+static bool Dm_cached; // whether Dmatrix and Rmatrix are loaded from the cache (always false in OpenCL mode)
+#if defined(OOC) && !defined(OPENCL)
+/* out-of-core mode (see DmStageLoad): Dmatrix and Rmatrix point into one of the buffers, which contains the rows for
+ * oocNx x-slices starting from local x oocX0 (a stage), while the other buffer is being filled by the reader thread.
+ * In lean mode each buffer holds a single component of the matrices
+ */
+static doublecomplex * restrict oocBuf[OOC_NBUF];
+static struct oocChunk * restrict oocChunks[OOC_NBUF]; // chunks of the file for the requests (see RequestStage)
+static size_t oocTag[OOC_NBUF]; // contents of each buffer (see StageTag), SIZE_MAX - empty
+static size_t oocNx;            // number of x-slices in a stage
+static size_t oocNst;           // number of stages
+static size_t oocX0;            // starting local x of the current stage
+static size_t oocNpl;           // number of planes (components) in each buffer
+static int oocNbuf;             // number of used buffers
+static int oocCur;              // buffer of the current stage
+#endif
+#ifdef MIXED_PREC
+// single-precision copies of Dmatrix, Rmatrix, and twiddleY for mixed-precision MatVec
+static floatcomplex * restrict Dmatrix_sp,* restrict Rmatrix_sp,* restrict twiddleY_sp;
+// single-precision FFTW3 plans, analogous to the double-precision ones below
+static fftwf_plan planXf_sp,planXb_sp,planYf_sp,planYb_sp,planZf_sp,planZb_sp;
+#endif
 
 #ifdef OPENCL
 // clFFT plans
@@ -123,7 +263,7 @@ static clFFT_Plan clplanX,clplanY,clplanZ;
 // FFTW3 plans: f - FFT_FORWARD; b - FFT_BACKWARD
 static fftw_plan planXf_Dm,planYf_slice,planZf_slice,planXf_Rm;
 #	ifndef OPENCL // these plans are used only if OpenCL is not used
-static fftw_plan planXf,planXb,planYf,planYb,planZf,planZb,planYRf,planZRf; // last two for reflected interaction
+static fftw_plan planXf,planXb,planYf,planYb,planZf,planZb;
 #	endif
 #elif defined(FFT_TEMPERTON)
 #	ifdef NO_FORTRAN
@@ -132,21 +272,74 @@ static fftw_plan planXf,planXb,planYf,planYb,planZf,planZb,planYRf,planZRf; // l
 #	define IFAX_SIZE 20
 // arrays for Temperton FFT
 static double * restrict trigsX,* restrict trigsY,* restrict trigsZ,* restrict work;
+static size_t work_size; // size of work for a single thread; the one for thread th starts at index th*work_size
 static int ifaxX[IFAX_SIZE],ifaxY[IFAX_SIZE],ifaxZ[IFAX_SIZE];
+#	ifndef OPENCL
+static double * restrict trigsYh; // for transforms of length smallY in fftY
+static int ifaxYh[IFAX_SIZE];
+#	endif
 // Fortran routines from cfft99D.f
 void cftfax_(const int *nn,int * restrict ifax,double * restrict trigs);
 void cfft99_(double * restrict data,double * restrict _work,const double * restrict trigs,const int * restrict ifax,
 	const int *inc,const int *jump,const int *nn,const int *lot,const int *isign);
+#elif defined(FFT_BUILTIN)
+// plans and tables of twiddle factors for built-in FFT
+static struct fftbPlan planX,planY,planZ;
+static doublecomplex * restrict twX,* restrict twY,* restrict twZ,* restrict work;
+static size_t work_size; // size of work for a single thread; the one for thread th starts at index th*work_size
+#	ifndef OPENCL
+static struct fftbPlan planYh; // for transforms of length smallY in fftY
+static doublecomplex * restrict twYh;
+#	endif
 #endif
 
 //======================================================================================================================
 
-static inline size_t IndexDmatrix(const size_t x,size_t y,size_t z)
-// index D matrix to store final result (symmetric with respect to center for y and z)
+#ifndef OPENCL
+static inline size_t StoredY(const size_t y)
+/* position of frequency y (y<DsizeY) along the y-axis of Dmatrix and Rmatrix: first all even and then all odd
+ * frequencies, which corresponds to the order in slices_tr after pruned fftY (see PrepareHalvesY). Then rows of
+ * matrices are traversed mostly sequentially in MatVec
+ */
+{
+	return (y%2==0) ? y/2 : (DsizeY+1)/2+y/2;
+}
+
+//======================================================================================================================
+
+static inline size_t FreqY(const size_t y)
+// frequency index along y, corresponding to index y in slices_tr after pruned fftY (first even, then odd frequencies)
+{
+	return (y<smallY) ? 2*y : 2*(y-smallY)+1;
+}
+#endif // !OPENCL
+
+//======================================================================================================================
+
+static inline size_t IndexComp(const size_t ind,const size_t comp,const size_t plane)
+/* index of component comp of ind-th element in D or R matrix. On CPU the components are stored as separate planes of
+ * size plane (to vectorize the product in MatVec), while OpenCL kernels use interleaved components. The same layout is
+ * used for the values of Green's tensor, which are temporarily stored in these matrices before the FFT
+ */
+{
+#ifdef OPENCL
+	return NDCOMP*ind+comp;
+#else
+	return comp*plane+ind;
+#endif
+}
+
+//======================================================================================================================
+
+static inline size_t IndexDmatrix(const size_t x,size_t y,size_t z,const size_t comp)
+// index D matrix to store final result (symmetric with respect to center for y and z); comp is index of component
 {
 	if (y>=DsizeY) y=gridY-y;
 	if (z>=DsizeZ) z=gridZ-z;
-	return(NDCOMP*((x*DsizeZ+z)*DsizeY+y));
+#ifndef OPENCL
+	y=StoredY(y);
+#endif
+	return IndexComp((x*DsizeZ+z)*DsizeY+y,comp,local_Nx*DsizeYZ);
 }
 
 //======================================================================================================================
@@ -193,11 +386,14 @@ static inline size_t IndexSlice_zy(const size_t y,const size_t z)
 
 //======================================================================================================================
 
-static inline size_t IndexRmatrix(const size_t x,size_t y,const size_t z)
-// index R matrix to store final result (symmetric with respect to center for y)
+static inline size_t IndexRmatrix(const size_t x,size_t y,const size_t z,const size_t comp)
+// index R matrix to store final result (symmetric with respect to center for y); comp is index of component
 {
 	if (y>=RsizeY) y=gridY-y;
-	return(NDCOMP*((x*gridZ+z)*RsizeY+y));
+#ifndef OPENCL
+	y=StoredY(y); // RsizeY=DsizeY
+#endif
+	return IndexComp((x*gridZ+z)*RsizeY+y,comp,local_Nx*gridZ*RsizeY);
 }
 
 //======================================================================================================================
@@ -224,56 +420,86 @@ static inline size_t IndexSliceR2matrix(int y,const int z)
 
 //======================================================================================================================
 
-static void transpose(const doublecomplex * restrict data,doublecomplex * restrict trans,const size_t Y,const size_t Z)
-// optimized routine to transpose complex matrix with dimensions YxZ: data -> trans
+static inline void transposeTile(const doublecomplex * restrict data,doublecomplex * restrict trans,const size_t Y,
+	const size_t Z,const size_t ldd,const size_t ldt)
+/* transposes a block of YxZ elements, which is small enough to reside in L1 cache; arguments are the same as for
+ * transpose(). The main part is processed by 2x2 blocks - two complex numbers (adjacent in memory) are read from each
+ * of two rows of data and written to each of two rows of trans. With AVX each such pair is moved by a single 256-bit
+ * load or store, the blocks are transposed by exchanging 128-bit lanes.
+ */
 {
-	size_t y,z,y1,y2,z1,z2,i,j,y0,z0;
-	doublecomplex *t1,*t2,*t3,*t4;
-	const doublecomplex *w1,*w2,*w3;
-	const size_t blockTr=64; // block size
-	/* Intel compiler 11.1 seems to produce broken code for this function whenever blockTr>1, at least when the function
-	 * is called in row of three from TransposeYZ(). So maybe the bug is due to incorrect inlining. This bug appears
-	 * only for -O3 compilation, but not for -O2. Moreover, the bug is not present for icc 13.0.
-	 * We have no idea what can be done on our side.
-	 */
+	size_t y,z;
+	const size_t Y2=Y&~(size_t)1,Z2=Z&~(size_t)1; // even parts of Y and Z
+	const doublecomplex *w0,*w1;
+	doublecomplex *t0,*t1;
+#ifdef __AVX__
+	__m256d r0,r1;
+#elif defined(USE_SSE3)
+	__m128d a00,a01,a10,a11;
+#endif
 
-	y1=Y/blockTr;
-	y2=Y%blockTr;
-	z1=Z/blockTr;
-	z2=Z%blockTr;
-
-	w1=data;
-	t1=trans-Y;
-
-	for(i=0;i<=y1;i++) {
-		if (i==y1) y0=y2;
-		else y0=blockTr;
-		w2=w1;
-		t2=t1;
-		for(j=0;j<=z1;j++) {
-			if (j==z1) z0=z2;
-			else z0=blockTr;
-			w3=w2;
-			t3=t2;
-			for (y=0;y<y0;y++) {
-				t4=t3+y;
-				for (z=0;z<z0;z++) *(t4+=Y)=w3[z];
-				w3+=Z;
-			}
-			w2+=blockTr;
-			t2+=blockTr*Y;
+	IGNORE_WARNING(-Wstrict-aliasing); // casts from doublecomplex to double pointers are valid in C99 (see fftX)
+	for (y=0;y<Y2;y+=2) {
+		w0=data+y*ldd;
+		w1=w0+ldd;
+		t0=trans+y;
+		for (z=0;z<Z2;z+=2) {
+			t1=t0+ldt;
+#ifdef __AVX__
+			r0=_mm256_loadu_pd((const double *)(w0+z));
+			r1=_mm256_loadu_pd((const double *)(w1+z));
+			_mm256_storeu_pd((double *)t0,_mm256_permute2f128_pd(r0,r1,0x20));
+			_mm256_storeu_pd((double *)t1,_mm256_permute2f128_pd(r0,r1,0x31));
+#elif defined(USE_SSE3)
+			a00=_mm_loadu_pd((const double *)(w0+z));
+			a01=_mm_loadu_pd((const double *)(w0+z+1));
+			a10=_mm_loadu_pd((const double *)(w1+z));
+			a11=_mm_loadu_pd((const double *)(w1+z+1));
+			_mm_storeu_pd((double *)t0,a00);
+			_mm_storeu_pd((double *)(t0+1),a10);
+			_mm_storeu_pd((double *)t1,a01);
+			_mm_storeu_pd((double *)(t1+1),a11);
+#else
+			t0[0]=w0[z];
+			t0[1]=w1[z];
+			t1[0]=w0[z+1];
+			t1[1]=w1[z+1];
+#endif
+			t0=t1+ldt;
+		}
+		if (Z2<Z) {
+			t0[0]=w0[Z2];
+			t0[1]=w1[Z2];
 		}
-		w1+=blockTr*Z;
-		t1+=blockTr;
 	}
+	STOP_IGNORE;
+	if (Y2<Y) for (z=0;z<Z;z++) trans[z*ldt+Y2]=data[Y2*ldd+z];
 }
 
 //======================================================================================================================
 
-void TransposeYZ(const int direction)
+static void transpose(const doublecomplex * restrict data,doublecomplex * restrict trans,const size_t Y,const size_t Z,
+	const size_t ldd,const size_t ldt)
+/* optimized routine to transpose complex matrix with dimensions YxZ: data -> trans; ldd and ldt are leading dimensions
+ * (distances between rows) of data and trans (in the latter rows are along Y), i.e. they are Z and Y for full matrices.
+ * The matrix is processed by square tiles of size TR_BLOCK, so that both the source and the destination tiles fit into
+ * L1 cache. Tiles are traversed along the rows of data, so that the reads are sequential.
+ */
+{
+	size_t y,z;
+
+	for (y=0;y<Y;y+=TR_BLOCK) for (z=0;z<Z;z+=TR_BLOCK)
+		transposeTile(data+y*ldd+z,trans+z*ldt+y,MIN(TR_BLOCK,Y-y),MIN(TR_BLOCK,Z-z),ldd,ldt);
+}
+
+//======================================================================================================================
+
+void TransposeYZ(const int direction,const size_t th ONLY_FOR_CPU)
 /* optimized routine to transpose y and z; forward: slices->slices_tr; backward: slices_tr->slices; direction can be
  * made boolean but this contradicts with existing definitions of FFT_FORWARD and FFT_BACKWARD, which themselves are
- * determined by FFT routines invocation format
+ * determined by FFT routines invocation format. th is the index of thread (slices), ignored in OpenCL mode.
+ * On CPU only the part y<boxY is transposed (in both directions), since the rest is either zero (forward) or not needed
+ * (backward). Slices_tr for boxY<=y<gridY are filled later by fftY.
  */
 {
 #ifdef OPENCL
@@ -298,15 +524,16 @@ void TransposeYZ(const int direction)
 	else CL_CH_ERR(clEnqueueNDRangeKernel(command_queue,cltransposeob,3,NULL,enqtglobalyz,tblock,0,NULL,NULL));
 #else
 	size_t Xcomp,ind;
+	const size_t sh=th*slice_batch*mv_ncomp*gridYZ; // shift for slices of the given thread
+	const size_t ncomp=(size_t)mv_ncomp*slice_batch; // total number of components in the batch of slices
 
-	if (direction==FFT_FORWARD) for (Xcomp=0;Xcomp<3;Xcomp++) {
-		ind=Xcomp*gridYZ;
-		transpose(slices+ind,slices_tr+ind,gridY,gridZ);
-		if (surface) transpose(slicesR+ind,slicesR_tr+ind,gridY,gridZ);
+	if (direction==FFT_FORWARD) for (Xcomp=0;Xcomp<ncomp;Xcomp++) {
+		ind=sh+Xcomp*gridYZ;
+		transpose(slices+ind,slices_tr+ind,boxY,gridZ,gridZ,gridY);
 	}
-	else for (Xcomp=0;Xcomp<3;Xcomp++) { // direction==FFT_BACKWARD
-		ind=Xcomp*gridYZ;
-		transpose(slices_tr+ind,slices+ind,gridZ,gridY);
+	else for (Xcomp=0;Xcomp<ncomp;Xcomp++) { // direction==FFT_BACKWARD
+		ind=sh+Xcomp*gridYZ;
+		transpose(slices_tr+ind,slices+ind,gridZ,boxY,gridY,gridZ);
 	}
 #endif
 }
@@ -314,7 +541,7 @@ void TransposeYZ(const int direction)
 //======================================================================================================================
 
 void fftX(const int isign)
-// FFT three components of (buf)Xmatrix(x) for all y,z; called from matvec
+// FFT three components of (buf)Xmatrix(x) for all y,z; called from matvec; uses nthreads threads (when OPENMP)
 {
 #ifdef OPENCL
 #	ifdef CLFFT_AMD
@@ -325,10 +552,20 @@ void fftX(const int isign)
 		bufXmatrix,0,NULL,NULL));
 #	endif
 #elif defined(FFTW3)
+#	ifdef FFTX_BY_PLANES // plans are for a single z-plane (of one component), executed by all threads in parallel
+	const fftw_plan plan=(isign==FFT_FORWARD) ? planXf : planXb;
+	const size_t zlim=mv_ncomp*local_Nz;
+	size_t z;
+
+#		pragma omp parallel for num_threads(nthreads) schedule(static)
+	for (z=0;z<zlim;z++) fftw_execute_dft(plan,Xmatrix+z*gridX*smallY,Xmatrix+z*gridX*smallY);
+#	else
 	if (isign==FFT_FORWARD) fftw_execute(planXf);
 	else fftw_execute(planXb);
+#	endif
 #elif defined(FFT_TEMPERTON)
 	int nn=gridX,inc=1,jump=nn,lot=boxY;
+	const size_t zlim=mv_ncomp*local_Nz;
 	size_t z;
 	/* Calls to Temperton FFT cause warnings for translation from doublecomplex to double pointers. However, such a cast
 	 * is perfectly valid in C99. So we set pragmas to remove these warnings.
@@ -337,15 +574,76 @@ void fftX(const int isign)
 	 * respects. This is also reasonable considering future switch to tgmath.h
 	 */
 	IGNORE_WARNING(-Wstrict-aliasing);
-	for (z=0;z<3*local_Nz;z++) cfft99_((double *)(Xmatrix+z*gridX*smallY),work,trigsX,ifaxX,&inc,&jump,&nn,&lot,&isign);
+#	ifdef OPENMP
+#		pragma omp parallel for num_threads(nthreads) schedule(static)
+#	endif
+	for (z=0;z<zlim;z++) cfft99_((double *)(Xmatrix+z*gridX*smallY),work+THREAD_ID*work_size,trigsX,ifaxX,&inc,&jump,
+		&nn,&lot,&isign);
 	STOP_IGNORE;
+#elif defined(FFT_BUILTIN)
+	const size_t zlim=mv_ncomp*local_Nz;
+	size_t z;
+
+#	ifdef OPENMP
+#		pragma omp parallel for num_threads(nthreads) schedule(static)
+#	endif
+	for (z=0;z<zlim;z++) fftbExec(&planX,Xmatrix+z*gridX*smallY,gridX,boxY,isign,work+THREAD_ID*work_size);
 #endif
 }
 
 //======================================================================================================================
 
-void fftY(const int isign)
-// FFT three components of slices_tr(y) for all z; called from matvec
+#ifndef OPENCL
+/* Pruned fftY. Input lines (along y) are nonzero only for y<boxY<=smallY=gridY/2, while only the same part of output is
+ * needed after the backward transform. Hence, the first step of decimation in time is performed explicitly - the
+ * transform of length gridY is split into two transforms of length smallY, applied to the halves of each line:
+ * forward:  F[2k]=FFT(a)[k], F[2k+1]=FFT(a*w)[k], where w[y]=exp(-2*pi*i*y/gridY), y<smallY;
+ * backward: a[y]=FFT(F[2k])[y]+conj(w[y])*FFT(F[2k+1])[y], computed only for y<boxY.
+ * So in frequency domain each line of slices_tr contains first even and then odd frequencies, which is accounted for by
+ * matvec.c when multiplying with Dmatrix (see FreqY there). This saves part of the operations of full transforms and
+ * half of the work on the combination (output pruning).
+ */
+
+static void PrepareHalvesY(doublecomplex * restrict data)
+// prepares 3*gridZ*slice_batch lines of data (slices_tr of a thread) for forward transforms of length smallY
+{
+	size_t line,y;
+	doublecomplex * restrict a;
+	const size_t bY=boxY;
+	const size_t nlines=mv_ncomp*gridZ*slice_batch;
+
+	for (line=0;line<nlines;line++) {
+		a=data+line*gridY;
+		for (y=0;y<bY;y++) a[smallY+y]=a[y]*twiddleY[y];
+		for (;y<smallY;y++) a[y]=a[smallY+y]=0;
+	}
+}
+
+//======================================================================================================================
+
+static void CombineHalvesY(doublecomplex * restrict data)
+/* combines results of backward transforms of length smallY (in 3*gridZ*slice_batch lines of data) into needed values
+ * for y<boxY
+ */
+{
+	size_t line,y;
+	doublecomplex * restrict a;
+	const size_t bY=boxY;
+	const size_t nlines=mv_ncomp*gridZ*slice_batch;
+
+	for (line=0;line<nlines;line++) {
+		a=data+line*gridY;
+		for (y=0;y<bY;y++) a[y]+=conj(twiddleY[y])*a[smallY+y];
+	}
+}
+#endif
+
+//======================================================================================================================
+
+void fftY(const int isign,const size_t th ONLY_FOR_CPU)
+/* FFT three components of slices_tr(y) for all z; called from matvec; th is the index of thread (slices). On CPU the
+ * transform is pruned (see comments before PrepareHalvesY), so the frequencies are reordered.
+ */
 {
 #ifdef OPENCL
 #	ifdef CLFFT_AMD
@@ -362,26 +660,51 @@ void fftY(const int isign)
 			bufslicesR_tr,bufslicesR_tr,0,NULL,NULL));
 #	endif
 #elif defined(FFTW3)
+	// plans are created for slices of the first thread, but new-array execute is thread-safe
+	const size_t sh=th*slice_batch*mv_ncomp*gridYZ;
 	if (isign==FFT_FORWARD) {
-		fftw_execute(planYf);
-		if (surface) fftw_execute(planYRf);
+		PrepareHalvesY(slices_tr+sh);
+		fftw_execute_dft(planYf,slices_tr+sh,slices_tr+sh);
+	}
+	else {
+		fftw_execute_dft(planYb,slices_tr+sh,slices_tr+sh);
+		CombineHalvesY(slices_tr+sh);
 	}
-	else fftw_execute(planYb);
 #elif defined(FFT_TEMPERTON)
-	int nn=gridY,inc=1,jump=nn,lot=3*gridZ;
+	int nn=smallY,inc=1,jump=nn,lot=2*mv_ncomp*gridZ*slice_batch; // two halves of each line are transformed separately
+	const size_t sh=th*slice_batch*mv_ncomp*gridYZ;
+	double * restrict wrk=work+th*work_size;
 
 	IGNORE_WARNING(-Wstrict-aliasing);
-	cfft99_((double *)(slices_tr),work,trigsY,ifaxY,&inc,&jump,&nn,&lot,&isign);
-	// the same operation is applied to sliceR_tr, when required
-	if (surface && isign==FFT_FORWARD) cfft99_((double *)(slicesR_tr),work,trigsY,ifaxY,&inc,&jump,&nn,&lot,&isign);
+	if (isign==FFT_FORWARD) {
+		PrepareHalvesY(slices_tr+sh);
+		// transform of length 1 is trivial, while cfft99 does not support it
+		if (nn>1) cfft99_((double *)(slices_tr+sh),wrk,trigsYh,ifaxYh,&inc,&jump,&nn,&lot,&isign);
+	}
+	else {
+		if (nn>1) cfft99_((double *)(slices_tr+sh),wrk,trigsYh,ifaxYh,&inc,&jump,&nn,&lot,&isign);
+		CombineHalvesY(slices_tr+sh);
+	}
 	STOP_IGNORE;
+#elif defined(FFT_BUILTIN)
+	const size_t lot=2*mv_ncomp*gridZ*slice_batch; // two halves of each line are transformed separately
+	const size_t sh=th*slice_batch*mv_ncomp*gridYZ;
+
+	if (isign==FFT_FORWARD) {
+		PrepareHalvesY(slices_tr+sh);
+		fftbExec(&planYh,slices_tr+sh,smallY,lot,isign,work+th*work_size);
+	}
+	else {
+		fftbExec(&planYh,slices_tr+sh,smallY,lot,isign,work+th*work_size);
+		CombineHalvesY(slices_tr+sh);
+	}
 #endif
 }
 
 //======================================================================================================================
 
-void fftZ(const int isign)
-// FFT three components of slices(z) for all y; called from matvec
+void fftZ(const int isign,const size_t th ONLY_FOR_CPU)
+// FFT three components of slices(z) for all y; called from matvec; th is the index of thread (slices)
 {
 #ifdef OPENCL
 #	ifdef CLFFT_AMD
@@ -398,27 +721,331 @@ void fftZ(const int isign)
 			bufslicesR,bufslicesR,0,NULL,NULL));
 #	endif
 #elif defined(FFTW3)
-	if (isign==FFT_FORWARD) {
-		fftw_execute(planZf);
-		if (surface) fftw_execute(planZRf);
-	}
-	else fftw_execute(planZb);
+	const size_t sh=th*slice_batch*mv_ncomp*gridYZ;
+	if (isign==FFT_FORWARD) fftw_execute_dft(planZf,slices+sh,slices+sh);
+	else fftw_execute_dft(planZb,slices+sh,slices+sh);
 #elif defined(FFT_TEMPERTON)
 	int nn=gridZ,inc=1,jump=nn,lot=boxY,Xcomp;
+	const int ncomp=mv_ncomp*slice_batch; // total number of components in the batch of slices
+	const size_t sh=th*slice_batch*mv_ncomp*gridYZ;
+	double * restrict wrk=work+th*work_size;
 
 	IGNORE_WARNING(-Wstrict-aliasing);
-	for (Xcomp=0;Xcomp<3;Xcomp++) cfft99_((double *)(slices+gridYZ*Xcomp),work,trigsZ,ifaxZ,&inc,&jump,&nn,&lot,&isign);
-	if (surface && isign==FFT_FORWARD) { // the same operation is applied to slicesR, but with inverse transform
-		const int invSign=FFT_BACKWARD;
-		for (Xcomp=0;Xcomp<3;Xcomp++)
-			cfft99_((double *)(slicesR+gridYZ*Xcomp),work,trigsZ,ifaxZ,&inc,&jump,&nn,&lot,&invSign);
-	}
+	for (Xcomp=0;Xcomp<ncomp;Xcomp++)
+		cfft99_((double *)(slices+sh+gridYZ*Xcomp),wrk,trigsZ,ifaxZ,&inc,&jump,&nn,&lot,&isign);
 	STOP_IGNORE;
+#elif defined(FFT_BUILTIN)
+	size_t Xcomp;
+	const size_t ncomp=mv_ncomp*slice_batch; // total number of components in the batch of slices
+	const size_t sh=th*slice_batch*mv_ncomp*gridYZ;
+
+	// only the first boxY lines of each component are nonzero
+	for (Xcomp=0;Xcomp<ncomp;Xcomp++) fftbExec(&planZ,slices+sh+gridYZ*Xcomp,gridZ,boxY,isign,work+th*work_size);
 #endif
 }
 
 //======================================================================================================================
 
+#ifndef OPENCL
+static inline const struct rowMult *RowDR(const size_t x,const size_t z,const bool transposed,size_t * restrict offD,
+	size_t * restrict offR,double * restrict sz,double * restrict st)
+/* determines the row description, the offsets of the rows in Dmatrix and Rmatrix, and the signs (see fft_ops.h) for the
+ * product in MultDRow, given local x and z in slices_tr. Takes into account reduced_FFT and transpose for G_SO
+ */
+{
+	size_t xD=x,zD=z;
+
+	*sz=*st=1;
+	if (transposed) { // used only for G_SO
+		/* reflection along the x-axis can't work in parallel mode, since the corresponding values are generally stored
+		 * on a different processor. A rearrangement of memory distribution is required to remove this limitation.
+		 */
+		if (x>0) xD=gridX-x;
+		if (z>0) zD=gridZ-z;
+		*st=-1; // corresponds to transpose of 3x3 submatrix of R (R is not reflected along z)
+	}
+	else if (z>=DsizeZ) {
+		zD=gridZ-z;
+		*sz=-1;
+	}
+#	ifdef OOC
+	if (ooc_Dm) xD=x-oocX0; // rows of the current stage are stored in the order of x (see RequestStage)
+#	endif
+	*offD=(xD*DsizeZ+zD)*DsizeY;
+	*offR=(xD*gridZ+z)*RsizeY;
+	return transposed ? &rowDR_T : &rowDR;
+}
+
+//======================================================================================================================
+
+void MultDRow(doublecomplex * restrict v,const doublecomplex * restrict w,const size_t x,const size_t z,
+	const bool transposed)
+/* product with Fourier-transformed interaction matrix for a row of slices_tr along y (at given local x and z): v=D~.v
+ * if w is NULL, and v=D~.v+R~.w otherwise; called from matvec. Takes into account pruned fftY, reduced_FFT, and
+ * transpose for G_SO. !!! v and w must not alias
+ */
+{
+	size_t offD,offR;
+	double sz,st;
+	const struct rowMult *rm=RowDR(x,z,transposed,&offD,&offR,&sz,&st);
+
+	RowMult(rm,0,v,w,Dmatrix+offD,sz,(w==NULL) ? NULL : Rmatrix+offR,st);
+}
+
+//======================================================================================================================
+
+void MultDRowComp(doublecomplex * restrict v,const doublecomplex * restrict w,const size_t x,const size_t z,
+	const bool transposed,const int mu,const int nu)
+/* same as MultDRow, but for single-component rows and a single element (mu,nu) of the 3x3 matrices; used in
+ * lean mode (see MatVec_lean in matvec.c). !!! v and w must not alias
+ */
+{
+	size_t offD,offR;
+	double sz,st;
+	const struct rowMult *rm=RowDR(x,z,transposed,&offD,&offR,&sz,&st);
+
+	RowMultComp_c(rm,mu,nu,v,w,Dmatrix+offD,sz,(w==NULL) ? NULL : Rmatrix+offR,st);
+}
+
+//======================================================================================================================
+
+#ifdef OOC
+static inline size_t StageTag(const size_t s,const int comp,const bool transposed)
+// identifies the contents of a buffer: stage s, component comp (-1 for all components), and whether transposed
+{
+	return (s*(NDCOMP+1)+(size_t)(comp+1))*2+transposed;
+}
+
+//======================================================================================================================
+
+static int FindStage(const size_t tag)
+// returns the buffer, which contains (or is being filled with) the stage with given tag, or -1 if there is no such
+{
+	int b;
+
+	for (b=0;b<oocNbuf;b++) if (oocTag[b]==tag) return b;
+	return -1;
+}
+
+//======================================================================================================================
+
+static size_t StageChunks(struct oocChunk * restrict ch,const size_t start,const size_t lx,
+	doublecomplex * restrict dest,const size_t x0,const size_t nx,const int comp,const bool transposed)
+/* fills the chunks to read nx x-slices starting from local x0 of a matrix, which starts at index start in the cache
+ * file (after the header) and has lx elements per x-slice in each component. Either all components or only comp (if
+ * non-negative) are read into consecutive planes of dest (oocNx x-slices each). Returns the number of chunks
+ */
+{
+	size_t c,k,xD,n;
+	const size_t c0 = (comp<0) ? 0 : (size_t)comp;
+	const size_t c1 = (comp<0) ? NDCOMP : c0+1;
+	const size_t sz=lx*sizeof(doublecomplex);
+
+	n=0;
+	for (c=c0;c<c1;c++) {
+		const uint64_t from=DMC_HEADER+sizeof(doublecomplex)*(uint64_t)(start+c*local_Nx*lx);
+		doublecomplex * restrict to=dest+(c-c0)*oocNx*lx;
+		// rows of transposed matrices are reflected along x (see RowDR), so the slices are read one by one
+		if (transposed) for (k=0;k<nx;k++) {
+			xD = (x0+k>0) ? gridX-x0-k : 0;
+			ch[n++]=(struct oocChunk){from+xD*sz,sz,to+k*lx};
+		}
+		else ch[n++]=(struct oocChunk){from+x0*sz,nx*sz,to};
+	}
+	return n;
+}
+
+//======================================================================================================================
+
+static void RequestStage(const int buf,const size_t s,const int comp,const bool transposed)
+// submits reading of stage s (either all components or only comp, if non-negative) into buffer buf
+{
+	const size_t x0=s*oocNx;
+	const size_t nx=MIN(oocNx,local_Nx-x0);
+	size_t n;
+
+	OocWait(buf); // chunks of the previous request may still be in use
+	n=StageChunks(oocChunks[buf],0,DsizeYZ,oocBuf[buf],x0,nx,comp,transposed);
+	if (surface) n+=StageChunks(oocChunks[buf]+n,NDCOMP*local_Nx*DsizeYZ,gridZ*RsizeY,
+		oocBuf[buf]+oocNpl*oocNx*DsizeYZ,x0,nx,comp,transposed);
+	OocSubmit(buf,oocChunks[buf],n);
+	oocTag[buf]=StageTag(s,comp,transposed);
+}
+#endif // OOC
+
+//======================================================================================================================
+
+size_t DmStageBatches(const size_t nbatch)
+/* returns the number of batches of slices (out of nbatch) in each stage of MatVec, i.e. the batches, which are
+ * processed with the same part of Dmatrix and Rmatrix (see DmStageLoad). It is a single batch per thread in out-of-core
+ * mode, and all batches otherwise
+ */
+{
+#ifdef OOC
+	if (ooc_Dm) return (size_t)nthreads;
+#endif
+	return nbatch;
+}
+
+//======================================================================================================================
+
+void DmStageLoad(const size_t stage ONLY_FOR_OOC,const bool transposed ONLY_FOR_OOC,const int mu ONLY_FOR_OOC,
+	const int nu ONLY_FOR_OOC)
+/* in out-of-core mode prepares Dmatrix and Rmatrix for the stage of MatVec (see DmStageBatches), does nothing
+ * otherwise. The reading of the stage is waited for (or performed now, if it was not prefetched), and then the reading
+ * of the next stage into the other buffer is started. In lean mode (see MatVec_lean) only the component for
+ * element (mu,nu) of 3x3 matrices is read, otherwise mu and nu should be -1. After the last stage the first one is
+ * prefetched, assuming the same transposed and (in lean mode) the next element in the order of MatVec_lean
+ */
+{
+#ifdef OOC
+	int b,comp;
+	size_t next;
+
+	if (!ooc_Dm) return;
+	comp = (mu<0) ? -1 : symComp[mu][nu];
+	if ((b=FindStage(StageTag(stage,comp,transposed)))<0) {
+		b = (oocNbuf>1) ? 1-oocCur : 0;
+		RequestStage(b,stage,comp,transposed);
+	}
+	OocWait(b);
+	oocCur=b;
+	oocX0=stage*oocNx;
+	Dmatrix=oocBuf[b];
+	if (surface) Rmatrix=oocBuf[b]+oocNpl*oocNx*DsizeYZ;
+	if (oocNbuf>1) {
+		next=stage+1;
+		if (next==oocNst) {
+			next=0;
+			if (mu>=0) { // next element, assuming cycles over nu (outer) and mu (inner) in MatVec_lean
+				if (mu<2) comp=symComp[mu+1][nu];
+				else comp=symComp[0][(nu+1)%3];
+			}
+		}
+		if (FindStage(StageTag(next,comp,transposed))<0) RequestStage(1-b,next,comp,transposed);
+	}
+#endif
+}
+#endif
+
+#ifdef MIXED_PREC
+/* Single-precision versions of MatVec routines, used in mixed-precision mode. They are analogous to the corresponding
+ * double-precision ones above (with FFTW3), but act on Xmatrix, slices, and slices_tr reinterpreted as arrays of
+ * floatcomplex
+ */
+
+//======================================================================================================================
+
+static void transpose_sp(const floatcomplex * restrict data,floatcomplex * restrict trans,const size_t Y,const size_t Z,
+	const size_t ldd,const size_t ldt)
+// same as transpose(), but for single precision; tiles are transposed by simple loops
+{
+	size_t y,z,y0,z0,ylim,zlim;
+
+	for (y0=0;y0<Y;y0+=TR_BLOCK) for (z0=0;z0<Z;z0+=TR_BLOCK) {
+		ylim=MIN(y0+TR_BLOCK,Y);
+		zlim=MIN(z0+TR_BLOCK,Z);
+		for (y=y0;y<ylim;y++) for (z=z0;z<zlim;z++) trans[z*ldt+y]=data[y*ldd+z];
+	}
+}
+
+//======================================================================================================================
+
+void TransposeYZ_sp(const int direction,const size_t th)
+// same as TransposeYZ(), but for single precision
+{
+	size_t Xcomp,ind;
+	const size_t sh=th*slice_batch*3*gridYZ;
+	const size_t ncomp=3*(size_t)slice_batch;
+	floatcomplex * restrict sl=slices_sp,* restrict sl_tr=slices_tr_sp;
+
+	if (direction==FFT_FORWARD) for (Xcomp=0;Xcomp<ncomp;Xcomp++) {
+		ind=sh+Xcomp*gridYZ;
+		transpose_sp(sl+ind,sl_tr+ind,boxY,gridZ,gridZ,gridY);
+	}
+	else for (Xcomp=0;Xcomp<ncomp;Xcomp++) { // direction==FFT_BACKWARD
+		ind=sh+Xcomp*gridYZ;
+		transpose_sp(sl_tr+ind,sl+ind,gridZ,boxY,gridY,gridZ);
+	}
+}
+
+//======================================================================================================================
+
+void fftX_sp(const int isign)
+// same as fftX(), but for single precision
+{
+#	ifdef FFTX_BY_PLANES
+	const fftwf_plan plan=(isign==FFT_FORWARD) ? planXf_sp : planXb_sp;
+	floatcomplex * restrict X=Xmatrix_sp;
+	const size_t zlim=3*local_Nz;
+	size_t z;
+
+#		pragma omp parallel for num_threads(nthreads) schedule(static)
+	for (z=0;z<zlim;z++) fftwf_execute_dft(plan,X+z*gridX*smallY,X+z*gridX*smallY);
+#	else
+	if (isign==FFT_FORWARD) fftwf_execute(planXf_sp);
+	else fftwf_execute(planXb_sp);
+#	endif
+}
+
+//======================================================================================================================
+
+void fftY_sp(const int isign,const size_t th)
+// same as fftY(), but for single precision
+{
+	size_t line,y;
+	floatcomplex * restrict a;
+	floatcomplex * restrict data=slices_tr_sp+th*slice_batch*3*gridYZ;
+	const size_t bY=boxY;
+	const size_t nlines=3*gridZ*slice_batch;
+
+	if (isign==FFT_FORWARD) {
+		// analogous to PrepareHalvesY
+		for (line=0;line<nlines;line++) {
+			a=data+line*gridY;
+			for (y=0;y<bY;y++) a[smallY+y]=a[y]*twiddleY_sp[y];
+			for (;y<smallY;y++) a[y]=a[smallY+y]=0;
+		}
+		fftwf_execute_dft(planYf_sp,data,data);
+	}
+	else {
+		fftwf_execute_dft(planYb_sp,data,data);
+		// analogous to CombineHalvesY
+		for (line=0;line<nlines;line++) {
+			a=data+line*gridY;
+			for (y=0;y<bY;y++) a[y]+=conjf(twiddleY_sp[y])*a[smallY+y];
+		}
+	}
+}
+
+//======================================================================================================================
+
+void fftZ_sp(const int isign,const size_t th)
+// same as fftZ(), but for single precision
+{
+	floatcomplex * restrict data=slices_sp+th*slice_batch*3*gridYZ;
+
+	if (isign==FFT_FORWARD) fftwf_execute_dft(planZf_sp,data,data);
+	else fftwf_execute_dft(planZb_sp,data,data);
+}
+
+//======================================================================================================================
+
+void MultDRow_sp(floatcomplex * restrict v,const floatcomplex * restrict w,const size_t x,const size_t z,
+	const bool transposed)
+// same as MultDRow(), but for single precision
+{
+	size_t offD,offR;
+	double sz,st;
+	const struct rowMult *rm=RowDR(x,z,transposed,&offD,&offR,&sz,&st);
+
+	RowMult_sp(rm,v,w,Dmatrix_sp+offD,(float)sz,(w==NULL) ? NULL : Rmatrix_sp+offR,(float)st);
+}
+
+#endif // MIXED_PREC
+
+//======================================================================================================================
+
 static void fftX_Dm(void)
 // FFT(forward) D2matrix(x) for all y,z; used for Dmatrix calculation
 {
@@ -431,6 +1058,8 @@ static void fftX_Dm(void)
 	IGNORE_WARNING(-Wstrict-aliasing);
 	for (z=0;z<lz_Dm;z++) cfft99_((double *)(D2matrix+z*gridX*D2sizeY),work,trigsX,ifaxX,&inc,&jump,&nn,&lot,&isign);
 	STOP_IGNORE;
+#elif defined(FFT_BUILTIN)
+	fftbExec(&planX,D2matrix,gridX,lz_Dm*D2sizeY,FFT_FORWARD,work);
 #endif
 }
 
@@ -449,6 +1078,9 @@ static void fftX_Rm(void)
 	IGNORE_WARNING(-Wstrict-aliasing);
 	for (z=0;z<zlim;z++) cfft99_((double *)(R2matrix+z*gridX*R2sizeY),work,trigsX,ifaxX,&inc,&jump,&nn,&lot,&isign);
 	STOP_IGNORE;
+#elif defined(FFT_BUILTIN)
+	// local_Nz_Rm can be smaller by 1 than lz_Rm
+	fftbExec(&planX,R2matrix,gridX,local_Nz_Rm*R2sizeY,FFT_FORWARD,work);
 #endif
 }
 
@@ -465,6 +1097,8 @@ static void fftY_slice(void)
 	IGNORE_WARNING(-Wstrict-aliasing);
 	cfft99_((double *)slice_tr,work,trigsY,ifaxY,&inc,&jump,&nn,&lot,&isign);
 	STOP_IGNORE;
+#elif defined(FFT_BUILTIN)
+	fftbExec(&planY,slice_tr,gridY,gridZ,FFT_FORWARD,work);
 #endif
 }
 
@@ -481,6 +1115,8 @@ static void fftZ_slice(void)
 	IGNORE_WARNING(-Wstrict-aliasing);
 	cfft99_((double *)slice,work,trigsZ,ifaxZ,&inc,&jump,&nn,&lot,&isign);
 	STOP_IGNORE;
+#elif defined(FFT_BUILTIN)
+	fftbExec(&planZ,slice,gridZ,gridY,FFT_FORWARD,work);
 #endif
 }
 
@@ -508,6 +1144,14 @@ void CheckNprocs(void)
 	if (y!=1) PrintError("Specified number of processors (%d) is weird (has prime divisors larger than 5). That is "
 		"incompatible with Temperton FFT. Revise the number of processors (recommended) or recompile with FFTW 3 "
 		"support.",nprocs);
+#	elif defined(FFT_BUILTIN)
+	while (y%7==0) y/=7;
+	if (y!=1) {
+		LogWarning(EC_WARN,ONE_POS,"Specified number of processors (%d) is weird (has prime divisors larger than 7). "
+			"Built-in FFT will work much less efficiently. It is strongly recommended to revise the number of "
+			"processors.",nprocs);
+		weird_nprocs=true;
+	}
 #	elif defined(FFTW3)
 	while (y%7==0) y/=7;
 	// one multiplier of either 11 or 13 is allowed
@@ -527,8 +1171,8 @@ void CheckNprocs(void)
 
 int fftFit(int x,int divis)
 /* find the first number >=x divisible by 2 only (Apple clFFT) or 2,3,5 only (Temperton FFT or clAMDFFT) or also
- * allowing 7 and one of 11 or 13 (FFTW3), and also divisible by 2 and divis. If weird_nprocs is used, only the latter
- * condition is required.
+ * allowing 7 (built-in FFT) and one of 11 or 13 (FFTW3), and also divisible by 2 and divis. If weird_nprocs is used,
+ * only the latter condition is required.
  */
 {
 	int y;
@@ -548,8 +1192,10 @@ int fftFit(int x,int divis)
 #ifndef OPENCL
 			while (y%3==0) y/=3;
 			while (y%5==0) y/=5; // here Temperton FFT ends
+#	if defined(FFTW3) || defined(FFT_BUILTIN)
+			while (y%7==0) y/=7; // here built-in FFT ends
+#	endif
 #	ifdef FFTW3
-			while (y%7==0) y/=7;
 			// one multiplier of either 11 or 13 is allowed
 			if (y%11==0) y/=11;
 			else if (y%13==0) y/=13;
@@ -571,14 +1217,21 @@ static void fftInitBeforeD(void)
 
 	D("FFTW library version: %s\n     compiler: %s\n     codelet optimizations: %s",fftw_version,fftw_cc,
 		fftw_codelet_optim);
-	planYf_slice=fftw_plan_many_dft(1,&grYint,gridZ,slice_tr,NULL,1,gridY,slice_tr,NULL,1,gridY,FFT_FORWARD,
-		PLAN_FFTW_DM);
-	planZf_slice=fftw_plan_many_dft(1,&grZint,gridY,slice,NULL,1,gridZ,slice,NULL,1,gridZ,FFT_FORWARD,PLAN_FFTW_DM);
-	planXf_Dm=fftw_plan_many_dft(1,&grXint,lz_Dm*D2sizeY,D2matrix,NULL,1,gridX,D2matrix,NULL,1,gridX,FFT_FORWARD,
-		PLAN_FFTW_DM);
-	// very similar to Dm, but local_Nz_Rm can be smaller by 1 than lz_Rm
-	if (surface) planXf_Rm=fftw_plan_many_dft(1,&grXint,local_Nz_Rm*R2sizeY,R2matrix,NULL,1,gridX,R2matrix,NULL,1,gridX,
-		FFT_FORWARD,PLAN_FFTW_DM);
+#	ifdef FFTW_THREADS // all FFTs of D- and R-matrices are executed sequentially, so they can use all threads
+	if (fftw_init_threads()==0) LogError(ALL_POS,"Failed to initialize threads in FFTW3");
+	fftw_plan_with_nthreads(nthreads);
+#	endif
+	if (!Dm_cached) { // otherwise, the plans for D- and R-matrices are not needed
+		planYf_slice=fftw_plan_many_dft(1,&grYint,gridZ,slice_tr,NULL,1,gridY,slice_tr,NULL,1,gridY,FFT_FORWARD,
+			PLAN_FFTW_DM);
+		planZf_slice=fftw_plan_many_dft(1,&grZint,gridY,slice,NULL,1,gridZ,slice,NULL,1,gridZ,FFT_FORWARD,
+			PLAN_FFTW_DM);
+		planXf_Dm=fftw_plan_many_dft(1,&grXint,lz_Dm*D2sizeY,D2matrix,NULL,1,gridX,D2matrix,NULL,1,gridX,FFT_FORWARD,
+			PLAN_FFTW_DM);
+		// very similar to Dm, but local_Nz_Rm can be smaller by 1 than lz_Rm
+		if (surface) planXf_Rm=fftw_plan_many_dft(1,&grXint,local_Nz_Rm*R2sizeY,R2matrix,NULL,1,gridX,R2matrix,NULL,1,
+			gridX,FFT_FORWARD,PLAN_FFTW_DM);
+	}
 #elif defined(FFT_TEMPERTON)
 	int nn;
 	size_t size;
@@ -587,9 +1240,11 @@ static void fftInitBeforeD(void)
 	MALLOC_VECTOR(trigsX,double,2*gridX,ALL);
 	MALLOC_VECTOR(trigsY,double,2*gridY,ALL);
 	MALLOC_VECTOR(trigsZ,double,2*gridZ,ALL);
-	size=MAX(gridX*D2sizeY,3*gridYZ);
+	size=MAX(gridX*D2sizeY,gridYZ*(size_t)mv_ncomp*slice_batch);
 	if (surface) size=MAX(size,gridX*R2sizeY);
-	MALLOC_VECTOR(work,double,2*size,ALL);
+	work_size=2*size;
+	// separate work array for each thread; only the first one is used for D- and R-matrices
+	MALLOC_VECTOR(work,double,work_size*nthreads,ALL);
 	// initialize ifax and trigs
 	nn=gridX;
 	cftfax_(&nn,ifaxX,trigsX);
@@ -597,11 +1252,410 @@ static void fftInitBeforeD(void)
 	cftfax_(&nn,ifaxY,trigsY);
 	nn=gridZ;
 	cftfax_(&nn,ifaxZ,trigsZ);
+#	ifndef OPENCL
+	MALLOC_VECTOR(trigsYh,double,2*smallY,ALL);
+	nn=smallY;
+	if (nn>1) cftfax_(&nn,ifaxYh,trigsYh);
+#	endif
+#elif defined(FFT_BUILTIN)
+	// allocate memory; a single line of maximum length is transformed at a time
+	MALLOC_VECTOR(twX,complex,fftbTwiddleSize(gridX),ALL);
+	MALLOC_VECTOR(twY,complex,fftbTwiddleSize(gridY),ALL);
+	MALLOC_VECTOR(twZ,complex,fftbTwiddleSize(gridZ),ALL);
+	work_size=MAX(gridX,MAX(gridY,gridZ));
+	// separate work array for each thread; only the first one is used for D- and R-matrices
+	MALLOC_VECTOR(work,complex,work_size*nthreads,ALL);
+	// initialize plans
+	fftbInit(&planX,gridX,twX);
+	fftbInit(&planY,gridY,twY);
+	fftbInit(&planZ,gridZ,twZ);
+#	ifndef OPENCL
+	MALLOC_VECTOR(twYh,complex,fftbTwiddleSize(smallY),ALL);
+	fftbInit(&planYh,smallY,twYh);
+#	endif
 #endif
 }
 
 //======================================================================================================================
 
+#if defined(FFTW3) && !defined(OPENCL)
+
+static unsigned PlanFlagFFTW(void)
+// returns FFTW3 planner flag, corresponding to fft_plan
+{
+	switch (fft_plan) {
+		case FP_ESTIMATE: return FFTW_ESTIMATE;
+		case FP_MEASURE: return FFTW_MEASURE;
+		case FP_PATIENT: return FFTW_PATIENT;
+		case FP_EXHAUSTIVE: return FFTW_EXHAUSTIVE;
+	}
+	LogError(ONE_POS,"Unknown level of FFTW3 planning (%d)",(int)fft_plan);
+}
+
+//======================================================================================================================
+
+static void ImportWisdom(void)
+/* reads FFTW3 wisdom from file (if specified and exists) and passes it to all processes. The file is read only by root,
+ * holding a lock file, to protect against partial reads, when another run is updating it
+ */
+{
+	FILE * restrict file;
+	FILEHANDLE lockid;
+	char *lockname;
+#	ifdef PARALLEL
+	char *wisdom=NULL;
+	size_t len=0;
+#	endif
+
+	if (fft_wisdom_fname==NULL) return;
+	if (IFROOT) {
+		lockname=dyn_sprintf("%s.lck",fft_wisdom_fname);
+		lockid=CreateLockFile(lockname);
+		if ((file=fopen(fft_wisdom_fname,"r"))!=NULL) {
+			if (fftw_import_wisdom_from_file(file)==0)
+				LogWarning(EC_WARN,ONE_POS,"Failed to import FFTW3 wisdom from file '%s'",fft_wisdom_fname);
+			FCloseErr(file,fft_wisdom_fname,ONE_POS);
+		}
+		RemoveLockFile(lockid,lockname);
+		Free_general(lockname);
+	}
+#	ifdef PARALLEL
+	/* other processes obtain wisdom from the root; it is relevant, since all processes plan transforms of the same (or
+	 * very similar) sizes
+	 */
+	if (IFROOT) {
+		wisdom=fftw_export_wisdom_to_string();
+		len=strlen(wisdom)+1;
+	}
+	MyBcast(&len,sizet_type,1,NULL);
+	if (!IFROOT) MALLOC_VECTOR(wisdom,char,len,ALL);
+	MyBcast(wisdom,uchar_type,len,NULL);
+	if (IFROOT) free(wisdom); // allocated by FFTW3 with malloc
+	else {
+		if (fftw_import_wisdom_from_string(wisdom)==0)
+			LogWarning(EC_WARN,ALL_POS,"Failed to import FFTW3 wisdom received from the root processor");
+		Free_general(wisdom);
+	}
+#	endif
+}
+
+//======================================================================================================================
+
+static void ExportWisdom(void)
+/* saves FFTW3 wisdom (if file is specified) by root processor. Current content of the file (which may have been updated
+ * by another run since the import) is first merged into the wisdom, so that no information is lost.
+ */
+{
+	FILE * restrict file;
+	FILEHANDLE lockid;
+	char *lockname;
+
+	if (fft_wisdom_fname==NULL || !IFROOT) return;
+	lockname=dyn_sprintf("%s.lck",fft_wisdom_fname);
+	lockid=CreateLockFile(lockname);
+	if ((file=fopen(fft_wisdom_fname,"r"))!=NULL) {
+		// errors are ignored here, since they have been reported during the import
+		fftw_import_wisdom_from_file(file);
+		FCloseErr(file,fft_wisdom_fname,ONE_POS);
+	}
+	file=FOpenErr(fft_wisdom_fname,"w",ONE_POS);
+	fftw_export_wisdom_to_file(file);
+	FCloseErr(file,fft_wisdom_fname,ONE_POS);
+	RemoveLockFile(lockid,lockname);
+	Free_general(lockname);
+}
+
+#endif // FFTW3 && !OPENCL
+
+#ifndef OPENCL
+
+//======================================================================================================================
+
+static double TimeTransform(const int n)
+/* returns the time (in seconds) of a pair of forward and backward transforms of length n, measured for a batch of
+ * contiguous transforms (the same layout as used in MatVec) with the same planning level. Is executed only by root.
+ */
+{
+	SYSTEM_TIME tv[2];
+	double elapsed;
+	int count;
+	const int lot=MAX(1,TUNE_BATCH/n);
+	doublecomplex * restrict data;
+
+	if (n==1) return 0;
+	MALLOC_VECTOR(data,complex,n*(size_t)lot,ONE);
+	memset(data,0,n*(size_t)lot*sizeof(doublecomplex));
+#	ifdef FFTW3
+	const unsigned plan_flag=PlanFlagFFTW();
+	fftw_plan pf,pb;
+	int nn=n;
+
+	pf=fftw_plan_many_dft(1,&nn,lot,data,NULL,1,n,data,NULL,1,n,FFT_FORWARD,plan_flag);
+	pb=fftw_plan_many_dft(1,&nn,lot,data,NULL,1,n,data,NULL,1,n,FFT_BACKWARD,plan_flag);
+	memset(data,0,n*(size_t)lot*sizeof(doublecomplex)); // planning may overwrite the data
+#	elif defined(FFT_TEMPERTON)
+	int nn=n,inc=1,jump=n,lot_int=lot,sign;
+	int ifax[IFAX_SIZE];
+	double * restrict trigs,* restrict wrk;
+
+	MALLOC_VECTOR(trigs,double,2*n,ONE);
+	MALLOC_VECTOR(wrk,double,2*n*(size_t)lot,ONE);
+	cftfax_(&nn,ifax,trigs);
+#	elif defined(FFT_BUILTIN)
+	struct fftbPlan plan;
+	doublecomplex * restrict tw,* restrict wrk;
+
+	MALLOC_VECTOR(tw,complex,fftbTwiddleSize(n),ONE);
+	MALLOC_VECTOR(wrk,complex,n,ONE);
+	fftbInit(&plan,n,tw);
+#	endif
+	count=0;
+	GET_SYSTEM_TIME(tv);
+	do {
+#	ifdef FFTW3
+		fftw_execute(pf);
+		fftw_execute(pb);
+#	elif defined(FFT_TEMPERTON)
+		IGNORE_WARNING(-Wstrict-aliasing);
+		sign=FFT_FORWARD;
+		cfft99_((double *)data,wrk,trigs,ifax,&inc,&jump,&nn,&lot_int,&sign);
+		sign=FFT_BACKWARD;
+		cfft99_((double *)data,wrk,trigs,ifax,&inc,&jump,&nn,&lot_int,&sign);
+		STOP_IGNORE;
+#	elif defined(FFT_BUILTIN)
+		fftbExec(&plan,data,n,lot,FFT_FORWARD,wrk);
+		fftbExec(&plan,data,n,lot,FFT_BACKWARD,wrk);
+#	endif
+		count++;
+		GET_SYSTEM_TIME(tv+1);
+		elapsed=DiffSystemTime(tv,tv+1);
+	} while (elapsed<TUNE_TIME);
+#	ifdef FFTW3
+	fftw_destroy_plan(pf);
+	fftw_destroy_plan(pb);
+#	elif defined(FFT_TEMPERTON)
+	Free_general(trigs);
+	Free_general(wrk);
+#	elif defined(FFT_BUILTIN)
+	Free_cVector(tw);
+	Free_cVector(wrk);
+#	endif
+	Free_cVector(data);
+	return elapsed/((double)count*lot);
+}
+
+//======================================================================================================================
+
+static double TimeArith(void)
+/* returns the time (in seconds) per grid point of element-wise operations in MatVec (product with Fourier-transformed
+ * interaction matrix and transposes), estimated by a product of symmetric 3x3 matrix with a vector. Is executed only by
+ * root.
+ */
+{
+	SYSTEM_TIME tv[2];
+	double elapsed;
+	int count;
+	size_t i;
+	doublecomplex * restrict mat,* restrict vec,tmp[3];
+
+	MALLOC_VECTOR(mat,complex,6*(size_t)TUNE_BATCH,ONE);
+	MALLOC_VECTOR(vec,complex,3*(size_t)TUNE_BATCH,ONE);
+	for (i=0;i<6*(size_t)TUNE_BATCH;i++) mat[i]=1e-3*I;
+	for (i=0;i<3*(size_t)TUNE_BATCH;i++) vec[i]=1;
+	count=0;
+	GET_SYSTEM_TIME(tv);
+	do {
+		for (i=0;i<TUNE_BATCH;i++) {
+			cSymMatrVec(mat+6*i,vec+3*i,tmp);
+			memcpy(vec+3*i,tmp,3*sizeof(doublecomplex));
+		}
+		count++;
+		GET_SYSTEM_TIME(tv+1);
+		elapsed=DiffSystemTime(tv,tv+1);
+	} while (elapsed<TUNE_TIME);
+	Free_cVector(mat);
+	Free_cVector(vec);
+	return elapsed/((double)count*TUNE_BATCH);
+}
+
+#	ifdef FFTW3
+//======================================================================================================================
+
+static bool ReadGridRecord(const char * restrict fname,int grid[static 3])
+/* looks for the grid, previously selected for the same problem, in the file (if it exists); returns whether the record
+ * is found. Is executed only by root
+ */
+{
+	FILE * restrict file;
+	FILEHANDLE lockid;
+	char *lockname;
+	int key[5],gr[3];
+	bool found=false;
+
+	lockname=dyn_sprintf("%s.lck",fname);
+	lockid=CreateLockFile(lockname);
+	if ((file=fopen(fname,"r"))!=NULL) {
+		while (!found && fscanf(file,"%d %d %d %d %d %d %d %d",key,key+1,key+2,key+3,key+4,gr,gr+1,gr+2)==8) {
+			if (key[0]==boxX && key[1]==boxY && key[2]==boxZ && key[3]==nprocs && key[4]==(int)fft_plan) {
+				memcpy(grid,gr,3*sizeof(int));
+				found=true;
+			}
+		}
+		FCloseErr(file,fname,ONE_POS);
+	}
+	RemoveLockFile(lockid,lockname);
+	Free_general(lockname);
+	return found;
+}
+
+//======================================================================================================================
+
+static void SaveGridRecord(const char * restrict fname,const int grid[static 3])
+// appends the selected grid to the file. Is executed only by root
+{
+	FILE * restrict file;
+	FILEHANDLE lockid;
+	char *lockname;
+
+	lockname=dyn_sprintf("%s.lck",fname);
+	lockid=CreateLockFile(lockname);
+	file=FOpenErr(fname,"a",ONE_POS);
+	fprintf(file,"%d %d %d %d %d %d %d %d\n",boxX,boxY,boxZ,nprocs,(int)fft_plan,grid[0],grid[1],grid[2]);
+	FCloseErr(file,fname,ONE_POS);
+	RemoveLockFile(lockid,lockname);
+	Free_general(lockname);
+}
+
+#	endif // FFTW3
+//======================================================================================================================
+
+void TuneGrid(void)
+/* if requested, selects the FFT grid (gridX, gridY, gridZ), which minimizes the predicted time of MatVec. Candidate
+ * sizes along each axis are the first grid_tune admissible sizes (see fftFit), so MPI divisibility is preserved. For
+ * each candidate length the time of transforms is measured (by root) with the actual planning level. Time of MatVec is
+ * then predicted from the number of transforms along each axis (per process) and the number of grid points in slices.
+ * Communication time is not included. The table of predictions is printed to stdout and log. If FFTW3 wisdom file is
+ * used, the choice is saved to (and further read from) the file with '.grid' appended to its name.
+ */
+{
+	int cand[3][MAX_GRID_TUNE],grid[3],i,ix,iy,iz,best[3];
+	double tX[MAX_GRID_TUNE],tY[MAX_GRID_TUNE],tZ[MAX_GRID_TUNE],tA,t,tmin,nX,nY,nZ,nA;
+	bool found=false;
+	char *recname=NULL;
+
+	if (grid_tune==0) return;
+#	ifdef FFTW3
+	ImportWisdom();
+	if (fft_wisdom_fname!=NULL) recname=dyn_sprintf("%s.grid",fft_wisdom_fname);
+#	endif
+	if (IFROOT) {
+#	ifdef FFTW3
+		if (recname!=NULL) found=ReadGridRecord(recname,grid);
+#	endif
+		if (found) PrintBoth(logfile,"FFT grid %dx%dx%d is taken from the result of previous auto-tuning in '%s'\n",
+			grid[0],grid[1],grid[2],recname);
+		else {
+			printf("Auto-tuning FFT grid...\n");
+			cand[0][0]=gridX;
+			cand[1][0]=gridY;
+			cand[2][0]=gridZ;
+			for (i=1;i<grid_tune;i++) {
+				cand[0][i]=fftFit(cand[0][i-1]+1,nprocs);
+				cand[1][i]=fftFit(cand[1][i-1]+1,1);
+				cand[2][i]=fftFit(cand[2][i-1]+1,2*nprocs);
+			}
+			for (i=0;i<grid_tune;i++) {
+				tX[i]=TimeTransform(cand[0][i]);
+				tY[i]=TimeTransform(cand[1][i]/2); // two halves of each line are transformed separately
+				tZ[i]=TimeTransform(cand[2][i]);
+			}
+			tA=TimeArith();
+			best[0]=best[1]=best[2]=0; // redundant initialization to remove warnings
+			PrintBoth(logfile,"Predicted time per MatVec (without communications) for candidate FFT grids:\n");
+			tmin=-1;
+			for (ix=0;ix<grid_tune;ix++) for (iy=0;iy<grid_tune;iy++) for (iz=0;iz<grid_tune;iz++) {
+				// numbers of pairs of (forward and backward) transforms and of grid points in slices per process
+				nX=3*(double)boxY*cand[2][iz]/(2*nprocs);
+				nZ=3*(double)boxY*cand[0][ix]/nprocs;
+				nY=6*(double)cand[2][iz]*cand[0][ix]/nprocs;
+				nA=(double)cand[1][iy]*cand[2][iz]*cand[0][ix]/nprocs;
+				t=nX*tX[ix]+nY*tY[iy]+nZ*tZ[iz]+nA*tA;
+				PrintBoth(logfile,"  %dx%dx%d: %.3g s\n",cand[0][ix],cand[1][iy],cand[2][iz],t);
+				if (tmin<0 || t<tmin) {
+					tmin=t;
+					best[0]=ix;
+					best[1]=iy;
+					best[2]=iz;
+				}
+			}
+			for (i=0;i<3;i++) grid[i]=cand[i][best[i]];
+			PrintBoth(logfile,"Selected FFT grid: %dx%dx%d (smallest admissible: %zux%zux%zu)\n",grid[0],grid[1],
+				grid[2],gridX,gridY,gridZ);
+#	ifdef FFTW3
+			if (recname!=NULL) SaveGridRecord(recname,grid);
+#	endif
+		}
+	}
+	Free_general(recname);
+	MyBcast(grid,int_type,3,NULL);
+	gridX=grid[0];
+	gridY=grid[1];
+	gridZ=grid[2];
+}
+
+#endif // !OPENCL
+
+#ifdef MIXED_PREC
+static void fftInitSingle(const unsigned plan_flag)
+/* initializes single-precision FFTW3 plans for mixed-precision MatVec, analogous to the double-precision ones (see
+ * fftInitAfterD). Wisdom is not used for them
+ */
+{
+	int lot;
+	fftwf_iodim dims,howmany_dims[2];
+	int smYint=smallY; // this is needed to provide 'int *' to smallY
+
+#	ifdef FFTW_THREADS
+	if (fftwf_init_threads()==0) LogError(ALL_POS,"Failed to initialize threads in single-precision FFTW3");
+	fftwf_plan_with_nthreads(1);
+#	endif
+	lot=6*gridZ*slice_batch;
+	planYf_sp=fftwf_plan_many_dft(1,&smYint,lot,slices_tr_sp,NULL,1,smallY,slices_tr_sp,NULL,1,smallY,FFT_FORWARD,
+		plan_flag);
+	planYb_sp=fftwf_plan_many_dft(1,&smYint,lot,slices_tr_sp,NULL,1,smallY,slices_tr_sp,NULL,1,smallY,FFT_BACKWARD,
+		plan_flag);
+	dims.n=gridZ;
+	dims.is=dims.os=1;
+	howmany_dims[0].n=3*slice_batch;
+	howmany_dims[0].is=howmany_dims[0].os=gridZ*gridY;
+	howmany_dims[1].n=boxY;
+	howmany_dims[1].is=howmany_dims[1].os=gridZ;
+	planZf_sp=fftwf_plan_guru_dft(1,&dims,2,howmany_dims,slices_sp,slices_sp,FFT_FORWARD,plan_flag);
+	planZb_sp=fftwf_plan_guru_dft(1,&dims,2,howmany_dims,slices_sp,slices_sp,FFT_BACKWARD,plan_flag);
+	dims.n=gridX;
+	dims.is=dims.os=1;
+#	ifdef FFTX_BY_PLANES
+	howmany_dims[0].n=boxY;
+	howmany_dims[0].is=howmany_dims[0].os=gridX;
+	planXf_sp=fftwf_plan_guru_dft(1,&dims,1,howmany_dims,Xmatrix_sp,Xmatrix_sp,FFT_FORWARD,plan_flag);
+	planXb_sp=fftwf_plan_guru_dft(1,&dims,1,howmany_dims,Xmatrix_sp,Xmatrix_sp,FFT_BACKWARD,plan_flag);
+#	else
+#		ifdef FFTW_THREADS
+	fftwf_plan_with_nthreads(nthreads);
+#		endif
+	howmany_dims[0].n=3*local_Nz;
+	howmany_dims[0].is=howmany_dims[0].os=smallY*gridX;
+	howmany_dims[1].n=boxY;
+	howmany_dims[1].is=howmany_dims[1].os=gridX;
+	planXf_sp=fftwf_plan_guru_dft(1,&dims,2,howmany_dims,Xmatrix_sp,Xmatrix_sp,FFT_FORWARD,plan_flag);
+	planXb_sp=fftwf_plan_guru_dft(1,&dims,2,howmany_dims,Xmatrix_sp,Xmatrix_sp,FFT_BACKWARD,plan_flag);
+#	endif
+}
+
+#endif // MIXED_PREC
+
+//======================================================================================================================
+
 static void fftInitAfterD(void)
 /* second part of fft initialization
  * completely separate code is used for OpenCL and FFTW3, because even precise-timing output is significantly different.
@@ -737,57 +1791,74 @@ static void fftInitAfterD(void)
 		DiffSystemTime(tvp,tvp+1),DiffSystemTime(tvp,tvp+3),DiffSystemTime(tvp+1,tvp+2),DiffSystemTime(tvp+2,tvp+3));
 #	endif
 #elif defined(FFTW3) // this is not needed when OpenCL is used
+	const unsigned plan_flag=PlanFlagFFTW();
 	int lot;
 	fftw_iodim dims,howmany_dims[2];
-	int grYint=gridY; // this is needed to provide 'int *' to gridY
+	int smYint=smallY; // this is needed to provide 'int *' to smallY
 #	ifdef PRECISE_TIMING
 	SYSTEM_TIME tvp[7];
 #	endif
 	if (IFROOT) printf("Initializing FFTW3\n");
+	ImportWisdom();
 #	ifdef PRECISE_TIMING
 	GET_SYSTEM_TIME(tvp);
 #	endif
-	lot=3*gridZ;
-	planYf=fftw_plan_many_dft(1,&grYint,lot,slices_tr,NULL,1,gridY,slices_tr,NULL,1,gridY,FFT_FORWARD,PLAN_FFTW);
-	if (surface) // same operation, but applied to slicesR_tr
-		planYRf=fftw_plan_many_dft(1,&grYint,lot,slicesR_tr,NULL,1,gridY,slicesR_tr,NULL,1,gridY,FFT_FORWARD,PLAN_FFTW);
+#	ifdef FFTW_THREADS // slice plans are executed inside the (OpenMP) parallel loop in MatVec, so are single-threaded
+	fftw_plan_with_nthreads(1);
+#	endif
+	lot=2*mv_ncomp*gridZ*slice_batch; // two halves of each line are transformed separately (see PrepareHalvesY)
+	planYf=fftw_plan_many_dft(1,&smYint,lot,slices_tr,NULL,1,smallY,slices_tr,NULL,1,smallY,FFT_FORWARD,plan_flag);
 #	ifdef PRECISE_TIMING
 	GET_SYSTEM_TIME(tvp+1);
 #	endif
-	planYb=fftw_plan_many_dft(1,&grYint,lot,slices_tr,NULL,1,gridY,slices_tr,NULL,1,gridY,FFT_BACKWARD,PLAN_FFTW);
+	planYb=fftw_plan_many_dft(1,&smYint,lot,slices_tr,NULL,1,smallY,slices_tr,NULL,1,smallY,FFT_BACKWARD,plan_flag);
 #	ifdef PRECISE_TIMING
 	GET_SYSTEM_TIME(tvp+2);
 #	endif
 	dims.n=gridZ;
 	dims.is=dims.os=1;
-	howmany_dims[0].n=3;
+	howmany_dims[0].n=mv_ncomp*slice_batch; // all components (of all right-hand sides) of all slices in a batch
 	howmany_dims[0].is=howmany_dims[0].os=gridZ*gridY;
 	howmany_dims[1].n=boxY;
 	howmany_dims[1].is=howmany_dims[1].os=gridZ;
-	planZf=fftw_plan_guru_dft(1,&dims,2,howmany_dims,slices,slices,FFT_FORWARD,PLAN_FFTW);
-	// same operation but for slicesR and inverse transform (since correlation is computed instead of convolution)
-	if (surface) planZRf=fftw_plan_guru_dft(1,&dims,2,howmany_dims,slicesR,slicesR,FFT_BACKWARD,PLAN_FFTW);
+	planZf=fftw_plan_guru_dft(1,&dims,2,howmany_dims,slices,slices,FFT_FORWARD,plan_flag);
 #	ifdef PRECISE_TIMING
 	GET_SYSTEM_TIME(tvp+3);
 #	endif
-	planZb=fftw_plan_guru_dft(1,&dims,2,howmany_dims,slices,slices,FFT_BACKWARD,PLAN_FFTW);
+	planZb=fftw_plan_guru_dft(1,&dims,2,howmany_dims,slices,slices,FFT_BACKWARD,plan_flag);
 #	ifdef PRECISE_TIMING
 	GET_SYSTEM_TIME(tvp+4);
 #	endif
 	dims.n=gridX;
 	dims.is=dims.os=1;
-	howmany_dims[0].n=3*local_Nz;
+#	ifdef FFTX_BY_PLANES // a plan for a single z-plane, which is executed for different planes in parallel (see fftX)
+	howmany_dims[0].n=boxY;
+	howmany_dims[0].is=howmany_dims[0].os=gridX;
+	planXf=fftw_plan_guru_dft(1,&dims,1,howmany_dims,Xmatrix,Xmatrix,FFT_FORWARD,plan_flag);
+#		ifdef PRECISE_TIMING
+	GET_SYSTEM_TIME(tvp+5);
+#		endif
+	planXb=fftw_plan_guru_dft(1,&dims,1,howmany_dims,Xmatrix,Xmatrix,FFT_BACKWARD,plan_flag);
+#	else
+#		ifdef FFTW_THREADS // a plan for the whole Xmatrix, executed by FFTW3 using all threads
+	fftw_plan_with_nthreads(nthreads);
+#		endif
+	howmany_dims[0].n=mv_ncomp*local_Nz;
 	howmany_dims[0].is=howmany_dims[0].os=smallY*gridX;
 	howmany_dims[1].n=boxY;
 	howmany_dims[1].is=howmany_dims[1].os=gridX;
-	planXf=fftw_plan_guru_dft(1,&dims,2,howmany_dims,Xmatrix,Xmatrix,FFT_FORWARD,PLAN_FFTW);
-#	ifdef PRECISE_TIMING
+	planXf=fftw_plan_guru_dft(1,&dims,2,howmany_dims,Xmatrix,Xmatrix,FFT_FORWARD,plan_flag);
+#		ifdef PRECISE_TIMING
 	GET_SYSTEM_TIME(tvp+5);
+#		endif
+	planXb=fftw_plan_guru_dft(1,&dims,2,howmany_dims,Xmatrix,Xmatrix,FFT_BACKWARD,plan_flag);
 #	endif
-	planXb=fftw_plan_guru_dft(1,&dims,2,howmany_dims,Xmatrix,Xmatrix,FFT_BACKWARD,PLAN_FFTW);
 #	ifdef PRECISE_TIMING
 	GET_SYSTEM_TIME(tvp+6);
 	// print precise timing of FFT planning
+#		ifdef OPENMP
+	if (IFROOT) PrintBoth(logfile,"Number of threads: %d\n",nthreads);
+#		endif
 	if (IFROOT) PrintBoth(logfile,
 		"~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n"
 		"         FFTW3 planning       \n"
@@ -800,22 +1871,185 @@ static void fftInitAfterD(void)
 		"Xb = "FFORMPT"\n\n",
 		DiffSystemTime(tvp,tvp+1),DiffSystemTime(tvp,tvp+6),DiffSystemTime(tvp+1,tvp+2),DiffSystemTime(tvp+2,tvp+3),
 		DiffSystemTime(tvp+3,tvp+4),DiffSystemTime(tvp+4,tvp+5),DiffSystemTime(tvp+5,tvp+6));
+#	endif
+	ExportWisdom();
+#	ifdef MIXED_PREC
+	if (mixed_prec) fftInitSingle(plan_flag);
 #	endif
 #endif
 #ifdef FFTW3
 	// destroy old (D,R-matrix) plans; also in OpenCL mode
-	fftw_destroy_plan(planXf_Dm);
-	fftw_destroy_plan(planYf_slice);
-	fftw_destroy_plan(planZf_slice);
-	if (surface) fftw_destroy_plan(planXf_Rm);
+	if (!Dm_cached) {
+		fftw_destroy_plan(planXf_Dm);
+		fftw_destroy_plan(planYf_slice);
+		fftw_destroy_plan(planZf_slice);
+		if (surface) fftw_destroy_plan(planXf_Rm);
+	}
 #	ifdef OPENCL // in this case, FFTW ends here
-	fftw_cleanup();
+	FFTW_CLEANUP();
 #	endif
 #endif
 }
 
 //======================================================================================================================
 
+#ifndef OPENCL
+
+static void DmatrixCacheHeader(char * restrict header,const size_t Dsize)
+/* fills the header (of size DMC_HEADER) of the cache file with the text description of all parameters, which determine
+ * Dmatrix and Rmatrix of the current processor (including their layout in memory). The rest of the header is filled
+ * with zeros. The incident beam does not affect these matrices, neither does refractive index of the particle except
+ * for '-int so' (InterTerm_so uses ref_index[0]).
+ */
+{
+	int len;
+	const doublecomplex m_int = (IntRelation==G_SO) ? ref_index[0] : 0;
+
+	memset(header,0,DMC_HEADER);
+	len=snprintf(header,DMC_HEADER,"ADDA cache of Fourier-transformed interaction matrices, format 2\n"
+		"element and matrix sizes: %zu %zu %zu\ngrid: %zu %zu %zu\nbox: %d %d %d\nprocessor: %d of %d\n"
+		"reduced FFT: %d\nwave number and dipole size: %.17g %.17g\ninteraction: %d %.17g %.17g %.17g %.17g %.17g\n"
+		"surface: %d %d %.17g %.17g %d %.17g\n",sizeof(doublecomplex),Dsize,surface ? Rsize : 0,gridX,gridY,gridZ,
+		boxX,boxY,boxZ,ringid,nprocs,(int)reduced_FFT,WaveNum,gridspace,(int)IntRelation,igt_lim,igt_eps,nloc_Rp,
+		creal(m_int),cimag(m_int),(int)surface,surface ? (int)ReflRelation : 0,surface ? creal(msub) : 0,
+		surface ? cimag(msub) : 0,surface ? (int)msubInf : 0,surface ? ZsumShift : 0);
+	if (len<0 || len>=DMC_HEADER) LogError(ALL_POS,"Header of Dmatrix cache does not fit into %d bytes",DMC_HEADER);
+}
+
+//======================================================================================================================
+
+static void OpenDmatrixCache(const size_t Dsize)
+/* If the cache is enabled, constructs the name of the cache file from the hash of its header (so that several sets of
+ * parameters can be cached in the same directory). If such file exists (for all processors) and its header matches the
+ * current parameters, Dmatrix and Rmatrix are taken from it; sets Dm_cached accordingly. When possible, the file is
+ * mapped into memory (read-only), otherwise it is read into allocated memory. In out-of-core mode the file is only read
+ * during MatVec (see DmStageLoad).
+ */
+{
+	char header[DMC_HEADER],fheader[DMC_HEADER];
+	FILE * restrict file;
+	uint64_t hash;
+	size_t i;
+	int hit;
+
+	Dm_cached=false;
+	if (dmatrix_cache_dir==NULL) return;
+	DmatrixCacheHeader(header,Dsize);
+	// 64-bit FNV-1a hash of the header
+	hash=UINT64_C(14695981039346656037);
+	for (i=0;i<DMC_HEADER && header[i]!=0;i++) hash=(hash^(unsigned char)header[i])*UINT64_C(1099511628211);
+	dmcName=dyn_sprintf("%s/dmatrix_%016"PRIx64"_%d.bin",dmatrix_cache_dir,hash,ringid);
+	dmcSize=DMC_HEADER+sizeof(doublecomplex)*(Dsize+(surface ? Rsize : 0));
+	hit=0;
+	if ((file=fopen(dmcName,"rb"))!=NULL) {
+		if (fread(fheader,1,DMC_HEADER,file)==DMC_HEADER && memcmp(header,fheader,DMC_HEADER)==0
+			&& fseek(file,0,SEEK_END)==0 && (size_t)ftell(file)==dmcSize) hit=1;
+		else LogWarning(EC_WARN,ALL_POS,"Dmatrix cache file '%s' does not match the current parameters. It will be "
+			"overwritten",dmcName);
+		FCloseErr(file,dmcName,ALL_POS);
+	}
+	// the cache is used only if available for all processors, since otherwise computation of Dmatrix would deadlock
+	MyInnerProduct(&hit,int_type,1,NULL);
+	if (hit!=nprocs) return;
+	Dm_cached=true;
+#	ifdef OOC
+	if (ooc_Dm) return;
+#	endif
+#	ifdef DMC_MMAP
+	int fd;
+	if ((fd=open(dmcName,O_RDONLY))==-1) LogError(ALL_POS,"Failed to open file '%s'",dmcName);
+	dmcMap=mmap(NULL,dmcSize,PROT_READ,MAP_SHARED,fd,0);
+	if (dmcMap==MAP_FAILED) LogError(ALL_POS,"Failed to map file '%s' into memory",dmcName);
+	close(fd); // mapping remains valid
+	Dmatrix=(doublecomplex *)((char *)dmcMap+DMC_HEADER);
+	if (surface) Rmatrix=Dmatrix+Dsize;
+#	else
+	file=FOpenErr(dmcName,"rb",ALL_POS);
+	MALLOC_VECTOR(Dmatrix,complex,Dsize,ALL);
+	if (fseek(file,DMC_HEADER,SEEK_SET)!=0 || fread(Dmatrix,sizeof(doublecomplex),Dsize,file)!=Dsize)
+		LogError(ALL_POS,"Failed to read Dmatrix from file '%s'",dmcName);
+	if (surface) {
+		MALLOC_VECTOR(Rmatrix,complex,Rsize,ALL);
+		if (fread(Rmatrix,sizeof(doublecomplex),Rsize,file)!=Rsize)
+			LogError(ALL_POS,"Failed to read Rmatrix from file '%s'",dmcName);
+	}
+	FCloseErr(file,dmcName,ALL_POS);
+#	endif
+}
+
+//======================================================================================================================
+
+static void SaveDmatrixCache(const size_t Dsize)
+/* saves computed Dmatrix and Rmatrix into the cache file (if the cache is enabled). The file is first written under a
+ * temporary name, holding a lock file, and then renamed. Thus, other runs never see a partially written file. Failure
+ * to save is not critical, so it produces only a warning.
+ */
+{
+	char header[DMC_HEADER];
+	char *tmpname,*lockname;
+	FILE * restrict file;
+	FILEHANDLE lockid;
+	bool ok;
+
+	if (dmcName==NULL) return;
+	DmatrixCacheHeader(header,Dsize);
+	tmpname=dyn_sprintf("%s.tmp",dmcName);
+	lockname=dyn_sprintf("%s.lck",dmcName);
+	// create directory if needed (otherwise creation of lock file will hang); the test file is overwritten below anyway
+	if (IFROOT) {
+		if ((file=fopen(tmpname,"ab"))==NULL) MkDirErr(dmatrix_cache_dir,ONE_POS);
+		else FCloseErr(file,tmpname,ONE_POS);
+	}
+	lockid=CreateLockFile(lockname);
+	if ((file=fopen(tmpname,"wb"))!=NULL) {
+		ok = fwrite(header,1,DMC_HEADER,file)==DMC_HEADER && fwrite(Dmatrix,sizeof(doublecomplex),Dsize,file)==Dsize
+			&& (!surface || fwrite(Rmatrix,sizeof(doublecomplex),Rsize,file)==Rsize);
+		ok = (fclose(file)==0) && ok;
+		remove(dmcName); // required for rename on some systems; the error (e.g. if file does not exist) is ignored
+		if (!ok || rename(tmpname,dmcName)!=0) {
+			LogWarning(EC_WARN,ALL_POS,"Failed to save Dmatrix cache into file '%s'",dmcName);
+			remove(tmpname);
+		}
+	}
+	else LogWarning(EC_WARN,ALL_POS,"Failed to create file '%s' for Dmatrix cache",tmpname);
+	RemoveLockFile(lockid,lockname);
+	Free_general(tmpname);
+	Free_general(lockname);
+}
+
+//======================================================================================================================
+
+#ifdef OOC
+static void InitOutOfCore(void)
+/* switches to out-of-core mode after Dmatrix and Rmatrix have been either computed and saved into the cache file (then
+ * they are freed) or found in the cache. Allocates the buffers for stages and starts the reader thread
+ */
+{
+	int b;
+	const size_t bufsize=oocNpl*oocNx*(DsizeYZ+(surface ? gridZ*RsizeY : 0));
+	const size_t nchunks=(surface ? 2 : 1)*oocNpl*oocNx; // maximum number (for transposed matrices)
+
+	if (!Dm_cached) {
+		Free_cVector(Dmatrix);
+		if (surface) Free_cVector(Rmatrix);
+	}
+	Dmatrix=Rmatrix=NULL;
+	for (b=0;b<oocNbuf;b++) {
+		MALLOC_VECTOR(oocBuf[b],complex,bufsize,ALL);
+		oocChunks[b]=voidVector(nchunks*sizeof(struct oocChunk),ALL_POS,"oocChunks");
+		oocTag[b]=SIZE_MAX;
+	}
+	oocCur=0;
+	OocOpen(dmcName);
+	if (IFROOT) PrintBoth(logfile,"Interaction matrices are read from cache during MatVec in %zu portion(s) of %zu "
+		"x-slice(s)\n",oocNst,oocNx);
+}
+#endif
+
+#endif // !OPENCL
+
+//======================================================================================================================
+
 static void InitRmatrix(const double invNgrid)
 /* Initializes the matrix R. R[i][j][k]=GR[i1-i2][j1-j2][k1+k2]. Actually R=-FFT(GR)/Ngrid. Then -GR.x=invFFT(R*FFT(x))
  * for practical implementation of FFT such that invFFT(FFT(x))=Ngrid*x. GR is exactly reflected Green's tensor. The
@@ -825,6 +2059,8 @@ static void InitRmatrix(const double invNgrid)
 {
 	int i,j,k,Rcomp;
 	size_t x,y,z,indexfrom,indexto,ind,index;
+	const size_t Rplane=Rsize/NDCOMP; // size of each component of Rmatrix
+	doublecomplex Gval[NDCOMP]; // values of Green's tensor for a single pair of dipoles
 
 	// allocate memory for Rmatrix (R2matrix is allocated earlier in InitDmatrix)
 	MALLOC_VECTOR(Rmatrix,complex,Rsize,ALL);
@@ -836,8 +2072,9 @@ static void InitRmatrix(const double invNgrid)
 #endif
 	if (IFROOT) printf("Calculating reflected Green's function (Rmatrix)\n");
 	/* Interaction matrix values are calculated all at once for performance reasons. They are stored in Rmatrix with
-	 * indexing corresponding to R2matrix (to facilitate copying) but NDCOMP elements instead of one. Afterwards they
-	 * are replaced by Fourier transforms (with different indexing) component-wise (in cycle over NDCOMP)
+	 * indexing corresponding to R2matrix (to facilitate copying) for each of NDCOMP components (see IndexComp).
+	 * Afterwards they are replaced by Fourier transforms (with different indexing) component-wise (in cycle over
+	 * NDCOMP). The final layout of each component does not overlap with the initial layout of other components.
 	 */
 	/* fill Rmatrix with 0, this if to fill the possible gap between e.g. boxY and gridY/2; (and for R=0) probably
 	 * faster than using a lot of conditionals
@@ -845,13 +2082,14 @@ static void InitRmatrix(const double invNgrid)
 	for (ind=0;ind<Rsize;ind++) Rmatrix[ind]=0;
 	// fill Rmatrix with values of reflected Green's tensor
 	for(k=0;k<local_Nz_Rm;k++) for (j=jstartR;j<boxY;j++) for (i=1-boxX;i<boxX;i++) {
-			index=NDCOMP*Index2matrix(i,j,k,R2sizeY);
-			(*ReflTerm_int)(i,j,k,Rmatrix+index);
+			index=Index2matrix(i,j,k,R2sizeY);
+			(*ReflTerm_int)(i,j,k,Gval);
+			for (Rcomp=0;Rcomp<NDCOMP;Rcomp++) Rmatrix[IndexComp(index,Rcomp,Rplane)]=Gval[Rcomp];
 	} // end of i,j,k loop
 	if (IFROOT) printf("Fourier transform of Rmatrix");
 	for(Rcomp=0;Rcomp<NDCOMP;Rcomp++) { // main cycle over components of Rmatrix
 		// fill R2matrix with precomputed values from Rmatrix
-		for (ind=0;ind<R2sizeTot;ind++) R2matrix[ind]=Rmatrix[NDCOMP*ind+Rcomp];
+		for (ind=0;ind<R2sizeTot;ind++) R2matrix[ind]=Rmatrix[IndexComp(ind,Rcomp,Rplane)];
 		fftX_Rm(); // fftX R2matrix
 		BlockTranspose_DRm(R2matrix,R2sizeY,lz_Rm);
 		for(x=local_x0;x<local_x1;x++) {
@@ -872,10 +2110,10 @@ static void InitRmatrix(const double invNgrid)
 				else slice[indexto]=slice[indexfrom];
 			}
 			fftZ_slice(); // fftZ slice
-			transpose(slice,slice_tr,gridY,gridZ);
+			transpose(slice,slice_tr,gridY,gridZ,gridZ,gridY);
 			fftY_slice(); // fftY slice_tr
 			for(z=0;z<gridZ;z++) for(y=0;y<RsizeY;y++) {
-				indexto=IndexRmatrix(x-local_x0,y,z)+Rcomp;
+				indexto=IndexRmatrix(x-local_x0,y,z,Rcomp);
 				indexfrom=IndexSlice_zy(y,z);
 				Rmatrix[indexto]=-invNgrid*slice_tr[indexfrom];
 			}
@@ -922,8 +2160,9 @@ void InitDmatrix(void)
  */
 {
 	int i,j,k,kcor,Dcomp;
-	size_t x,y,z,indexfrom,indexto,ind,index,Dsize,D2sizeTot;
+	size_t x,y,z,indexfrom,indexto,ind,index,Dsize,Dplane,D2sizeTot;
 	double invNgrid;
+	doublecomplex Gval[NDCOMP]; // values of Green's tensor for a single pair of dipoles
 	int nnn; // multiplier used for reduced_FFT or not reduced; 1 or 2
 	int jstart,kstart;
 	TIME_TYPE start,time1;
@@ -973,8 +2212,11 @@ void InitDmatrix(void)
 	DsizeYZ=DsizeY*DsizeZ;
 	invNgrid=1.0/(gridX*((double)gridYZ));
 	local_Nsmall=(gridX/2)*(gridYZ/(2*nprocs)); // size of X vector (for 1 component)
+	// larger batches are never filled in MatVec
+	if ((size_t)slice_batch>local_Nx) slice_batch=(int)local_Nx;
 	// potentially this may cause unnecessary error during prognosis, but makes code cleaner
 	Dsize=MultOverflow(NDCOMP*local_Nx,DsizeYZ,ONE_POS_FUNC);
+	Dplane=Dsize/NDCOMP; // size of each component of Dmatrix
 	D2sizeTot=nnn*local_Nz*D2sizeY*gridX; // this should be approximately equal to Dsize/NDCOMP
 	if (IFROOT) fprintf(logfile,"The FFT grid is: %zux%zux%zu\n",gridX,gridY,gridZ);
 
@@ -1170,14 +2412,48 @@ void InitDmatrix(void)
 #ifndef OPENCL
 	/* allocated memory that is used further on (Dmatrix,Xmatrix,slices,slices_tr), not relevant for OpenCL version;
 	 * we assume that it is always larger than memPeak above (so memPeak doesn't have to be adjusted). In particular,
-	 * we ignore the memory, which is temporarily allocated for BlockTranspose buffers of Dm and Rm.
+	 * we ignore the memory, which is temporarily allocated for BlockTranspose buffers of Dm and Rm. Slices are
+	 * allocated separately for each thread.
+	 */
+	const double memSlices=sizeof(doublecomplex)*2*mv_ncomp*gridYZ*(double)nthreads*slice_batch;
+	/* for Dmatrix and Rmatrix; the reflected term of MatVec is obtained from the same (transformed) slices, so no
+	 * additional slices are required for the latter
+	 */
+	double memDR=sizeof(doublecomplex)*((double)Dsize+(surface ? (double)Rsize : 0));
+#	ifdef OOC
+	if (ooc_Dm) { // only the buffers for stages are stored (see DmStageLoad)
+		oocNx=MAX(MIN((size_t)nthreads*slice_batch,local_Nx),1);
+		oocNst=(local_Nx+oocNx-1)/oocNx;
+		oocNpl = lean_matvec ? 1 : NDCOMP;
+		// a single buffer is enough, if its contents is never changed
+		oocNbuf = (oocNst>1 || lean_matvec || !reduced_FFT) ? OOC_NBUF : 1;
+		memDR=sizeof(doublecomplex)*oocNbuf*(double)oocNpl*oocNx*(DsizeYZ+(surface ? gridZ*RsizeY : 0));
+	}
+#	endif
+	double mem=sizeof(doublecomplex)*mv_ncomp*(double)local_Nsmall+memDR+memSlices;
+	/* part of the above (together with BlockTranspose buffers below), which scales with the number of components; it is
+	 * used to compute the exact gain of lean mode
 	 */
-	double mem=sizeof(doublecomplex)*((double)Dsize+3*local_Nsmall+6*gridYZ);
-	if (surface) mem+=sizeof(doublecomplex)*((double)Rsize+6*gridYZ); // for Rmatrix, slicesR, and slicesR_tr
+	double memComp=sizeof(doublecomplex)*((double)local_Nsmall+2*gridYZ*(double)nthreads*slice_batch);
+	mem+=sizeof(size_t)*((double)local_nvoid_Ndip+boxY*(double)boxZ); // Xindex and garbledYZ
+#	ifdef MIXED_PREC
+	// single-precision copies of Dmatrix and Rmatrix; other arrays are shared with double-precision MatVec
+	if (mixed_prec) mem+=sizeof(floatcomplex)*((double)Dsize+(surface ? (double)Rsize : 0));
+#	endif
 #ifdef PARALLEL
-	const size_t BTsize = 6*smallY*local_Nz*local_Nx; // in doubles
+	const size_t BTsize = 2*mv_ncomp*smallY*local_Nz*local_Nx; // in doubles
 	mem+=2*BTsize*sizeof(double);
+	memComp+=4*smallY*local_Nz*local_Nx*sizeof(double);
 #endif
+	/* In lean mode all further memory peaks are decreased by memLean (compared to '-opt speed'), while the
+	 * current memPeak (determined by initialization of Dmatrix) is not affected. So the former is tracked separately
+	 * starting from here, and the exact decrease of the peak memory is computed in AllocateEverything (calculator.c)
+	 */
+	if (lean_matvec) {
+		memLean=(3*nrhs-mv_ncomp)*memComp;
+		memPeakDm=memPeak;
+		memPeak=0;
+	}
 	// printout some information
 	if (IFROOT) {
 #ifdef PARALLEL
@@ -1185,180 +2461,314 @@ void InitDmatrix(void)
 #else
 		PrintBoth(logfile,"Memory usage for MatVec matrices: "FFORMM" MB\n",mem/MBYTE);
 #endif
+		if (slice_batch>1) PrintBoth(logfile,"  including slices (in batches of %d): "FFORMM" MB\n",slice_batch,
+			memSlices/MBYTE);
+		if (lean_matvec) PrintBoth(logfile,"  decreased by "FFORMM" MB due to '-opt lean' (at the cost of 9+9 "
+			"instead of 3+3 3D FFTs per MatVec for each incident polarization)\n",memLean/MBYTE);
+#	ifdef OOC
+		if (ooc_Dm) PrintBoth(logfile,"  including buffers for out-of-core interaction matrices: "FFORMM" MB\n",
+			memDR/MBYTE);
+#	endif
 	}
 	memory+=mem;
 #endif
 	if (prognosis) return;
-	// allocate memory for Dmatrix
-	MALLOC_VECTOR(Dmatrix,complex,Dsize,ALL);
-	// allocate memory for D2matrix components
-	MALLOC_VECTOR(D2matrix,complex,D2sizeTot,ALL);
-	MALLOC_VECTOR(slice,complex,gridYZ,ALL);
-	MALLOC_VECTOR(slice_tr,complex,gridYZ,ALL);
-	/* allocate memory for R2matrix components. In principle, this can be done after D2 matrix is freed. However, this
-	 * way allows us to init all FFT routines (in particular, build FFTW plans) in one go. Moreover, this should not
-	 * increase the peak memory, since Rmatrix is allocated further on (see above).
-	 */
-	if (surface) MALLOC_VECTOR(R2matrix,complex,R2sizeTot,ALL);
-	// actually allocation of Xmatrix, slices, slices_tr is below after freeing of Dmatrix and its slice
+#ifndef OPENCL
+	OpenDmatrixCache(Dsize);
+#endif
+	if (!Dm_cached) {
+		// allocate memory for Dmatrix
+		MALLOC_VECTOR(Dmatrix,complex,Dsize,ALL);
+		// allocate memory for D2matrix components
+		MALLOC_VECTOR(D2matrix,complex,D2sizeTot,ALL);
+		MALLOC_VECTOR(slice,complex,gridYZ,ALL);
+		MALLOC_VECTOR(slice_tr,complex,gridYZ,ALL);
+		/* allocate memory for R2matrix components. In principle, this can be done after D2 matrix is freed. However,
+		 * this way allows us to init all FFT routines (in particular, build FFTW plans) in one go. Moreover, this
+		 * should not increase the peak memory, since Rmatrix is allocated further on (see above).
+		 */
+		if (surface) MALLOC_VECTOR(R2matrix,complex,R2sizeTot,ALL);
+		// actually allocation of Xmatrix, slices, slices_tr is below after freeing of Dmatrix and its slice
 #ifdef PARALLEL
-	// allocate buffer for BlockTranspose_Dm
-	size_t bufsize = 2*lz_Dm*D2sizeY*local_Nx;
-	MALLOC_VECTOR(BT_buffer,double,bufsize,ALL);
-	MALLOC_VECTOR(BT_rbuffer,double,bufsize,ALL);
+		// allocate buffer for BlockTranspose_Dm
+		size_t bufsize = 2*lz_Dm*D2sizeY*local_Nx;
+		MALLOC_VECTOR(BT_buffer,double,bufsize,ALL);
+		MALLOC_VECTOR(BT_rbuffer,double,bufsize,ALL);
 #endif
+	}
 	D("Initialize FFT (1st part)");
 	fftInitBeforeD();
 #ifdef PRECISE_TIMING
 	GET_SYSTEM_TIME(tvp+1);
 	Elapsed(tvp,tvp+1,&Timing_beg); // it includes a lot of OpenCL stuff
 #endif
-	if (IFROOT) printf("Calculating Green's function (Dmatrix)\n");
-	/* Interaction matrix values are calculated all at once for performance reasons. They are stored in Dmatrix with
-	 * indexing corresponding to D2matrix (to facilitate copying) but NDCOMP elements instead of one. Afterwards they
-	 * are replaced by Fourier transforms (with different indexing) component-wise (in cycle over NDCOMP)
-	 */
-	/* fill Dmatrix with 0, this if to fill the possible gap between e.g. boxY and gridY/2; (and for R=0) probably
-	 * faster than using a lot of conditionals
-	 */
-	for (ind=0;ind<Dsize;ind++) Dmatrix[ind]=0;
-	// fill Dmatrix with values of Green's tensor
-	for(k=nnn*local_z0;k<nnn*local_z1;k++) {
-		// correction of k is relevant only if reduced_FFT is not used
-		if (k>(int)smallZ) kcor=k-gridZ;
-		else kcor=k;
-		for (j=jstart;j<boxY;j++) for (i=1-boxX;i<boxX;i++) {
-			index=NDCOMP*Index2matrix(i,j,k-nnn*local_z0,D2sizeY);
-			/* The test for zero distance is somewhat non-optimal. However, other alternatives are not perfect either:
-			 * 1) complicate the loops to remove the zero element in the beginning (move tests to the upper level)
-			 * 2) call the function with zero - it will produce NaN. Then set this element to zero after the loop.
-			 */
-			if (i!=0 || j!=0 || kcor!=0) (*InterTerm_int)(i,j,kcor,Dmatrix+index);
-		}
-	} // end of i,j,k loop
-	if (IFROOT) printf("Fourier transform of Dmatrix");
+	if (Dm_cached) {
+		if (IFROOT) PrintBoth(logfile,"Fourier-transformed interaction matrices are loaded from cache '%s'\n",dmcName);
+#ifdef PRECISE_TIMING
+		GET_SYSTEM_TIME(tvp+11);
+#endif
+	}
+	else {
+		if (IFROOT) printf("Calculating Green's function (Dmatrix)\n");
+		/* Interaction matrix values are calculated all at once for performance reasons. They are stored in Dmatrix with
+		 * indexing corresponding to D2matrix (to facilitate copying) for each of NDCOMP components (see IndexComp).
+		 * Afterwards they are replaced by Fourier transforms (with different indexing) component-wise (in cycle over
+		 * NDCOMP). The final layout of each component does not overlap with the initial layout of other components.
+		 */
+		/* fill Dmatrix with 0, this if to fill the possible gap between e.g. boxY and gridY/2; (and for R=0) probably
+		 * faster than using a lot of conditionals
+		 */
+		for (ind=0;ind<Dsize;ind++) Dmatrix[ind]=0;
+		/* fill Dmatrix with values of Green's tensor. The loop is over rows along x, which are distributed among
+		 * threads, when a thread-safe row-batched version of the Green's tensor is available. Otherwise, the elements
+		 * are computed one by one in a single thread.
+		 */
+		const int rowN=2*boxX-1; // number of elements in a row
+		const int nrowsY=boxY-jstart;
+		const int nrows=nnn*(local_z1-local_z0)*nrowsY;
+		const bool byRows=(InterTerm_row!=NULL);
+		int row;
+		doublecomplex * restrict Grow=NULL; // values of Green's tensor for a row (for each thread)
+		if (byRows) MALLOC_VECTOR(Grow,complex,(size_t)NDCOMP*rowN*nthreads,ALL);
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(dynamic) private(i,j,k,kcor,index,Dcomp,Gval) if(byRows)
+#endif
+		for (row=0;row<nrows;row++) {
+			k=nnn*local_z0+row/nrowsY;
+			j=jstart+row%nrowsY;
+			// correction of k is relevant only if reduced_FFT is not used
+			if (k>(int)smallZ) kcor=k-gridZ;
+			else kcor=k;
+			if (byRows) {
+				doublecomplex * restrict Gr=Grow+THREAD_ID*NDCOMP*rowN;
+				// zero distance is excluded by splitting the row in two parts
+				if (j==0 && kcor==0) {
+					(*InterTerm_row)(1-boxX,boxX-1,j,kcor,Gr);
+					(*InterTerm_row)(1,boxX-1,j,kcor,Gr+NDCOMP*boxX);
+				}
+				else (*InterTerm_row)(1-boxX,rowN,j,kcor,Gr);
+				for (i=1-boxX;i<boxX;i++) if (i!=0 || j!=0 || kcor!=0) {
+					index=Index2matrix(i,j,k-nnn*local_z0,D2sizeY);
+					for (Dcomp=0;Dcomp<NDCOMP;Dcomp++)
+						Dmatrix[IndexComp(index,Dcomp,Dplane)]=Gr[NDCOMP*(i+boxX-1)+Dcomp];
+				}
+			}
+			else for (i=1-boxX;i<boxX;i++) {
+				index=Index2matrix(i,j,k-nnn*local_z0,D2sizeY);
+				/* The test for zero distance is somewhat non-optimal. However, other alternatives are not perfect
+				 * either: 1) complicate the loops to remove the zero element at the start (move tests to upper level)
+				 * 2) call the function with zero - it will produce NaN. Then set this element to zero after the loop.
+				 */
+				if (i!=0 || j!=0 || kcor!=0) {
+					(*InterTerm_int)(i,j,kcor,Gval);
+					for (Dcomp=0;Dcomp<NDCOMP;Dcomp++) Dmatrix[IndexComp(index,Dcomp,Dplane)]=Gval[Dcomp];
+				}
+			}
+		} // end of rows loop
+		if (byRows) Free_cVector(Grow);
+		if (IFROOT) printf("Fourier transform of Dmatrix");
 #ifdef PRECISE_TIMING
-	GET_SYSTEM_TIME(tvp+11); // same as the last time-stamp in the following loop
-	Elapsed(tvp+1,tvp+11,&Timing_Gcalc);
+		GET_SYSTEM_TIME(tvp+11); // same as the last time-stamp in the following loop
+		Elapsed(tvp+1,tvp+11,&Timing_Gcalc);
 #endif
-	for(Dcomp=0;Dcomp<NDCOMP;Dcomp++) { // main cycle over components of Dmatrix
+		for(Dcomp=0;Dcomp<NDCOMP;Dcomp++) { // main cycle over components of Dmatrix
 #ifdef PRECISE_TIMING
-		GET_SYSTEM_TIME(tvp+2);
-		ElapsedInc(tvp+11,tvp+2,&Timing_InitMV);
+			GET_SYSTEM_TIME(tvp+2);
+			ElapsedInc(tvp+11,tvp+2,&Timing_InitMV);
 #endif
-		// fill D2matrix with precomputed values from Dmatrix
-		for (ind=0;ind<D2sizeTot;ind++) D2matrix[ind]=Dmatrix[NDCOMP*ind+Dcomp];
+			// fill D2matrix with precomputed values from Dmatrix
+			for (ind=0;ind<D2sizeTot;ind++) D2matrix[ind]=Dmatrix[IndexComp(ind,Dcomp,Dplane)];
 #ifdef PRECISE_TIMING
-		GET_SYSTEM_TIME(tvp+3);
-		ElapsedInc(tvp+2,tvp+3,&Timing_ar1);
+			GET_SYSTEM_TIME(tvp+3);
+			ElapsedInc(tvp+2,tvp+3,&Timing_ar1);
 #endif
-		fftX_Dm(); // fftX D2matrix
+			fftX_Dm(); // fftX D2matrix
 #ifdef PRECISE_TIMING
-		GET_SYSTEM_TIME(tvp+4);
-		ElapsedInc(tvp+3,tvp+4,&Timing_fftX);
+			GET_SYSTEM_TIME(tvp+4);
+			ElapsedInc(tvp+3,tvp+4,&Timing_fftX);
 #endif
-		BlockTranspose_DRm(D2matrix,D2sizeY,lz_Dm);
+			BlockTranspose_DRm(D2matrix,D2sizeY,lz_Dm);
 #ifdef PRECISE_TIMING
-		GET_SYSTEM_TIME(tvp+5);
-		ElapsedInc(tvp+4,tvp+5,&Timing_BT);
+			GET_SYSTEM_TIME(tvp+5);
+			ElapsedInc(tvp+4,tvp+5,&Timing_BT);
 #endif
-		for(x=local_x0;x<local_x1;x++) {
+			for(x=local_x0;x<local_x1;x++) {
 #ifdef PRECISE_TIMING
-			GET_SYSTEM_TIME(tvp+6);
+				GET_SYSTEM_TIME(tvp+6);
 #endif
-			for (ind=0;ind<gridYZ;ind++) slice[ind]=0.0; // fill slice with 0.0
-			for(j=jstart;j<boxY;j++) for(k=kstart;k<boxZ;k++) {
-				indexfrom=IndexGarbledD(x,j,k);
-				indexto=IndexSliceD2matrix(j,k);
-				slice[indexto]=D2matrix[indexfrom];
-			}
-			if (reduced_FFT) { // here a specific symmetry is used, that G is a combination of tensors I and RR/|R|^2
-				for(j=1;j<boxY;j++) for(k=0;k<boxZ;k++) {
-					// mirror along y
-					indexfrom=IndexSliceD2matrix(j,k);
-					indexto=IndexSliceD2matrix(-j,k);
-					if (Dcomp==1 || Dcomp==4) slice[indexto]=-slice[indexfrom];
-					else slice[indexto]=slice[indexfrom];
+				for (ind=0;ind<gridYZ;ind++) slice[ind]=0.0; // fill slice with 0.0
+				for(j=jstart;j<boxY;j++) for(k=kstart;k<boxZ;k++) {
+					indexfrom=IndexGarbledD(x,j,k);
+					indexto=IndexSliceD2matrix(j,k);
+					slice[indexto]=D2matrix[indexfrom];
 				}
-				for(j=1-boxY;j<boxY;j++) for(k=1;k<boxZ;k++) {
-					// mirror along z
-					indexfrom=IndexSliceD2matrix(j,k);
-					indexto=IndexSliceD2matrix(j,-k);
-					if (Dcomp==2 || Dcomp==4) slice[indexto]=-slice[indexfrom];
-					else slice[indexto]=slice[indexfrom];
+				if (reduced_FFT) { // here a specific symmetry is used: G is a combination of tensors I and RR/|R|^2
+					for(j=1;j<boxY;j++) for(k=0;k<boxZ;k++) {
+						// mirror along y
+						indexfrom=IndexSliceD2matrix(j,k);
+						indexto=IndexSliceD2matrix(-j,k);
+						if (Dcomp==1 || Dcomp==4) slice[indexto]=-slice[indexfrom];
+						else slice[indexto]=slice[indexfrom];
+					}
+					for(j=1-boxY;j<boxY;j++) for(k=1;k<boxZ;k++) {
+						// mirror along z
+						indexfrom=IndexSliceD2matrix(j,k);
+						indexto=IndexSliceD2matrix(j,-k);
+						if (Dcomp==2 || Dcomp==4) slice[indexto]=-slice[indexfrom];
+						else slice[indexto]=slice[indexfrom];
+					}
 				}
-			}
 #ifdef PRECISE_TIMING
-			GET_SYSTEM_TIME(tvp+7);
-			ElapsedInc(tvp+6,tvp+7,&Timing_ar2);
+				GET_SYSTEM_TIME(tvp+7);
+				ElapsedInc(tvp+6,tvp+7,&Timing_ar2);
 #endif
-			fftZ_slice(); // fftZ slice
+				fftZ_slice(); // fftZ slice
 #ifdef PRECISE_TIMING
-			GET_SYSTEM_TIME(tvp+8);
-			ElapsedInc(tvp+7,tvp+8,&Timing_fftZ);
+				GET_SYSTEM_TIME(tvp+8);
+				ElapsedInc(tvp+7,tvp+8,&Timing_fftZ);
 #endif
-			transpose(slice,slice_tr,gridY,gridZ);
+				transpose(slice,slice_tr,gridY,gridZ,gridZ,gridY);
 #ifdef PRECISE_TIMING
-			GET_SYSTEM_TIME(tvp+9);
-			ElapsedInc(tvp+8,tvp+9,&Timing_TYZ);
+				GET_SYSTEM_TIME(tvp+9);
+				ElapsedInc(tvp+8,tvp+9,&Timing_TYZ);
 #endif
-			fftY_slice(); // fftY slice_tr
+				fftY_slice(); // fftY slice_tr
 #ifdef PRECISE_TIMING
-			GET_SYSTEM_TIME(tvp+10);
-			ElapsedInc(tvp+9,tvp+10,&Timing_fftY);
+				GET_SYSTEM_TIME(tvp+10);
+				ElapsedInc(tvp+9,tvp+10,&Timing_fftY);
 #endif
-			for(z=0;z<DsizeZ;z++) for(y=0;y<DsizeY;y++) {
-				indexto=IndexDmatrix(x-local_x0,y,z)+Dcomp;
-				indexfrom=IndexSlice_zy(y,z);
-				Dmatrix[indexto]=-invNgrid*slice_tr[indexfrom];
-			}
+				for(z=0;z<DsizeZ;z++) for(y=0;y<DsizeY;y++) {
+					indexto=IndexDmatrix(x-local_x0,y,z,Dcomp);
+					indexfrom=IndexSlice_zy(y,z);
+					Dmatrix[indexto]=-invNgrid*slice_tr[indexfrom];
+				}
 #ifdef PRECISE_TIMING
-			GET_SYSTEM_TIME(tvp+11);
-			ElapsedInc(tvp+10,tvp+11,&Timing_ar3);
+				GET_SYSTEM_TIME(tvp+11);
+				ElapsedInc(tvp+10,tvp+11,&Timing_ar3);
 #endif
-		} // end slice X
-		if (IFROOT) printf(".");
-	} // end of Dcomp
-	if (IFROOT) printf("\n");
-	// free vectors used for computation of Dmatrix; slice and slice_tr are freed after InitRmatrix
-	Free_cVector(D2matrix);
+			} // end slice X
+			if (IFROOT) printf(".");
+		} // end of Dcomp
+		if (IFROOT) printf("\n");
+		// free vectors used for computation of Dmatrix; slice and slice_tr are freed after InitRmatrix
+		Free_cVector(D2matrix);
 #ifdef PARALLEL
-	// deallocate buffers for BlockTranspose_DRm
-	Free_general(BT_buffer);
-	Free_general(BT_rbuffer);
+		// deallocate buffers for BlockTranspose_DRm
+		Free_general(BT_buffer);
+		Free_general(BT_rbuffer);
 #endif
 #ifdef OPENCL
-	// copy Dmatrix to OpenCL buffer, blocking to ensure completion before function end
-	CL_CH_ERR(clEnqueueWriteBuffer(command_queue,bufDmatrix,CL_TRUE,0,Dsize*sizeof(*Dmatrix),Dmatrix,0,NULL,NULL));
-	Free_cVector(Dmatrix);
+		// copy Dmatrix to OpenCL buffer, blocking to ensure completion before function end
+		CL_CH_ERR(clEnqueueWriteBuffer(command_queue,bufDmatrix,CL_TRUE,0,Dsize*sizeof(*Dmatrix),Dmatrix,0,NULL,NULL));
+		Free_cVector(Dmatrix);
 #endif
-	if (surface) { // only the total execution time of InitRmatrix is timed
+		if (surface) { // only the total execution time of InitRmatrix is timed
 #ifdef PRECISE_TIMING
-			GET_SYSTEM_TIME(tvp+12);
+				GET_SYSTEM_TIME(tvp+12);
 #endif
-			InitRmatrix(invNgrid);
-			Free_cVector(R2matrix); // free it here since it was allocated above
+				InitRmatrix(invNgrid);
+				Free_cVector(R2matrix); // free it here since it was allocated above
 #ifdef PRECISE_TIMING
-			GET_SYSTEM_TIME(tvp+13);
-			t_Rm=DiffSystemTime(tvp+12,tvp+13);
+				GET_SYSTEM_TIME(tvp+13);
+				t_Rm=DiffSystemTime(tvp+12,tvp+13);
+#endif
+		}
+		Free_cVector(slice);
+		Free_cVector(slice_tr);
+#ifndef OPENCL
+		SaveDmatrixCache(Dsize);
 #endif
 	}
-	Free_cVector(slice);
-	Free_cVector(slice_tr);
+#if defined(OOC) && !defined(OPENCL)
+	if (ooc_Dm) InitOutOfCore();
+#endif
 #ifdef PARALLEL
 	// allocate buffers for BlockTranspose
 	MALLOC_VECTOR(BT_buffer,double,BTsize,ALL);
 	MALLOC_VECTOR(BT_rbuffer,double,BTsize,ALL);
 #endif
 #ifndef OPENCL
-	// allocate memory for Xmatrix, slices and slices_tr - used in matvec
-	MALLOC_VECTOR(Xmatrix,complex,3*local_Nsmall,ALL);
-	MALLOC_VECTOR(slices,complex,3*gridYZ,ALL);
-	MALLOC_VECTOR(slices_tr,complex,3*gridYZ,ALL);
-	if (surface) { // additional slices for reflection interaction
-		MALLOC_VECTOR(slicesR,complex,3*gridYZ,ALL);
-		MALLOC_VECTOR(slicesR_tr,complex,3*gridYZ,ALL);
+	// allocate memory for Xmatrix, slices and slices_tr (one set per thread) - used in matvec
+	const size_t slsize=mv_ncomp*gridYZ*(size_t)nthreads*slice_batch;
+	MALLOC_VECTOR(Xmatrix,complex,mv_ncomp*local_Nsmall,ALL);
+	MALLOC_VECTOR(slices,complex,slsize,ALL);
+	MALLOC_VECTOR(slices_tr,complex,slsize,ALL);
+#	ifdef MIXED_PREC
+	// allocated memory has no declared type, so it can be accessed as floatcomplex (only in single-precision MatVec)
+	IGNORE_WARNING(-Wstrict-aliasing);
+	Xmatrix_sp=(floatcomplex *)Xmatrix;
+	slices_sp=(floatcomplex *)slices;
+	slices_tr_sp=(floatcomplex *)slices_tr;
+	STOP_IGNORE;
+#	endif
+	/* unused slices of a partial batch are still transformed in MatVec, so they should contain finite values from the
+	 * beginning
+	 */
+	for (ind=0;ind<slsize;ind++) slices[ind]=0;
+	// indices of dipoles and slice elements in Xmatrix, to avoid their recomputation in each MatVec
+	MALLOC_VECTOR(Xindex,sizet,local_nvoid_Ndip,ALL);
+	for (ind=0;ind<local_nvoid_Ndip;ind++)
+		Xindex[ind]=((size_t)position[3*ind+2]*smallY+position[3*ind+1])*gridX+position[3*ind];
+	MALLOC_VECTOR(garbledYZ,sizet,boxY*(size_t)boxZ,ALL);
+	for (y=0;y<(size_t)boxY;y++) for (z=0;z<(size_t)boxZ;z++) {
+#	ifdef PARALLEL
+		garbledYZ[y*boxZ+z]=((z%local_Nz)*smallY+y)*gridX+(z/local_Nz)*local_Nx;
+#	else
+		garbledYZ[y*boxZ+z]=(z*smallY+y)*gridX;
+#	endif
+	}
+	MALLOC_VECTOR(twiddleY,complex,boxY,ALL);
+	for (y=0;y<(size_t)boxY;y++) twiddleY[y]=imExp(-2*PI*(double)y/(double)gridY);
+#	ifdef MIXED_PREC
+	if (mixed_prec) { // single-precision copies are obtained from the final matrices (either computed or cached)
+		Dmatrix_sp=voidVector(Dsize*sizeof(floatcomplex),ALL_POS,"Dmatrix_sp");
+		for (ind=0;ind<Dsize;ind++) Dmatrix_sp[ind]=(floatcomplex)Dmatrix[ind];
+		if (surface) {
+			Rmatrix_sp=voidVector(Rsize*sizeof(floatcomplex),ALL_POS,"Rmatrix_sp");
+			for (ind=0;ind<Rsize;ind++) Rmatrix_sp[ind]=(floatcomplex)Rmatrix[ind];
+		}
+		twiddleY_sp=voidVector(boxY*sizeof(floatcomplex),ALL_POS,"twiddleY_sp");
+		for (y=0;y<(size_t)boxY;y++) twiddleY_sp[y]=(floatcomplex)twiddleY[y];
+	}
+#	endif
+	/* indices and signs for rows of Dmatrix and Rmatrix. For each y in slices_tr the corresponding frequency is reduced
+	 * (for reduced_FFT) and then put at its place in the matrix row (see StoredY). For transposed matrices the
+	 * frequency is negated, while reduced_FFT is never used
+	 */
+	MALLOC_VECTOR(posY,sizet,gridY,ALL);
+	MALLOC_VECTOR(sgnY,double,2*gridY,ALL);
+	for (y=0;y<gridY;y++) {
+		ind=FreqY(y);
+		if (ind>=DsizeY) {
+			posY[y]=StoredY(gridY-ind);
+			sgnY[2*y]=sgnY[2*y+1]=-1;
+		}
+		else {
+			posY[y]=StoredY(ind);
+			sgnY[2*y]=sgnY[2*y+1]=1;
+		}
+	}
+	rowDR.n=gridY;
+	rowDR.ldv=gridYZ;
+	rowDR.ldD=local_Nx*DsizeYZ;
+	rowDR.ldR=surface ? local_Nx*gridZ*RsizeY : 0;
+#	ifdef OOC
+	if (ooc_Dm) { // buffers contain oocNx x-slices, and a single component in lean mode (see DmStageLoad)
+		rowDR.ldD = (oocNpl>1) ? oocNx*DsizeYZ : 0;
+		rowDR.ldR = (surface && oocNpl>1) ? oocNx*gridZ*RsizeY : 0;
+	}
+#	endif
+	rowDR.ind=posY;
+	rowDR.sgn=sgnY;
+	if (!reduced_FFT) {
+		MALLOC_VECTOR(posYT,sizet,gridY,ALL);
+		for (y=0;y<gridY;y++) posYT[y]=StoredY((gridY-FreqY(y))%gridY);
+		rowDR_T=rowDR;
+		rowDR_T.ind=posYT;
 	}
+	const char *rmName;
+	RowMult=SelectRowMult(&rmName);
+	if (IFROOT) fprintf(logfile,"Kernel for products with Fourier-transformed interaction matrix: %s\n",rmName);
 #endif
 	time1=GET_TIME();
 	Timing_Dm_Init=time1-start;
@@ -1390,6 +2800,11 @@ void InitDmatrix(void)
 		t_Tot-=t_Rm;
 	}
 
+#	ifdef OPENMP
+	if (IFROOT) PrintBoth(logfile,"Number of threads: %d\n",nthreads);
+#	endif
+	if (IFROOT) PrintBoth(logfile,"Green's tensor (Gcalc) is computed %s using %d thread(s)\n",
+		(InterTerm_row==NULL) ? "element-wise" : "by rows",(InterTerm_row==NULL) ? 1 : nthreads);
 	if (IFROOT) PrintBoth(logfile,
 		"~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n"
 		"            Init Dmatrix timing            \n"
@@ -1457,15 +2872,39 @@ void Free_FFT_Dmat(void)
 #	endif
 	if (oclMem>0) LogWarning(EC_WARN,ALL_POS,"Possible leak of OpenCL memory (size %zu bytes) detected",oclMem);
 #else
-	Free_cVector(Dmatrix);
+#	ifdef OOC
+	if (ooc_Dm) {
+		int b;
+		OocClose();
+		for (b=0;b<oocNbuf;b++) {
+			Free_cVector(oocBuf[b]);
+			Free_general(oocChunks[b]);
+		}
+	}
+	else
+#	endif
+	if (Dm_cached) {
+#	ifdef DMC_MMAP
+		munmap(dmcMap,dmcSize);
+#	else
+		Free_cVector(Dmatrix);
+		if (surface) Free_cVector(Rmatrix);
+#	endif
+	}
+	else {
+		Free_cVector(Dmatrix);
+		if (surface) Free_cVector(Rmatrix);
+	}
+	Free_general(dmcName);
 	Free_cVector(Xmatrix);
 	Free_cVector(slices);
 	Free_cVector(slices_tr);
-	if (surface) {
-		Free_cVector(Rmatrix);
-		Free_cVector(slicesR);
-		Free_cVector(slicesR_tr);
-	}
+	Free_general(Xindex);
+	Free_general(garbledYZ);
+	Free_cVector(twiddleY);
+	Free_general(posY);
+	Free_general(sgnY);
+	if (!reduced_FFT) Free_general(posYT);
 #	ifdef PARALLEL
 	Free_general(BT_buffer);
 	Free_general(BT_rbuffer);
@@ -1477,11 +2916,21 @@ void Free_FFT_Dmat(void)
 	fftw_destroy_plan(planYb);
 	fftw_destroy_plan(planZf);
 	fftw_destroy_plan(planZb);
-	if (surface) {
-		fftw_destroy_plan(planYRf);
-		fftw_destroy_plan(planZRf);
+	FFTW_CLEANUP();
+#	endif
+#	ifdef MIXED_PREC
+	if (mixed_prec) {
+		Free_general(Dmatrix_sp);
+		if (surface) Free_general(Rmatrix_sp);
+		Free_general(twiddleY_sp);
+		fftwf_destroy_plan(planXf_sp);
+		fftwf_destroy_plan(planXb_sp);
+		fftwf_destroy_plan(planYf_sp);
+		fftwf_destroy_plan(planYb_sp);
+		fftwf_destroy_plan(planZf_sp);
+		fftwf_destroy_plan(planZb_sp);
+		FFTWF_CLEANUP();
 	}
-	fftw_cleanup();
 #	endif
 #endif
 #ifdef FFT_TEMPERTON // these vectors are used even with OpenCL
@@ -1489,5 +2938,16 @@ void Free_FFT_Dmat(void)
 	Free_general(trigsX);
 	Free_general(trigsY);
 	Free_general(trigsZ);
+#	ifndef OPENCL
+	Free_general(trigsYh);
+#	endif
+#elif defined(FFT_BUILTIN)
+	Free_cVector(work);
+	Free_cVector(twX);
+	Free_cVector(twY);
+	Free_cVector(twZ);
+#	ifndef OPENCL
+	Free_cVector(twYh);
+#	endif
 #endif
 }
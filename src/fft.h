@@ -19,7 +19,16 @@
 #ifndef __fft_h
 #define __fft_h
 
-#ifndef FFT_TEMPERTON
+// project headers
+#include "types.h" // for doublecomplex
+// system headers
+#include <stdbool.h>
+#include <stddef.h> // for size_t
+
+#if defined(FFT_TEMPERTON) && defined(FFT_BUILTIN)
+#	error "Only one of FFT_TEMPERTON and FFT_BUILTIN can be used"
+#endif
+#if !defined(FFT_TEMPERTON) && !defined(FFT_BUILTIN)
 #	define FFTW3 // FFTW3 is default
 #endif
 #ifdef OPENCL
@@ -27,19 +36,43 @@
 #		define CLFFT_AMD // CLFFT_AMD is default for OPENCL
 #	endif
 #endif
+#if defined(MIXED_PREC) && (!defined(FFTW3) || defined(OPENCL))
+#	error "Mixed-precision MatVec (MIXED_PREC) requires FFTW3 and is not supported in OpenCL mode"
+#endif
 
-// direction of FFT and transpose; complies with definitions of FFTW3, TempertonFFT, Apple and AMD OpenCL FFTs
+/* direction of FFT and transpose; complies with definitions of FFTW3, TempertonFFT, built-in FFT, Apple and AMD OpenCL
+ * FFTs
+ */
 #define FFT_FORWARD -1
 #define FFT_BACKWARD 1
 
 void fftX(int isign);
-void fftY(int isign);
-void fftZ(int isign);
-void TransposeYZ(int direction);
+void fftY(int isign,size_t th);
+void fftZ(int isign,size_t th);
+void TransposeYZ(int direction,size_t th);
+#ifndef OPENCL
+void MultDRow(doublecomplex * restrict v,const doublecomplex * restrict w,size_t x,size_t z,bool transposed);
+void MultDRowComp(doublecomplex * restrict v,const doublecomplex * restrict w,size_t x,size_t z,bool transposed,
+	int mu,int nu);
+size_t DmStageBatches(size_t nbatch);
+void DmStageLoad(size_t stage,bool transposed,int mu,int nu);
+#endif
+#ifdef MIXED_PREC
+// single-precision versions of the above functions, used in mixed-precision mode
+void fftX_sp(int isign);
+void fftY_sp(int isign,size_t th);
+void fftZ_sp(int isign,size_t th);
+void TransposeYZ_sp(int direction,size_t th);
+void MultDRow_sp(floatcomplex * restrict v,const floatcomplex * restrict w,size_t x,size_t z,bool transposed);
+#endif
 void InitDmatrix(void);
 void Free_FFT_Dmat(void);
 int fftFit(int size, int _div);
 void CheckNprocs(void);
+#ifndef OPENCL
+#	define MAX_GRID_TUNE 8 // maximum number of candidate sizes along each axis for auto-tuning of FFT grid
+void TuneGrid(void);
+#endif
 
 #endif // __fft_h
 
@@ -0,0 +1,467 @@
+/* File: fft_builtin.c
+ * Descr: built-in mixed-radix FFT, which requires neither external libraries nor Fortran (used with option FFT_BUILTIN)
+ *
+ * The transform of each line is a sequence of Stockham stages (see fft_builtin.h). For the stage with radix r, length
+ * of sub-transform n'=r*m, and stride s, the elements x[q+s*(p+k*m)] (k<r) for each p<m and q<s are combined by the
+ * radix-r butterfly, and the j-th output is multiplied by the twiddle factor exp(isign*2*pi*i*p*j/n') and stored into
+ * y[q+s*(r*p+j)]. Vector kernels process two complex numbers at once - consecutive q for s>1 or consecutive p for the
+ * first stage (s=1). The kernels are selected at runtime (fftbKernel), analogous to the ones in fft_ops.h.
+ *
+ * Copyright (C) 2014 ADDA contributors
+ * This file is part of ADDA.
+ *
+ * ADDA is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * ADDA is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with ADDA. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#include "const.h" // keep this first
+#include "fft_builtin.h" // corresponding header
+// project headers
+#include "cmplx.h"    // for imExp
+#include "fft.h"      // for FFT_FORWARD
+#include "function.h" // for ATT_TARGET and SIMD_DISPATCH
+// system headers
+#include <math.h>
+#include <string.h> // for memcpy
+#ifdef SIMD_DISPATCH
+#	include <immintrin.h>
+#endif
+
+// constants of the butterflies
+#define S3 0.86602540378443864676 // sin(2*pi/3)
+#define C5_1 0.30901699437494742410 // cos(2*pi/5)
+#define C5_2 (-0.80901699437494742410) // cos(4*pi/5)
+#define S5_1 0.95105651629515357212 // sin(2*pi/5)
+#define S5_2 0.58778525229247312917 // sin(4*pi/5)
+/* maximum radix processed by vector kernels; larger prime factors are processed by generic code. Radices starting from
+ * 7 use the table of r roots of unity, stored after the twiddle factors of the stage
+ */
+#define MAX_VEC_RADIX 7
+#define TABLE_RADIX 7
+#define MAX_VEC_HALF ((MAX_VEC_RADIX-1)/2)
+
+typedef void (*stageFunc)(const struct fftbStage * restrict st,const doublecomplex * restrict w,
+	const doublecomplex * restrict x,doublecomplex * restrict y,double sgn);
+
+static stageFunc Stage=NULL;   // stage kernel, selected by fftbKernel
+static const char *kernelName; // its name
+
+//======================================================================================================================
+
+static int Factorize(int n,int fact[static FFTB_MAX_STAGES])
+// factorizes n into radices of stages (the order of factors is the order of stages); returns the number of stages
+{
+	int nst=0,f;
+
+	while (n%4==0) {
+		fact[nst++]=4;
+		n/=4;
+	}
+	if (n%2==0) {
+		fact[nst++]=2;
+		n/=2;
+	}
+	for (f=3;n>1;f+=2) while (n%f==0) {
+		fact[nst++]=f;
+		n/=f;
+	}
+	return nst;
+}
+
+//======================================================================================================================
+
+static inline size_t StageTwiddleSize(const int r,const size_t m)
+// number of elements of twiddle table used by a stage with radix r and m butterflies per line
+{
+	return (r-1)*m + ((r>=TABLE_RADIX) ? (size_t)r : 0);
+}
+
+//======================================================================================================================
+
+size_t fftbTwiddleSize(int n)
+// returns the size of twiddle table (in complex numbers) required for a transform of length n
+{
+	int fact[FFTB_MAX_STAGES];
+	int i,nst;
+	size_t len=n,size=0;
+
+	nst=Factorize(n,fact);
+	for (i=0;i<nst;i++) {
+		len/=fact[i];
+		size+=StageTwiddleSize(fact[i],len);
+	}
+	return 2*size; // both for forward and backward transforms
+}
+
+//======================================================================================================================
+
+void fftbInit(struct fftbPlan * restrict plan,const int n,doublecomplex * restrict tw)
+/* initializes plan for transforms of length n, using tw (of size fftbTwiddleSize(n)) to store twiddle factors. tw
+ * should not be freed or changed while the plan is used.
+ */
+{
+	int fact[FFTB_MAX_STAGES];
+	int i,j,r;
+	size_t len,p,m,off,half;
+	struct fftbStage * restrict st;
+	doublecomplex * restrict w;
+
+	plan->n=n;
+	plan->nst=Factorize(n,fact);
+	// first, define stages
+	len=n;
+	off=0;
+	for (i=0;i<plan->nst;i++) {
+		st=plan->st+i;
+		st->r=fact[i];
+		st->m=len/st->r;
+		st->s=n/len;
+		st->tw=off;
+		off+=StageTwiddleSize(st->r,st->m);
+		len=st->m;
+	}
+	half=off;
+	// second, compute twiddle factors; angles are reduced exactly to [0,2*pi) for better accuracy
+	for (i=0;i<plan->nst;i++) {
+		st=plan->st+i;
+		r=st->r;
+		m=st->m;
+		len=r*m;
+		w=tw+st->tw;
+		for (j=1;j<r;j++) for (p=0;p<m;p++) w[(j-1)*m+p]=imExp(-TWO_PI*(double)((p*j)%len)/(double)len);
+		if (r>=TABLE_RADIX) for (j=0;j<r;j++) w[(r-1)*m+j]=imExp(-TWO_PI*j/r);
+	}
+	for (p=0;p<half;p++) tw[half+p]=conj(tw[p]);
+	plan->twf=tw;
+	plan->twb=tw+half;
+	fftbKernel(); // selects kernels, if not done before
+}
+
+//======================================================================================================================
+// generic (scalar) code
+
+static inline void ButterflyOdd_c(const int r,doublecomplex * restrict a,const doublecomplex * restrict tab)
+/* butterfly of odd radix r using the table of roots of unity tab[k]=exp(isign*2*pi*i*k/r). The outputs are obtained in
+ * pairs: y[j],y[r-j] = a[0] + sum_k cos(2*pi*j*k/r)*(a[k]+a[r-k]) +- i*sum_k isign*sin(2*pi*j*k/r)*(a[k]-a[r-k])
+ */
+{
+	const int h=(r-1)/2;
+	int j,k,jk;
+	doublecomplex b[h],d[h],y[r],e,f;
+
+	y[0]=a[0];
+	for (k=1;k<=h;k++) {
+		b[k-1]=a[k]+a[r-k];
+		d[k-1]=I*(a[k]-a[r-k]);
+		y[0]+=b[k-1];
+	}
+	for (j=1;j<=h;j++) {
+		e=a[0];
+		f=0;
+		for (k=1,jk=j;k<=h;k++,jk=(jk+j)%r) {
+			e+=creal(tab[jk])*b[k-1];
+			f+=cimag(tab[jk])*d[k-1];
+		}
+		y[j]=e+f;
+		y[r-j]=e-f;
+	}
+	memcpy(a,y,r*sizeof(doublecomplex));
+}
+
+//======================================================================================================================
+
+static inline void Butterfly_c(const int r,doublecomplex * restrict a,const doublecomplex * restrict tab,
+	const double sgn)
+// in-place butterfly of radix r; sgn is isign, tab is used only for r>=TABLE_RADIX
+{
+	doublecomplex t0,t1,t2,t3;
+
+	switch (r) {
+		case 2:
+			t0=a[1];
+			a[1]=a[0]-t0;
+			a[0]+=t0;
+			break;
+		case 3:
+			t0=a[1]+a[2];
+			t1=a[0]-0.5*t0;
+			t2=(sgn*S3*I)*(a[1]-a[2]);
+			a[0]+=t0;
+			a[1]=t1+t2;
+			a[2]=t1-t2;
+			break;
+		case 4:
+			t0=a[0]+a[2];
+			t1=a[0]-a[2];
+			t2=a[1]+a[3];
+			t3=(sgn*I)*(a[1]-a[3]);
+			a[0]=t0+t2;
+			a[2]=t0-t2;
+			a[1]=t1+t3;
+			a[3]=t1-t3;
+			break;
+		case 5: {
+			const doublecomplex b1=a[1]+a[4],b2=a[2]+a[3];
+			const doublecomplex d1=(sgn*I)*(a[1]-a[4]),d2=(sgn*I)*(a[2]-a[3]);
+			t0=a[0]+C5_1*b1+C5_2*b2;
+			t1=a[0]+C5_2*b1+C5_1*b2;
+			t2=S5_1*d1+S5_2*d2;
+			t3=S5_2*d1-S5_1*d2;
+			a[0]+=b1+b2;
+			a[1]=t0+t2;
+			a[4]=t0-t2;
+			a[2]=t1+t3;
+			a[3]=t1-t3;
+			break;
+		}
+		default: ButterflyOdd_c(r,a,tab);
+	}
+}
+
+//======================================================================================================================
+
+static void StageBlock_c(const struct fftbStage * restrict st,const doublecomplex * restrict w,
+	const doublecomplex * restrict x,doublecomplex * restrict y,const double sgn,const size_t p0,const size_t p1,
+	const size_t q0,const size_t q1)
+// performs part of the stage for p0<=p<p1 and q0<=q<q1; w is the stage part of the twiddle table
+{
+	const int r=st->r;
+	const size_t m=st->m,s=st->s;
+	const doublecomplex * restrict tab=w+(r-1)*m;
+	size_t p,q;
+	int j,k;
+	doublecomplex a[r];
+
+	for (p=p0;p<p1;p++) for (q=q0;q<q1;q++) {
+		for (k=0;k<r;k++) a[k]=x[q+s*(p+k*m)];
+		Butterfly_c(r,a,tab,sgn);
+		y[q+s*r*p]=a[0];
+		for (j=1;j<r;j++) y[q+s*(r*p+j)]=a[j]*w[(j-1)*m+p];
+	}
+}
+
+//======================================================================================================================
+
+static void Stage_c(const struct fftbStage * restrict st,const doublecomplex * restrict w,
+	const doublecomplex * restrict x,doublecomplex * restrict y,const double sgn)
+// performs a whole stage; generic version
+{
+	StageBlock_c(st,w,x,y,sgn,0,st->m,0,st->s);
+}
+
+#ifdef SIMD_DISPATCH
+/* Each vector register holds two complex numbers with interleaved real and imaginary parts. Multiplication by i is
+ * implemented as swap of real and imaginary parts combined with sign change, and complex product - as in fft_ops.h.
+ */
+
+//======================================================================================================================
+
+ATT_TARGET("avx2,fma") static inline __m256d CMul_avx2(const __m256d w,const __m256d x)
+// w*x for two complex numbers
+{
+	return _mm256_fmaddsub_pd(_mm256_movedup_pd(w),x,_mm256_mul_pd(_mm256_permute_pd(w,0xF),_mm256_permute_pd(x,0x5)));
+}
+
+//======================================================================================================================
+
+ATT_TARGET("avx2,fma") static inline __m256d MulI_avx2(const __m256d x,const __m256d si)
+// sgn*i*x, where si={-sgn,sgn,-sgn,sgn}
+{
+	return _mm256_mul_pd(_mm256_permute_pd(x,0x5),si);
+}
+
+//======================================================================================================================
+
+ATT_TARGET("avx2,fma") static inline ATT_INLINE void Butterfly_avx2(const int r,__m256d * restrict a,const __m256d si,
+	const __m256d * restrict ctab)
+/* in-place butterfly of radix r (r<=MAX_VEC_RADIX); analogous to Butterfly_c. For r>=TABLE_RADIX ctab contains
+ * broadcasted cos(2*pi*j*k/r) and isign*sin(2*pi*j*k/r) (with j,k from 1 to (r-1)/2) in the order of ButterflyOdd_c
+ */
+{
+	__m256d t0,t1,t2,t3;
+
+	switch (r) {
+		case 2:
+			t0=a[1];
+			a[1]=_mm256_sub_pd(a[0],t0);
+			a[0]=_mm256_add_pd(a[0],t0);
+			break;
+		case 3:
+			t0=_mm256_add_pd(a[1],a[2]);
+			t1=_mm256_fnmadd_pd(_mm256_set1_pd(0.5),t0,a[0]);
+			t2=MulI_avx2(_mm256_mul_pd(_mm256_set1_pd(S3),_mm256_sub_pd(a[1],a[2])),si);
+			a[0]=_mm256_add_pd(a[0],t0);
+			a[1]=_mm256_add_pd(t1,t2);
+			a[2]=_mm256_sub_pd(t1,t2);
+			break;
+		case 4:
+			t0=_mm256_add_pd(a[0],a[2]);
+			t1=_mm256_sub_pd(a[0],a[2]);
+			t2=_mm256_add_pd(a[1],a[3]);
+			t3=MulI_avx2(_mm256_sub_pd(a[1],a[3]),si);
+			a[0]=_mm256_add_pd(t0,t2);
+			a[2]=_mm256_sub_pd(t0,t2);
+			a[1]=_mm256_add_pd(t1,t3);
+			a[3]=_mm256_sub_pd(t1,t3);
+			break;
+		case 5: {
+			const __m256d b1=_mm256_add_pd(a[1],a[4]),b2=_mm256_add_pd(a[2],a[3]);
+			const __m256d d1=MulI_avx2(_mm256_sub_pd(a[1],a[4]),si),d2=MulI_avx2(_mm256_sub_pd(a[2],a[3]),si);
+			const __m256d c1=_mm256_set1_pd(C5_1),c2=_mm256_set1_pd(C5_2);
+			const __m256d s1=_mm256_set1_pd(S5_1),s2=_mm256_set1_pd(S5_2);
+			t0=_mm256_fmadd_pd(c2,b2,_mm256_fmadd_pd(c1,b1,a[0]));
+			t1=_mm256_fmadd_pd(c1,b2,_mm256_fmadd_pd(c2,b1,a[0]));
+			t2=_mm256_fmadd_pd(s2,d2,_mm256_mul_pd(s1,d1));
+			t3=_mm256_fnmadd_pd(s1,d2,_mm256_mul_pd(s2,d1));
+			a[0]=_mm256_add_pd(a[0],_mm256_add_pd(b1,b2));
+			a[1]=_mm256_add_pd(t0,t2);
+			a[4]=_mm256_sub_pd(t0,t2);
+			a[2]=_mm256_add_pd(t1,t3);
+			a[3]=_mm256_sub_pd(t1,t3);
+			break;
+		}
+		default: {
+			const int h=(r-1)/2;
+			int j,k;
+			__m256d b[MAX_VEC_HALF],d[MAX_VEC_HALF],y[MAX_VEC_RADIX],e,f;
+			const __m256d iv=_mm256_set_pd(1,-1,1,-1); // for plain multiplication by i
+
+			y[0]=a[0];
+			for (k=1;k<=h;k++) {
+				b[k-1]=_mm256_add_pd(a[k],a[r-k]);
+				d[k-1]=MulI_avx2(_mm256_sub_pd(a[k],a[r-k]),iv);
+				y[0]=_mm256_add_pd(y[0],b[k-1]);
+			}
+			for (j=1;j<=h;j++) {
+				e=a[0];
+				f=_mm256_setzero_pd();
+				for (k=1;k<=h;k++) {
+					e=_mm256_fmadd_pd(ctab[2*((j-1)*h+k-1)],b[k-1],e);
+					f=_mm256_fmadd_pd(ctab[2*((j-1)*h+k-1)+1],d[k-1],f);
+				}
+				y[j]=_mm256_add_pd(e,f);
+				y[r-j]=_mm256_sub_pd(e,f);
+			}
+			for (k=0;k<r;k++) a[k]=y[k];
+		}
+	}
+}
+
+//======================================================================================================================
+
+ATT_TARGET("avx2,fma") static inline ATT_INLINE void StageR_avx2(const int r,const struct fftbStage * restrict st,
+	const doublecomplex * restrict w,const doublecomplex * restrict x,doublecomplex * restrict y,const double sgn)
+/* same as Stage_c, but using AVX2 and FMA instructions; radix r (<=MAX_VEC_RADIX) is given explicitly, so that the code
+ * is specialized for each radix after inlining
+ */
+{
+	const size_t m=st->m,s=st->s;
+	const __m256d si=_mm256_set_pd(sgn,-sgn,sgn,-sgn);
+	size_t p,q;
+	int j,k,jk;
+	__m256d a[MAX_VEC_RADIX],wv[MAX_VEC_RADIX],ctab[2*MAX_VEC_HALF*MAX_VEC_HALF];
+
+	if (r>=TABLE_RADIX) {
+		const doublecomplex * restrict tab=w+(r-1)*m;
+		const int h=(r-1)/2;
+		for (j=1;j<=h;j++) for (k=1;k<=h;k++) {
+			jk=(j*k)%r;
+			ctab[2*((j-1)*h+k-1)]=_mm256_set1_pd(creal(tab[jk]));
+			ctab[2*((j-1)*h+k-1)+1]=_mm256_set1_pd(cimag(tab[jk]));
+		}
+	}
+	IGNORE_WARNING(-Wstrict-aliasing); // cast from doublecomplex* to double* is perfectly valid in C99
+	if (s==1) { // first stage - vectorization over pairs of butterflies, each with its own twiddle factors
+		for (p=0;p+2<=m;p+=2) {
+			for (k=0;k<r;k++) a[k]=_mm256_loadu_pd((const double *)(x+p+k*m));
+			Butterfly_avx2(r,a,si,ctab);
+			for (j=1;j<r;j++) a[j]=CMul_avx2(_mm256_loadu_pd((const double *)(w+(j-1)*m+p)),a[j]);
+			for (j=0;j<r;j++) {
+				_mm_storeu_pd((double *)(y+r*p+j),_mm256_castpd256_pd128(a[j]));
+				_mm_storeu_pd((double *)(y+r*(p+1)+j),_mm256_extractf128_pd(a[j],1));
+			}
+		}
+		if (p<m) StageBlock_c(st,w,x,y,sgn,p,m,0,1);
+	}
+	else for (p=0;p<m;p++) { // vectorization over q with the same twiddle factors
+		for (j=1;j<r;j++) wv[j]=_mm256_broadcast_pd((const __m128d *)(w+(j-1)*m+p));
+		for (q=0;q+2<=s;q+=2) {
+			for (k=0;k<r;k++) a[k]=_mm256_loadu_pd((const double *)(x+q+s*(p+k*m)));
+			Butterfly_avx2(r,a,si,ctab);
+			_mm256_storeu_pd((double *)(y+q+s*r*p),a[0]);
+			for (j=1;j<r;j++) _mm256_storeu_pd((double *)(y+q+s*(r*p+j)),CMul_avx2(wv[j],a[j]));
+		}
+		if (q<s) StageBlock_c(st,w,x,y,sgn,p,p+1,q,s);
+	}
+	STOP_IGNORE;
+}
+
+//======================================================================================================================
+
+ATT_TARGET("avx2,fma") static void Stage_avx2(const struct fftbStage * restrict st,const doublecomplex * restrict w,
+	const doublecomplex * restrict x,doublecomplex * restrict y,const double sgn)
+// performs a whole stage using AVX2 and FMA instructions, larger radices are processed by generic code
+{
+	switch (st->r) {
+		case 2: StageR_avx2(2,st,w,x,y,sgn); break;
+		case 3: StageR_avx2(3,st,w,x,y,sgn); break;
+		case 4: StageR_avx2(4,st,w,x,y,sgn); break;
+		case 5: StageR_avx2(5,st,w,x,y,sgn); break;
+		case 7: StageR_avx2(7,st,w,x,y,sgn); break;
+		default: Stage_c(st,w,x,y,sgn);
+	}
+}
+
+#endif // SIMD_DISPATCH
+
+//======================================================================================================================
+
+const char *fftbKernel(void)
+// selects the best stage kernel supported by the current processor (only once) and returns its name
+{
+	if (Stage==NULL) {
+		Stage=Stage_c;
+		kernelName="generic";
+#ifdef SIMD_DISPATCH
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+			Stage=Stage_avx2;
+			kernelName="AVX2";
+		}
+#endif
+	}
+	return kernelName;
+}
+
+//======================================================================================================================
+
+void fftbExec(const struct fftbPlan * restrict plan,doublecomplex * restrict data,const size_t jump,const size_t lot,
+	const int isign,doublecomplex * restrict work)
+/* performs lot transforms (of direction isign) of contiguous lines of length plan->n, separated by jump in data. Work
+ * should have size of at least plan->n; different threads should use different work arrays. Backward transform is not
+ * normalized.
+ */
+{
+	size_t l;
+	int i;
+	const doublecomplex * restrict w=(isign==FFT_FORWARD) ? plan->twf : plan->twb;
+	const double sgn=isign;
+	doublecomplex *x,*y,*t;
+
+	for (l=0;l<lot;l++) {
+		x=data+l*jump;
+		y=work;
+		for (i=0;i<plan->nst;i++) {
+			Stage(plan->st+i,w+plan->st[i].tw,x,y,sgn);
+			t=x;
+			x=y;
+			y=t;
+		}
+		if (x!=data+l*jump) memcpy(data+l*jump,x,plan->n*sizeof(doublecomplex));
+	}
+}
@@ -0,0 +1,52 @@
+/* File: fft_builtin.h
+ * Descr: definitions for the built-in mixed-radix FFT (used with option FFT_BUILTIN)
+ *
+ * Copyright (C) 2014 ADDA contributors
+ * This file is part of ADDA.
+ *
+ * ADDA is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * ADDA is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with ADDA. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#ifndef __fft_builtin_h
+#define __fft_builtin_h
+
+// project headers
+#include "types.h" // for doublecomplex
+// system headers
+#include <stddef.h> // for size_t
+
+/* The transform is a sequence of Stockham (self-sorting) stages with radices 4, 2, 3, 5, 7 (and generic, but slow,
+ * butterflies for larger prime factors). Each stage transfers data between the line and the work array, so no bit
+ * reversal is required. Twiddle factors are computed once at initialization and stored in the array, supplied by the
+ * caller (analogous to trigs of Temperton FFT).
+ */
+#define FFTB_MAX_STAGES 32 // enough for any length, representable by int
+
+struct fftbStage {
+	int r;     // radix
+	size_t m;  // number of butterflies per line of the stage (length of the sub-transform divided by r)
+	size_t s;  // stride between elements of a butterfly, i.e. the product of radices of the previous stages
+	size_t tw; // offset of the stage twiddle factors in the table
+};
+
+struct fftbPlan {
+	size_t n;                             // length of transform
+	int nst;                              // number of stages
+	struct fftbStage st[FFTB_MAX_STAGES]; // description of stages
+	const doublecomplex * restrict twf;   // twiddle factors for forward transforms
+	const doublecomplex * restrict twb;   // twiddle factors for backward transforms
+};
+
+size_t fftbTwiddleSize(int n);
+void fftbInit(struct fftbPlan * restrict plan,int n,doublecomplex * restrict tw);
+void fftbExec(const struct fftbPlan * restrict plan,doublecomplex * restrict data,size_t jump,size_t lot,int isign,
+	doublecomplex * restrict work);
+const char *fftbKernel(void);
+
+#endif // __fft_builtin_h
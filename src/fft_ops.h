@@ -0,0 +1,383 @@
+/* File: fft_ops.h
+ * Descr: low-level kernels for the product of Fourier-transformed interaction matrices with vectors in MatVec; void in
+ *        sparse and OpenCL modes
+ *
+ * Copyright (C) 2014 ADDA contributors
+ * This file is part of ADDA.
+ *
+ * ADDA is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * ADDA is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with ADDA. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#if !defined(SPARSE) && !defined(OPENCL)
+
+#ifndef __fft_ops_h
+#define __fft_ops_h
+
+// project headers
+#include "cmplx.h"
+#include "function.h" // for ATT_TARGET and SIMD_DISPATCH
+// system headers
+#include <stddef.h> // for size_t
+#ifdef SIMD_DISPATCH
+#	include <immintrin.h>
+#endif
+
+/* Kernels process a row of slices_tr along y (for fixed x and z). Each of the 6 components of D (or R) is stored as a
+ * separate plane, and the matrix element for the y-th element of vectors is taken at index ind[y] of the row. Signs of
+ * the components 1 (xy), 2 (xz), and 4 (yz) are given by sy=sgn[2*y], by sz, and by their product, respectively (for R
+ * - with st instead of sz). These signs account for reflections of reduced_FFT and for transpose of R (for G_SO).
+ */
+struct rowMult {
+	size_t n;                    // number of elements in a row (gridY)
+	size_t ldv;                  // distance between components of vectors (gridYZ)
+	size_t ldD,ldR;              // distances between components (planes) of D and R
+	const size_t * restrict ind; // indices of matrix elements
+	const double * restrict sgn; // signs due to reflection along y, each one is repeated twice (for Re and Im parts)
+};
+
+// index of the component of D (or R) for element (mu,nu) of the symmetric 3x3 matrix
+static const int symComp[3][3]={{0,1,2},{1,3,4},{2,4,5}};
+
+typedef void (*rowMultFunc)(const struct rowMult * restrict rm,size_t y0,doublecomplex * restrict v,
+	const doublecomplex * restrict w,const doublecomplex * restrict D,double sz,const doublecomplex * restrict R,
+	double st);
+
+//======================================================================================================================
+
+static void RowMult_c(const struct rowMult * restrict rm,const size_t y0,doublecomplex * restrict v,
+	const doublecomplex * restrict w,const doublecomplex * restrict D,const double sz,const doublecomplex * restrict R,
+	const double st)
+/* v=D.v, if R is NULL, and v=D.v+R.w otherwise, for elements y0<=y<n of a row; R is applied as a reflection matrix
+ * (see cReflMatrVec). Generic version. !!! v and w must not alias
+ */
+{
+	size_t y,j;
+	double sy;
+	doublecomplex m[6],xv[3],yv[3],yw[3];
+	const size_t ldv=rm->ldv,ldD=rm->ldD,ldR=rm->ldR;
+
+	for (y=y0;y<rm->n;y++) {
+		j=rm->ind[y];
+		sy=rm->sgn[2*y];
+		xv[0]=v[y];
+		xv[1]=v[ldv+y];
+		xv[2]=v[2*ldv+y];
+		m[0]=D[j];
+		m[1]=sy*D[ldD+j];
+		m[2]=sz*D[2*ldD+j];
+		m[3]=D[3*ldD+j];
+		m[4]=sy*sz*D[4*ldD+j];
+		m[5]=D[5*ldD+j];
+		cSymMatrVec(m,xv,yv);
+		if (R!=NULL) {
+			xv[0]=w[y];
+			xv[1]=w[ldv+y];
+			xv[2]=w[2*ldv+y];
+			m[0]=R[j];
+			m[1]=sy*R[ldR+j];
+			m[2]=st*R[2*ldR+j];
+			m[3]=R[3*ldR+j];
+			m[4]=sy*st*R[4*ldR+j];
+			m[5]=R[5*ldR+j];
+			cReflMatrVec(m,xv,yw);
+			cvAdd(yw,yv,yv);
+		}
+		v[y]=yv[0];
+		v[ldv+y]=yv[1];
+		v[2*ldv+y]=yv[2];
+	}
+}
+
+//======================================================================================================================
+
+static void RowMultComp_c(const struct rowMult * restrict rm,const int mu,const int nu,doublecomplex * restrict v,
+	const doublecomplex * restrict w,const doublecomplex * restrict D,const double sz,const doublecomplex * restrict R,
+	const double st)
+/* same as RowMult_c, but for a single element (mu,nu) of the 3x3 matrices and single-component rows v and w (used in
+ * lean MatVec): v=D[mu,nu].v, if R is NULL, and v=D[mu,nu].v+R[mu,nu].w otherwise. !!! v and w must not alias
+ */
+{
+	size_t y,j;
+	const int comp=symComp[mu][nu];
+	const bool useY=(comp==1 || comp==4); // whether the sign due to reflection along y is used
+	// signs along z; for R it also includes the sign of the reflection matrix (see cReflMatrVec)
+	const double sD=(comp==2 || comp==4) ? sz : 1;
+	const double sR=((comp==2 || comp==4) ? st : 1)*((mu==2 && nu!=2) ? -1 : 1);
+	const doublecomplex * restrict Dc=D+comp*rm->ldD;
+	const doublecomplex * restrict Rc=(R==NULL) ? NULL : R+comp*rm->ldR;
+	double sy;
+
+	for (y=0;y<rm->n;y++) {
+		j=rm->ind[y];
+		sy=useY ? rm->sgn[2*y] : 1;
+		if (Rc==NULL) v[y]=sy*sD*Dc[j]*v[y];
+		else v[y]=sy*(sD*Dc[j]*v[y]+sR*Rc[j]*w[y]);
+	}
+}
+
+#ifdef MIXED_PREC
+//======================================================================================================================
+
+static void RowMult_sp(const struct rowMult * restrict rm,floatcomplex * restrict v,const floatcomplex * restrict w,
+	const floatcomplex * restrict D,const float sz,const floatcomplex * restrict R,const float st)
+/* same as RowMult_c, but for single-precision vectors and matrices (used in mixed-precision MatVec); the operations of
+ * cSymMatrVec and cReflMatrVec are written explicitly. !!! v and w must not alias
+ */
+{
+	size_t y,j;
+	float sy;
+	floatcomplex m0,m1,m2,m3,m4,m5,x0,x1,x2,y0,y1,y2;
+	const size_t ldv=rm->ldv,ldD=rm->ldD,ldR=rm->ldR;
+
+	for (y=0;y<rm->n;y++) {
+		j=rm->ind[y];
+		sy=(float)rm->sgn[2*y];
+		x0=v[y];
+		x1=v[ldv+y];
+		x2=v[2*ldv+y];
+		m0=D[j];
+		m1=sy*D[ldD+j];
+		m2=sz*D[2*ldD+j];
+		m3=D[3*ldD+j];
+		m4=sy*sz*D[4*ldD+j];
+		m5=D[5*ldD+j];
+		y0=m0*x0+m1*x1+m2*x2;
+		y1=m1*x0+m3*x1+m4*x2;
+		y2=m2*x0+m4*x1+m5*x2;
+		if (R!=NULL) {
+			x0=w[y];
+			x1=w[ldv+y];
+			x2=w[2*ldv+y];
+			m0=R[j];
+			m1=sy*R[ldR+j];
+			m2=st*R[2*ldR+j];
+			m3=R[3*ldR+j];
+			m4=sy*st*R[4*ldR+j];
+			m5=R[5*ldR+j];
+			y0+=m0*x0+m1*x1+m2*x2;
+			y1+=m1*x0+m3*x1+m4*x2;
+			y2+=m5*x2-m2*x0-m4*x1;
+		}
+		v[y]=y0;
+		v[ldv+y]=y1;
+		v[2*ldv+y]=y2;
+	}
+}
+
+#endif // MIXED_PREC
+
+#ifdef SIMD_DISPATCH
+/* Vector kernels process 2 (AVX2) or 4 (AVX-512) elements of a row at once, each vector register holds interleaved real
+ * and imaginary parts of several complex numbers. Complex products are computed as a*x=Re(a)*x -+ Im(a)*swap(x), where
+ * swap interchanges real and imaginary parts. The remaining elements of a row (if any) are processed by generic code.
+ * These functions are compiled for the corresponding instruction sets irrespective of compiler flags, and are selected
+ * at runtime by SelectRowMult().
+ */
+
+//======================================================================================================================
+
+ATT_TARGET("avx2,fma") static inline __m256d LoadPair_avx2(const doublecomplex * restrict p,
+	const size_t * restrict ind)
+// loads p[ind[0]] and p[ind[1]]
+{
+	IGNORE_WARNING(-Wstrict-aliasing); // cast from doublecomplex* to double* is perfectly valid in C99
+	return _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd((const double *)(p+ind[0]))),
+		_mm_loadu_pd((const double *)(p+ind[1])),1);
+	STOP_IGNORE;
+}
+
+//======================================================================================================================
+
+ATT_TARGET("avx2,fma") static inline __m256d CMul3_avx2(const __m256d a0,const __m256d a1,const __m256d a2,
+	const __m256d x0,const __m256d x1,const __m256d x2,const __m256d xs0,const __m256d xs1,const __m256d xs2)
+// a0*x0+a1*x1+a2*x2 for two complex numbers; xs are x with swapped real and imaginary parts
+{
+	__m256d re,im;
+
+	im=_mm256_mul_pd(_mm256_permute_pd(a0,0xF),xs0);
+	im=_mm256_fmadd_pd(_mm256_permute_pd(a1,0xF),xs1,im);
+	im=_mm256_fmadd_pd(_mm256_permute_pd(a2,0xF),xs2,im);
+	re=_mm256_mul_pd(_mm256_movedup_pd(a0),x0);
+	re=_mm256_fmadd_pd(_mm256_movedup_pd(a1),x1,re);
+	return _mm256_add_pd(re,_mm256_fmaddsub_pd(_mm256_movedup_pd(a2),x2,im));
+}
+
+//======================================================================================================================
+
+ATT_TARGET("avx2,fma") static void RowMult_avx2(const struct rowMult * restrict rm,const size_t y0,
+	doublecomplex * restrict v,const doublecomplex * restrict w,const doublecomplex * restrict D,const double sz,
+	const doublecomplex * restrict R,const double st)
+// same as RowMult_c, but using AVX2 and FMA instructions
+{
+	size_t y;
+	const size_t ldv=rm->ldv,ldD=rm->ldD,ldR=rm->ldR;
+	const size_t * restrict ind;
+	const __m256d vsz=_mm256_set1_pd(sz),vst=_mm256_set1_pd(st),zero=_mm256_setzero_pd();
+	__m256d sy,x0,x1,x2,xs0,xs1,xs2,m0,m1,m2,m3,m4,m5,r0,r1,r2;
+
+	IGNORE_WARNING(-Wstrict-aliasing); // cast from doublecomplex* to double* is perfectly valid in C99
+	for (y=y0;y+2<=rm->n;y+=2) {
+		ind=rm->ind+y;
+		sy=_mm256_loadu_pd(rm->sgn+2*y);
+		x0=_mm256_loadu_pd((double *)(v+y));
+		x1=_mm256_loadu_pd((double *)(v+ldv+y));
+		x2=_mm256_loadu_pd((double *)(v+2*ldv+y));
+		xs0=_mm256_permute_pd(x0,0x5);
+		xs1=_mm256_permute_pd(x1,0x5);
+		xs2=_mm256_permute_pd(x2,0x5);
+		m0=LoadPair_avx2(D,ind);
+		m1=_mm256_mul_pd(sy,LoadPair_avx2(D+ldD,ind));
+		m2=_mm256_mul_pd(vsz,LoadPair_avx2(D+2*ldD,ind));
+		m3=LoadPair_avx2(D+3*ldD,ind);
+		m4=_mm256_mul_pd(_mm256_mul_pd(sy,vsz),LoadPair_avx2(D+4*ldD,ind));
+		m5=LoadPair_avx2(D+5*ldD,ind);
+		r0=CMul3_avx2(m0,m1,m2,x0,x1,x2,xs0,xs1,xs2);
+		r1=CMul3_avx2(m1,m3,m4,x0,x1,x2,xs0,xs1,xs2);
+		r2=CMul3_avx2(m2,m4,m5,x0,x1,x2,xs0,xs1,xs2);
+		if (R!=NULL) {
+			x0=_mm256_loadu_pd((const double *)(w+y));
+			x1=_mm256_loadu_pd((const double *)(w+ldv+y));
+			x2=_mm256_loadu_pd((const double *)(w+2*ldv+y));
+			xs0=_mm256_permute_pd(x0,0x5);
+			xs1=_mm256_permute_pd(x1,0x5);
+			xs2=_mm256_permute_pd(x2,0x5);
+			m0=LoadPair_avx2(R,ind);
+			m1=_mm256_mul_pd(sy,LoadPair_avx2(R+ldR,ind));
+			m2=_mm256_mul_pd(vst,LoadPair_avx2(R+2*ldR,ind));
+			m3=LoadPair_avx2(R+3*ldR,ind);
+			m4=_mm256_mul_pd(_mm256_mul_pd(sy,vst),LoadPair_avx2(R+4*ldR,ind));
+			m5=LoadPair_avx2(R+5*ldR,ind);
+			r0=_mm256_add_pd(r0,CMul3_avx2(m0,m1,m2,x0,x1,x2,xs0,xs1,xs2));
+			r1=_mm256_add_pd(r1,CMul3_avx2(m1,m3,m4,x0,x1,x2,xs0,xs1,xs2));
+			r2=_mm256_add_pd(r2,CMul3_avx2(_mm256_sub_pd(zero,m2),_mm256_sub_pd(zero,m4),m5,x0,x1,x2,xs0,xs1,xs2));
+		}
+		_mm256_storeu_pd((double *)(v+y),r0);
+		_mm256_storeu_pd((double *)(v+ldv+y),r1);
+		_mm256_storeu_pd((double *)(v+2*ldv+y),r2);
+	}
+	STOP_IGNORE;
+	if (y<rm->n) RowMult_c(rm,y,v,w,D,sz,R,st);
+}
+
+//======================================================================================================================
+
+ATT_TARGET("avx512f") static inline __m512d LoadQuad_avx512(const doublecomplex * restrict p,
+	const size_t * restrict ind)
+// loads p[ind[0]],...,p[ind[3]]
+{
+	__m256d lo,hi;
+
+	IGNORE_WARNING(-Wstrict-aliasing); // cast from doublecomplex* to double* is perfectly valid in C99
+	lo=_mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd((const double *)(p+ind[0]))),
+		_mm_loadu_pd((const double *)(p+ind[1])),1);
+	hi=_mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd((const double *)(p+ind[2]))),
+		_mm_loadu_pd((const double *)(p+ind[3])),1);
+	STOP_IGNORE;
+	return _mm512_insertf64x4(_mm512_castpd256_pd512(lo),hi,1);
+}
+
+//======================================================================================================================
+
+ATT_TARGET("avx512f") static inline __m512d CMul3_avx512(const __m512d a0,const __m512d a1,const __m512d a2,
+	const __m512d x0,const __m512d x1,const __m512d x2,const __m512d xs0,const __m512d xs1,const __m512d xs2)
+// a0*x0+a1*x1+a2*x2 for four complex numbers; xs are x with swapped real and imaginary parts
+{
+	__m512d re,im;
+
+	im=_mm512_mul_pd(_mm512_permute_pd(a0,0xFF),xs0);
+	im=_mm512_fmadd_pd(_mm512_permute_pd(a1,0xFF),xs1,im);
+	im=_mm512_fmadd_pd(_mm512_permute_pd(a2,0xFF),xs2,im);
+	re=_mm512_mul_pd(_mm512_movedup_pd(a0),x0);
+	re=_mm512_fmadd_pd(_mm512_movedup_pd(a1),x1,re);
+	return _mm512_add_pd(re,_mm512_fmaddsub_pd(_mm512_movedup_pd(a2),x2,im));
+}
+
+//======================================================================================================================
+
+ATT_TARGET("avx512f") static void RowMult_avx512(const struct rowMult * restrict rm,const size_t y0,
+	doublecomplex * restrict v,const doublecomplex * restrict w,const doublecomplex * restrict D,const double sz,
+	const doublecomplex * restrict R,const double st)
+// same as RowMult_c, but using AVX-512 instructions
+{
+	size_t y;
+	const size_t ldv=rm->ldv,ldD=rm->ldD,ldR=rm->ldR;
+	const size_t * restrict ind;
+	const __m512d vsz=_mm512_set1_pd(sz),vst=_mm512_set1_pd(st),zero=_mm512_setzero_pd();
+	__m512d sy,x0,x1,x2,xs0,xs1,xs2,m0,m1,m2,m3,m4,m5,r0,r1,r2;
+
+	IGNORE_WARNING(-Wstrict-aliasing); // cast from doublecomplex* to double* is perfectly valid in C99
+	for (y=y0;y+4<=rm->n;y+=4) {
+		ind=rm->ind+y;
+		sy=_mm512_loadu_pd(rm->sgn+2*y);
+		x0=_mm512_loadu_pd((double *)(v+y));
+		x1=_mm512_loadu_pd((double *)(v+ldv+y));
+		x2=_mm512_loadu_pd((double *)(v+2*ldv+y));
+		xs0=_mm512_permute_pd(x0,0x55);
+		xs1=_mm512_permute_pd(x1,0x55);
+		xs2=_mm512_permute_pd(x2,0x55);
+		m0=LoadQuad_avx512(D,ind);
+		m1=_mm512_mul_pd(sy,LoadQuad_avx512(D+ldD,ind));
+		m2=_mm512_mul_pd(vsz,LoadQuad_avx512(D+2*ldD,ind));
+		m3=LoadQuad_avx512(D+3*ldD,ind);
+		m4=_mm512_mul_pd(_mm512_mul_pd(sy,vsz),LoadQuad_avx512(D+4*ldD,ind));
+		m5=LoadQuad_avx512(D+5*ldD,ind);
+		r0=CMul3_avx512(m0,m1,m2,x0,x1,x2,xs0,xs1,xs2);
+		r1=CMul3_avx512(m1,m3,m4,x0,x1,x2,xs0,xs1,xs2);
+		r2=CMul3_avx512(m2,m4,m5,x0,x1,x2,xs0,xs1,xs2);
+		if (R!=NULL) {
+			x0=_mm512_loadu_pd((const double *)(w+y));
+			x1=_mm512_loadu_pd((const double *)(w+ldv+y));
+			x2=_mm512_loadu_pd((const double *)(w+2*ldv+y));
+			xs0=_mm512_permute_pd(x0,0x55);
+			xs1=_mm512_permute_pd(x1,0x55);
+			xs2=_mm512_permute_pd(x2,0x55);
+			m0=LoadQuad_avx512(R,ind);
+			m1=_mm512_mul_pd(sy,LoadQuad_avx512(R+ldR,ind));
+			m2=_mm512_mul_pd(vst,LoadQuad_avx512(R+2*ldR,ind));
+			m3=LoadQuad_avx512(R+3*ldR,ind);
+			m4=_mm512_mul_pd(_mm512_mul_pd(sy,vst),LoadQuad_avx512(R+4*ldR,ind));
+			m5=LoadQuad_avx512(R+5*ldR,ind);
+			r0=_mm512_add_pd(r0,CMul3_avx512(m0,m1,m2,x0,x1,x2,xs0,xs1,xs2));
+			r1=_mm512_add_pd(r1,CMul3_avx512(m1,m3,m4,x0,x1,x2,xs0,xs1,xs2));
+			r2=_mm512_add_pd(r2,CMul3_avx512(_mm512_sub_pd(zero,m2),_mm512_sub_pd(zero,m4),m5,x0,x1,x2,xs0,xs1,
+				xs2));
+		}
+		_mm512_storeu_pd((double *)(v+y),r0);
+		_mm512_storeu_pd((double *)(v+ldv+y),r1);
+		_mm512_storeu_pd((double *)(v+2*ldv+y),r2);
+	}
+	STOP_IGNORE;
+	if (y<rm->n) RowMult_c(rm,y,v,w,D,sz,R,st);
+}
+
+#endif // SIMD_DISPATCH
+
+//======================================================================================================================
+
+static rowMultFunc SelectRowMult(const char **name)
+// returns the best kernel supported by the current processor; its name is stored in 'name'
+{
+#ifdef SIMD_DISPATCH
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		*name="AVX-512";
+		return RowMult_avx512;
+	}
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		*name="AVX2";
+		return RowMult_avx2;
+	}
+#endif
+	*name="generic";
+	return RowMult_c;
+}
+
+#endif // __fft_ops_h
+
+#endif // !SPARSE && !OPENCL
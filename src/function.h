@@ -58,6 +58,16 @@
 #	endif
 #	define ATT_NORETURN __attribute__ ((__noreturn__))
 #	define ATT_UNUSED   __attribute__ ((__unused__))
+#	define ATT_INLINE   __attribute__ ((__always_inline__)) // forces inlining, e.g. to specialize for constant args
+	/* compilation of separate functions for specific instruction sets with runtime selection among them (fft_ops.h).
+	 * Clang claims to be gcc 4.2, but supports all the required features
+	 */
+#	if (GCC_PREREQ(4,9) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#		define ATT_TARGET(x) __attribute__ ((__target__(x)))
+#		define SIMD_DISPATCH
+#	else
+#		define ATT_TARGET(x)
+#	endif
 #else
 #	define IGNORE_WARNING(x)
 #	define STOP_IGNORE
@@ -66,6 +76,8 @@
 #	define ATT_MALLOC
 #	define ATT_NORETURN
 #	define ATT_UNUSED
+#	define ATT_INLINE
+#	define ATT_TARGET(x)
 #endif
 
 #ifdef __ICC
@@ -58,10 +58,20 @@ static bool XlessY; // whether boxX is not larger than boxY (used for SomTable)
 static doublecomplex * restrict somTable; // table of Sommerfeld integrals
 static size_t * restrict somIndex; // array for indexing somTable (in the xy-plane)
 
+// table of interaction terms for distances, which are unique under octahedral symmetry (see InitSymTable)
+static void (*InterTerm_sym_base)(const int i,const int j,const int k,doublecomplex result[static restrict 6]);
+static doublecomplex * restrict symTable; // six components for each sorted distance
+static bool * restrict symDone; // whether the corresponding element of symTable has been computed
+static size_t * restrict symOffs,symSizeA; // offsets inside the block with fixed largest coordinate, and its size
+static int symMax[3]; // bounds (exclusive) of sorted coordinates
+static bool symTabled; // whether the table is used
+
 #ifdef USE_SSE3
 static __m128d c1, c2, c3, zo, inv_2pi, p360, prad_to_deg;
 static __m128d exptbl[361];
 #endif //USE_SSE3
+// number of elements processed at once by row-batched functions (defines the size of their local arrays)
+#define ROW_CHUNK 64
 
 // EXTERNAL FUNCTIONS
 
@@ -126,6 +136,24 @@ void name##_real(const double qvec_in[restrict 3],doublecomplex result[static re
 void name##_real(const double qvec[restrict 3],doublecomplex result[static restrict 6]) \
 	{ name(qvec,result,false); }
 
+/* wrapper for <name>, evaluating a row of elements along x, based on integer input; arguments are described in .h file.
+ * Each element is computed by the inlined function, which removes the call through function pointer per element
+ */
+# define ROW_WRAPPER_INTER(name) \
+void name##_row(const int i0,const int n,const int j,const int k,doublecomplex * restrict result) { \
+	double qvec[3]; \
+	for (int ii=0;ii<n;ii++) { \
+		vCopyIntReal(i0+ii,j,k,qvec); \
+		name(qvec,result+NDCOMP*ii,true); } }
+
+// same as above, but calling function is different from name and accepts additional argument
+# define ROW_WRAPPER_INTER_3(name,func,arg) \
+void name##_row(const int i0,const int n,const int j,const int k,doublecomplex * restrict result) { \
+	double qvec[3]; \
+	for (int ii=0;ii<n;ii++) { \
+		vCopyIntReal(i0+ii,j,k,qvec); \
+		func(qvec,result+NDCOMP*ii,true,arg); } }
+
 // aggregate defines
 #define WRAPPERS_INTER(name) INT_WRAPPER_INTER(name) REAL_WRAPPER_INTER(name)
 #define WRAPPERS_INTER_3(name,func,arg) INT_WRAPPER_INTER_3(name,func,arg) REAL_WRAPPER_INTER_3(name,func,arg)
@@ -332,6 +360,57 @@ WRAPPERS_INTER(InterTerm_poi)
 
 //=====================================================================================================================
 
+void InterTerm_poi_row(const int i0,const int n,const int j,const int k,doublecomplex * restrict result)
+/* Row-batched version of InterTerm_poi, arguments are described in .h file. The row is processed in chunks, each in
+ * three passes: scalar geometric factors (vectorizable by compiler), imaginary exponents (accImExp, which uses
+ * tabulated values when USE_SSE3), and assembly of tensor components.
+ * Equivalent to calling InterTerm_poi_int in a loop.
+ */
+{
+	double invrn[ROW_CHUNK],invr3[ROW_CHUNK],kr[ROW_CHUNK]; // 1/|R/d|, |R|^-3, kR
+	doublecomplex expval[ROW_CHUNK]; // exp(ikR)/|R|^3
+	double q[3],qmunu[6],kr2,t1,t2,t3;
+	doublecomplex * restrict res;
+	int c0,m,ii;
+	const double jk2=(double)j*j+(double)k*k;
+
+	for (c0=0;c0<n;c0+=ROW_CHUNK) {
+		m=MIN(ROW_CHUNK,n-c0);
+		for (ii=0;ii<m;ii++) {
+			const double x=i0+c0+ii;
+			const double rn=sqrt(x*x+jk2);
+			const double rr=rn*gridspace;
+			invrn[ii]=1/rn;
+			invr3[ii]=1/(rr*rr*rr);
+			kr[ii]=WaveNum*rr;
+		}
+		for (ii=0;ii<m;ii++) expval[ii]=invr3[ii]*accImExp(kr[ii]);
+		for (ii=0;ii<m;ii++) {
+			q[0]=(i0+c0+ii)*invrn[ii];
+			q[1]=j*invrn[ii];
+			q[2]=k*invrn[ii];
+			OuterSym(q,qmunu);
+			kr2=kr[ii]*kr[ii];
+			t1=3-kr2;
+			t2=-3*kr[ii];
+			t3=kr2-1;
+			res=result+NDCOMP*(c0+ii);
+#define INTERACT_DIAG(ind) { res[ind] = ((t1*qmunu[ind]+t3) + I*(kr[ii]+t2*qmunu[ind]))*expval[ii]; }
+#define INTERACT_NONDIAG(ind) { res[ind] = (t1+I*t2)*qmunu[ind]*expval[ii]; }
+			INTERACT_DIAG(0);    // xx
+			INTERACT_NONDIAG(1); // xy
+			INTERACT_NONDIAG(2); // xz
+			INTERACT_DIAG(3);    // yy
+			INTERACT_NONDIAG(4); // yz
+			INTERACT_DIAG(5);    // zz
+#undef INTERACT_DIAG
+#undef INTERACT_NONDIAG
+		}
+	}
+}
+
+//=====================================================================================================================
+
 static inline void InterTerm_fcd(double qvec[static 3],doublecomplex result[static 6],const bool unitsGrid)
 /* Interaction term between two dipoles for FCD. See InterTerm_poi for more details.
  *
@@ -380,6 +459,7 @@ static inline void InterTerm_fcd(double qvec[static 3],doublecomplex result[stat
 }
 
 WRAPPERS_INTER(InterTerm_fcd)
+ROW_WRAPPER_INTER(InterTerm_fcd)
 
 //=====================================================================================================================
 
@@ -409,6 +489,7 @@ static inline void InterTerm_fcd_st(double qvec[static 3],doublecomplex result[s
 }
 
 WRAPPERS_INTER(InterTerm_fcd_st)
+ROW_WRAPPER_INTER(InterTerm_fcd_st)
 
 //=====================================================================================================================
 
@@ -705,6 +786,8 @@ static inline void InterTerm_nloc_both(double qvec[static 3],doublecomplex resul
 // wrappers both for nloc and nloc_av
 WRAPPERS_INTER_3(InterTerm_nloc,InterTerm_nloc_both,false)
 WRAPPERS_INTER_3(InterTerm_nloc_av,InterTerm_nloc_both,true)
+ROW_WRAPPER_INTER_3(InterTerm_nloc,InterTerm_nloc_both,false)
+ROW_WRAPPER_INTER_3(InterTerm_nloc_av,InterTerm_nloc_both,true)
 
 //=====================================================================================================================
 
@@ -1079,6 +1162,93 @@ static void FreeTables(void)
 
 //=====================================================================================================================
 
+static void InterTerm_sym_int(const int i,const int j,const int k,doublecomplex result[static restrict 6])
+/* Interaction term through the table of distances, which are unique under the octahedral symmetry; arguments are
+ * described in .h file. Distance is transformed to sorted absolute values a>=b>=c>=0, then G(i,j,k)=S.P.G(a,b,c).P^T.S,
+ * where P is the permutation and S is the diagonal matrix of signs. Values in the table are computed on first request
+ * (memoization), since not all of them are required, e.g. for a part of the grid in MPI mode or in sparse mode.
+ * Distances outside of the table are computed directly.
+ */
+{
+	int ivec[3],srt[3],ord[3]; // ord[mu] is the position of mu-th coordinate in the sorted triplet srt
+	double sig[3];
+	int mu,nu,comp;
+	size_t ind;
+	doublecomplex * restrict val;
+	// number of component [mu,nu] in symmetric matrix, {xx,xy,xz,yy,yz,zz}
+	static const int symComp[3][3]={{0,1,2},{1,3,4},{2,4,5}};
+
+	ivec[0]=i;
+	ivec[1]=j;
+	ivec[2]=k;
+	for (mu=0;mu<3;mu++) {
+		if (ivec[mu]<0) {
+			sig[mu]=-1;
+			ivec[mu]*=-1;
+		}
+		else sig[mu]=1;
+	}
+	// sort in descending order, ties are resolved by the original order
+	for (mu=0;mu<3;mu++) {
+		ord[mu]=0;
+		for (nu=0;nu<3;nu++) if (ivec[nu]>ivec[mu] || (ivec[nu]==ivec[mu] && nu<mu)) ord[mu]++;
+		srt[ord[mu]]=ivec[mu];
+	}
+	if (srt[0]>=symMax[0] || srt[1]>=symMax[1] || srt[2]>=symMax[2]) {
+		(*InterTerm_sym_base)(i,j,k,result);
+		return;
+	}
+	ind=srt[0]*symSizeA+symOffs[srt[1]]+srt[2];
+	val=symTable+NDCOMP*ind;
+	if (!symDone[ind]) {
+		(*InterTerm_sym_base)(srt[0],srt[1],srt[2],val);
+		symDone[ind]=true;
+	}
+	for (mu=0,comp=0;mu<3;mu++) for (nu=mu;nu<3;nu++,comp++)
+		result[comp]=sig[mu]*sig[nu]*val[symComp[ord[mu]][ord[nu]]];
+}
+
+//=====================================================================================================================
+
+static void InitSymTable(void)
+/* Replaces InterTerm_int by memoization through the table of sorted distances, which are unique under the octahedral
+ * symmetry (see InterTerm_sym_int). Should be called only for formulations, which are invariant under permutations and
+ * sign changes of coordinates. It reduces the number of evaluations up to 48 times, but requires memory comparable
+ * to 1/6 of the number of elements in the box. Hence, it is used only for expensive formulations.
+ */
+{
+	int a,b,dims[3],tmp;
+	size_t size,ind;
+
+	// sort box dimensions in descending order; they bound the sorted absolute distances
+	dims[0]=boxX;
+	dims[1]=boxY;
+	dims[2]=boxZ;
+	for (a=0;a<2;a++) for (b=a+1;b<3;b++) if (dims[b]>dims[a]) {
+		tmp=dims[a];
+		dims[a]=dims[b];
+		dims[b]=tmp;
+	}
+	memcpy(symMax,dims,3*sizeof(int));
+	// symOffs[b] is the offset of elements with second sorted coordinate b inside the block of the first one
+	MALLOC_VECTOR(symOffs,sizet,symMax[1]+1,ALL);
+	memory+=(symMax[1]+1)*sizeof(size_t);
+	symOffs[0]=0;
+	for (b=0;b<symMax[1];b++) symOffs[b+1]=symOffs[b]+MIN(b+1,symMax[2]);
+	symSizeA=symOffs[symMax[1]];
+	size=symMax[0]*symSizeA;
+	memory+=size*(NDCOMP*sizeof(doublecomplex)+sizeof(bool));
+	if (!prognosis) {
+		MALLOC_VECTOR(symTable,complex,NDCOMP*size,ALL);
+		MALLOC_VECTOR(symDone,bool,size,ALL);
+		for (ind=0;ind<size;ind++) symDone[ind]=false;
+	}
+	InterTerm_sym_base=InterTerm_int;
+	InterTerm_int=&InterTerm_sym_int;
+}
+
+//=====================================================================================================================
+
 static inline void vCopyIntRealShift(const int i,const int j,const int k,double qvec[static 3])
 // initialize real vector with integer values
 {
@@ -1348,18 +1518,22 @@ void InitInteraction(void)
 // Initialize the interaction calculations
 {
 #define SET_FUNC_POINTERS(type,name) { type##_int = &type##_##name##_int; type##_real = &type##_##name##_real; }
-	// set InterTerm_int (real) to point at the right functions
+#define SET_ROW_POINTER(name) { InterTerm_row = &InterTerm_##name##_row; }
+	/* set InterTerm_int (real) to point at the right functions; InterTerm_row is set only for formulations, which have
+	 * row-batched version and are thread-safe
+	 */
+	InterTerm_row=NULL;
 	switch (IntRelation) {
-		case G_POINT_DIP: SET_FUNC_POINTERS(InterTerm,poi); break;
-		case G_FCD: SET_FUNC_POINTERS(InterTerm,fcd); break;
-		case G_FCD_ST: SET_FUNC_POINTERS(InterTerm,fcd_st); break;
+		case G_POINT_DIP: SET_FUNC_POINTERS(InterTerm,poi); SET_ROW_POINTER(poi); break;
+		case G_FCD: SET_FUNC_POINTERS(InterTerm,fcd); SET_ROW_POINTER(fcd); break;
+		case G_FCD_ST: SET_FUNC_POINTERS(InterTerm,fcd_st); SET_ROW_POINTER(fcd_st); break;
 		case G_IGT_SO:
 			if (InteractionRealArgs) PrintError("'-int igt_so' does not support calculation of interaction tensor for "
 				"arbitrary real arguments");
 			SET_FUNC_POINTERS(InterTerm,igt_so);
 			break;
-		case G_NLOC: SET_FUNC_POINTERS(InterTerm,nloc); break;
-		case G_NLOC_AV: SET_FUNC_POINTERS(InterTerm,nloc_av); break;
+		case G_NLOC: SET_FUNC_POINTERS(InterTerm,nloc); SET_ROW_POINTER(nloc); break;
+		case G_NLOC_AV: SET_FUNC_POINTERS(InterTerm,nloc_av); SET_ROW_POINTER(nloc_av); break;
 		case G_SO:
 			if (InteractionRealArgs) PrintError("'-int so' does not support calculation of interaction tensor for "
 				"arbitrary real arguments");
@@ -1381,6 +1555,11 @@ void InitInteraction(void)
 	}
 	// read tables if needed
 	if (IntRelation == G_SO || IntRelation == G_IGT_SO) ReadTables();
+	/* memoization of expensive formulations, which are invariant under octahedral symmetry. SO formulation is
+	 * currently used with averaging over propagation directions (inter_avg), hence it is also invariant
+	 */
+	symTabled=(IntRelation==G_IGT || IntRelation==G_IGT_SO || IntRelation==G_SO);
+	if (symTabled) InitSymTable();
 
 	// Interaction through reflection from surface
 	if (surface) {
@@ -1427,6 +1606,7 @@ void InitInteraction(void)
 #endif
 
 #undef SET_FUNC_POINTERS
+#undef SET_ROW_POINTER
 }
 
 //=====================================================================================================================
@@ -1435,6 +1615,11 @@ void FreeInteraction(void)
 // Free buffers used for interaction calculation
 {
 	if (IntRelation == G_SO || IntRelation == G_IGT_SO) FreeTables();
+	if (symTabled) {
+		Free_general(symOffs);
+		Free_cVector(symTable);
+		Free_general(symDone);
+	}
 	if (surface && ReflRelation==GR_SOM) {
 		Free_general(somIndex);
 		Free_cVector(somTable);
@@ -25,6 +25,11 @@
 void (*InterTerm_int)(const int i,const int j,const int k,doublecomplex result[static restrict 6]);
 // same as above, but distance is passed as a double vector (in um)
 void (*InterTerm_real)(const double qvec[static restrict 3],doublecomplex result[static restrict 6]);
+/* same as InterTerm_int, but evaluates a row of n elements for distances {i0+ii,j,k}, ii=0,...,n-1. The six components
+ * for each element are stored consecutively in result (of size 6n). Zero distance must not be included in the row.
+ * It is NULL for formulations, which have no row-batched version; only the latter are guaranteed to be thread-safe.
+ */
+void (*InterTerm_row)(const int i0,const int n,const int j,const int k,doublecomplex * restrict result);
 
 /* Calculates reflection term between two dipoles; given integer distance vector {i,j,k} (in units of d). k is the _sum_
  * of dipole indices along z with respect to the center of bottom dipoles of the particle. Bottom is considered for the
@@ -33,6 +33,18 @@
 #	include <sys/stat.h>
 #	include <sys/types.h>
 #endif
+// definitions for file locking
+#ifdef USE_LOCK
+#	ifdef POSIX
+#		include <unistd.h>
+#		include <fcntl.h>
+#	endif
+#	define LOCK_WAIT 1 // in seconds
+#	define MAX_LOCK_WAIT_CYCLES 60
+#	define ONLY_FOR_LOCK
+#else
+#	define ONLY_FOR_LOCK ATT_UNUSED
+#endif
 
 // SEMI-GLOBAL VARIABLES
 
@@ -491,6 +503,80 @@ void MkDirErr(const char * restrict dir,ERR_LOC_DECL)
 
 //======================================================================================================================
 
+FILEHANDLE CreateLockFile(const char * restrict fname ONLY_FOR_LOCK)
+// create lock file; works only if USE_LOCK is enabled
+{
+#ifdef USE_LOCK
+	FILEHANDLE fd;
+	int i;
+
+#	ifdef WINDOWS
+	i=0;
+	while ((fd=CreateFile(fname,GENERIC_WRITE,FILE_SHARE_WRITE,NULL,CREATE_NEW,FILE_ATTRIBUTE_NORMAL,NULL))
+		    ==INVALID_HANDLE_VALUE) {
+		Sleep(LOCK_WAIT*1000);
+		if (i++ == MAX_LOCK_WAIT_CYCLES) LogError(ONE_POS,"Lock file %s permanently exists",fname);
+	}
+#	elif defined(POSIX)
+#		ifdef LOCK_FOR_NFS
+	struct flock lock;
+#		endif
+	// open file exclusively
+	i=0;
+	while ((fd=open(fname,O_WRONLY | O_CREAT | O_EXCL,0666))==-1) {
+		sleep(LOCK_WAIT);
+		if (i++ == MAX_LOCK_WAIT_CYCLES) LogError(ONE_POS,"Lock file %s permanently exists",fname);
+	}
+#		ifdef LOCK_FOR_NFS
+	// specify lock
+	lock.l_type=F_WRLCK;
+	lock.l_whence=SEEK_SET;
+	lock.l_start=0;
+	lock.l_len=0;
+	// obtain lock*/
+	i=0;
+	while (fcntl(fd,F_SETLK,&lock)==-1) {
+		// if locked by another process wait and try again
+		if (errno==EACCES || errno==EAGAIN) {
+			sleep(LOCK_WAIT);
+			if (i++ == MAX_LOCK_WAIT_CYCLES) LogError(ONE_POS,"Lock file %s permanently exists",fname);
+		}
+		else { // otherwise produce a message and continue
+			if (errno==EOPNOTSUPP || errno==ENOLCK || errno==ENOSYS)
+				LogWarning(EC_WARN,ONE_POS,"Advanced file locking is not supported by the file system");
+			else LogWarning(EC_WARN,ONE_POS,"Unknown problem with file locking ('%s').",strerror(errno));
+			break;
+		}
+	}
+#		endif
+#	endif
+	// return file handle
+	return fd;
+#else
+	return 0;
+#endif
+}
+
+//======================================================================================================================
+
+void RemoveLockFile(FILEHANDLE fd ONLY_FOR_LOCK,const char * restrict fname ONLY_FOR_LOCK)
+// closes and remove lock file; works only if USE_LOCK is enabled
+{
+#ifdef USE_LOCK
+#	ifdef WINDOWS
+	// close file
+	CloseHandle(fd);
+#	elif defined(POSIX)
+	// close file; all locks are automatically released
+	close(fd);
+#	endif
+	// remove lock file
+	RemoveErr(fname,ONE_POS);
+#endif
+}
+
+//======================================================================================================================
+
 static inline void SkipFullLine(FILE * restrict file,char * restrict buf,const int buf_size)
 // skips full line in the file, starting from current position; uses buffer 'buf' with size 'buf_size'
 {
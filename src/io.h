@@ -20,13 +20,14 @@
 // project headers
 #include "const.h"    // for enum types
 #include "function.h" // for function attributes
+#include "os.h"       // for WINDOWS and POSIX
 // system headers
 #include <stdio.h>    // for file
 #include <stdarg.h>   // for va_list
 
 /* File locking is made quite robust, however it is a complex operation that can cause unexpected behavior (permanent
  * locks) especially when program is terminated externally (e.g. because of MPI failure). Moreover, it is not ANSI C,
- * hence may have problems on some particular systems. Currently file locking functions are only in param.c
+ * hence may have problems on some particular systems. Lock files are created and removed by functions below.
  */
 
 //#define NOT_USE_LOCK  // uncomment to disable file locking
@@ -37,6 +38,15 @@
 #	ifndef ONLY_LOCKFILE
 #		define LOCK_FOR_NFS // currently this works only for POSIX
 #	endif
+#	ifdef WINDOWS
+#		define FILEHANDLE HANDLE
+#	elif defined(POSIX)
+#		define FILEHANDLE int
+#	else
+#		error "Unknown operation system. Creation of lock files is not supported."
+#	endif
+#else
+#	define FILEHANDLE int
 #endif
 
 // Common parts of function declaration and calls; they are passed to ProcessError and DebugPrintf
@@ -71,6 +81,8 @@ FILE *FOpenErr(const char * restrict fname,const char * restrict mode,ERR_LOC_DE
 void FCloseErr(FILE * restrict file,const char * restrict fname,ERR_LOC_DECL);
 void RemoveErr(const char * restrict fname,ERR_LOC_DECL);
 void MkDirErr(const char * restrict dirname,ERR_LOC_DECL);
+FILEHANDLE CreateLockFile(const char * restrict fname);
+void RemoveLockFile(FILEHANDLE fd,const char * restrict fname);
 
 char *FGetsError(FILE * restrict file,const char * restrict fname,size_t *line,char * restrict buf,const int buf_size,
 	ERR_LOC_DECL);
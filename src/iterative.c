@@ -28,10 +28,12 @@
 #include "io.h"
 #include "linalg.h"
 #include "memory.h"
+#include "precond.h"
 #include "timing.h"
 #include "vars.h"
 // system headers
 #include <math.h>
+#include <stdint.h> // for uint64_t
 #include <stdlib.h>
 #include <string.h>
 #include <time.h> // for time_t & time
@@ -46,23 +48,36 @@
 // defined and initialized in calculator.c
 extern doublecomplex *rvec; // can't be declared restrict due to SwapPointers
 extern doublecomplex * restrict vec1,* restrict vec2,* restrict vec3,* restrict vec4,* restrict Avecbuffer;
+extern doublecomplex * restrict precvec;
+extern doublecomplex * restrict Eprev;
 // defined and initialized in fft.c
 #if !defined(OPENCL) && !defined(SPARSE)
 extern doublecomplex * restrict Xmatrix; // used as storage for arrays in WKB init field
 #endif
 // defined and initialized in param.c
 extern const double iter_eps;
+extern const int gmres_m,idr_s,recycle_k;
+extern const enum prec Precond;
 extern const enum init_field InitField;
 extern const char *infi_fnameY,*infi_fnameX;
-extern const bool recalc_resid;
+extern const bool recalc_resid,recycle_ref;
 extern const enum chpoint chp_type;
 extern const time_t chp_time;
 extern const char *chp_dir;
+#ifdef MIXED_PREC
+extern const bool mixed_prec;
+#endif
 // defined and initialized in timing.c
 extern time_t last_chp_wt;
 extern TIME_TYPE Timing_OneIter,Timing_OneIterComm,Timing_InitIter,Timing_InitIterComm,Timing_IntFieldOneComm,
 	Timing_MVP,Timing_MVPComm,Timing_OneIterMVP,Timing_OneIterMVPComm;
-extern size_t TotalIter;
+extern size_t TotalIter,TotalMatVec;
+extern long TotalRecycleSaved;
+
+#ifdef MIXED_PREC
+// used in matvec.c
+bool matvec_single; // whether single-precision MatVec is used (inside inner iterations of mixed-precision mode)
+#endif
 
 // LOCAL VARIABLES
 
@@ -73,14 +88,24 @@ static double inprodR;     // used as |r_0|^2 and best squared norm of residual
 static double inprodRp1;   // used as |r_k+1|^2 and squared norm of current residual
 static double epsB;        // stopping criterion
 static double resid_scale; // scale to get square of relative error
+static double col_scale[MAX_NRHS]; // scales to get squares of relative errors for each column (only if nrhs>1)
 static double prev_err;    // previous relative error; used in ProgressReport, initialized in IterativeSolver
 static int ind_m;          // index of iterative method
-static int niter;          // iteration count
+static int niter;          // iteration count (since the last restart in mixed-precision mode)
+static int niter_shift;    // number of iterations before the last restart, added to niter in reports
 static int counter;        // number of successive iterations without residual decrease
 static bool chp_exit;      // checkpoint occurred - exit
 static bool complete;      // complete iteration was performed (not stopped in the middle)
 	// whether matrix-vector product computed during initialization can be reused at first iteration
 static bool matvec_ready;
+// recycled subspace of GMRES (see RecycleUpdate), which is kept between the runs of the iterative solver
+static int nrec;                          // number of recycled vectors (columns of U and C)
+static double rec_scale[MAX_GMRES_M];     // inverse norms of columns of U
+static doublecomplex rec_cc[MAX_NMAT][3]; // values of cc_sqrt, for which C=A.U was computed
+static bool rec_off;                      // recycling is turned off (during the reference solve, see IterativeSolver)
+static size_t rec_mvp_ref;                // number of MatVecs in the last reference solve
+static bool prev_ready[2]; // whether internal fields from the previous orientation are stored in Eprev (Y and X)
+static double prev_frame[2][3][3]; // incPolX, incPolY, and prop for the fields stored in Eprev
 typedef struct // data for checkpoints
 {
 	void *ptr; // pointer to the data
@@ -106,8 +131,12 @@ static doublecomplex dumb ATT_UNUSED; // dumb variable, used in workaround for i
 ITER_FUNC(BCGS2);
 ITER_FUNC(BiCG_CS);
 ITER_FUNC(BiCGStab);
+ITER_FUNC(BiCGStab_Block);
 ITER_FUNC(CGNR);
 ITER_FUNC(CSYM);
+ITER_FUNC(GMRES);
+ITER_FUNC(IDR);
+ITER_FUNC(PBiCGStab);
 ITER_FUNC(QMR_CS);
 ITER_FUNC(QMR_CS_2);
 /* TO ADD NEW ITERATIVE SOLVER
@@ -119,8 +148,12 @@ static const struct iter_params_struct params[]={
 	{IT_BCGS2,15000,2,1,BCGS2},
 	{IT_BICG_CS,50000,1,0,BiCG_CS},
 	{IT_BICGSTAB,30000,3,3,BiCGStab},
+	{IT_BICGSTAB_B,30000,0,0,BiCGStab_Block},
 	{IT_CGNR,10,1,0,CGNR},
 	{IT_CSYM,10,6,2,CSYM},
+	{IT_GMRES,50000,8,1,GMRES},
+	{IT_IDR,10000,2,3,IDR},
+	{IT_PBICGSTAB,30000,4,1,PBiCGStab},
 	{IT_QMR_CS,50000,8,3,QMR_CS},
 	{IT_QMR_CS_2,50000,5,2,QMR_CS_2}
 	/* TO ADD NEW ITERATIVE SOLVER
@@ -156,6 +189,91 @@ static inline void SwapPointers(doublecomplex **a,doublecomplex **b)
 
 //======================================================================================================================
 
+/* The following functions are analogues of the ones in linalg.c for block vectors, i.e. consisting of nrhs columns of
+ * length local_nRows each (see nrhs). For nrhs=1 they are equivalent to the original functions.
+ */
+
+static inline doublecomplex *Col(doublecomplex * restrict v,const int j)
+// returns the j-th column of block vector v
+{
+	return v+j*local_nRows;
+}
+
+//======================================================================================================================
+
+static double ColumnsNorm(const double * restrict norm)
+/* returns the squared norm of the residual, which is used in convergence test, given the squared norms of its columns.
+ * For a block vector it is the maximum of the latter, scaled by the squared norms of the corresponding right-hand sides
+ * (so that the relative error is controlled for each of the columns).
+ */
+{
+	int j;
+	double res;
+
+	if (nrhs==1) return norm[0];
+	res=0;
+	for (j=0;j<nrhs;j++) res=MAX(res,col_scale[j]*norm[j]);
+	return res;
+}
+
+//======================================================================================================================
+
+static void BlockInit(doublecomplex * restrict a)
+// initialize block vector a with null values
+{
+	int j;
+
+	for (j=0;j<nrhs;j++) nInit(Col(a,j));
+}
+
+//======================================================================================================================
+
+static void BlockCopy(doublecomplex * restrict a,doublecomplex * restrict b)
+// copy block vector b to a
+{
+	int j;
+
+	for (j=0;j<nrhs;j++) nCopy(Col(a,j),Col(b,j));
+}
+
+//======================================================================================================================
+
+static void BlockSubtr(doublecomplex * restrict a,doublecomplex * restrict b,doublecomplex * restrict c,
+	double * restrict inprod,TIME_TYPE *comm_timing)
+// a=b-c for block vectors, inprod is the norm of a (see ColumnsNorm)
+{
+	int j;
+	double norm[MAX_NRHS];
+
+	for (j=0;j<nrhs;j++) nSubtr(Col(a,j),Col(b,j),Col(c,j),norm+j,comm_timing);
+	*inprod=ColumnsNorm(norm);
+}
+
+//======================================================================================================================
+
+static void BlockDecrem(doublecomplex * restrict a,doublecomplex * restrict b,double * restrict inprod,
+	TIME_TYPE *comm_timing)
+// a-=b for block vectors, inprod is the norm of a (see ColumnsNorm)
+{
+	int j;
+	double norm[MAX_NRHS];
+
+	for (j=0;j<nrhs;j++) nDecrem(Col(a,j),Col(b,j),norm+j,comm_timing);
+	*inprod=ColumnsNorm(norm);
+}
+
+//======================================================================================================================
+
+static void BlockMult_mat(doublecomplex * restrict a,doublecomplex * restrict b)
+// a=sqrt(C).b for block vectors
+{
+	int j;
+
+	for (j=0;j<nrhs;j++) nMult_mat(Col(a,j),Col(b,j),cc_sqrt);
+}
+
+//======================================================================================================================
+
 /* Checkpoint systems saves the current state of the iterative solver to the file. By default (for every iterative
  * solver) a number of scalars and vectors are saved. The scalars include, among others, inprodR. There are 3 default
  * vectors: xvec, rvec, pvec (Avecbuffer is _not_ saved). If the iterative solver requires any other scalars or vectors
@@ -298,7 +416,7 @@ static void ProgressReport(void)
 		if (counter==0) temp="+ ";
 		else if (progr>0) temp="-+";
 		else temp="- ";
-		SnprintfErr(ONE_POS,progr_string,MAX_LINE,RESID_STRING"  %s",niter,err,temp);
+		SnprintfErr(ONE_POS,progr_string,MAX_LINE,RESID_STRING"  %s",niter+niter_shift,err,temp);
 		if (!orient_avg) fprintf(logfile,"%s  progress ="FFORM_PROG"\n",progr_string,progr);
 		printf("%s\n",progr_string);
 		prev_err=err;
@@ -332,13 +450,56 @@ static double ResidualNorm2(doublecomplex * restrict x,doublecomplex * restrict
 	MatVec(x,buffer,NULL,false,mvp_timing,&mc_time);
 	(*mvp_comm_timing) += mc_time;
 	(*comm_timing) += mc_time;
-	nMult_mat(r,Einc,cc_sqrt);
-	nDecrem(r,buffer,&res,comm_timing);
+	BlockMult_mat(r,Einc);
+	BlockDecrem(r,buffer,&res,comm_timing);
 	return res;
 }
 
 //======================================================================================================================
 
+static void PrecMatVec(doublecomplex * restrict in,doublecomplex * restrict out,double * inprod,TIME_TYPE *timing,
+	TIME_TYPE *comm_timing)
+/* Matrix-vector product of the right-preconditioned matrix out=A.M.in, which is used inside the iterative solvers
+ * instead of MatVec (all other arguments are the same). Without preconditioner it is identical to MatVec, otherwise
+ * M.in is first computed (column by column) into precvec. Time of the latter is added to timing.
+ */
+{
+	int j;
+	TIME_TYPE tstart;
+
+	if (Precond==PREC_NONE) MatVec(in,out,inprod,false,timing,comm_timing);
+	else {
+		tstart=GET_TIME();
+		for (j=0;j<nrhs;j++) PrecApply(Col(precvec,j),Col(in,j));
+		(*timing)+=GET_TIME()-tstart;
+		MatVec(precvec,out,inprod,false,timing,comm_timing);
+	}
+}
+
+//======================================================================================================================
+
+static void PrecToSolver(void)
+/* transforms xvec from the solution of the original system (x) into that of the preconditioned one (z=M^(-1).x); the
+ * residual is not changed, since A.M.z=A.x
+ */
+{
+	int j;
+
+	if (Precond!=PREC_NONE) for (j=0;j<nrhs;j++) PrecApplyInverse(Col(xvec,j));
+}
+
+//======================================================================================================================
+
+static void PrecToSolution(void)
+// inverse of PrecToSolver: x=M.z
+{
+	int j;
+
+	if (Precond!=PREC_NONE) for (j=0;j<nrhs;j++) PrecApply(Col(xvec,j),Col(xvec,j));
+}
+
+//======================================================================================================================
+
 ITER_FUNC(BCGS2)
 /* Enhanced Bi-CGStab(2) method.
  * Based on the code by M.A. Botchev and D.R. Fokkema - http://www.math.uu.nl/people/vorst/zbcg2.f90 and
@@ -411,7 +572,7 @@ ITER_FUNC(BCGS2)
 				rho0=rho1;
 				// u_j+1 = A.u_j
 				if (niter==1 && j==0 && matvec_ready) {} // do nothing; u[1]<=>Avecbuffer already contains matvec result
-				else MatVec(u[j],u[j+1],NULL,false,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
+				else PrecMatVec(u[j],u[j+1],NULL,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
 				sigma=nDotProd(u[j+1],pvec,&Timing_OneIterComm); // sigma = u_j+1.r~0
 				// test for zero sigma (1/alpha)
 				dtmp=cabs(sigma)/cabs(rho1); // assume that rho1 is not exactly zero
@@ -423,7 +584,7 @@ ITER_FUNC(BCGS2)
 				// r_i = r_i - alpha*u_i+1
 				temp1=-alpha;
 				for (i=0;i<=j;i++) nIncrem01_cmplx(r[i],u[i+1],temp1,NULL,NULL);
-				MatVec(r[j],r[j+1],NULL,false,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
+				PrecMatVec(r[j],r[j+1],NULL,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
 			}
 			// --- The convex polynomial part ---
 			// Z = R'R
@@ -669,10 +830,11 @@ ITER_FUNC(BiCGStab)
 			return;
 		case PHASE_INIT:
 			if (!load_chpoint) nCopy(rtilda,rvec); // r~=r_0
+			// ro_0=r_0.r~ ; further it is computed at the end of each iteration
+			ro_new=nDotProd(rvec,rtilda,&Timing_InitIterComm);
 			return;
 		case PHASE_ITER:
-			// ro_k-1=r_k-1.r~ ; check for ro_k-1!=0
-			ro_new=nDotProd(rvec,rtilda,&Timing_OneIterComm);
+			// ro_new=ro_k-1=r_k-1.r~ ; assume that ro_k-1!=0
 			if (niter==1) nCopy(pvec,rvec); // p_1=r_0
 			else {
 				// beta_k-1=(ro_k-1/ro_k-2)*(alpha_k-1/omega_k-1)
@@ -689,7 +851,7 @@ ITER_FUNC(BiCGStab)
 			}
 			// calculate v_k=A.p_k
 			if (niter==1 && matvec_ready) nCopy(v,Avecbuffer);
-			else MatVec(pvec,v,NULL,false,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
+			else PrecMatVec(pvec,v,NULL,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
 			// alpha_k=ro_new/(v_k.r~)
 			temp1=nDotProd(v,rtilda,&Timing_OneIterComm);
 			dtmp=cabs(temp1)/cabs(ro_new); // assume that ro_new is not exactly zero
@@ -707,16 +869,16 @@ ITER_FUNC(BiCGStab)
 			}
 			else {
 				// t=Avecbuffer=A.s
-				MatVec(s,Avecbuffer,&denumOmega,false,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
+				PrecMatVec(s,Avecbuffer,NULL,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
 				// omega_k=s.t/|t|^2
-				omega=nDotProd(s,Avecbuffer,&Timing_OneIterComm)/denumOmega;
-				// x_k=x_k-1+alpha_k*p_k+omega_k*s
-				nIncrem011_cmplx(xvec,pvec,s,alpha,omega);
-				// r_k=s-omega_k*t and |r_k|^2
-				temp1=-omega;
-				nLinComb1_cmplx(rvec,Avecbuffer,s,temp1,&inprodRp1,&Timing_OneIterComm);
+				omega=nDotProd_Norm2(s,Avecbuffer,&denumOmega,&Timing_OneIterComm)/denumOmega;
 				// initialize ro_old -> ro_k-2 for next iteration
 				ro_old=ro_new;
+				/* x_k=x_k-1+alpha_k*p_k+omega_k*s, r_k=s-omega_k*t, |r_k|^2, and ro_k=r_k.r~ for the next iteration
+				 * in a single pass
+				 */
+				ro_new=nIncrem011_LinComb1_cmplx(xvec,pvec,s,rvec,Avecbuffer,rtilda,alpha,omega,&inprodRp1,
+					&Timing_OneIterComm);
 			}
 			return; // end of PHASE_ITER
 	}
@@ -727,6 +889,153 @@ ITER_FUNC(BiCGStab)
 
 //======================================================================================================================
 
+static void SolveSmall(doublecomplex * restrict M,doublecomplex * restrict B,const int k,const char * restrict name)
+/* solves matrix equation M.X=B by Gaussian elimination with partial pivoting, where M and B are k x k matrices (stored
+ * by rows); the solution is stored in B, while M is destroyed. Used in block iterative solvers, for which nearly
+ * singular M (the smallest pivot relative to the largest element of M is less than EPS_PIVOT) signifies a breakdown.
+ * name is used in the error message.
+ */
+{
+#define EPS_PIVOT 1E-10
+	int i,j,l,p;
+	double mmax,pmax;
+	doublecomplex tmp;
+
+	mmax=0;
+	for (i=0;i<k*k;i++) mmax=MAX(mmax,cabs(M[i]));
+	for (j=0;j<k;j++) {
+		// choose the pivot and swap the rows
+		p=j;
+		pmax=cabs(M[j*k+j]);
+		for (i=j+1;i<k;i++) if (cabs(M[i*k+j])>pmax) {
+			p=i;
+			pmax=cabs(M[i*k+j]);
+		}
+		Dz("relative pivot %d of %s = "GFORM_DEBUG,j,name,pmax/mmax);
+		if (!(pmax>EPS_PIVOT*mmax)) LogError(ONE_POS,"Block solver fails: matrix %s is (nearly) singular (relative "
+			"pivot is "GFORM_DEBUG").",name,pmax/mmax);
+		if (p!=j) for (l=0;l<k;l++) {
+			tmp=M[j*k+l];
+			M[j*k+l]=M[p*k+l];
+			M[p*k+l]=tmp;
+			tmp=B[j*k+l];
+			B[j*k+l]=B[p*k+l];
+			B[p*k+l]=tmp;
+		}
+		// eliminate the column below the pivot
+		for (i=j+1;i<k;i++) {
+			tmp=M[i*k+j]/M[j*k+j];
+			for (l=j;l<k;l++) M[i*k+l]-=tmp*M[j*k+l];
+			for (l=0;l<k;l++) B[i*k+l]-=tmp*B[j*k+l];
+		}
+	}
+	// back substitution
+	for (j=k-1;j>=0;j--) for (l=0;l<k;l++) {
+		tmp=B[j*k+l];
+		for (i=j+1;i<k;i++) tmp-=M[j*k+i]*B[i*k+l];
+		B[j*k+l]=tmp/M[j*k+j];
+	}
+#undef EPS_PIVOT
+}
+
+//======================================================================================================================
+
+ITER_FUNC(BiCGStab_Block)
+/* Block Bi-Conjugate Gradient Stabilized for nrhs right-hand sides, based on
+ * A. El Guennouni, K. Jbilou, and H. Sadok, "A block version of BiCGSTAB for linear systems with multiple right-hand
+ * sides," Electron. Trans. Numer. Anal. 16, 129-142 (2003).
+ * All vectors are block ones (see nrhs), and scalar coefficients, except omega, are nrhs x nrhs matrices (stored by
+ * rows). Matrix-vector products are computed for all columns at once, which is the main advantage of the block solver,
+ * while other operations are performed column by column. Convergence is determined by the largest relative residual
+ * among the columns.
+ */
+{
+#define EPS1 1E-10 // for |omega|
+	static doublecomplex omega,alpha[MAX_NRHS*MAX_NRHS],beta[MAX_NRHS*MAX_NRHS],M[MAX_NRHS*MAX_NRHS];
+	static doublecomplex * restrict v,* restrict s,* restrict rtilda;
+	doublecomplex Mtmp[MAX_NRHS*MAX_NRHS],num;
+	double norm[MAX_NRHS],denum[MAX_NRHS],dtmp;
+	int i,j;
+	const int k=nrhs;
+
+	switch (ph) {
+		case PHASE_VARS:
+			v=vec1;
+			s=vec2;
+			rtilda=vec3;
+			return;
+		case PHASE_INIT:
+			BlockCopy(rtilda,rvec); // R~=R_0
+			return;
+		case PHASE_ITER:
+			if (niter==1) BlockCopy(pvec,rvec); // P_1=R_0
+			else {
+				// P_k=R_k-1+(P_k-1-omega_k-1*V_k-1).beta_k-1; V_k-1 is used as temporary storage
+				for (i=0;i<k;i++) nIncrem10_cmplx(Col(v,i),Col(pvec,i),-omega,NULL,NULL);
+				for (j=0;j<k;j++) {
+					nCopy(Col(pvec,j),Col(rvec,j));
+					for (i=0;i<k;i++) nIncrem01_cmplx(Col(pvec,j),Col(v,i),beta[i*k+j],NULL,NULL);
+				}
+			}
+			// calculate V_k=A.P_k
+			if (niter==1 && matvec_ready) BlockCopy(v,Avecbuffer);
+			else PrecMatVec(pvec,v,NULL,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
+			// alpha_k is the solution of (R~^H.V_k).alpha_k = R~^H.R_k-1
+			for (i=0;i<k;i++) for (j=0;j<k;j++) {
+				M[i*k+j]=nDotProd(Col(v,j),Col(rtilda,i),&Timing_OneIterComm);
+				alpha[i*k+j]=nDotProd(Col(rvec,j),Col(rtilda,i),&Timing_OneIterComm);
+			}
+			memcpy(Mtmp,M,k*k*sizeof(doublecomplex));
+			SolveSmall(Mtmp,alpha,k,"R~^H.V");
+			// S=R_k-1-V_k.alpha_k
+			for (j=0;j<k;j++) {
+				nCopy(Col(s,j),Col(rvec,j));
+				for (i=0;i<k;i++) nIncrem01_cmplx(Col(s,j),Col(v,i),-alpha[i*k+j],(i==k-1) ? norm+j : NULL,
+					&Timing_OneIterComm);
+			}
+			inprodRp1=ColumnsNorm(norm);
+			// check convergence at this step
+			if (inprodRp1<epsB) {
+				// X_k=X_k-1+P_k.alpha_k
+				for (j=0;j<k;j++) for (i=0;i<k;i++) nIncrem01_cmplx(Col(xvec,j),Col(pvec,i),alpha[i*k+j],NULL,NULL);
+				complete=false;
+			}
+			else {
+				// T=Avecbuffer=A.S
+				PrecMatVec(s,Avecbuffer,denum,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
+				// omega_k=Tr(T^H.S)/Tr(T^H.T)
+				num=0;
+				dtmp=0;
+				for (j=0;j<k;j++) {
+					num+=nDotProd(Col(s,j),Col(Avecbuffer,j),&Timing_OneIterComm);
+					dtmp+=denum[j];
+				}
+				omega=num/dtmp;
+				Dz("|omega|="GFORM_DEBUG,cabs(omega));
+				if (cabs(omega)<EPS1) LogError(ONE_POS,"Block BiCGStab fails: |omega| is too small ("GFORM_DEBUG").",
+					cabs(omega));
+				// X_k=X_k-1+P_k.alpha_k+omega_k*S
+				for (j=0;j<k;j++) {
+					for (i=0;i<k;i++) nIncrem01_cmplx(Col(xvec,j),Col(pvec,i),alpha[i*k+j],NULL,NULL);
+					nIncrem01_cmplx(Col(xvec,j),Col(s,j),omega,NULL,NULL);
+				}
+				// R_k=S-omega_k*T and norms of its columns
+				for (j=0;j<k;j++)
+					nLinComb1_cmplx(Col(rvec,j),Col(Avecbuffer,j),Col(s,j),-omega,norm+j,&Timing_OneIterComm);
+				inprodRp1=ColumnsNorm(norm);
+				// beta_k is the solution of (R~^H.V_k).beta_k = -R~^H.T
+				for (i=0;i<k;i++) for (j=0;j<k;j++)
+					beta[i*k+j]=-nDotProd(Col(Avecbuffer,j),Col(rtilda,i),&Timing_OneIterComm);
+				SolveSmall(M,beta,k,"R~^H.V");
+			}
+			return; // end of PHASE_ITER
+	}
+	LogError(ONE_POS,"Unknown phase (%d) of the iterative solver",(int)ph);
+}
+#undef EPS1
+
+//======================================================================================================================
+
 ITER_FUNC(CGNR)
 /* Conjugate Gradient applied to Normalized Equations with minimization of Residual Norm, based on
  * "Templates for the Solution of Linear Systems: Building Blocks for Iterative Methods",
@@ -895,6 +1204,674 @@ ITER_FUNC(CSYM)
 
 //======================================================================================================================
 
+static inline double RandomEntry(uint64_t key)
+/* returns a pseudo-random number in [-1,1), completely determined by the key. It is based on the SplitMix64 generator,
+ * so the values for consecutive keys are statistically independent. Used to get vectors, which do not depend on the
+ * distribution of rows among processors.
+ */
+{
+	key+=0x9E3779B97F4A7C15ULL;
+	key=(key^(key>>30))*0xBF58476D1CE4E5B9ULL;
+	key=(key^(key>>27))*0x94D049BB133111EBULL;
+	key^=key>>31;
+	return (key>>11)/4503599627370496.0-1; // 2^52
+}
+
+//======================================================================================================================
+
+static void SmallQR(doublecomplex * restrict A,doublecomplex * restrict R,const int m,const int n)
+/* QR factorization of a small m x n matrix A (stored by rows, m>=n) by modified Gram-Schmidt orthogonalization of its
+ * columns; A is replaced by Q, and R (n x n upper-triangular, stored by rows) is stored if not NULL. Used for the
+ * update of the recycled subspace of GMRES, where the columns of A are (in exact arithmetic) linearly independent.
+ */
+{
+	int i,l,p;
+	double norm;
+	doublecomplex tmp;
+
+	for (l=0;l<n;l++) {
+		for (p=0;p<l;p++) {
+			tmp=0;
+			for (i=0;i<m;i++) tmp+=conj(A[i*n+p])*A[i*n+l];
+			for (i=0;i<m;i++) A[i*n+l]-=tmp*A[i*n+p];
+			if (R!=NULL) {
+				R[p*n+l]=tmp;
+				R[l*n+p]=0;
+			}
+		}
+		norm=0;
+		for (i=0;i<m;i++) norm+=cAbs2(A[i*n+l]);
+		norm=sqrt(norm);
+		if (norm==0) LogError(ONE_POS,"GMRES fails: recycled subspace is degenerate");
+		for (i=0;i<m;i++) A[i*n+l]/=norm;
+		if (R!=NULL) R[l*n+l]=norm;
+	}
+}
+
+//======================================================================================================================
+
+static void RecycleScale(doublecomplex * restrict U,TIME_TYPE *comm_timing)
+// computes the inverse norms of the recycled vectors (columns of U), which are used to scale them inside GMRES cycles
+{
+	int i;
+
+	for (i=0;i<nrec;i++) rec_scale[i]=1/sqrt(nNorm2(Col(U,i),comm_timing));
+}
+
+//======================================================================================================================
+
+static void RecycleStart(doublecomplex * restrict U,doublecomplex * restrict C)
+/* prepares the recycled subspace (nrec>0) for the new run of the iterative solver (or restart in mixed-precision mode).
+ * If the matrix has changed since C was computed (e.g. LDR polarizability depends on the incident polarization and
+ * direction), C=A.U is recomputed (nrec MatVecs) and orthonormalized (U is transformed accordingly). Then the initial
+ * guess is improved by the projection on the recycled subspace: x+=U.C^H.r, r-=C.C^H.r, and inprodR is updated.
+ */
+{
+	int i,l;
+	double dtmp;
+	doublecomplex tmp,h[MAX_GMRES_M],*Cp[MAX_GMRES_M];
+
+	if (memcmp(rec_cc,cc_sqrt,sizeof(rec_cc))!=0) {
+		memcpy(rec_cc,cc_sqrt,sizeof(rec_cc));
+		for (i=0;i<nrec;i++) {
+			PrecMatVec(Col(U,i),Col(C,i),NULL,&Timing_MVP,&Timing_MVPComm);
+			for (l=0;l<i;l++) {
+				tmp=nDotProd(Col(C,i),Col(C,l),&Timing_InitIterComm);
+				nIncrem01_cmplx(Col(C,i),Col(C,l),-tmp,NULL,NULL);
+				nIncrem01_cmplx(Col(U,i),Col(U,l),-tmp,NULL,NULL);
+			}
+			dtmp=1/sqrt(nNorm2(Col(C,i),&Timing_InitIterComm));
+			nMultSelf(Col(C,i),dtmp);
+			nMultSelf(Col(U,i),dtmp);
+		}
+		RecycleScale(U,&Timing_InitIterComm);
+	}
+	for (i=0;i<nrec;i++) Cp[i]=Col(C,i);
+	nDotProdBlock(h,Cp,nrec,&rvec,1,&Timing_InitIterComm);
+	for (i=0;i<nrec;i++) {
+		nIncrem01_cmplx(xvec,Col(U,i),h[i],NULL,NULL);
+		nIncrem01_cmplx(rvec,Col(C,i),-h[i],(i==nrec-1) ? &inprodR : NULL,&Timing_InitIterComm);
+	}
+}
+
+//======================================================================================================================
+
+static void RecycleUpdate(doublecomplex * restrict V,doublecomplex * restrict U,doublecomplex * restrict C,
+	doublecomplex * restrict S,doublecomplex (* restrict H)[MAX_GMRES_M+1],doublecomplex (* restrict G)[MAX_GMRES_M+1],
+	const double * restrict cs,const doublecomplex * restrict sn,const int k)
+/* updates the recycled subspace at the end of a GMRES cycle of k iterations (including nrec recycled ones), based on
+ * M.L. Parks, E. de Sturler, G. Mackey, D.D. Johnson, and S. Maiti, "Recycling Krylov subspaces for sequences of linear
+ * systems," SIAM J. Sci. Comput. 28, 1651-1674 (2006). The cycle satisfies A.Vh=W.Gb, where Vh=[U.D,V_k-nrec],
+ * W=[C,V_k-nrec+1] (orthonormal), and Gb is composed of D (diagonal matrix of rec_scale) and the unrotated Hessenberg
+ * matrix G. The new subspace is spanned by the harmonic Ritz vectors Vh.P, where P are the eigenvectors of the
+ * generalized problem Gb^H.Gb.p=theta*Gb^H.W^H.Vh.p with the smallest |theta|. Using the QR factorization Gb=Q.R (given
+ * by the rotated H and rotations cs,sn), this is equivalent to the largest eigenvalues of M=R^(-1).Q^H.W^H.Vh; the
+ * corresponding invariant subspace is obtained by orthogonal (subspace) iterations. Then Gb.P=Q2.R2, C=W.Q2,
+ * U=Vh.P.R2^(-1), so that A.U=C and C^H.C=I. S is a workspace of 2*recycle_k vectors.
+ */
+{
+#define REC_MAXITER 100 // maximum number of subspace iterations
+#define REC_EPS 1E-6    // relative tolerance of the subspace iterations
+	int i,l,p,it;
+	const int kk=MIN(recycle_k,k),k1=k+1;
+	double err,norm;
+	doublecomplex tmp;
+	doublecomplex *Z,*P,*Y,*GP,*R2,*WU;
+	doublecomplex *Wp[MAX_GMRES_M+1],*Vp[MAX_GMRES_M],*Sp[2*MAX_GMRES_M];
+
+	MALLOC_VECTOR(Z,complex,k1*k,ALL);
+	MALLOC_VECTOR(P,complex,k*kk,ALL);
+	MALLOC_VECTOR(Y,complex,k*kk,ALL);
+	MALLOC_VECTOR(GP,complex,k1*kk,ALL);
+	MALLOC_VECTOR(R2,complex,kk*kk,ALL);
+	// bases W and Vh as lists of vectors (the latter contains U without scaling)
+	for (i=0;i<nrec;i++) {
+		Wp[i]=Col(C,i);
+		Vp[i]=Col(U,i);
+	}
+	for (i=nrec;i<=k;i++) Wp[i]=Col(V,i-nrec);
+	for (i=nrec;i<k;i++) Vp[i]=Col(V,i-nrec);
+	// Z=W^H.Vh (k+1 x k); the part corresponding to V_k-nrec is trivial, since the latter is orthogonal to C
+	for (i=0;i<k1*k;i++) Z[i]=0;
+	if (nrec>0) {
+		MALLOC_VECTOR(WU,complex,k1*nrec,ALL);
+		nDotProdBlock(WU,Wp,k1,Vp,nrec,&Timing_OneIterComm);
+		for (i=0;i<k1;i++) for (l=0;l<nrec;l++) Z[i*k+l]=WU[i*nrec+l]*rec_scale[l];
+		Free_cVector(WU);
+	}
+	for (i=nrec;i<k;i++) Z[i*k+i]=1;
+	// M=R^(-1).Q^H.Z (first rotations, then back substitution); M is stored in the first k rows of Z
+	for (l=0;l<k;l++) for (i=0;i<k;i++) {
+		tmp=Z[i*k+l];
+		Z[i*k+l]=cs[i]*tmp+sn[i]*Z[(i+1)*k+l];
+		Z[(i+1)*k+l]=cs[i]*Z[(i+1)*k+l]-conj(sn[i])*tmp;
+	}
+	for (l=0;l<k;l++) for (i=k-1;i>=0;i--) {
+		tmp=Z[i*k+l];
+		for (p=i+1;p<k;p++) tmp-=H[p][i]*Z[p*k+l];
+		Z[i*k+l]=tmp/H[i][i];
+	}
+	/* orthogonal iterations P=orth(M.P) starting from a pseudo-random block, until the part of M.P orthogonal to P is
+	 * small (then P spans an approximate invariant subspace of M)
+	 */
+	for (i=0;i<k*kk;i++) P[i]=RandomEntry(2*(uint64_t)i)+I*RandomEntry(2*(uint64_t)i+1);
+	SmallQR(P,NULL,k,kk);
+	for (it=0;it<REC_MAXITER;it++) {
+		for (i=0;i<k;i++) for (l=0;l<kk;l++) {
+			tmp=0;
+			for (p=0;p<k;p++) tmp+=Z[i*k+p]*P[p*kk+l];
+			Y[i*kk+l]=tmp;
+		}
+		memcpy(GP,Y,k*kk*sizeof(doublecomplex)); // GP is used as a temporary storage for Y-P.P^H.Y
+		norm=err=0;
+		for (l=0;l<kk;l++) {
+			for (p=0;p<kk;p++) {
+				tmp=0;
+				for (i=0;i<k;i++) tmp+=conj(P[i*kk+p])*Y[i*kk+l];
+				for (i=0;i<k;i++) GP[i*kk+l]-=tmp*P[i*kk+p];
+			}
+			for (i=0;i<k;i++) {
+				norm+=cAbs2(Y[i*kk+l]);
+				err+=cAbs2(GP[i*kk+l]);
+			}
+		}
+		Dz("subspace iteration %d: relative error "GFORM_DEBUG,it,sqrt(err/norm));
+		if (err<REC_EPS*REC_EPS*norm) break;
+		memcpy(P,Y,k*kk*sizeof(doublecomplex));
+		SmallQR(P,NULL,k,kk);
+	}
+	// Gb.P=Q2.R2, Q2 is stored in GP
+	for (i=0;i<k1;i++) for (l=0;l<kk;l++) {
+		tmp=(i<nrec) ? rec_scale[i]*P[i*kk+l] : 0;
+		for (p=MAX(nrec,i-1);p<k;p++) tmp+=G[p][i]*P[p*kk+l];
+		GP[i*kk+l]=tmp;
+	}
+	SmallQR(GP,R2,k1,kk);
+	// P.R2^(-1) (in place), then scale the part, corresponding to U, by D
+	for (i=0;i<k;i++) for (l=0;l<kk;l++) {
+		tmp=P[i*kk+l];
+		for (p=0;p<l;p++) tmp-=P[i*kk+p]*R2[p*kk+l];
+		P[i*kk+l]=tmp/R2[l*kk+l];
+	}
+	for (i=0;i<nrec;i++) for (l=0;l<kk;l++) P[i*kk+l]*=rec_scale[i];
+	// new U and C are computed in workspace S, since the old ones are used in the right-hand sides
+	for (l=0;l<2*kk;l++) Sp[l]=Col(S,l);
+	nLinCombBlock(Sp,kk,Vp,k,P);
+	nLinCombBlock(Sp+kk,kk,Wp,k1,GP);
+	for (l=0;l<kk;l++) {
+		nCopy(Col(U,l),Sp[l]);
+		nCopy(Col(C,l),Sp[kk+l]);
+	}
+	nrec=kk;
+	memcpy(rec_cc,cc_sqrt,sizeof(rec_cc));
+	RecycleScale(U,&Timing_OneIterComm);
+	Free_cVector(Z);
+	Free_cVector(P);
+	Free_cVector(Y);
+	Free_cVector(GP);
+	Free_cVector(R2);
+#undef REC_MAXITER
+#undef REC_EPS
+}
+
+//======================================================================================================================
+
+static void RecycleReport(const size_t mvp)
+/* prints the number of MatVecs in the current run of the iterative solver with Krylov subspace recycling (including the
+ * ones for the update of the recycled subspace). With reference solves (recycle_ref) also prints the number of MatVecs
+ * saved compared to the reference solve of the same system without recycling, and accumulates it in TotalRecycleSaved
+ */
+{
+	char tmp_str[MAX_LINE];
+	long saved;
+
+	if (recycle_ref) {
+		saved=(long)rec_mvp_ref-(long)mvp;
+		TotalRecycleSaved+=saved;
+		SnprintfErr(ONE_POS,tmp_str,MAX_LINE,"Krylov recycling: %zu MatVecs (%ld saved compared to the reference "
+			"solve without recycling)\n",mvp,saved);
+	}
+	else SnprintfErr(ONE_POS,tmp_str,MAX_LINE,"Krylov recycling: %zu MatVecs in this run\n",mvp);
+	if (IFROOT) {
+		if (!orient_avg) fprintf(logfile,"%s",tmp_str);
+		printf("%s",tmp_str);
+	}
+}
+
+//======================================================================================================================
+
+static void GMRES_Start(doublecomplex * restrict V,doublecomplex (* restrict H)[MAX_GMRES_M+1],
+	doublecomplex * restrict g,double * restrict cs,doublecomplex * restrict sn,const double beta)
+/* starts a new cycle of GMRES: v_0=r/|r|, g=|r|.e_nrec. The first nrec columns of H correspond to the recycled vectors
+ * (if any); this part is a diagonal matrix of rec_scale, which requires no rotations
+ */
+{
+	int i,l;
+
+	nMult(V,rvec,1/beta);
+	for (i=0;i<nrec;i++) {
+		for (l=0;l<nrec;l++) H[i][l]=0;
+		H[i][i]=rec_scale[i];
+		g[i]=0;
+		cs[i]=1;
+		sn[i]=0;
+	}
+	g[nrec]=beta;
+}
+
+//======================================================================================================================
+
+static void GMRES_Update(doublecomplex * restrict V,doublecomplex * restrict U,
+	doublecomplex (* restrict H)[MAX_GMRES_M+1],doublecomplex * restrict g,const double * restrict cs,
+	const doublecomplex * restrict sn,const int k)
+/* finalizes the current cycle of GMRES after k iterations (including nrec recycled ones): x_k=x_0+Vh_k.y, where y is
+ * the solution of upper-triangular system H_k.y=g_k (H already contains the rotated Hessenberg matrix) and
+ * Vh_k=[U.D,V_k-nrec] (see RecycleUpdate), and r_k=V_k-nrec+1.Q_k^H.(0,...,0,g_k+1). The latter does not require an
+ * additional matrix-vector product, and C does not contribute to it, since the first nrec rotations are trivial. g is
+ * destroyed.
+ */
+{
+	int i,l;
+	doublecomplex z[MAX_GMRES_M+1],tmp;
+
+	// r_k is expressed through the basis, by applying inverse rotations to the last element of g
+	for (i=0;i<k;i++) z[i]=0;
+	z[k]=g[k];
+	for (i=k-1;i>=nrec;i--) {
+		tmp=z[i];
+		z[i]=cs[i]*tmp-sn[i]*z[i+1];
+		z[i+1]=conj(sn[i])*tmp+cs[i]*z[i+1];
+	}
+	nMult_cmplx(rvec,V,z[nrec]);
+	for (i=nrec+1;i<=k;i++) nIncrem01_cmplx(rvec,Col(V,i-nrec),z[i],NULL,NULL);
+	// back substitution, y is stored in g
+	for (i=k-1;i>=0;i--) {
+		tmp=g[i];
+		for (l=i+1;l<k;l++) tmp-=H[l][i]*g[l];
+		g[i]=tmp/H[i][i];
+	}
+	for (i=0;i<nrec;i++) nIncrem01_cmplx(xvec,Col(U,i),g[i]*rec_scale[i],NULL,NULL);
+	for (i=nrec;i<k;i++) nIncrem01_cmplx(xvec,Col(V,i-nrec),g[i],NULL,NULL);
+}
+
+//======================================================================================================================
+
+ITER_FUNC(GMRES)
+/* Generalized Minimal Residual, restarted after every m iterations (m is specified by gmres_m), based on
+ * Y. Saad and M.H. Schultz, "GMRES: a generalized minimal residual algorithm for solving nonsymmetric linear systems,"
+ * SIAM J. Sci. Stat. Comput. 7, 856-869 (1986).
+ * Each iteration is a step of the Arnoldi process (with modified Gram-Schmidt orthogonalization) and requires one
+ * matrix-vector product; the QR factorization of the Hessenberg matrix is updated by Givens rotations, which gives the
+ * residual norm for free. The solution (and the residual) is updated only at the end of each cycle, when the iterations
+ * have converged, or when maxiter is reached, so xvec and rvec correspond to the start of the current cycle otherwise.
+ * The residual norm never increases, but the method needs m+1 additional vectors (the Krylov basis V). It does not
+ * depend on the (complex) symmetry of the matrix, thus it is applicable to any interaction formulation.
+ *
+ * If recycle_k>0, the method is GCRO-DR (see RecycleUpdate): a subspace U of recycle_k vectors with known C=A.U
+ * (C^H.C=I) is kept between the cycles and between the runs of the iterative solver. Each cycle then consists of nrec
+ * (trivial) iterations, corresponding to U, and m-nrec Arnoldi iterations with the operator (I-C.C^H).A. It requires
+ * 4*recycle_k more vectors (U, C, and the workspace for their update) and a few dot products per iteration, but can
+ * significantly decrease the number of iterations both within a run (compared to GMRES with the same m) and for the
+ * following runs with the same (or slightly different) matrix.
+ */
+{
+	static doublecomplex H[MAX_GMRES_M][MAX_GMRES_M+1]; // rotated Hessenberg matrix, stored by columns
+	static doublecomplex G[MAX_GMRES_M][MAX_GMRES_M+1]; // unrotated copy of H (only with recycling)
+	static doublecomplex g[MAX_GMRES_M+1],sn[MAX_GMRES_M];
+	static double cs[MAX_GMRES_M];
+	static int j; // number of iterations (basis vectors) in the current cycle
+	static doublecomplex * restrict V,* restrict U,* restrict C,* restrict S;
+	doublecomplex *w,*Cp[MAX_GMRES_M];
+	doublecomplex tmp;
+	double dtmp,beta;
+	int i;
+
+	switch (ph) {
+		case PHASE_VARS:
+			V=vec1;
+			U=Col(vec1,gmres_m+1);
+			C=Col(vec1,gmres_m+1+recycle_k);
+			S=vec2;
+			/* initialize data structure for checkpoints; only the first m columns of H are saved, while the whole
+			 * block V (m+1 vectors), together with U and C, is treated as a single vector with element size
+			 * (m+1+2k)*sizeof(doublecomplex)
+			 */
+			scalars[0].ptr=H;
+			scalars[1].ptr=g;
+			scalars[2].ptr=sn;
+			scalars[3].ptr=cs;
+			scalars[4].ptr=&j;
+			scalars[5].ptr=G;
+			scalars[6].ptr=&nrec;
+			scalars[7].ptr=rec_scale;
+			scalars[0].size=gmres_m*(MAX_GMRES_M+1)*sizeof(doublecomplex);
+			scalars[1].size=(gmres_m+1)*sizeof(doublecomplex);
+			scalars[2].size=gmres_m*sizeof(doublecomplex);
+			scalars[3].size=gmres_m*sizeof(double);
+			scalars[4].size=sizeof(int);
+			scalars[5].size=(recycle_k>0) ? scalars[0].size : 0;
+			scalars[6].size=sizeof(int);
+			scalars[7].size=recycle_k*sizeof(double);
+			vectors[0].ptr=vec1;
+			vectors[0].size=(gmres_m+1+2*recycle_k)*sizeof(doublecomplex);
+			return;
+		case PHASE_INIT:
+			// the cycle is started anew, unless the state is loaded from checkpoint (niter_shift>0 for RestartMixed)
+			if (!load_chpoint || niter_shift!=0) {
+				if (nrec>0) RecycleStart(U,C);
+				GMRES_Start(V,H,g,cs,sn,sqrt(inprodR));
+				j=nrec;
+			}
+			// the loaded recycled subspace (if any) corresponds to the current matrix
+			else memcpy(rec_cc,cc_sqrt,sizeof(rec_cc));
+			return;
+		case PHASE_ITER:
+			// w=v_j+1=A.v_j (indices of V are shifted by nrec)
+			w=Col(V,j-nrec+1);
+			PrecMatVec(Col(V,j-nrec),w,NULL,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
+			// orthogonalization against C: h_ij=c_i.w, w-=C.h (single reduction)
+			if (nrec>0) {
+				for (i=0;i<nrec;i++) Cp[i]=Col(C,i);
+				nDotProdBlock(H[j],Cp,nrec,&w,1,&Timing_OneIterComm);
+				for (i=0;i<nrec;i++) nIncrem01_cmplx(w,Cp[i],-H[j][i],NULL,NULL);
+			}
+			// orthogonalization: h_ij=v_i.w, w-=h_ij*v_i; |w|^2 is computed at the last step
+			for (i=nrec;i<=j;i++) {
+				H[j][i]=nDotProd(w,Col(V,i-nrec),&Timing_OneIterComm);
+				nIncrem01_cmplx(w,Col(V,i-nrec),-H[j][i],(i==j) ? &dtmp : NULL,&Timing_OneIterComm);
+			}
+			// h_j+1,j=|w|, v_j+1=w/|w|; if |w|=0 (lucky breakdown) the residual below is exactly zero
+			H[j][j+1]=sqrt(dtmp);
+			if (dtmp!=0) nMultSelf(w,1/creal(H[j][j+1]));
+			if (recycle_k>0) memcpy(G[j],H[j],(j+2)*sizeof(doublecomplex));
+			// apply previous rotations to the new column of H
+			for (i=0;i<j;i++) {
+				tmp=H[j][i];
+				H[j][i]=cs[i]*tmp+sn[i]*H[j][i+1];
+				H[j][i+1]=cs[i]*H[j][i+1]-conj(sn[i])*tmp;
+			}
+			/* new rotation eliminates h_j+1,j: c_j=|h_jj|/rho, s_j=(h_jj/|h_jj|)*h_j+1,j/rho, where
+			 * rho=sqrt(|h_jj|^2+h_j+1,j^2), computed to avoid overflows (h_j+1,j is real and non-negative)
+			 */
+			dtmp=cabs(H[j][j]);
+			beta=creal(H[j][j+1]);
+			if (dtmp==0) {
+				if (beta==0) LogError(ONE_POS,"GMRES fails: Hessenberg matrix is singular");
+				cs[j]=0;
+				sn[j]=1;
+				H[j][j]=beta;
+			}
+			else {
+				tmp=H[j][j]/dtmp;
+				if (dtmp<beta) {
+					dtmp=dtmp/beta;
+					cs[j]=dtmp/sqrt(1+dtmp*dtmp);
+					beta*=sqrt(1+dtmp*dtmp);
+				}
+				else {
+					beta=beta/dtmp;
+					cs[j]=1/sqrt(1+beta*beta);
+					beta=dtmp*sqrt(1+beta*beta);
+				}
+				sn[j]=tmp*creal(H[j][j+1])/beta;
+				H[j][j]=tmp*beta;
+			}
+			H[j][j+1]=0;
+			// g_j+1=-s_j(*)*g_j, g_j=c_j*g_j; |r_j+1|=|g_j+1|
+			g[j+1]=-conj(sn[j])*g[j];
+			g[j]*=cs[j];
+			inprodRp1=cAbs2(g[j+1]);
+			j++;
+			// end of cycle: update x and r, and start a new cycle (if needed)
+			if (j==gmres_m || inprodRp1<epsB || niter+niter_shift==maxiter) {
+				GMRES_Update(V,U,H,g,cs,sn,j);
+				/* the recycled subspace is not updated after a short final cycle, since the latter contains too little
+				 * new information (the harmonic Ritz vectors may become worse)
+				 */
+				if (recycle_k>0 && !rec_off && (j==gmres_m || j-nrec>=recycle_k)) RecycleUpdate(V,U,C,S,H,G,cs,sn,j);
+				if (inprodRp1<epsB) return;
+				GMRES_Start(V,H,g,cs,sn,sqrt(inprodRp1));
+				j=nrec;
+			}
+			return; // end of PHASE_ITER
+	}
+	LogError(ONE_POS,"Unknown phase (%d) of the iterative solver",(int)ph);
+}
+
+//======================================================================================================================
+
+ITER_FUNC(IDR)
+/* Induced Dimension Reduction IDR(s) with bi-orthogonalization, based on
+ * M.B. van Gijzen and P. Sonneveld, "Algorithm 913: An elegant IDR(s) variant that efficiently exploits
+ * biorthogonality properties," ACM Trans. Math. Softw. 38, 5 (2011).
+ * The dimension of the shadow space s is specified by idr_s. Each iteration consists of s+1 matrix-vector products
+ * (s steps in the current subspace and one dimension-reduction step); the residual is updated after each of them.
+ * Shadow vectors P are random (orthonormalized), the omega is chosen with the 'maintaining the convergence' strategy
+ * (kappa=0.7). For s=1 the method is mathematically equivalent to BiCGStab, while for larger s it usually requires
+ * considerably less matrix-vector products (at the expense of 3s additional vectors).
+ */
+{
+#define EPS1 1E-10 // for |m_kk/f_k|
+#define EPS2 1E-10 // for |t.r|/(|t||r|)
+#define KAPPA 0.7  // threshold for omega
+	static doublecomplex M[MAX_IDR_S*MAX_IDR_S],omega; // M=P^H.G is lower triangular, stored by rows
+	static doublecomplex * restrict P,* restrict G,* restrict U;
+	doublecomplex f[MAX_IDR_S],c[MAX_IDR_S],alpha,beta;
+	doublecomplex * restrict v;
+	double dtmp,rho;
+	size_t j,n0;
+	int i,k,l;
+	const int s=idr_s;
+
+	switch (ph) {
+		case PHASE_VARS:
+			P=vec1;
+			G=vec2;
+			U=vec3;
+			// initialize data structure for checkpoints; each block of s vectors is treated as a single vector
+			scalars[0].ptr=M;
+			scalars[1].ptr=&omega;
+			scalars[0].size=s*s*sizeof(doublecomplex);
+			scalars[1].size=sizeof(doublecomplex);
+			vectors[0].ptr=vec1; // P
+			vectors[1].ptr=vec2; // G
+			vectors[2].ptr=vec3; // U
+			vectors[0].size=vectors[1].size=vectors[2].size=s*sizeof(doublecomplex);
+			return;
+		case PHASE_INIT:
+			// the solver is started anew, unless the state is loaded from checkpoint (niter_shift>0 for RestartMixed)
+			if (!load_chpoint || niter_shift!=0) {
+				// random P, which is then orthonormalized (modified Gram-Schmidt)
+				n0=3*local_nvoid_d0; // global index of the first local row
+				for (k=0;k<s;k++) {
+					v=Col(P,k);
+					for (j=0;j<local_nRows;j++) v[j]=RandomEntry(((uint64_t)(2*k)<<40)+n0+j)
+						+ I*RandomEntry(((uint64_t)(2*k+1)<<40)+n0+j);
+					for (i=0;i<k;i++) nIncrem01_cmplx(v,Col(P,i),-nDotProd(v,Col(P,i),&Timing_InitIterComm),NULL,NULL);
+					nMultSelf(v,1/sqrt(nNorm2(v,&Timing_InitIterComm)));
+				}
+				// G=U=0, M=I, omega=1
+				for (k=0;k<s;k++) {
+					nInit(Col(G,k));
+					nInit(Col(U,k));
+					for (i=0;i<s;i++) M[i*s+k]=(i==k);
+				}
+				omega=1;
+			}
+			return;
+		case PHASE_ITER:
+			v=Avecbuffer;
+			// f=P^H.r
+			for (i=0;i<s;i++) f[i]=nDotProd(rvec,Col(P,i),&Timing_OneIterComm);
+			for (k=0;k<s;k++) {
+				// solve lower-triangular system M(k:s,k:s).c=f(k:s)
+				for (i=k;i<s;i++) {
+					c[i]=f[i];
+					for (l=k;l<i;l++) c[i]-=M[i*s+l]*c[l];
+					c[i]/=M[i*s+i];
+				}
+				// v=r-G(:,k:s).c
+				nCopy(v,rvec);
+				for (i=k;i<s;i++) nIncrem01_cmplx(v,Col(G,i),-c[i],NULL,NULL);
+				// u_k=U(:,k:s).c+omega*v
+				nMultSelf_cmplx(Col(U,k),c[k]);
+				for (i=k+1;i<s;i++) nIncrem01_cmplx(Col(U,k),Col(U,i),c[i],NULL,NULL);
+				nIncrem01_cmplx(Col(U,k),v,omega,NULL,NULL);
+				// g_k=A.u_k
+				PrecMatVec(Col(U,k),Col(G,k),NULL,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
+				// bi-orthogonalize g_k (and u_k accordingly) against p_i, i<k
+				for (i=0;i<k;i++) {
+					alpha=nDotProd(Col(G,k),Col(P,i),&Timing_OneIterComm)/M[i*s+i];
+					nIncrem01_cmplx(Col(G,k),Col(G,i),-alpha,NULL,NULL);
+					nIncrem01_cmplx(Col(U,k),Col(U,i),-alpha,NULL,NULL);
+				}
+				// new column of M: m_ik=p_i.g_k, i>=k
+				for (i=k;i<s;i++) M[i*s+k]=nDotProd(Col(G,k),Col(P,i),&Timing_OneIterComm);
+				// beta=f_k/m_kk; assume that f_k is not exactly zero
+				dtmp=cabs(M[k*s+k])/cabs(f[k]);
+				Dz("|m_kk/f_k|="GFORM_DEBUG,dtmp);
+				if (dtmp<EPS1) LogError(ONE_POS,"IDR(s) fails: |m_kk/f_k| is too small ("GFORM_DEBUG").",dtmp);
+				beta=f[k]/M[k*s+k];
+				// r=r-beta*g_k, x=x+beta*u_k
+				nIncrem01_cmplx(rvec,Col(G,k),-beta,&inprodRp1,&Timing_OneIterComm);
+				nIncrem01_cmplx(xvec,Col(U,k),beta,NULL,NULL);
+				// f(k+1:s)=f(k+1:s)-beta*M(k+1:s,k)
+				for (i=k+1;i<s;i++) f[i]-=beta*M[i*s+k];
+				// check convergence at this step; if yes, checkpoint should not be saved afterwards
+				if (inprodRp1<epsB && chp_type!=CHP_ALWAYS) {
+					complete=false;
+					return;
+				}
+			}
+			// dimension reduction step: t=Avecbuffer=A.r, omega=t.r/|t|^2
+			PrecMatVec(rvec,Avecbuffer,&dtmp,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
+			alpha=nDotProd(rvec,Avecbuffer,&Timing_OneIterComm);
+			rho=cabs(alpha)/sqrt(dtmp*inprodRp1);
+			Dz("|t.r|/(|t||r|)="GFORM_DEBUG,rho);
+			if (rho<EPS2) LogError(ONE_POS,"IDR(s) fails: |t.r|/(|t||r|) is too small ("GFORM_DEBUG").",rho);
+			omega=alpha/dtmp;
+			if (rho<KAPPA) omega*=KAPPA/rho;
+			// x=x+omega*r, r=r-omega*t
+			nIncrem01_cmplx(xvec,rvec,omega,NULL,NULL);
+			nIncrem01_cmplx(rvec,Avecbuffer,-omega,&inprodRp1,&Timing_OneIterComm);
+			return; // end of PHASE_ITER
+	}
+	LogError(ONE_POS,"Unknown phase (%d) of the iterative solver",(int)ph);
+}
+#undef EPS1
+#undef EPS2
+#undef KAPPA
+
+//======================================================================================================================
+
+ITER_FUNC(PBiCGStab)
+/* Pipelined Bi-Conjugate Gradient Stabilized, based on
+ * S. Cools and W. Vanroose, "The communication-hiding pipelined BiCGstab method for the parallel solution of large
+ * unsymmetric linear systems," Parallel Computing 65, 1-20 (2017).
+ * Mathematically equivalent to BiCGStab, but the additional recurrences for s=A.p, z=A.s, w=A.r, and t=A.w allow one
+ * to group all inner products into two global reductions per iteration, each of them started (non-blocking) before and
+ * completed after one of the two matrix-vector products. All vector updates between the reductions are fused into a
+ * single pass (see nPipeUpdate1,2 in linalg.c). The price is 3 additional vectors (compared to BiCGStab), 2 extra
+ * matrix-vector products during initialization, and a somewhat larger accumulation of round-off errors.
+ */
+{
+#define EPS1 1E-10 // for 1/|beta|
+#define EPS2 1E-10 // for |denominator of alpha|/|r.r~|
+	static double dtmp;
+	static doublecomplex alpha,beta,omega,ro_old,temp1;
+	static doublecomplex dots[5]; // r.r~, w.r~, s.r~, z.r~, |r|^2 from the previous iteration
+	static doublecomplex sums[2]; // q.y, |y|^2
+	static doublecomplex * restrict rtilda,* restrict s,* restrict z,* restrict w,* restrict t,* restrict v;
+
+	switch (ph) {
+		case PHASE_VARS:
+			// rename parts of a single block
+			rtilda=vec1;
+			s=vec1+local_nRows;
+			z=vec1+2*local_nRows;
+			w=vec1+3*local_nRows;
+			t=vec1+4*local_nRows;
+			v=vec1+5*local_nRows;
+			// initialize data structure for checkpoints
+			scalars[0].ptr=&ro_old;
+			scalars[1].ptr=&omega;
+			scalars[2].ptr=&alpha;
+			scalars[3].ptr=dots;
+			scalars[0].size=scalars[1].size=scalars[2].size=sizeof(doublecomplex);
+			scalars[3].size=sizeof(dots);
+			vectors[0].ptr=vec1; // all six vectors at once
+			vectors[0].size=6*sizeof(doublecomplex);
+			return;
+		case PHASE_INIT:
+			// the solver is started anew, unless the state is loaded from checkpoint (niter_shift>0 for RestartMixed)
+			if (!load_chpoint || niter_shift!=0) {
+				nCopy(rtilda,rvec); // r~=r_0
+				// w_0=A.r_0; t_0=A.w_0
+				if (matvec_ready) nCopy(w,Avecbuffer);
+				else PrecMatVec(rvec,w,NULL,&Timing_MVP,&Timing_MVPComm);
+				PrecMatVec(w,t,NULL,&Timing_MVP,&Timing_MVPComm);
+				// p_-1=s_-1=z_-1=v_-1=0
+				nInit(pvec);
+				nInit(s);
+				nInit(z);
+				nInit(v);
+				// alpha_0=(r_0.r~)/(w_0.r~), where r_0.r~=|r_0|^2
+				ro_old=inprodR;
+				temp1=nDotProd(w,rtilda,&Timing_InitIterComm);
+				dtmp=cabs(temp1)/inprodR;
+				if (dtmp<EPS2) LogError(ONE_POS,"PBiCGStab fails: |w.r~|/|r.r~| is too small ("GFORM_DEBUG").",dtmp);
+				alpha=ro_old/temp1;
+			}
+			return;
+		case PHASE_ITER:
+			if (niter==1) beta=0; // then the old values of p, s, z, and v are not used
+			else { // complete the scalar recurrences using the reduction from the previous iteration
+				// beta_k-1=(ro_k/ro_k-1)*(alpha_k-1/omega_k-1)
+				temp1=dots[0]*alpha;
+				dtmp=cabs(ro_old*omega)/cabs(temp1); // assume that r.r~ is not exactly zero
+				Dz("1/|beta|="GFORM_DEBUG,dtmp);
+				if (dtmp<EPS1) LogError(ONE_POS,"PBiCGStab fails: 1/|beta| is too small ("GFORM_DEBUG").",dtmp);
+				beta=temp1/(ro_old*omega);
+				// alpha_k=(r_k.r~)/(w_k.r~+beta_k-1*(s_k-1.r~)-beta_k-1*omega_k-1*(z_k-1.r~))
+				temp1=dots[1]+beta*(dots[2]-omega*dots[3]);
+				dtmp=cabs(temp1)/cabs(dots[0]);
+				Dz("|den.alpha|/|r.r~|="GFORM_DEBUG,dtmp);
+				if (dtmp<EPS2) LogError(ONE_POS,"PBiCGStab fails: |denominator of alpha|/|r.r~| is too small ("
+					GFORM_DEBUG").",dtmp);
+				alpha=dots[0]/temp1;
+				ro_old=dots[0];
+			}
+			/* p_k=r_k+beta*(p_k-1-omega*s_k-1), s_k=A.p_k=w_k+beta*(s_k-1-omega*z_k-1),
+			 * z_k=A.s_k=t_k+beta*(z_k-1-omega*v_k-1); then q_k=r_k-alpha_k*s_k and y_k=A.q_k=w_k-alpha_k*z_k are
+			 * stored in place of r and w, respectively; sums=(q_k.y_k,|y_k|^2)
+			 */
+			nPipeUpdate1(pvec,s,z,rvec,w,t,v,beta,omega,alpha,sums);
+			MyInnerProductStart(sums,cmplx_type,2,&Timing_OneIterComm);
+			// v_k=A.z_k (overlapped with the reduction)
+			PrecMatVec(z,v,NULL,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
+			MyInnerProductWait(&Timing_OneIterComm);
+			// omega_k=(q_k.y_k)/|y_k|^2
+			dtmp=creal(sums[1]);
+			if (dtmp==0) LogError(ONE_POS,"PBiCGStab fails: |A.q| is exactly zero");
+			omega=sums[0]/dtmp;
+			/* x_k+1=x_k+alpha_k*p_k+omega_k*q_k, r_k+1=q_k-omega_k*y_k, w_k+1=A.r_k+1=y_k-omega_k*(t_k-alpha_k*v_k);
+			 * inner products needed for the next iteration and |r_k+1|^2 are stored in dots
+			 */
+			nPipeUpdate2(xvec,pvec,rvec,w,t,v,s,z,rtilda,alpha,omega,dots);
+			MyInnerProductStart(dots,cmplx_type,5,&Timing_OneIterComm);
+			// t_k+1=A.w_k+1 (overlapped with the reduction)
+			PrecMatVec(w,t,NULL,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
+			MyInnerProductWait(&Timing_OneIterComm);
+			inprodRp1=creal(dots[4]);
+			return; // end of PHASE_ITER
+	}
+	LogError(ONE_POS,"Unknown phase (%d) of the iterative solver",(int)ph);
+}
+#undef EPS1
+#undef EPS2
+
+//======================================================================================================================
+
 ITER_FUNC(QMR_CS)
 /* Quasi Minimum Residual for Complex Symmetric systems, based on:
  * Freund R.W. "Conjugate gradient-type methods for linear systems with complex symmetric coefficient matrices",
@@ -903,9 +1880,9 @@ ITER_FUNC(QMR_CS)
 {
 #define EPS1 1E-10 // for (vT.v)/(v.v)
 #define EPS2 1E-40 // for overflow of exponent number
-	static double c_old,c_new,omega_old,omega_new,zetaabs,dtmp1,dtmp2;
+	static double c_old,c_new,omega_old,omega_new,zetaabs,dtmp1,dtmp2,dtmp3;
 	static doublecomplex alpha,beta,theta,eta,zeta,zetatilda,tau,tautilda;
-	static doublecomplex s_new,s_old,temp1,temp2,temp4;
+	static doublecomplex s_new,s_old,temp1,temp2,temp3,temp4;
 	static doublecomplex *v,*vtilda,*p_new,*p_old; // can't be declared restrict due to SwapPointers
 
 	switch (ph) {
@@ -965,12 +1942,17 @@ ITER_FUNC(QMR_CS)
 			}
 			else MatVec(v,Avecbuffer,NULL,false,&Timing_OneIterMVP,&Timing_OneIterMVPComm);
 			alpha=nDotProd_conj(v,Avecbuffer,&Timing_OneIterComm);
-			// v~_k+1=-beta_k*v_k-1-alpha_k*v_k+A.v_k
+			/* v~_k+1=-beta_k*v_k-1-alpha_k*v_k+A.v_k; together with temp3=v~_k+1(*).v~_k+1 and dtmp3=||v~_k+1||^2
+			 * (used below)
+			 */
 			temp2=-alpha;
-			if (niter==1) nLinComb1_cmplx(vtilda,v,Avecbuffer,temp2,NULL,NULL); // use explicitly that v_0=0
+			if (niter==1) { // use explicitly that v_0=0
+				nLinComb1_cmplx(vtilda,v,Avecbuffer,temp2,NULL,NULL);
+				temp3=nDotProdSelf_conj_Norm2(vtilda,&dtmp3,&Timing_OneIterComm);
+			}
 			else {
 				temp1=-beta;
-				nIncrem110_cmplx(vtilda,v,Avecbuffer,temp1,temp2);
+				temp3=nIncrem110_cmplx_DotSelf(vtilda,v,Avecbuffer,temp1,temp2,&dtmp3,&Timing_OneIterComm);
 			}
 			// theta_k=s_k-2(*)*omega_k-1*beta_k
 			theta=conj(s_old)*omega_old*beta;
@@ -981,8 +1963,8 @@ ITER_FUNC(QMR_CS)
 			zetatilda = c_new*omega_new*alpha - s_new*c_old*omega_old*beta;
 			// beta_k+1=sqrt(v~_k+1(*).v~_k+1); omega_k+1=||v~_k+1||/|beta_k+1|
 			omega_old=omega_new;
-			temp1=nDotProdSelf_conj_Norm2(vtilda,&dtmp1,&Timing_OneIterComm); // dtmp1=||v~||^2
-			beta=csqrt(temp1);
+			dtmp1=dtmp3; // dtmp1=||v~||^2
+			beta=csqrt(temp3);
 			/* Here we do not check for zero beta, since exact zero is very improbable and the following code (until the
 			 * end of iteration) employs only the product omega_k+1*beta_k+1. So the (almost) breakdown is instead
 			 * checked at the beginning of the iteration.
@@ -1270,6 +2252,10 @@ static void CalcFieldWKB(doublecomplex * restrict Efield)
 		a_top=true;
 	}
 #else // define all vectors using memory assigned to Xmatrix; kind of weird but should be OK
+	// in lean mode Xmatrix holds a single component, which may be insufficient for a thin local box along z
+	if ((local_Ndip+2*boxXY)*sizeof(doublecomplex)+local_Ndip>mv_ncomp*local_Nsmall*sizeof(doublecomplex))
+		LogError(ALL_POS,"Lean mode ('-opt lean') is incompatible with WKB initial field for this grid. Use "
+			"'-opt mem', '-opt speed', or fewer processors");
 	arg=Xmatrix;
 #	ifdef PARALLEL
 	bottom=Xmatrix+local_Ndip;
@@ -1339,74 +2325,213 @@ static void InitFieldfromE(void)
 
 //======================================================================================================================
 
+static void PrevFieldCorrect(doublecomplex * restrict E,const enum incpol which)
+/* transforms the internal field E for the previous orientation according to the change of the incident plane wave:
+ * field at each dipole is rotated together with the beam reference frame and multiplied by the change of the phase of
+ * the incident wave. Thus, the incident field for the previous orientation is transformed exactly into the current one.
+ */
+{
+	size_t j;
+	int k;
+	double dk[3];
+	doublecomplex phase,cX,cY,cZ;
+	double (*frame)[3]=prev_frame[which];
+
+	vSubtr(prop,frame[2],dk);
+	vMultScal(WaveNum,dk,dk);
+	for (j=0;j<local_nRows;j+=3) {
+		phase=imExp(DotProd(dk,DipoleCoord+j));
+		cX=phase*crDotProd(E+j,frame[0]);
+		cY=phase*crDotProd(E+j,frame[1]);
+		cZ=phase*crDotProd(E+j,frame[2]);
+		for (k=0;k<3;k++) E[j+k]=cX*incPolX[k]+cY*incPolY[k]+cZ*prop[k];
+	}
+}
+
+//======================================================================================================================
+
+static const char *InitFieldPrevInc(const enum incpol which)
+/* sets starting vector from the internal field for the previous orientation (in xvec), corrected for the change of the
+ * incident field by PrevFieldCorrect. The corrected x_p is additionally scaled by a complex factor c to minimize the
+ * residual |b-c*A.x_p|; hence the latter is never larger than that for zero x_0. Requires the same single MatVec as
+ * InitFieldfromE. Returns string containing description of the initial field.
+ */
+{
+	doublecomplex c;
+	double norm;
+
+	PrevFieldCorrect(xvec,which);
+	InitFieldfromE(); // here Avecbuffer=A.x_p
+	norm=nNorm2(Avecbuffer,&Timing_InitIterComm);
+	c=nDotProd(pvec,Avecbuffer,&Timing_InitIterComm)/norm;
+	// x_0=c*x_p, r_0=b-c*A.x_p
+	nMultSelf_cmplx(xvec,c);
+	nLinComb1_cmplx(rvec,Avecbuffer,pvec,-c,&inprodR,&Timing_InitIterComm);
+	return dyn_sprintf("x_0 = "CFORM" * (corrected x from previous orientation)\n",REIM(c));
+}
+
+//======================================================================================================================
+
 static const char *CalcInitField(double zero_resid,const enum incpol which)
 /* Initializes the field as the starting point of the iterative solver. Assumes that pvec contains the right-hand side
  * of equations (b). At the end of this function xvec should contain initial vector for the iterative solver (x_0), rvec
  * - corresponding residual r_0, and inprodR - the norm of the latter residual. Returns string containing description of
- * the initial field used.
+ * the initial field used. For block solvers (nrhs>1) the same choice is made for all columns.
  */
 {
-	switch (InitField) {
+	enum init_field type=InitField;
+	// for the first orientation there is no previous solution
+	if ((type==IF_PREV || type==IF_PREV_INC) && !prev_ready[which]) type=IF_AUTO;
+	switch (type) {
 		case IF_AUTO:
 			/* This code is somewhat inelegant, but there seem to be no easy way to completely reuse code for other
 			 * cases. Moreover, this option will probably be changed afterwards.
 			 */
 			// calculate A.(x_0=b), r_0=b-A.(x_0=b) and |r_0|^2
 			MatVec(pvec,Avecbuffer,NULL,false,&Timing_MVP,&Timing_MVPComm);
-			nSubtr(rvec,pvec,Avecbuffer,&inprodR,&Timing_InitIterComm);
+			BlockSubtr(rvec,pvec,Avecbuffer,&inprodR,&Timing_InitIterComm);
 			// check which x_0 is better
 			if (zero_resid<inprodR) { // use x_0=0
-				nInit(xvec);
-				nCopy(rvec,pvec);
+				BlockInit(xvec);
+				BlockCopy(rvec,pvec);
 				inprodR=zero_resid;
 				matvec_ready=true; // here Avecbuffer = A.r_0
 				return "x_0 = 0\n";
 			}
 			else { // use x_0=Einc
-				nCopy(xvec,pvec);
+				BlockCopy(xvec,pvec);
 				return "x_0 = E_inc\n";
 			}
 		case IF_ZERO:
-			nInit(xvec); // x_0=0
-			nCopy(rvec,pvec); // r_0=b
+			BlockInit(xvec); // x_0=0
+			BlockCopy(rvec,pvec); // r_0=b
 			inprodR=zero_resid;
 			return "x_0 = 0\n";
 		case IF_INC:
-			nCopy(xvec,pvec); // x_0=b, i.e. E_exc=E_inc
+			BlockCopy(xvec,pvec); // x_0=b, i.e. E_exc=E_inc
 			// calculate A.(x_0=b), r_0=b-A.(x_0=b) and |r_0|^2
 			MatVec(xvec,Avecbuffer,NULL,false,&Timing_MVP,&Timing_MVPComm);
-			nSubtr(rvec,pvec,Avecbuffer,&inprodR,&Timing_InitIterComm);
+			BlockSubtr(rvec,pvec,Avecbuffer,&inprodR,&Timing_InitIterComm);
 			return "x_0 = E_inc\n";
 		case IF_WKB:
 			CalcFieldWKB(xvec); // calculate WKB electric field
 			InitFieldfromE(); // transform it into starting vector
 			return "x_0 = result of WKB\n";
-		case IF_READ: {
+		case IF_READ:
+		case IF_FILE: {
 			const char *fname;
 			if (which==INCPOL_Y) fname=infi_fnameY;
 			else fname=infi_fnameX; // which==INCPOL_X
-			ReadField(fname,xvec); // read electric field
+			// read electric field
+			if (type==IF_READ) ReadField(fname,xvec);
+			else ReadFieldBin(fname,xvec);
 			InitFieldfromE(); // transform it into starting vector
 			return dyn_sprintf("x_0 = from file %s\n",fname);
 		}
+		case IF_PREV:
+			nCopy(xvec,Col(Eprev,which));
+			InitFieldfromE();
+			return "x_0 = from previous orientation\n";
+		case IF_PREV_INC:
+			nCopy(xvec,Col(Eprev,which));
+			return InitFieldPrevInc(which);
 	}
 	LogError(ONE_POS,"Unknown method to calculate initial field (%d)",(int)InitField);
 }
 
 //======================================================================================================================
 
+#ifdef MIXED_PREC
+static bool RestartMixed(double * restrict outer_resid,int * restrict n_outer)
+/* Outer step of iterative refinement in mixed-precision mode, called after the iterations (with single-precision
+ * MatVec) are finished. Recomputes the residual (and inprodR) using double-precision MatVec. If it is still above the
+ * stopping criterion, restarts the iterative solver from the current xvec and returns true. Restart is not performed,
+ * if the iterations were stopped due to maxiter or checkpoint, or if the residual hasn't decreased since the previous
+ * outer step (in the latter case the achievable accuracy is limited by single precision). outer_resid is the squared
+ * norm of the residual after the previous outer step, n_outer is incremented for each correction.
+ */
+{
+	int j;
+	char tmp_str[MAX_LINE];
+
+	matvec_single=false;
+	// if no iterations were performed since the last restart, inprodR has already been computed in double precision
+	if (niter==1 || chp_exit) return false;
+	// with preconditioner, xvec is kept as z (see PrecMatVec), while the residual is computed for x=M.z
+	if (Precond==PREC_NONE) inprodR=ResidualNorm2(xvec,rvec,Avecbuffer,&Timing_MVP,&Timing_MVPComm,
+		&Timing_IntFieldOneComm);
+	else {
+		for (j=0;j<nrhs;j++) PrecApply(Col(precvec,j),Col(xvec,j));
+		inprodR=ResidualNorm2(precvec,rvec,Avecbuffer,&Timing_MVP,&Timing_MVPComm,&Timing_IntFieldOneComm);
+	}
+	(*n_outer)++;
+	if (IFROOT) {
+		prev_err=sqrt(resid_scale*inprodR);
+		SnprintfErr(ONE_POS,tmp_str,MAX_LINE,"Double-precision correction #%d: "RESID_STRING"\n",*n_outer,
+			niter+niter_shift-1,prev_err);
+		if (!orient_avg) fprintf(logfile,"%s",tmp_str);
+		printf("%s",tmp_str);
+	}
+	if (inprodR<=epsB || niter+niter_shift>maxiter) return false;
+	if (inprodR>=*outer_resid) {
+		LogWarning(EC_WARN,ONE_POS,"Residual norm hasn't decreased after the last double-precision correction. "
+			"Probably, the required accuracy ('-eps') can't be reached with single-precision MatVec.");
+		return false;
+	}
+	*outer_resid=inprodR;
+	// restart the iterative solver from the current xvec and rvec
+	niter_shift+=niter-1;
+	niter=1;
+	counter=0;
+	matvec_ready=false;
+	(*params[ind_m].func)(PHASE_INIT);
+	matvec_single=true;
+	return true;
+}
+
+#endif
+//======================================================================================================================
+
 int IterativeSolver(const enum iter method_in,const enum incpol which)
 /* choose required iterative method; do common initialization part;
- * 'which' is used only if the initial field is read from file
+ * 'which' is used only if the initial field is read from file. For block solvers (nrhs>1) all vectors contain nrhs
+ * columns, corresponding to different incident polarizations (see CalculateE), which are solved simultaneously.
  */
 {
 	double temp;
+	int j;
 	char tmp_str[MAX_LINE];
 	TIME_TYPE tstart,time_tmp,time_tmp2,time_tmp3;
+	size_t mvp_run; // to count MatVecs in this run (including initialization)
+#ifdef MIXED_PREC
+	double outer_resid;
+	int n_outer=0;
+	size_t mvp_start=0,n_inner=0;
+#endif
 
 	// redundant initialization to remove warnings
 	time_tmp=time_tmp2=time_tmp3=0;
 
+	/* reference solve of the same system by GMRES without recycling (the recycled subspace is kept intact), which is
+	 * a complete run of the iterative solver, except for storing the internal field for the next orientation. Then
+	 * the system is solved anew (from the same initial field) with recycling, overwriting all the results.
+	 */
+	if (recycle_ref && !rec_off) {
+		const int nrec_saved=nrec;
+		const size_t mvp_ref=TotalMatVec;
+		if (IFROOT) {
+			if (!orient_avg) fprintf(logfile,"Reference solve without Krylov recycling:\n");
+			printf("Reference solve without Krylov recycling:\n");
+		}
+		rec_off=true;
+		nrec=0;
+		IterativeSolver(method_in,which);
+		rec_off=false;
+		nrec=nrec_saved;
+		rec_mvp_ref=TotalMatVec-mvp_ref;
+	}
+	mvp_run=TotalMatVec;
+
 	/* Instead of solving system (I+D.C).x=b , C - diagonal matrix with couple constants
 	 *                                         D - symmetric interaction matrix of Green's tensor
 	 * we solve system (I+S.D.S).(S.x)=(S.b), S=sqrt(C), then total interaction matrix is symmetric and
@@ -1418,13 +2543,25 @@ int IterativeSolver(const enum iter method_in,const enum incpol which)
 	Timing_InitIterComm=Timing_MVP=Timing_MVPComm=0;
 	tstart=GET_TIME();
 	matvec_ready=false; // can be set to true only in CalcInitField (if !load_chpoint)
+	if (Precond!=PREC_NONE) UpdatePreconditioner();
 	if (!load_chpoint) {
-		nMult_mat(pvec,Einc,cc_sqrt);
-		temp=nNorm2(pvec,&Timing_InitIterComm); // |r_0|^2 when x_0=0
+		BlockMult_mat(pvec,Einc);
+		if (nrhs==1) temp=nNorm2(pvec,&Timing_InitIterComm); // |r_0|^2 when x_0=0
+		else { // each column is scaled by its own right-hand side, so the (scaled) |r_0|^2 equals 1 (see ColumnsNorm)
+			for (j=0;j<nrhs;j++) col_scale[j]=1/nNorm2(Col(pvec,j),&Timing_InitIterComm);
+			temp=1;
+		}
 		resid_scale=1/temp;
 		epsB=iter_eps*iter_eps*temp;
 		// Calculate initial field
 		const char *descr=CalcInitField(temp,which);
+		/* with preconditioner, the iterative solver works with z=M^(-1).x (see PrecMatVec), so A.r_0 computed in
+		 * CalcInitField can't be reused. The checkpoint (if loaded) already contains z.
+		 */
+		if (Precond!=PREC_NONE) {
+			PrecToSolver();
+			matvec_ready=false;
+		}
 		// print start values
 		if (IFROOT) {
 			prev_err=sqrt(resid_scale*inprodR);
@@ -1436,6 +2573,7 @@ int IterativeSolver(const enum iter method_in,const enum incpol which)
 		niter=1;
 		counter=0;
 	}
+	niter_shift=0;
 	/* determine index of the iterative solver, which is further used to get its parameters from list 'params'. This way
 	 * it should be resistant to inconsistencies in orders of iterative solvers inside the list of identifiers in
 	 * const.h and in the list 'params' above.
@@ -1463,8 +2601,17 @@ int IterativeSolver(const enum iter method_in,const enum incpol which)
 	Timing_InitIter = GET_TIME() - tstart;
 	Timing_InitIterComm += Timing_MVPComm; // Timing_MVPComm should (by here) include only iteration initialization
 	Timing_IntFieldOneComm=Timing_InitIterComm;
+#ifdef MIXED_PREC
+	/* In mixed-precision mode the iterations use single-precision MatVec, while the initial residual and its
+	 * corrections after the iterations (see RestartMixed) are computed in double precision
+	 */
+	outer_resid=inprodR;
+	matvec_single=mixed_prec;
+	do {
+		mvp_start=TotalMatVec;
+#endif
 	// main iteration cycle
-	while (inprodR>epsB && niter<=maxiter && counter<=params[ind_m].mc && !chp_exit) {
+	while (inprodR>epsB && niter+niter_shift<=maxiter && counter<=params[ind_m].mc && !chp_exit) {
 		// initialize time
 		Timing_OneIterComm=Timing_OneIterMVP=Timing_OneIterMVPComm=0;
 		tstart=GET_TIME();
@@ -1493,8 +2640,19 @@ int IterativeSolver(const enum iter method_in,const enum incpol which)
 		 */
 		ProgressReport();
 	}
+#ifdef MIXED_PREC
+		if (matvec_single) n_inner+=TotalMatVec-mvp_start;
+	} while (mixed_prec && RestartMixed(&outer_resid,&n_outer));
+	if (mixed_prec && IFROOT) {
+		SnprintfErr(ONE_POS,tmp_str,MAX_LINE,"Mixed precision: %zu inner single-precision MatVecs, %d outer "
+			"double-precision corrections\n",n_inner,n_outer);
+		if (!orient_avg) fprintf(logfile,"%s",tmp_str);
+		printf("%s",tmp_str);
+	}
+#endif
 	// Save checkpoint of type always
 	if (chp_type==CHP_ALWAYS && !chp_exit) SaveIterChpoint();
+	PrecToSolution(); // checkpoints contain the solution of the preconditioned system
 	/* process incomplete convergence
 	 * Since maxiter can be used in several reasonable ways, e.g. to control execution time, we allow calculation of
 	 * (potentially inaccurate) scattering quantities, when it is reached. We leave the warning although it may be
@@ -1504,8 +2662,8 @@ int IterativeSolver(const enum iter method_in,const enum incpol which)
 	 * better use maxiter.
 	 */
 	if (inprodR>epsB) {
-		if (niter>maxiter) LogWarning(EC_WARN,ONE_POS,"Iterations haven't converged in %d iterations. Further "
-			"calculated scattering quantities may be less accurate.",maxiter);
+		if (niter+niter_shift>maxiter) LogWarning(EC_WARN,ONE_POS,"Iterations haven't converged in %d iterations. "
+			"Further calculated scattering quantities may be less accurate.",maxiter);
 		else if (counter>params[ind_m].mc) LogError(ONE_POS,"Residual norm haven't decreased for maximum allowed "
 			"number of iterations (%d)",params[ind_m].mc);
 	}
@@ -1518,13 +2676,22 @@ int IterativeSolver(const enum iter method_in,const enum incpol which)
 			printf("%s",tmp_str);
 		}
 	}
+	if (recycle_k>0 && !rec_off && !chp_exit) RecycleReport(TotalMatVec-mvp_run);
 	// post-processing
 	if (params[ind_m].sc_N>0) Free_general(scalars);
 	if (params[ind_m].vec_N>0) Free_general(vectors);
 	/* x is a solution of a modified system, not exactly internal field; should not be used further except for adaptive
 	 * technique (as starting vector for next system)
 	 */
-	nMult_mat(pvec,xvec,cc_sqrt); // p now contains polarizations. Can be used to calculate e.g. scattered field faster.
+	BlockMult_mat(pvec,xvec); // p now contains polarizations. Can be used to calculate e.g. scattered field faster.
 	if (chp_exit) return CHP_EXIT; // check if exiting after checkpoint
-	return (niter-1); // the number of iterations elapsed
+	// store internal field to be used as initial one for the next orientation
+	if ((InitField==IF_PREV || InitField==IF_PREV_INC) && !rec_off) {
+		nMult_mat(Col(Eprev,which),pvec,chi_inv);
+		vCopy(incPolX,prev_frame[which][0]);
+		vCopy(incPolY,prev_frame[which][1]);
+		vCopy(prop,prev_frame[which][2]);
+		prev_ready[which]=true;
+	}
+	return (niter+niter_shift-1); // the number of iterations elapsed
 }
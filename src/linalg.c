@@ -145,6 +145,30 @@ doublecomplex nDotProdSelf_conj_Norm2(const doublecomplex * restrict a,double *
 
 //======================================================================================================================
 
+doublecomplex nDotProd_Norm2(const doublecomplex * restrict a,const doublecomplex * restrict b,double * restrict norm,
+	TIME_TYPE *comm_timing)
+/* Computes both dot product of two large vectors (a.b, here the dot implies conjugation) and the squared norm of the
+ * second one (norm=||b||^2) in a single pass and with a single reduction
+ * !!! a and b must not alias !!!
+ */
+{
+	register size_t i;
+	register const size_t n=local_nRows;
+	double buf[3]={0,0,0};
+
+	LARGE_LOOP;
+	for (i=0;i<n;i++) {
+		buf[0]+=creal(a[i])*creal(b[i]) + cimag(a[i])*cimag(b[i]);
+		buf[1]+=cimag(a[i])*creal(b[i]) - creal(a[i])*cimag(b[i]);
+		buf[2]+=cAbs2(b[i]);
+	}
+	MyInnerProduct(buf,double_type,3,comm_timing);
+	*norm=buf[2];
+	return buf[0] + I*buf[1];
+}
+
+//======================================================================================================================
+
 void nIncrem110_cmplx(doublecomplex * restrict a,const doublecomplex * restrict b,const doublecomplex * restrict c,
 	const doublecomplex c1,const doublecomplex c2)
 // a=c1*a+c2*b+c; !!! a,b,c must not alias !!!
@@ -158,6 +182,31 @@ void nIncrem110_cmplx(doublecomplex * restrict a,const doublecomplex * restrict
 
 //======================================================================================================================
 
+doublecomplex nIncrem110_cmplx_DotSelf(doublecomplex * restrict a,const doublecomplex * restrict b,
+	const doublecomplex * restrict c,const doublecomplex c1,const doublecomplex c2,double * restrict norm,
+	TIME_TYPE *comm_timing)
+/* a=c1*a+c2*b+c; returns conjugate dot product of the result on itself (a.a*), norm=||a||^2. Combination of
+ * nIncrem110_cmplx and nDotProdSelf_conj_Norm2 in a single pass. !!! a,b,c must not alias !!!
+ */
+{
+	register size_t i;
+	register const size_t n=local_nRows;
+	double buf[3]={0,0,0};
+
+	LARGE_LOOP;
+	for (i=0;i<n;i++) {
+		a[i] = c1*a[i] + c2*b[i] + c[i];
+		buf[0]+=creal(a[i])*creal(a[i]);
+		buf[1]+=cimag(a[i])*cimag(a[i]);
+		buf[2]+=creal(a[i])*cimag(a[i]);
+	}
+	MyInnerProduct(buf,double_type,3,comm_timing);
+	*norm=buf[0]+buf[1];
+	return buf[0] - buf[1] + I*2*buf[2];
+}
+
+//======================================================================================================================
+
 void nIncrem011_cmplx(doublecomplex * restrict a,const doublecomplex * restrict b,const doublecomplex * restrict c,
 	const doublecomplex c1,const doublecomplex c2)
 // a+=c1*b+c2*c; !!! a,b,c must not alias !!!
@@ -460,6 +509,34 @@ void nLinComb1_cmplx_conj(doublecomplex * restrict a,const doublecomplex * restr
 	}
 }
 
+//======================================================================================================================
+
+doublecomplex nIncrem011_LinComb1_cmplx(doublecomplex * restrict a,const doublecomplex * restrict b,
+	const doublecomplex * restrict c,doublecomplex * restrict d,const doublecomplex * restrict e,
+	const doublecomplex * restrict f,const doublecomplex c1,const doublecomplex c2,double * restrict inprod,
+	TIME_TYPE *comm_timing)
+/* a=a+c1*b+c2*c, d=c-c2*e, inprod=|d|^2; returns d.f (here the dot implies conjugation). Combines nIncrem011_cmplx,
+ * nLinComb1_cmplx and nDotProd (the end of BiCGStab iteration) in a single pass and with a single reduction.
+ * !!! a,b,c,d,e,f must not alias !!!
+ */
+{
+	register const size_t n=local_nRows;
+	register size_t i;
+	double buf[3]={0,0,0};
+
+	LARGE_LOOP;
+	for (i=0;i<n;i++) {
+		a[i] += c1*b[i] + c2*c[i];
+		d[i] = c[i] - c2*e[i];
+		buf[0]+=creal(d[i])*creal(f[i]) + cimag(d[i])*cimag(f[i]);
+		buf[1]+=cimag(d[i])*creal(f[i]) - creal(d[i])*cimag(f[i]);
+		buf[2]+=cAbs2(d[i]);
+	}
+	MyInnerProduct(buf,double_type,3,comm_timing);
+	*inprod=buf[2];
+	return buf[0] + I*buf[1];
+}
+
 
 //======================================================================================================================
 
@@ -603,3 +680,120 @@ void nConj(doublecomplex * restrict a)
 	LARGE_LOOP;
 	for (i=0;i<n;i++) a[i]=conj(a[i]);
 }
+
+//======================================================================================================================
+
+/* The following two functions implement the vector updates of the pipelined BiCGStab (see PBiCGStab in iterative.c),
+ * each in a single pass over all vectors. They compute only the local (on the current processor) parts of the inner
+ * products, to be reduced by the caller (non-blocking, overlapped with MatVec).
+ */
+void nPipeUpdate1(doublecomplex * restrict p,doublecomplex * restrict s,doublecomplex * restrict z,
+	doublecomplex * restrict r,doublecomplex * restrict w,const doublecomplex * restrict t,
+	const doublecomplex * restrict v,const doublecomplex beta,const doublecomplex omega,const doublecomplex alpha,
+	doublecomplex sums[2])
+/* p=r+beta*(p-omega*s), s=w+beta*(s-omega*z), z=t+beta*(z-omega*v) (using old values of s,z,v), then
+ * r=r-alpha*s, w=w-alpha*z (using new values); sums[0]=r.w, sums[1]=|w|^2 (here the dot implies conjugation)
+ * !!! all vectors must not alias !!!
+ */
+{
+	register const size_t n=local_nRows;
+	register size_t i;
+	doublecomplex dot=0;
+	double norm=0;
+
+	LARGE_LOOP;
+	for (i=0;i<n;i++) {
+		p[i] = r[i] + beta*(p[i]-omega*s[i]);
+		s[i] = w[i] + beta*(s[i]-omega*z[i]);
+		z[i] = t[i] + beta*(z[i]-omega*v[i]);
+		r[i] -= alpha*s[i];
+		w[i] -= alpha*z[i];
+		dot+=r[i]*conj(w[i]);
+		norm+=cAbs2(w[i]);
+	}
+	sums[0]=dot;
+	sums[1]=norm;
+}
+
+//======================================================================================================================
+
+void nPipeUpdate2(doublecomplex * restrict x,const doublecomplex * restrict p,doublecomplex * restrict r,
+	doublecomplex * restrict w,const doublecomplex * restrict t,const doublecomplex * restrict v,
+	const doublecomplex * restrict s,const doublecomplex * restrict z,const doublecomplex * restrict rt,
+	const doublecomplex alpha,const doublecomplex omega,doublecomplex sums[5])
+/* x=x+alpha*p+omega*r, r=r-omega*w, w=w-omega*(t-alpha*v) (using old values of r,w); sums[0]=r.rt, sums[1]=w.rt,
+ * sums[2]=s.rt, sums[3]=z.rt, sums[4]=|r|^2 (here the dot implies conjugation)
+ * !!! all vectors must not alias !!!
+ */
+{
+	register const size_t n=local_nRows;
+	register size_t i;
+	doublecomplex q,y,rtc;
+	doublecomplex buf[4]={0,0,0,0};
+	double norm=0;
+
+	LARGE_LOOP;
+	for (i=0;i<n;i++) {
+		q=r[i];
+		y=w[i];
+		x[i] += alpha*p[i] + omega*q;
+		r[i] = q - omega*y;
+		w[i] = y - omega*(t[i]-alpha*v[i]);
+		rtc=conj(rt[i]);
+		buf[0]+=r[i]*rtc;
+		buf[1]+=w[i]*rtc;
+		buf[2]+=s[i]*rtc;
+		buf[3]+=z[i]*rtc;
+		norm+=cAbs2(r[i]);
+	}
+	sums[0]=buf[0];
+	sums[1]=buf[1];
+	sums[2]=buf[2];
+	sums[3]=buf[3];
+	sums[4]=norm;
+}
+
+//======================================================================================================================
+
+void nDotProdBlock(doublecomplex * restrict res,doublecomplex * const * restrict a,const int na,
+	doublecomplex * const * restrict b,const int nb,TIME_TYPE *comm_timing)
+/* dot products of all pairs from two sets of large vectors (given by arrays of pointers): res[i*nb+j]=b_j.a_i (here the
+ * dot implies conjugation), i.e. a^H.b. Computed in a single pass over the vectors with a single reduction.
+ * !!! res must have na*nb elements !!!
+ */
+{
+	register const size_t n=local_nRows;
+	register size_t i;
+	int p,q;
+	doublecomplex tmp;
+
+	for (p=0;p<na*nb;p++) res[p]=0;
+	LARGE_LOOP;
+	for (i=0;i<n;i++) for (p=0;p<na;p++) {
+		tmp=conj(a[p][i]);
+		for (q=0;q<nb;q++) res[p*nb+q]+=b[q][i]*tmp;
+	}
+	MyInnerProduct(res,cmplx_type,na*nb,comm_timing);
+}
+
+//======================================================================================================================
+
+void nLinCombBlock(doublecomplex * const * restrict a,const int na,doublecomplex * const * restrict b,const int nb,
+	const doublecomplex * restrict c)
+/* linear combinations of a set of large vectors (given by array of pointers): a_j=sum(b_i*c[i*na+j],i), i.e. a=b.c,
+ * computed in a single pass over the vectors
+ * !!! a and b must not alias !!!
+ */
+{
+	register const size_t n=local_nRows;
+	register size_t i;
+	int p,q;
+	doublecomplex tmp;
+
+	LARGE_LOOP;
+	for (i=0;i<n;i++) for (q=0;q<na;q++) {
+		tmp=0;
+		for (p=0;p<nb;p++) tmp+=b[p][i]*c[p*na+q];
+		a[q][i]=tmp;
+	}
+}
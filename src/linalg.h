@@ -28,8 +28,13 @@ doublecomplex nDotProd(const doublecomplex * restrict a,const doublecomplex * re
 doublecomplex nDotProd_conj(const doublecomplex * restrict a,const doublecomplex * restrict b,TIME_TYPE *comm_timing);
 doublecomplex nDotProdSelf_conj(const doublecomplex * restrict a,TIME_TYPE *comm_timing);
 doublecomplex nDotProdSelf_conj_Norm2(const doublecomplex * restrict a,double * restrict norm,TIME_TYPE *comm_timing);
+doublecomplex nDotProd_Norm2(const doublecomplex * restrict a,const doublecomplex * restrict b,double * restrict norm,
+	TIME_TYPE *comm_timing);
 void nIncrem110_cmplx(doublecomplex * restrict a,const doublecomplex * restrict b,const doublecomplex * restrict c,
 	const doublecomplex c1,const doublecomplex c2);
+doublecomplex nIncrem110_cmplx_DotSelf(doublecomplex * restrict a,const doublecomplex * restrict b,
+	const doublecomplex * restrict c,const doublecomplex c1,const doublecomplex c2,double * restrict norm,
+	TIME_TYPE *comm_timing);
 void nIncrem011_cmplx(doublecomplex * restrict a,const doublecomplex * restrict b,const doublecomplex * restrict c,
 	const doublecomplex c1,const doublecomplex c2);
 void nIncrem110_d_c_conj(doublecomplex * restrict a,const doublecomplex * restrict b,const doublecomplex * restrict c,
@@ -56,6 +61,10 @@ void nLinComb1_cmplx(doublecomplex * restrict a,const doublecomplex * restrict b
 	const doublecomplex c1,double * restrict inprod,TIME_TYPE *comm_timing);
 void nLinComb1_cmplx_conj(doublecomplex * restrict a,const doublecomplex * restrict b,const doublecomplex * restrict c,
 	const doublecomplex c1,double * restrict inprod,TIME_TYPE *comm_timing);
+doublecomplex nIncrem011_LinComb1_cmplx(doublecomplex * restrict a,const doublecomplex * restrict b,
+	const doublecomplex * restrict c,doublecomplex * restrict d,const doublecomplex * restrict e,
+	const doublecomplex * restrict f,const doublecomplex c1,const doublecomplex c2,double * restrict inprod,
+	TIME_TYPE *comm_timing);
 void nSubtr(doublecomplex * restrict a,const doublecomplex * restrict b,const doublecomplex * restrict c,
 	double * restrict inprod,TIME_TYPE *comm_timing);
 void nMult(doublecomplex * restrict a,const doublecomplex * restrict b,const double c);
@@ -66,5 +75,17 @@ void nMultSelf_cmplx(doublecomplex * restrict a,const doublecomplex c);
 void nMult_mat(doublecomplex * restrict a,const doublecomplex * restrict b,doublecomplex (* restrict c)[3]);
 void nMultSelf_mat(doublecomplex * restrict a,doublecomplex (* restrict c)[3]);
 void nConj(doublecomplex * restrict a);
+void nPipeUpdate1(doublecomplex * restrict p,doublecomplex * restrict s,doublecomplex * restrict z,
+	doublecomplex * restrict r,doublecomplex * restrict w,const doublecomplex * restrict t,
+	const doublecomplex * restrict v,const doublecomplex beta,const doublecomplex omega,const doublecomplex alpha,
+	doublecomplex sums[2]);
+void nPipeUpdate2(doublecomplex * restrict x,const doublecomplex * restrict p,doublecomplex * restrict r,
+	doublecomplex * restrict w,const doublecomplex * restrict t,const doublecomplex * restrict v,
+	const doublecomplex * restrict s,const doublecomplex * restrict z,const doublecomplex * restrict rt,
+	const doublecomplex alpha,const doublecomplex omega,doublecomplex sums[5]);
+void nDotProdBlock(doublecomplex * restrict res,doublecomplex * const * restrict a,const int na,
+	doublecomplex * const * restrict b,const int nb,TIME_TYPE *comm_timing);
+void nLinCombBlock(doublecomplex * const * restrict a,const int na,doublecomplex * const * restrict b,const int nb,
+	const doublecomplex * restrict c);
 
 #endif // __linalg_h
@@ -23,9 +23,16 @@
 #include "io.h"
 #include "interaction.h"
 #include "linalg.h"
+#include "memory.h"
 #include "prec_time.h"
 #include "sparse_ops.h"
 #include "vars.h"
+// system headers
+#include <stdlib.h> // for EXIT_SUCCESS
+#include <string.h>
+#ifdef OPENMP
+#	include <omp.h>
+#endif
 
 // SEMI-GLOBAL VARIABLES
 
@@ -34,13 +41,18 @@
 extern doublecomplex * restrict arg_full;
 #else
 // defined and initialized in fft.c
-extern const doublecomplex * restrict Dmatrix,* restrict Rmatrix;
-extern doublecomplex * restrict Xmatrix,* restrict slices,* restrict slices_tr,* restrict slicesR,* restrict slicesR_tr;
-extern const size_t DsizeY,DsizeZ;
+extern doublecomplex * restrict Xmatrix,* restrict slices,* restrict slices_tr;
+extern size_t * restrict Xindex,* restrict garbledYZ;
+#	ifdef MIXED_PREC
+extern floatcomplex * restrict Xmatrix_sp,* restrict slices_sp,* restrict slices_tr_sp;
+#	endif
 #endif // !SPARSE
-extern const size_t RsizeY;
 // defined and initialized in timing.c
 extern size_t TotalMatVec;
+#ifdef MIXED_PREC
+// defined and initialized in iterative.c
+extern bool matvec_single;
+#endif
 
 // EXTERNAL FUNCTIONS
 
@@ -50,12 +62,13 @@ void FreeEverything(void); // for proper finalization
 #endif
 
 #ifndef SPARSE
-//======================================================================================================================
+// LOCAL VARIABLES
 
-static inline size_t IndexSliceZY(const size_t y,const size_t z)
-{
-	return z*gridY+y;
-}
+#ifdef PRECISE_TIMING
+// timers for the stages of ProcessSliceBatch; initialized and reported in MatVec
+static SYSTEM_TIME Timing_FFTYf,Timing_FFTZf,Timing_FFTYb,Timing_FFTZb,Timing_Mult2,Timing_Mult3,Timing_Mult4,
+	Timing_TYZf,Timing_TYZb;
+#endif
 
 //======================================================================================================================
 
@@ -67,57 +80,466 @@ static inline size_t IndexSliceYZ(const size_t y,const size_t z)
 //======================================================================================================================
 
 static inline size_t IndexGarbledX(const size_t x,const size_t y,const size_t z)
+/* index of (x,y,z) in Xmatrix after BlockTranspose, using precomputed garbledYZ; it is always called for
+ * local_x0<=x<local_x1, y<boxY, and z<boxZ
+ */
 {
-#ifdef PARALLEL
-	return ((z%local_Nz)*smallY+y)*gridX+(z/local_Nz)*local_Nx+x%local_Nx;
-#else
-	return (z*smallY+y)*gridX+x;
-#endif
+	return garbledYZ[y*boxZ+z]+(x-local_x0);
 }
 
 //======================================================================================================================
 
-static inline size_t IndexXmatrix(const size_t x,const size_t y,const size_t z)
+static void FillSlices(const size_t x0,const size_t nb,const size_t th)
+/* fill nb slices (starting from x0) of thread th with values from Xmatrix (all mv_ncomp components) and zeros. Only
+ * lines with y<boxY are used by fftZ and TransposeYZ, so the rest of the slice is not touched
+ */
 {
-	return (z*smallY+y)*gridX+x;
+	size_t i,j,k,x,y,z,Xcomp;
+	const size_t boxY_st=boxY,boxZ_st=boxZ; // copies with different type
+	const size_t ncomp=mv_ncomp,slsize=ncomp*gridYZ;
+	doublecomplex * restrict sl;
+
+	for (k=0;k<nb;k++) {
+		x=x0+k;
+		sl=slices+(th*slice_batch+k)*slsize; // slice of the current thread and batch
+		for(y=0;y<boxY_st;y++) {
+			for(z=0;z<boxZ_st;z++) {
+				i=IndexSliceYZ(y,z);
+				j=IndexGarbledX(x,y,z);
+				for (Xcomp=0;Xcomp<ncomp;Xcomp++) sl[i+Xcomp*gridYZ]=Xmatrix[j+Xcomp*local_Nsmall];
+			}
+			for(;z<gridZ;z++) {
+				i=IndexSliceYZ(y,z);
+				for (Xcomp=0;Xcomp<ncomp;Xcomp++) sl[i+Xcomp*gridYZ]=0.0;
+			}
+		}
+	}
 }
 
 //======================================================================================================================
 
-static inline size_t IndexDmatrix_mv(size_t x,size_t y,size_t z,const bool transposed)
+static void StoreSlices(const size_t x0,const size_t nb,const size_t th)
+// copy nb slices (starting from x0) of thread th back to Xmatrix; inverse of FillSlices
 {
-	if (transposed) { // used only for G_SO
-		/* reflection along the x-axis can't work in parallel mode, since the corresponding values are generally stored
-		 * on a different processor. A rearrangement of memory distribution is required to remove this limitation.
-		 */
-		if (x>0) x=gridX-x;
-		if (y>0) y=gridY-y;
-		if (z>0) z=gridZ-z;
+	size_t i,j,k,x,y,z,Xcomp;
+	const size_t boxY_st=boxY,boxZ_st=boxZ;
+	const size_t ncomp=mv_ncomp,slsize=ncomp*gridYZ;
+	const doublecomplex * restrict sl;
+
+	for (k=0;k<nb;k++) {
+		x=x0+k;
+		sl=slices+(th*slice_batch+k)*slsize;
+		for(y=0;y<boxY_st;y++) for(z=0;z<boxZ_st;z++) {
+			i=IndexSliceYZ(y,z);
+			j=IndexGarbledX(x,y,z);
+			for (Xcomp=0;Xcomp<ncomp;Xcomp++) Xmatrix[j+Xcomp*local_Nsmall]=sl[i+Xcomp*gridYZ];
+		}
 	}
-	else {
-		if (y>=DsizeY) y=gridY-y;
-		if (z>=DsizeZ) z=gridZ-z;
+}
+
+#ifdef MIXED_PREC
+//======================================================================================================================
+
+static void FillSlices_sp(const size_t x0,const size_t nb,const size_t th)
+// same as FillSlices(), but for single precision
+{
+	size_t i,j,k,x,y,z,Xcomp;
+	const size_t boxY_st=boxY,boxZ_st=boxZ;
+	const size_t ncomp=mv_ncomp,slsize=ncomp*gridYZ;
+	floatcomplex * restrict sl;
+
+	for (k=0;k<nb;k++) {
+		x=x0+k;
+		sl=slices_sp+(th*slice_batch+k)*slsize;
+		for(y=0;y<boxY_st;y++) {
+			for(z=0;z<boxZ_st;z++) {
+				i=IndexSliceYZ(y,z);
+				j=IndexGarbledX(x,y,z);
+				for (Xcomp=0;Xcomp<ncomp;Xcomp++) sl[i+Xcomp*gridYZ]=Xmatrix_sp[j+Xcomp*local_Nsmall];
+			}
+			for(;z<gridZ;z++) {
+				i=IndexSliceYZ(y,z);
+				for (Xcomp=0;Xcomp<ncomp;Xcomp++) sl[i+Xcomp*gridYZ]=0;
+			}
+		}
 	}
+}
 
-	return NDCOMP*((x*DsizeZ+z)*DsizeY+y);
+//======================================================================================================================
+
+static void StoreSlices_sp(const size_t x0,const size_t nb,const size_t th)
+// same as StoreSlices(), but for single precision
+{
+	size_t i,j,k,x,y,z,Xcomp;
+	const size_t boxY_st=boxY,boxZ_st=boxZ;
+	const size_t ncomp=mv_ncomp,slsize=ncomp*gridYZ;
+	const floatcomplex * restrict sl;
+
+	for (k=0;k<nb;k++) {
+		x=x0+k;
+		sl=slices_sp+(th*slice_batch+k)*slsize;
+		for(y=0;y<boxY_st;y++) for(z=0;z<boxZ_st;z++) {
+			i=IndexSliceYZ(y,z);
+			j=IndexGarbledX(x,y,z);
+			for (Xcomp=0;Xcomp<ncomp;Xcomp++) Xmatrix_sp[j+Xcomp*local_Nsmall]=sl[i+Xcomp*gridYZ];
+		}
+	}
 }
 
 //======================================================================================================================
 
-static inline size_t IndexRmatrix_mv(size_t x,size_t y,size_t z,const bool transposed)
+static void SwitchSlices(const bool single)
+/* unused slices of a partial batch are still transformed in MatVec, so they should contain finite values. Hence, slices
+ * are reset to zeros each time the precision of MatVec is changed
+ */
 {
-	if (transposed) { // used only for G_SO !!!
-		/* reflection along the x-axis can't work in parallel mode, since the corresponding values are generally stored
-		 * on a different processor. A rearrangement of memory distribution is required to remove this limitation.
-		 */
-		if (x>0) x=gridX-x;
-		if (y>0) y=gridY-y;
+	static bool cur_single=false; // whether slices are currently used in single precision
+
+	if (single!=cur_single) {
+		memset(slices,0,3*gridYZ*(size_t)nthreads*slice_batch*sizeof(doublecomplex));
+		cur_single=single;
 	}
-	else {
-		if (y>=RsizeY) y=gridY-y;
+}
+#endif // MIXED_PREC
+
+//======================================================================================================================
+
+static inline void MultRow(void * restrict v,const void * restrict w,const size_t x,const size_t z,
+	const bool transposed,const int mu,const int nu)
+/* multiplies a row of slices_tr by the corresponding row of F(D) (and F(R)), calling either MultDRow (full 3x3 matrix,
+ * mu<0), MultDRowComp (single element (mu,nu)), or MultDRow_sp (single precision)
+ */
+{
+#ifdef MIXED_PREC
+	if (matvec_single) {
+		MultDRow_sp(v,w,x,z,transposed);
+		return;
 	}
+#endif
+	if (mu<0) MultDRow(v,w,x,z,transposed);
+	else MultDRowComp(v,w,x,z,transposed,mu,nu);
+}
+
+//======================================================================================================================
+
+static void MultSlices(const size_t x0,const size_t nb,const size_t th,const bool transposed,const int mu,
+	const int nu)
+/* do the product D~*X~ and R~*X'~ by rows along y for nb slices (starting from x0) of thread th. For surface, X'~ at
+ * z-frequency z is X~ at zr=-z (modulo gridZ), hence rows z and zr are updated one after another. Row z is copied
+ * beforehand into the first lines of slices (which are not used between forward and backward TransposeYZ), since it is
+ * required for row zr. zr==z for z=0 and z=smallZ (gridZ is always even). For nrhs>1 the rows of all right-hand sides
+ * are processed one after another, while the corresponding rows of F(D) and F(R) are still in cache. The same code
+ * serves double- and single-precision slices, hence the addressing is performed in bytes (elsize).
+ */
+{
+	size_t k,x,z,zr,r,c;
+	const size_t nr=(mu<0) ? (size_t)mv_ncomp/3 : 1; // number of right-hand sides
+	const size_t cpr=mv_ncomp/nr; // number of components per right-hand side
+	const size_t slsize=mv_ncomp*gridYZ;
+#ifdef MIXED_PREC
+	const size_t elsize=matvec_single ? sizeof(floatcomplex) : sizeof(doublecomplex);
+#else
+	const size_t elsize=sizeof(doublecomplex);
+#endif
+	char * restrict sl,* restrict sl_tr;
 
-	return NDCOMP*((x*gridZ+z)*RsizeY+y);
+	for (k=0;k<nb;k++) {
+		x=x0+k-local_x0;
+		for (r=0;r<nr;r++) {
+			sl_tr=(char *)slices_tr+elsize*((th*slice_batch+k)*slsize+r*cpr*gridYZ);
+			if (surface) {
+				sl=(char *)slices+elsize*(th*slice_batch*slsize+r*cpr*gridYZ);
+				for(z=0;z<=smallZ;z++) {
+					zr=(gridZ-z)%gridZ;
+					for (c=0;c<cpr;c++)
+						memcpy(sl+elsize*c*gridYZ,sl_tr+elsize*(z*gridY+c*gridYZ),elsize*gridY);
+					MultRow(sl_tr+elsize*z*gridY,(zr==z) ? sl : sl_tr+elsize*zr*gridY,x,z,transposed,mu,nu);
+					if (zr!=z) MultRow(sl_tr+elsize*zr*gridY,sl,x,zr,transposed,mu,nu);
+				}
+			}
+			else for(z=0;z<gridZ;z++) MultRow(sl_tr+elsize*z*gridY,NULL,x,z,transposed,mu,nu);
+		}
+	}
+}
+
+//======================================================================================================================
+
+static void ProcessSliceBatch(const size_t b,const size_t th,const bool transposed,const int mu,const int nu)
+/* the part of MatVec between the forward and backward BlockTranspose for batch b of slices (along x), processed by
+ * thread th: slices are filled from Xmatrix, Fourier transformed along z and y, multiplied by F(D) (and F(R)),
+ * transformed back and copied back to Xmatrix. FFTs and transposes always process the whole batch, but the last batch
+ * may be only partly used. mu<0 corresponds to the product with full 3x3 matrices (all mv_ncomp components), otherwise
+ * slices contain a single component, which is multiplied by element (mu,nu) (used in MatVec_lean). In mixed-precision
+ * mode (matvec_single) all arrays are used in single precision (except for mu>=0, which is not supported).
+ * Precise timing of the stages is collected with shared timers, hence it is done only for a single thread.
+ */
+{
+	const size_t batch=slice_batch; // number of slices processed together
+	const size_t x0=local_x0+b*batch; // first x in the current batch
+	const size_t nb=MIN(batch,local_x1-x0); // number of slices in the current batch
+#ifdef MIXED_PREC
+	const bool single=matvec_single;
+#endif
+#ifdef PRECISE_TIMING
+	SYSTEM_TIME tvp[10];
+
+	GET_SYSTEM_TIME(tvp);
+#endif
+	/* TODO: the reflected interaction already reuses the transformed slices (see MatVec), but the typical situation of
+	 * particles near surfaces, like large particulate slabs, correspond to the smallest dimension along z. Then it is
+	 * beneficial to interchange z and y FFTs and to distribute dipoles among processors along y (then gridZ do not
+	 * have to divide nprocs). This requires an alternative data layout in fft.c, matvec.c, and comm.c - issue 177
+	 */
+#ifdef MIXED_PREC
+	if (single) FillSlices_sp(x0,nb,th);
+	else
+#endif
+	FillSlices(x0,nb,th);
+#ifdef PRECISE_TIMING
+	GET_SYSTEM_TIME(tvp+1);
+	ElapsedInc(tvp,tvp+1,&Timing_Mult2);
+#endif
+	// FFT z&y
+#ifdef MIXED_PREC
+	if (single) fftZ_sp(FFT_FORWARD,th);
+	else
+#endif
+	fftZ(FFT_FORWARD,th); // fftZ (buf)slices
+#ifdef PRECISE_TIMING
+	GET_SYSTEM_TIME(tvp+2);
+	ElapsedInc(tvp+1,tvp+2,&Timing_FFTZf);
+#endif
+#ifdef MIXED_PREC
+	if (single) TransposeYZ_sp(FFT_FORWARD,th);
+	else
+#endif
+	TransposeYZ(FFT_FORWARD,th);
+#ifdef PRECISE_TIMING
+	GET_SYSTEM_TIME(tvp+3);
+	ElapsedInc(tvp+2,tvp+3,&Timing_TYZf);
+#endif
+#ifdef MIXED_PREC
+	if (single) fftY_sp(FFT_FORWARD,th);
+	else
+#endif
+	fftY(FFT_FORWARD,th); // fftY (buf)slices_tr
+#ifdef PRECISE_TIMING
+	GET_SYSTEM_TIME(tvp+4);
+	ElapsedInc(tvp+3,tvp+4,&Timing_FFTYf);
+#endif
+	MultSlices(x0,nb,th,transposed,mu,nu);
+#ifdef PRECISE_TIMING
+	GET_SYSTEM_TIME(tvp+5);
+	ElapsedInc(tvp+4,tvp+5,&Timing_Mult3);
+#endif
+	// inverse FFT y&z
+#ifdef MIXED_PREC
+	if (single) fftY_sp(FFT_BACKWARD,th);
+	else
+#endif
+	fftY(FFT_BACKWARD,th); // fftY (buf)slices_tr
+#ifdef PRECISE_TIMING
+	GET_SYSTEM_TIME(tvp+6);
+	ElapsedInc(tvp+5,tvp+6,&Timing_FFTYb);
+#endif
+#ifdef MIXED_PREC
+	if (single) TransposeYZ_sp(FFT_BACKWARD,th);
+	else
+#endif
+	TransposeYZ(FFT_BACKWARD,th);
+#ifdef PRECISE_TIMING
+	GET_SYSTEM_TIME(tvp+7);
+	ElapsedInc(tvp+6,tvp+7,&Timing_TYZb);
+#endif
+#ifdef MIXED_PREC
+	if (single) fftZ_sp(FFT_BACKWARD,th);
+	else
+#endif
+	fftZ(FFT_BACKWARD,th); // fftZ (buf)slices
+#ifdef PRECISE_TIMING
+	GET_SYSTEM_TIME(tvp+8);
+	ElapsedInc(tvp+7,tvp+8,&Timing_FFTZb);
+#endif
+	// copy slices back to Xmatrix
+#ifdef MIXED_PREC
+	if (single) StoreSlices_sp(x0,nb,th);
+	else
+#endif
+	StoreSlices(x0,nb,th);
+#ifdef PRECISE_TIMING
+	GET_SYSTEM_TIME(tvp+9);
+	ElapsedInc(tvp+8,tvp+9,&Timing_Mult4);
+#endif
+}
+
+#ifdef MIXED_PREC
+//======================================================================================================================
+
+static void MatVec_sp(doublecomplex * restrict argvec,doublecomplex * restrict resultvec,double *inprod,const bool her,
+	TIME_TYPE *comm_timing)
+/* single-precision version of MatVec, used in mixed-precision mode (see matvec_single). Argument and result vectors are
+ * double precision, but all intermediate arrays (Xmatrix, slices, slices_tr) are used as arrays of floatcomplex, and
+ * all operations in between are performed in single precision. The algorithm is the same as in MatVec below, including
+ * the processing of slices by ProcessSliceBatch.
+ */
+{
+	size_t i,j,b,index,Xcomp;
+	unsigned char mat;
+	double ipr_sum=0;
+	const bool ipr=(inprod!=NULL);
+	const bool transposed=(!reduced_FFT) && her;
+	const size_t Xsize=3*local_Nsmall;
+	const size_t nbatch=(local_x1-local_x0+slice_batch-1)/slice_batch;
+	floatcomplex * restrict Xf=Xmatrix_sp;
+
+	if (ipr && !ipr_required) LogError(ONE_POS,"Incompatibility error in MatVec");
+	SwitchSlices(true);
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+	for (i=0;i<Xsize;i++) Xf[i]=0;
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(static) private(j,mat,index,Xcomp)
+#endif
+	for (i=0;i<local_nvoid_Ndip;i++) {
+		j=3*i;
+		mat=material[i];
+		index=Xindex[i];
+		if (her) for (Xcomp=0;Xcomp<3;Xcomp++)
+			Xf[index+Xcomp*local_Nsmall]=(floatcomplex)(cc_sqrt[mat][Xcomp]*conj(argvec[j+Xcomp]));
+		else for (Xcomp=0;Xcomp<3;Xcomp++)
+			Xf[index+Xcomp*local_Nsmall]=(floatcomplex)(cc_sqrt[mat][Xcomp]*argvec[j+Xcomp]);
+	}
+	fftX_sp(FFT_FORWARD);
+#ifdef PARALLEL
+	BlockTranspose(Xf,sizeof(*Xf),comm_timing);
+#endif
+#if defined(OPENMP) && !defined(PRECISE_TIMING)
+#	pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+	for(b=0;b<nbatch;b++) {
+#if defined(OPENMP) && !defined(PRECISE_TIMING)
+		ProcessSliceBatch(b,(size_t)omp_get_thread_num(),transposed,-1,-1);
+#else
+		ProcessSliceBatch(b,0,transposed,-1,-1);
+#endif
+	}
+#ifdef PARALLEL
+	BlockTranspose(Xf,sizeof(*Xf),comm_timing);
+#endif
+	fftX_sp(FFT_BACKWARD);
+	// the final sum is computed in double precision
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(static) private(j,mat,index,Xcomp) reduction(+:ipr_sum)
+#endif
+	for (i=0;i<local_nvoid_Ndip;i++) {
+		j=3*i;
+		mat=material[i];
+		index=Xindex[i];
+		if (her) for (Xcomp=0;Xcomp<3;Xcomp++) resultvec[j+Xcomp]=argvec[j+Xcomp]
+			+conj(cc_sqrt[mat][Xcomp]*(doublecomplex)Xf[index+Xcomp*local_Nsmall]);
+		else for (Xcomp=0;Xcomp<3;Xcomp++) resultvec[j+Xcomp]=argvec[j+Xcomp]
+			+cc_sqrt[mat][Xcomp]*(doublecomplex)Xf[index+Xcomp*local_Nsmall];
+		if (ipr) ipr_sum+=cvNorm2(resultvec+j);
+	}
+	if (ipr) {
+		*inprod=ipr_sum;
+		MyInnerProduct(inprod,double_type,1,comm_timing);
+	}
+}
+
+#endif // MIXED_PREC
+
+//======================================================================================================================
+
+static void MatVec_lean(doublecomplex * restrict argvec,doublecomplex * restrict resultvec,double *inprod,
+	const bool her,TIME_TYPE *comm_timing)
+/* lean version of MatVec (used with '-opt lean'), in which Xmatrix, slices, and slices_tr hold a single
+ * component (mv_ncomp=1). The convolution is performed separately for each element (mu,nu) of the 3x3 interaction
+ * matrix (and each right-hand side) - component nu of the argument is transformed, multiplied by the element of D~ (and
+ * R~), transformed back, and added to component mu of resultvec. The reflected term (for surface) uses the same
+ * transformed slices, and is computed in the same pass.
+ * This requires 9 forward and 9 backward 3D FFTs instead of 3 and 3 in MatVec. A second single-component buffer for
+ * Xmatrix (accumulating component mu of the result over nu in the Fourier space, mu being the outer cycle) would
+ * decrease the number of backward FFTs to 3, at the cost of half the memory gain. Transforming each nu only once
+ * would require all three transformed components of the argument, i.e. the same memory as in MatVec. Precise timing
+ * is not supported.
+ */
+{
+	size_t i,b,s,index,r;
+	int mu,nu;
+	unsigned char mat;
+	double ipr_sum;
+	const bool ipr=(inprod!=NULL);
+	const bool transposed=(!reduced_FFT) && her;
+	const size_t nbatch=(local_x1-local_x0+slice_batch-1)/slice_batch;
+	const size_t sbatch=DmStageBatches(nbatch);
+
+	if (ipr && !ipr_required) LogError(ONE_POS,"Incompatibility error in MatVec");
+	for (r=0;r<(size_t)nrhs;r++) {
+		const doublecomplex * restrict av=argvec+r*local_nRows;
+		doublecomplex * restrict rv=resultvec+r*local_nRows;
+
+		memcpy(rv,av,local_nRows*sizeof(doublecomplex));
+		for (nu=0;nu<3;nu++) for (mu=0;mu<3;mu++) {
+			// Xmat=cc_sqrt*argvec (or its conjugate for her) for component nu
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+			for (i=0;i<local_Nsmall;i++) Xmatrix[i]=0.0;
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(static) private(mat)
+#endif
+			for (i=0;i<local_nvoid_Ndip;i++) {
+				mat=material[i];
+				if (her) Xmatrix[Xindex[i]]=cc_sqrt[mat][nu]*conj(av[3*i+nu]);
+				else Xmatrix[Xindex[i]]=cc_sqrt[mat][nu]*av[3*i+nu];
+			}
+			fftX(FFT_FORWARD);
+#ifdef PARALLEL
+			BlockTranspose(Xmatrix,sizeof(*Xmatrix),comm_timing);
+#endif
+			// the same as in MatVec, but for a single component (only it is read in out-of-core mode)
+			for (s=0;s<nbatch;s+=sbatch) { // stages (see DmStageBatches)
+				const size_t b1=MIN(s+sbatch,nbatch);
+
+				DmStageLoad(s/sbatch,transposed,mu,nu);
+#if defined(OPENMP) && !defined(PRECISE_TIMING)
+#	pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+				for(b=s;b<b1;b++) {
+#if defined(OPENMP) && !defined(PRECISE_TIMING)
+					ProcessSliceBatch(b,(size_t)omp_get_thread_num(),transposed,mu,nu);
+#else
+					ProcessSliceBatch(b,0,transposed,mu,nu);
+#endif
+				}
+			}
+#ifdef PARALLEL
+			BlockTranspose(Xmatrix,sizeof(*Xmatrix),comm_timing);
+#endif
+			fftX(FFT_BACKWARD);
+			// result+=cc_sqrt*Xmat (conjugated for her) for component mu
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(static) private(mat,index)
+#endif
+			for (i=0;i<local_nvoid_Ndip;i++) {
+				mat=material[i];
+				index=Xindex[i];
+				if (her) rv[3*i+mu]+=conj(cc_sqrt[mat][mu]*Xmatrix[index]);
+				else rv[3*i+mu]+=cc_sqrt[mat][mu]*Xmatrix[index];
+			}
+		}
+		if (ipr) {
+			ipr_sum=0;
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(static) reduction(+:ipr_sum)
+#endif
+			for (i=0;i<local_nvoid_Ndip;i++) ipr_sum+=cvNorm2(rv+3*i);
+			inprod[r]=ipr_sum;
+		}
+	}
+	if (ipr) MyInnerProduct(inprod,double_type,nrhs,comm_timing);
 }
 
 #endif // !SPARSE
@@ -135,19 +557,24 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
  * as a non-NULL pointer. if 'inprod' is NULL, we don't calculate it. 'argvec' always remains unchanged afterwards,
  * however it is not strictly const - some manipulations may occur during the execution. comm_timing can be NULL, then
  * it is ignored.
+ * When nrhs>1 (block iterative solver), argvec and resultvec consist of nrhs columns (each of length local_nRows),
+ * which are multiplied simultaneously, and inprod (if not NULL) is an array of nrhs norms of the columns of resultvec.
+ * Such a product is counted in TotalMatVec as nrhs products.
  */
 {
-	size_t j,x;
+	size_t j,b,s;
 	bool ipr,transposed;
-	size_t boxY_st=boxY,boxZ_st=boxZ; // copies with different type
 	size_t i;
-	doublecomplex fmat[6],xv[3],yv[3],xvR[3],yvR[3];
-	size_t index,y,z,Xcomp;
+	size_t index,Xcomp,r;
 	unsigned char mat;
+	double ipr_sum; // local accumulator for inner product (to be used in reduction among threads)
+	const size_t Xsize=3*local_Nsmall; // size of Xmatrix for a single right-hand side
+	const size_t nr=nrhs; // number of right-hand sides
+	const size_t nbatch=(local_x1-local_x0+slice_batch-1)/slice_batch; // number of batches of slices
+	const size_t sbatch=DmStageBatches(nbatch); // number of batches in a stage
 #ifdef PRECISE_TIMING
 	SYSTEM_TIME tvp[18];
-	SYSTEM_TIME Timing_FFTXf,Timing_FFTYf,Timing_FFTZf,Timing_FFTXb,Timing_FFTYb,Timing_FFTZb,Timing_Mult1,Timing_Mult2,
-		Timing_Mult3,Timing_Mult4,Timing_Mult5,Timing_BTf,Timing_BTb,Timing_TYZf,Timing_TYZb,Timing_ipr;
+	SYSTEM_TIME Timing_FFTXf,Timing_FFTXb,Timing_Mult1,Timing_Mult5,Timing_BTf,Timing_BTb,Timing_ipr;
 	double t_FFTXf,t_FFTYf,t_FFTZf,t_FFTXb,t_FFTYb,t_FFTZb,t_Mult1,t_Mult2,t_Mult3,t_Mult4,t_Mult5,t_ipr,t_BTf,t_BTb,
 		t_TYZf,t_TYZb,t_Arithm,t_FFT,t_Comm;
 
@@ -169,16 +596,42 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
 	 *
 	 * For reflected matrix the situation is similar.
 	 * R.x=F(-1)(F(R).H(X)), where R is a vector, similar with G, where R[i,j,k=0] is for interaction of two bottom
-	 * dipoles. H(X) is FxFy(Fz^(-1)(X)), where Fx,... are Fourier transforms along corresponding coordinates. It can be
-	 * computed along with F(X).
+	 * dipoles. H(X) is FxFy(Fz^(-1)(X)), where Fx,... are Fourier transforms along corresponding coordinates. Since
+	 * Fz^(-1)(X)(kz)=Fz(X)(-kz), H(X) is obtained from F(X) by reflection of the z-frequency without any additional
+	 * transforms. Therefore, the (pointwise) products for kz and -kz are computed together, using both values of F(X).
 	 * Matrix R is symmetric (as a whole), but not in small parts, so R(i,j)=R(j,i)(T). Hence, in contrast to D, for
 	 * 'transpose' actual transpose (changing sign of a few elements) of 3x3 submatrix is required along with addressing
 	 * different elements of F(R).
 	 *
-	 * For (her) three additional operations of nConj are used. Should not be a problem, but can be avoided by a more
-	 * complex code.
+	 * For (her) the conjugation is performed together with multiplication by S in the first and last steps, i.e.
+	 * A(H).x = x + (S.(D(T).(S.x(*))))(*), so argvec is not modified and no additional passes over vectors are needed.
+	 *
+	 * When compiled with OPENMP, all loops over the grid or dipoles are split among nthreads threads. In particular,
+	 * each thread processes its own range of x-slices with separate slice buffers (the ones for thread th are shifted
+	 * by th*3*gridYZ). All MPI communications are performed by the master thread outside of parallel regions.
+	 *
+	 * For nrhs>1 the columns of argvec are treated as additional components, i.e. Xmatrix and slices contain 3*nrhs
+	 * components, and all FFTs and transposes process them together. Then each row of F(D) (and F(R)) is read once and
+	 * applied to all columns.
+	 *
+	 * In lean mode (lean_matvec) the product is computed by MatVec_lean instead.
 	 */
 	TIME_TYPE tstart=GET_TIME();
+	if (lean_matvec) {
+		MatVec_lean(argvec,resultvec,inprod,her,comm_timing);
+		(*timing) += GET_TIME() - tstart;
+		TotalMatVec+=nrhs;
+		return;
+	}
+#ifdef MIXED_PREC
+	if (matvec_single) {
+		MatVec_sp(argvec,resultvec,inprod,her,comm_timing);
+		(*timing) += GET_TIME() - tstart;
+		TotalMatVec+=nrhs;
+		return;
+	}
+	SwitchSlices(false);
+#endif
 	transposed=(!reduced_FFT) && her;
 	ipr=(inprod!=NULL);
 	if (ipr && !ipr_required) LogError(ONE_POS,"Incompatibility error in MatVec");
@@ -195,20 +648,30 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
 	GET_SYSTEM_TIME(tvp);
 #endif
 	// FFT_matvec code
-	if (ipr) *inprod = 0.0;
 	// fill Xmatrix with 0.0
-	for (i=0;i<3*local_Nsmall;i++) Xmatrix[i]=0.0;
-
-	// transform from coordinates to grid and multiply with coupling constant
-	if (her) nConj(argvec); // conjugated back afterwards
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+	for (i=0;i<nr*Xsize;i++) Xmatrix[i]=0.0;
 
-	for (i=0;i<local_nvoid_Ndip;i++) {
-		// fill grid with argvec*sqrt_cc
-		j=3*i;
-		mat=material[i];
-		index=IndexXmatrix(position[j],position[j+1],position[j+2]);
-		// Xmat=cc_sqrt*argvec
-		for (Xcomp=0;Xcomp<3;Xcomp++) Xmatrix[index+Xcomp*local_Nsmall]=cc_sqrt[mat][Xcomp]*argvec[j+Xcomp];
+	/* transform from coordinates to grid and multiply with coupling constant. Different dipoles correspond to different
+	 * grid points, so the loop can be safely split among threads
+	 */
+	for (r=0;r<nr;r++) {
+		const doublecomplex * restrict av=argvec+r*local_nRows;
+		doublecomplex * restrict Xm=Xmatrix+r*Xsize;
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(static) private(j,mat,index,Xcomp)
+#endif
+		for (i=0;i<local_nvoid_Ndip;i++) {
+			// fill grid with argvec*sqrt_cc
+			j=3*i;
+			mat=material[i];
+			index=Xindex[i];
+			// Xmat=cc_sqrt*argvec (or its conjugate for her)
+			if (her) for (Xcomp=0;Xcomp<3;Xcomp++) Xm[index+Xcomp*local_Nsmall]=cc_sqrt[mat][Xcomp]*conj(av[j+Xcomp]);
+			else for (Xcomp=0;Xcomp<3;Xcomp++) Xm[index+Xcomp*local_Nsmall]=cc_sqrt[mat][Xcomp]*av[j+Xcomp];
+		}
 	}
 #ifdef PRECISE_TIMING
 	GET_SYSTEM_TIME(tvp+1);
@@ -221,123 +684,38 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
 	Elapsed(tvp+1,tvp+2,&Timing_FFTXf);
 #endif
 #ifdef PARALLEL
-	BlockTranspose(Xmatrix,comm_timing);
+	BlockTranspose(Xmatrix,sizeof(*Xmatrix),comm_timing);
 #endif
 #ifdef PRECISE_TIMING
 	GET_SYSTEM_TIME(tvp+3);
 	Elapsed(tvp+2,tvp+3,&Timing_BTf);
 #endif
-	// following is done by slices
-	for(x=local_x0;x<local_x1;x++) {
-		/* TODO: if z and y FFTs are interchanged, then computing reflected interaction can be optimized even further.
-		 * Moreover, the typical situation of particles near surfaces, like large particulate slabs, correspond to the
-		 * smallest dimension along z, which will also benefit from such interchange (then gridZ do not have to divide
-		 * nprocs) - issue 177
-		 */
-#ifdef PRECISE_TIMING
-		GET_SYSTEM_TIME(tvp+4);
-#endif
-		// clear slice
-		for(i=0;i<3*gridYZ;i++) slices[i]=0.0;
-		// fill slices with values from Xmatrix
-		for(y=0;y<boxY_st;y++) for(z=0;z<boxZ_st;z++) {
-			i=IndexSliceYZ(y,z);
-			j=IndexGarbledX(x,y,z);
-			for (Xcomp=0;Xcomp<3;Xcomp++) slices[i+Xcomp*gridYZ]=Xmatrix[j+Xcomp*local_Nsmall];
-		}
-		// create a copy of slice, which is further transformed differently
-		if (surface) memcpy(slicesR,slices,3*gridYZ*sizeof(doublecomplex));
-#ifdef PRECISE_TIMING
-		GET_SYSTEM_TIME(tvp+5);
-		ElapsedInc(tvp+4,tvp+5,&Timing_Mult2);
-#endif
-		// FFT z&y
-		fftZ(FFT_FORWARD); // fftZ (buf)slices (and reflected terms)
-#ifdef PRECISE_TIMING
-		GET_SYSTEM_TIME(tvp+6);
-		ElapsedInc(tvp+5,tvp+6,&Timing_FFTZf);
-#endif
-		TransposeYZ(FFT_FORWARD); // including reflecting terms
-#ifdef PRECISE_TIMING
-		GET_SYSTEM_TIME(tvp+7);
-		ElapsedInc(tvp+6,tvp+7,&Timing_TYZf);
-#endif
-		fftY(FFT_FORWARD); // fftY (buf)slices_tr (and reflected terms)
-#ifdef PRECISE_TIMING//
-		GET_SYSTEM_TIME(tvp+8);
-		ElapsedInc(tvp+7,tvp+8,&Timing_FFTYf);
-#endif//
-		// do the product D~*X~  and R~*X'~
-		for(z=0;z<gridZ;z++) for(y=0;y<gridY;y++) {
-			i=IndexSliceZY(y,z);
-			for (Xcomp=0;Xcomp<3;Xcomp++) xv[Xcomp]=slices_tr[i+Xcomp*gridYZ];
-			j=IndexDmatrix_mv(x-local_x0,y,z,transposed);
-			memcpy(fmat,Dmatrix+j,6*sizeof(doublecomplex));
-			if (reduced_FFT) { // symmetry with respect to reflection (x_i -> x_2N-i) is the same as in r-space
-				if (y>=DsizeY) { // we assume that compiler will optimize x*=-1 into negation of sign
-					fmat[1]*=-1;
-					if (z>=DsizeZ) fmat[2]*=-1;
-					else fmat[4]*=-1;
-				}
-				else if (z>=DsizeZ) {
-					fmat[2]*=-1;
-					fmat[4]*=-1;
-				}
-			}
-			cSymMatrVec(fmat,xv,yv); // yv=fmat.xv
-			if (surface) {
-				for (Xcomp=0;Xcomp<3;Xcomp++) xvR[Xcomp]=slicesR_tr[i+Xcomp*gridYZ];
-				j=IndexRmatrix_mv(x-local_x0,y,z,transposed);
-				memcpy(fmat,Rmatrix+j,6*sizeof(doublecomplex));
-				if (reduced_FFT && y>=RsizeY) {
-					fmat[1]*=-1;
-					fmat[4]*=-1;
-				}
-				if (transposed) { // corresponds to transpose of 3x3 matrix
-					fmat[2]*=-1;
-					fmat[4]*=-1;
-				}
-				// yv+=fmat.xvR
-				cReflMatrVec(fmat,xvR,yvR);
-				cvAdd(yvR,yv,yv);
-			}
-			for (Xcomp=0;Xcomp<3;Xcomp++) slices_tr[i+Xcomp*gridYZ]=yv[Xcomp];
-		}
-#ifdef PRECISE_TIMING
-		GET_SYSTEM_TIME(tvp+9);
-		ElapsedInc(tvp+8,tvp+9,&Timing_Mult3);
-#endif
-		// inverse FFT y&z
-		fftY(FFT_BACKWARD); // fftY (buf)slices_tr
-#ifdef PRECISE_TIMING
-		GET_SYSTEM_TIME(tvp+10);
-		ElapsedInc(tvp+9,tvp+10,&Timing_FFTYb);
-#endif
-		TransposeYZ(FFT_BACKWARD);
-#ifdef PRECISE_TIMING
-		GET_SYSTEM_TIME(tvp+11);
-		ElapsedInc(tvp+10,tvp+11,&Timing_TYZb);
+	/* following is done by batches of slice_batch slices (along x), which are distributed among threads (see
+	 * ProcessSliceBatch). In out-of-core mode, the batches are additionally grouped into stages, for which the
+	 * corresponding parts of Dmatrix and Rmatrix are read from the file (overlapping with computations for the previous
+	 * stage).
+	 */
+	for (s=0;s<nbatch;s+=sbatch) { // stages (see DmStageBatches)
+		const size_t b1=MIN(s+sbatch,nbatch);
+
+		DmStageLoad(s/sbatch,transposed,-1,-1);
+#if defined(OPENMP) && !defined(PRECISE_TIMING)
+#	pragma omp parallel for num_threads(nthreads) schedule(static)
 #endif
-		fftZ(FFT_BACKWARD); // fftZ (buf)slices
-#ifdef PRECISE_TIMING
-		GET_SYSTEM_TIME(tvp+12);
-		ElapsedInc(tvp+11,tvp+12,&Timing_FFTZb);
+		for(b=s;b<b1;b++) {
+#if defined(OPENMP) && !defined(PRECISE_TIMING)
+			ProcessSliceBatch(b,(size_t)omp_get_thread_num(),transposed,-1,-1);
+#else
+			ProcessSliceBatch(b,0,transposed,-1,-1);
 #endif
-		//arith4 on host
-		// copy slice back to Xmatrix
-		for(y=0;y<boxY_st;y++) for(z=0;z<boxZ_st;z++) {
-			i=IndexSliceYZ(y,z);
-			j=IndexGarbledX(x,y,z);
-			for (Xcomp=0;Xcomp<3;Xcomp++) Xmatrix[j+Xcomp*local_Nsmall]=slices[i+Xcomp*gridYZ];
 		}
+	}
 #ifdef PRECISE_TIMING
-		GET_SYSTEM_TIME(tvp+13);
-		ElapsedInc(tvp+12,tvp+13,&Timing_Mult4);
+	GET_SYSTEM_TIME(tvp+13);
 #endif
-	} // end of loop over slices
 	// FFT-X back the result
 #ifdef PARALLEL
-	BlockTranspose(Xmatrix,comm_timing);
+	BlockTranspose(Xmatrix,sizeof(*Xmatrix),comm_timing);
 #endif
 #ifdef PRECISE_TIMING
 	GET_SYSTEM_TIME(tvp+14);
@@ -349,24 +727,32 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
 	Elapsed(tvp+14,tvp+15,&Timing_FFTXb);
 #endif
 	// fill resultvec
-	for (i=0;i<local_nvoid_Ndip;i++) {
-		j=3*i;
-		mat=material[i];
-		index=IndexXmatrix(position[j],position[j+1],position[j+2]);
-		for (Xcomp=0;Xcomp<3;Xcomp++) // result=argvec+cc_sqrt*Xmat
-			resultvec[j+Xcomp]=argvec[j+Xcomp]+cc_sqrt[mat][Xcomp]*Xmatrix[index+Xcomp*local_Nsmall];
-		// norm is unaffected by conjugation, hence can be computed here
-		if (ipr) *inprod+=cvNorm2(resultvec+j);
-	}
-	if (her) {
-		nConj(resultvec);
-		nConj(argvec); // conjugate back argvec, so it remains unchanged after MatVec
+	for (r=0;r<nr;r++) {
+		const doublecomplex * restrict av=argvec+r*local_nRows;
+		doublecomplex * restrict rv=resultvec+r*local_nRows;
+		const doublecomplex * restrict Xm=Xmatrix+r*Xsize;
+		ipr_sum=0;
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(static) private(j,mat,index,Xcomp) reduction(+:ipr_sum)
+#endif
+		for (i=0;i<local_nvoid_Ndip;i++) {
+			j=3*i;
+			mat=material[i];
+			index=Xindex[i];
+			// result=argvec+cc_sqrt*Xmat (the latter term is conjugated for her)
+			if (her) for (Xcomp=0;Xcomp<3;Xcomp++)
+				rv[j+Xcomp]=av[j+Xcomp]+conj(cc_sqrt[mat][Xcomp]*Xm[index+Xcomp*local_Nsmall]);
+			else for (Xcomp=0;Xcomp<3;Xcomp++)
+				rv[j+Xcomp]=av[j+Xcomp]+cc_sqrt[mat][Xcomp]*Xm[index+Xcomp*local_Nsmall];
+			if (ipr) ipr_sum+=cvNorm2(rv+j);
+		}
+		if (ipr) inprod[r]=ipr_sum;
 	}
 #ifdef PRECISE_TIMING
 	GET_SYSTEM_TIME(tvp+16);
 	Elapsed(tvp+15,tvp+16,&Timing_Mult5);
 #endif
-	if (ipr) MyInnerProduct(inprod,double_type,1,comm_timing);
+	if (ipr) MyInnerProduct(inprod,double_type,nr,comm_timing);
 #ifdef PRECISE_TIMING
 	GET_SYSTEM_TIME(tvp+17);
 	Elapsed(tvp+16,tvp+17,&Timing_ipr);
@@ -393,6 +779,9 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
 	t_Comm=t_BTf+t_BTb+t_ipr;
 
 	if (IFROOT) {
+#	ifdef OPENMP // the slice loop is not parallelized with PRECISE_TIMING, but fftX and arithmetics are
+		PrintBoth(logfile,"Number of threads: %d (only for FFTX, Arith1, and Arith5)\n",nthreads);
+#	endif
 		PrintBoth(logfile,
 			"~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~\n"
 			"                MatVec timing              \n"
@@ -421,11 +810,53 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
 	Stop(EXIT_SUCCESS);
 #endif
 	(*timing) += GET_TIME() - tstart;
-	TotalMatVec++;
+	TotalMatVec+=nrhs;
 }
 
 #else // SPARSE is defined
 
+// LOCAL VARIABLES
+
+static struct sparseSoA soa; // positions and argument vector in structure-of-arrays form, used by AijRow
+static aijRowFunc AijRow; // vector kernel for a row of interaction matrix; NULL if not used
+
+//======================================================================================================================
+
+void InitSparseMatVec(void)
+/* selects the vector kernel for MatVec, and allocates and initializes additional arrays for it (only if not prognosis).
+ * Memory is counted always
+ */
+{
+	const char *name;
+	int mu;
+	size_t j;
+
+	AijRow=SelectAijRow(&name);
+	if (AijRow==NULL) return;
+	if (IFROOT) fprintf(logfile,"Kernel for interaction of dipoles: %s\n",name);
+	if (!prognosis) for (mu=0;mu<3;mu++) {
+		MALLOC_VECTOR(soa.pos[mu],int,nvoid_Ndip,ALL);
+		MALLOC_VECTOR(soa.re[mu],double,nvoid_Ndip,ALL);
+		MALLOC_VECTOR(soa.im[mu],double,nvoid_Ndip,ALL);
+		for (j=0;j<nvoid_Ndip;j++) soa.pos[mu][j]=position_full[3*j+mu];
+	}
+	memory+=3*nvoid_Ndip*(sizeof(int)+2*sizeof(double));
+}
+
+//======================================================================================================================
+
+void FreeSparseMatVec(void)
+// frees arrays allocated in InitSparseMatVec
+{
+	int mu;
+
+	if (AijRow!=NULL) for (mu=0;mu<3;mu++) {
+		Free_general(soa.pos[mu]);
+		Free_general(soa.re[mu]);
+		Free_general(soa.im[mu]);
+	}
+}
+
 //======================================================================================================================
 
 /* The sparse MatVec is implemented completely separately from the non-sparse version. Although there is some code
@@ -439,26 +870,38 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
              TIME_TYPE *comm_timing) // this variable is incremented by communication time
 {
 	const bool ipr = (inprod != NULL);
-	size_t i,j,i3;
+	size_t i,j,i3,d;
+	int mu;
 
 	TIME_TYPE tstart=GET_TIME();
-	if (her) nConj(argvec);
+	// conjugation for her is performed inside CcMul and DiagProd, so argvec is not modified
 	// TODO: can be replaced by nMult_mat
-	for (j=0; j<local_nvoid_Ndip; j++) CcMul(argvec,arg_full+3*local_nvoid_d0,j);
+	for (j=0; j<local_nvoid_Ndip; j++) CcMul(argvec,arg_full+3*local_nvoid_d0,j,her);
 #	ifdef PARALLEL
 	AllGather(NULL,arg_full,cmplx3_type,comm_timing);
 #	endif
-	for (i=0; i<local_nvoid_Ndip; i++) {
+	if (AijRow!=NULL) {
+		for (j=0; j<nvoid_Ndip; j++) for (mu=0; mu<3; mu++) {
+			soa.re[mu][j]=creal(arg_full[3*j+mu]);
+			soa.im[mu][j]=cimag(arg_full[3*j+mu]);
+		}
+		for (i=0; i<local_nvoid_Ndip; i++) {
+			i3 = 3*i;
+			cvInit(resultvec+i3);
+			// main interaction is not computed for coinciding dipoles
+			d=local_nvoid_d0+i;
+			AijRow(&soa,d,0,d,resultvec+i3);
+			AijRow(&soa,d,d+1,nvoid_Ndip,resultvec+i3);
+			if (surface) for (j=0; j<nvoid_Ndip; j++) ReflProd(arg_full,resultvec,i,j);
+		}
+	}
+	else for (i=0; i<local_nvoid_Ndip; i++) {
 		i3 = 3*i;
 		cvInit(resultvec+i3);
 		for (j=0; j<nvoid_Ndip; j++) AijProd(arg_full,resultvec,i,j);
 	}
 	// TODO: can be replaced by a specially designed function from linalg.c
-	for (i=0; i<local_nvoid_Ndip; i++) DiagProd(argvec,resultvec,i);
-	if (her) {
-		nConj(resultvec);
-		nConj(argvec);
-	}
+	for (i=0; i<local_nvoid_Ndip; i++) DiagProd(argvec,resultvec,i,her);
 	if (ipr) (*inprod)=nNorm2(resultvec,comm_timing);
 	(*timing) += GET_TIME() - tstart;
 	TotalMatVec++;
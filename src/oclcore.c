@@ -39,7 +39,7 @@
  */
 cl_context context;
 cl_command_queue command_queue;
-cl_kernel clarith1,clarith2,clarith3,clarith3_surface,clarith4,clarith5,clzero,clinprod,clnConj,cltransposeof,
+cl_kernel clarith1,clarith2,clarith3,clarith3_surface,clarith4,clarith5,clzero,clinprod,cltransposeof,
 	cltransposeob,cltransposeofR;
 cl_mem bufXmatrix,bufmaterial,bufposition,bufcc_sqrt,bufargvec,bufresultvec,bufslices,bufslices_tr,bufDmatrix,
 	bufinproduct;
@@ -411,8 +411,6 @@ void oclinit(void)
 	CL_CH_ERR(err);
 	clarith5=clCreateKernel(program,"arith5",&err);
 	CL_CH_ERR(err);
-	clnConj=clCreateKernel(program,"nConj",&err);
-	CL_CH_ERR(err);
 	clinprod=clCreateKernel(program,"inpr",&err);
 	CL_CH_ERR(err);
 	/* In principle a single kernel can be used for all transpose operations, including surface ones. However, this will
@@ -483,7 +481,6 @@ void oclunload(void)
 	CL_CH_ERR(clReleaseKernel(clarith3));
 	CL_CH_ERR(clReleaseKernel(clarith4));
 	CL_CH_ERR(clReleaseKernel(clarith5));
-	CL_CH_ERR(clReleaseKernel(clnConj));
 	CL_CH_ERR(clReleaseKernel(clinprod));
 	CL_CH_ERR(clReleaseKernel(cltransposeof));
 	CL_CH_ERR(clReleaseKernel(cltransposeob));
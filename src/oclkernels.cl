@@ -60,24 +60,24 @@ void cMult2(__constant double2 *a,__global const double2 *b,double2 *c)
 
 //======================================================================================================================
 
-double cvNorm2(__global const double2 *a)
-// square of the norm of a complex vector[3]
+void cMult3(__constant double2 *a,const double2 *b,__global double2 *c)
+// complex multiplication; c=ab; b is private
 {
-	return ( a[0].s0*a[0].s0 + a[0].s1*a[0].s1 + a[1].s0*a[1].s0 + a[1].s1*a[1].s1
-	       + a[2].s0*a[2].s0 + a[2].s1*a[2].s1 );
+	(*c).s0=(*a).s0*(*b).s0 - (*a).s1*(*b).s1;
+	(*c).s1=(*a).s1*(*b).s0 + (*a).s0*(*b).s1;
 }
 
 //======================================================================================================================
-// Arith1 kernels
 
-__kernel void nConj(__global double2 *a)
+double cvNorm2(__global const double2 *a)
+// square of the norm of a complex vector[3]
 {
-	const size_t id=get_global_id(0);
-
-	a[id].s1= -a[id].s1;
+	return ( a[0].s0*a[0].s0 + a[0].s1*a[0].s1 + a[1].s0*a[1].s0 + a[1].s1*a[1].s1
+	       + a[2].s0*a[2].s0 + a[2].s1*a[2].s1 );
 }
 
 //======================================================================================================================
+// Arith1 kernels
 
 __kernel void clzero(__global double2 *input)
 {
@@ -90,16 +90,22 @@ __kernel void clzero(__global double2 *input)
 
 __kernel void arith1(__global const uchar *material,__global const ushort *position,__constant double2 *cc_sqrt,
 	__global const double2 *argvec, __global double2 *Xmatrix,const in_sizet local_Nsmall,const in_sizet smallY,
-	const in_sizet gridX)
+	const in_sizet gridX,const char her)
+// for her argvec is conjugated before multiplication
 {
 	const size_t id=get_global_id(0);
 	const size_t j=3*id;
 	const uchar mat=material[id];
 	size_t index;
+	double2 temp;
 	int xcomp;
 
 	index = ((position[j+2]*smallY+position[j+1])*gridX+position[j]);
-	for (xcomp=0;xcomp<3;xcomp++) cMult(&cc_sqrt[mat*3+xcomp],&argvec[j+xcomp],&Xmatrix[index+xcomp*local_Nsmall]);
+	for (xcomp=0;xcomp<3;xcomp++) {
+		temp=argvec[j+xcomp];
+		if (her) temp.s1=-temp.s1;
+		cMult3(&cc_sqrt[mat*3+xcomp],&temp,&Xmatrix[index+xcomp*local_Nsmall]);
+	}
 }
 
 //======================================================================================================================
@@ -385,7 +391,8 @@ __kernel void arith4(__global double2 *Xmatrix,__global const double2 *slices,co
 
 __kernel void arith5(__global const uchar *material,__global const ushort *position,__constant double2 *cc_sqrt,
 	__global const double2 *argvec,__global const double2 *Xmatrix,const in_sizet local_Nsmall,const in_sizet smallY,
-	const in_sizet gridX,__global double2 *resultvec)
+	const in_sizet gridX,__global double2 *resultvec,const char her)
+// for her the product of cc_sqrt and Xmatrix is conjugated
 {
 	const size_t id = get_global_id(0);
 	const size_t j=3*id;
@@ -397,6 +404,7 @@ __kernel void arith5(__global const uchar *material,__global const ushort *posit
 	index = ((position[j+2]*smallY+position[j+1])*gridX+position[j]);
 	for (xcomp=0;xcomp<3;xcomp++) {
 		cMult2(&cc_sqrt[mat*3+xcomp],&Xmatrix[index+xcomp*local_Nsmall],&temp);
+		if (her) temp.s1=-temp.s1;
 		resultvec[j+xcomp]=argvec[j+xcomp]+temp;
 	}
 }
@@ -70,8 +70,8 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
 	 * 'transpose' actual transpose (changing sign of a few elements) of 3x3 submatrix is required along with addressing
 	 * different elements of F(R).
 	 *
-	 * For (her) three additional operations of nConj are used. Should not be a problem, but can be avoided by a more
-	 * complex code.
+	 * For (her) the conjugation is performed together with multiplication by S in the first and last steps (arith1
+	 * and arith5 kernels), so argvec is not modified and no additional kernels are needed.
 	 */
 	TIME_TYPE tstart=GET_TIME();
 	transposed=(!reduced_FFT) && her;
@@ -83,6 +83,7 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
 	// little workaround for kernel cannot take bool arguments
 	const cl_char transp=(cl_char)transposed;
 	const cl_char redfft=(cl_char)reduced_FFT;
+	const cl_char herm=(cl_char)her;
 
 	/* following two calls to clSetKernelArg can be moved to fft.c, since the arguments are constant. However, this
 	 * requires setting auxiliary variables redfft and ndcomp as globals, since the kernel is called below.
@@ -90,6 +91,8 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
 	CL_CH_ERR(clSetKernelArg(clarith3,7,sizeof(cl_char),&ndcomp));
 	CL_CH_ERR(clSetKernelArg(clarith3,8,sizeof(cl_char),&redfft));
 	CL_CH_ERR(clSetKernelArg(clarith3,9,sizeof(cl_char),&transp));
+	CL_CH_ERR(clSetKernelArg(clarith1,8,sizeof(cl_char),&herm));
+	CL_CH_ERR(clSetKernelArg(clarith5,9,sizeof(cl_char),&herm));
 	if (surface) { // arguments for surface-version of the arith3 kernel
 		CL_CH_ERR(clSetKernelArg(clarith3_surface,7,sizeof(cl_char),&ndcomp));
 		CL_CH_ERR(clSetKernelArg(clarith3_surface,8,sizeof(cl_char),&redfft));
@@ -101,10 +104,6 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
 		argvec,0,NULL,NULL));
 
 	size_t xmsize=local_Nsmall*3;
-	if (her) {
-		CL_CH_ERR(clSetKernelArg(clnConj,0,sizeof(cl_mem),&bufargvec));
-		CL_CH_ERR(clEnqueueNDRangeKernel(command_queue,clnConj,1,NULL,&local_nRows,NULL,0,NULL,NULL));
-	}
 	// setting (buf)Xmatrix with zeros (on device)
 	CL_CH_ERR(clSetKernelArg(clzero,0,sizeof(cl_mem),&bufXmatrix));
 	CL_CH_ERR(clEnqueueNDRangeKernel(command_queue,clzero,1,NULL,&xmsize,NULL,0,NULL,NULL));
@@ -137,18 +136,18 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
 		if (surface) CL_CH_ERR(clEnqueueCopyBuffer(command_queue,bufslices,bufslicesR,0,0,
 			slicesize*sizeof(doublecomplex),0,NULL,NULL));
 
-		fftZ(FFT_FORWARD); // fftZ (buf)slices (and reflected terms)
-		TransposeYZ(FFT_FORWARD); // including reflecting terms
-		fftY(FFT_FORWARD); // fftY (buf)slices_tr (and reflected terms)
+		fftZ(FFT_FORWARD,0); // fftZ (buf)slices (and reflected terms)
+		TransposeYZ(FFT_FORWARD,0); // including reflecting terms
+		fftY(FFT_FORWARD,0); // fftY (buf)slices_tr (and reflected terms)
 		// arith3 on Device
 		if (surface) 
 			CL_CH_ERR(clEnqueueNDRangeKernel(command_queue,clarith3_surface,3,gwo3,gwsclarith3,NULL,0,NULL,NULL));
 		else 
 			CL_CH_ERR(clEnqueueNDRangeKernel(command_queue,clarith3,3,gwo3,gwsclarith3,NULL,0,NULL,NULL));
 		// inverse FFT y&z
-		fftY(FFT_BACKWARD); // fftY (buf)slices_tr
-		TransposeYZ(FFT_BACKWARD);
-		fftZ(FFT_BACKWARD); // fftZ (buf)slices
+		fftY(FFT_BACKWARD,0); // fftY (buf)slices_tr
+		TransposeYZ(FFT_BACKWARD,0);
+		fftZ(FFT_BACKWARD,0); // fftZ (buf)slices
 
 		CL_CH_ERR(clEnqueueNDRangeKernel(command_queue,clarith4,3,gwo24,gwsarith24,NULL,0,NULL,NULL));
 	}
@@ -167,10 +166,6 @@ void MatVec (doublecomplex * restrict argvec,    // the argument vector
 		// sum up on the CPU after calculating the norm on GPU; hence the read above is blocking
 		for (j=0;j<local_nvoid_Ndip;j++) *inprod+=inprodhlp[j];
 	}
-	if (her) {
-		CL_CH_ERR(clSetKernelArg(clnConj,0,sizeof(cl_mem),&bufresultvec));
-		CL_CH_ERR(clEnqueueNDRangeKernel(command_queue,clnConj,1,NULL,&local_nRows,NULL,0,NULL,NULL));
-	}
 	// blocking read to finalize queue
 	if (bufupload) CL_CH_ERR(clEnqueueReadBuffer(command_queue,bufresultvec,CL_TRUE,0,local_nRows*sizeof(doublecomplex),
 		resultvec,0,NULL,NULL));
@@ -0,0 +1,190 @@
+/* File: ooc.c
+ * Descr: asynchronous reading of a file by a separate (POSIX) thread with double buffering; used for out-of-core
+ *        storage of the Fourier-transformed interaction matrices in MatVec (option OOC)
+ *
+ * Copyright (C) 2014 ADDA contributors
+ * This file is part of ADDA.
+ *
+ * ADDA is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * ADDA is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with ADDA. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#include "const.h" // keep this first
+#include "ooc.h" // corresponding header
+// project headers
+#include "function.h" // for ATT_UNUSED
+#include "io.h"
+#include "os.h"
+#include "timing.h"
+// system headers
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef OOC
+
+#ifndef POSIX
+#	error "Out-of-core mode (OOC) is implemented only for POSIX systems"
+#endif
+
+// SEMI-GLOBAL VARIABLES
+
+// defined and initialized in timing.c
+extern double Timing_OocRead,Timing_OocWait,TotalOocBytes;
+
+// LOCAL VARIABLES
+
+static int fd;                 // descriptor of the file
+static const char *fileName;   // name of the file (for error messages)
+static pthread_t reader;       // the reader thread
+// all the following variables are protected by the mutex
+static pthread_mutex_t lock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond=PTHREAD_COND_INITIALIZER; // signals both new requests and completed ones
+static const struct oocChunk *chunkList[OOC_NBUF];  // chunks of the submitted requests
+static size_t nChunks[OOC_NBUF];                     // their numbers
+static bool pending[OOC_NBUF];                       // whether request for the buffer is not yet completed
+static unsigned long order[OOC_NBUF];                // sequential numbers of requests (to keep the order)
+static unsigned long nextOrder;                      // number of the next request
+static bool quit;                                    // whether the reader should stop
+static int readErr;                                  // errno of the failed read (0 if no errors)
+
+//======================================================================================================================
+
+static int ReadChunk(const struct oocChunk * restrict ch)
+/* reads a single chunk from the file, taking into account partial reads; returns 0 on success and errno otherwise. The
+ * file is accessed only by the reader thread, so lseek+read is used (pread is not available in strict C99 mode)
+ */
+{
+	size_t done=0;
+	ssize_t res;
+
+	if (lseek(fd,(off_t)ch->off,SEEK_SET)==(off_t)-1) return errno;
+	while (done<ch->size) {
+		res=read(fd,(char *)ch->dest+done,ch->size-done);
+		if (res>0) done+=(size_t)res;
+		else if (res==0) return EIO; // unexpected end of file
+		else if (errno!=EINTR) return errno;
+	}
+	return 0;
+}
+
+//======================================================================================================================
+
+static void *Reader(void *arg ATT_UNUSED)
+/* main function of the reader thread; processes the submitted requests in the order of submission. The time of reading
+ * (wall) and the number of bytes read are accumulated
+ */
+{
+	int b,cur,err;
+	size_t i,bytes;
+	SYSTEM_TIME tv[2];
+
+	pthread_mutex_lock(&lock);
+	while (true) {
+		cur=-1;
+		for (b=0;b<OOC_NBUF;b++) if (pending[b] && (cur<0 || order[b]<order[cur])) cur=b;
+		if (cur<0) {
+			if (quit) break;
+			pthread_cond_wait(&cond,&lock);
+			continue;
+		}
+		pthread_mutex_unlock(&lock);
+		GET_SYSTEM_TIME(tv);
+		err=0;
+		bytes=0;
+		for (i=0;i<nChunks[cur] && err==0;i++) {
+			err=ReadChunk(chunkList[cur]+i);
+			bytes+=chunkList[cur][i].size;
+		}
+		GET_SYSTEM_TIME(tv+1);
+		pthread_mutex_lock(&lock);
+		Timing_OocRead+=DiffSystemTime(tv,tv+1);
+		TotalOocBytes+=bytes;
+		if (err!=0 && readErr==0) readErr=err;
+		pending[cur]=false;
+		pthread_cond_broadcast(&cond);
+	}
+	pthread_mutex_unlock(&lock);
+	return NULL;
+}
+
+//======================================================================================================================
+
+void OocOpen(const char * restrict fname)
+// opens the file for reading and starts the reader thread
+{
+	int b;
+
+	fileName=fname;
+	if ((fd=open(fname,O_RDONLY))==-1) LogError(ALL_POS,"Failed to open file '%s' for out-of-core reading",fname);
+	// the access pattern is defined by the requests, so the read-ahead by the system is not needed
+#	ifdef POSIX_FADV_RANDOM
+	posix_fadvise(fd,0,0,POSIX_FADV_RANDOM);
+#	endif
+	for (b=0;b<OOC_NBUF;b++) pending[b]=false;
+	nextOrder=0;
+	quit=false;
+	readErr=0;
+	if (pthread_create(&reader,NULL,Reader,NULL)!=0)
+		LogError(ALL_POS,"Failed to create thread for out-of-core reading");
+}
+
+//======================================================================================================================
+
+void OocSubmit(const int buf,const struct oocChunk * restrict chunks,const size_t n)
+/* submits a request to read n chunks (the array should remain valid until completion) into buffer buf; the previous
+ * request for the same buffer is first waited for
+ */
+{
+	OocWait(buf);
+	pthread_mutex_lock(&lock);
+	chunkList[buf]=chunks;
+	nChunks[buf]=n;
+	order[buf]=nextOrder++;
+	pending[buf]=true;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+}
+
+//======================================================================================================================
+
+void OocWait(const int buf)
+// waits until the request for buffer buf is completed; the time of waiting (wall) is accumulated
+{
+	SYSTEM_TIME tv[2];
+	int err;
+
+	pthread_mutex_lock(&lock);
+	if (pending[buf]) {
+		GET_SYSTEM_TIME(tv);
+		while (pending[buf]) pthread_cond_wait(&cond,&lock);
+		GET_SYSTEM_TIME(tv+1);
+		Timing_OocWait+=DiffSystemTime(tv,tv+1);
+	}
+	err=readErr;
+	pthread_mutex_unlock(&lock);
+	if (err!=0) LogError(ALL_POS,"Failed to read from file '%s' (%s)",fileName,strerror(err));
+}
+
+//======================================================================================================================
+
+void OocClose(void)
+// waits for all requests, stops the reader thread and closes the file
+{
+	pthread_mutex_lock(&lock);
+	quit=true;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+	pthread_join(reader,NULL);
+	close(fd);
+}
+
+#endif // OOC
@@ -0,0 +1,45 @@
+/* File: ooc.h
+ * Descr: definitions for asynchronous reading of a file by a separate thread, used for out-of-core storage of the
+ *        Fourier-transformed interaction matrices (used with option OOC)
+ *
+ * Copyright (C) 2014 ADDA contributors
+ * This file is part of ADDA.
+ *
+ * ADDA is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * ADDA is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with ADDA. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#ifndef __ooc_h
+#define __ooc_h
+
+#ifdef OOC
+
+// system headers
+#include <stddef.h> // for size_t
+#include <stdint.h> // for uint64_t
+
+/* The reader thread fills one of OOC_NBUF buffers (supplied by the caller), while the other one is being used by the
+ * main thread, i.e. it implements double buffering. Each request is a list of chunks (contiguous parts of the file),
+ * requests are processed one after another in the order of submission.
+ */
+#define OOC_NBUF 2
+
+struct oocChunk {
+	uint64_t off; // offset of the chunk in the file (in bytes)
+	size_t size;  // size of the chunk (in bytes)
+	void *dest;   // destination in memory
+};
+
+void OocOpen(const char * restrict fname);
+void OocSubmit(int buf,const struct oocChunk * restrict chunks,size_t n);
+void OocWait(int buf);
+void OocClose(void);
+
+#endif // OOC
+
+#endif // __ooc_h
@@ -24,6 +24,9 @@
 #include "debug.h"
 #include "fft.h"
 #include "function.h"
+#ifdef FFT_BUILTIN
+#	include "fft_builtin.h"
+#endif
 #include "io.h"
 #include "oclcore.h"
 #include "os.h"
@@ -37,6 +40,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#ifdef OPENMP
+#	include <omp.h>
+#endif
 
 #ifdef CLFFT_AMD
 /* One can also include clAmdFft.h (the only recommended public header), which can be redundant, but more portable.
@@ -57,28 +63,6 @@
 #	include "svnrev.h" // for SVNREV, this file is automatically created during compilation
 #endif
 
-// definitions for file locking
-#ifdef USE_LOCK
-#	ifdef WINDOWS
-#		define FILEHANDLE HANDLE
-#	elif defined(POSIX)
-#		include <unistd.h>
-#		include <fcntl.h>
-#		ifdef LOCK_FOR_NFS
-#			include <errno.h> // for error handling of fcntl call
-#		endif
-#		define FILEHANDLE int
-#	else
-#		error "Unknown operation system. Creation of lock files is not supported."
-#	endif
-#	define LOCK_WAIT 1 // in seconds
-#	define MAX_LOCK_WAIT_CYCLES 60
-#	define ONLY_FOR_LOCK
-#else
-#	define FILEHANDLE int
-#	define ONLY_FOR_LOCK ATT_UNUSED
-#endif
-
 // GLOBAL VARIABLES
 
 opt_index opt; // main option index; it is also defined as extern in param.h
@@ -100,6 +84,7 @@ extern const size_t mat_count[];
 
 // used in CalculateE.c
 bool store_int_field; // save full internal fields to text file
+bool store_int_bin;   // save internal fields in binary format (instead of text)
 bool store_dip_pol;   // save dipole polarizations to text file
 bool store_beam;      // save incident beam to file
 bool store_scat_grid; // Store the scattered field for grid of angles
@@ -120,6 +105,12 @@ const char *scat_grid_parms;      // name of file with parameters of scattering
 // used in crosssec.c
 double incPolX_0[3],incPolY_0[3]; // initial incident polarizations (in lab RF)
 enum scat ScatRelation;           // type of formulae for scattering quantities
+// used in fft.c
+enum fftplan fft_plan;        // level of planning of FFTW3 for MatVec
+const char *fft_wisdom_fname; // name of file with FFTW3 wisdom (NULL if not used)
+const char *dmatrix_cache_dir; // directory for cache of Fourier-transformed interaction matrices (NULL if not used)
+int grid_tune; // number of candidate sizes along each axis for auto-tuning of FFT grid (0 - not used)
+bool ooc_Dm;   // whether Fourier-transformed interaction matrices are streamed from the cache file during MatVec
 // used in GenerateB.c
 int beam_Npars;
 double beam_pars[MAX_N_BEAM_PARMS]; // beam parameters
@@ -139,9 +130,17 @@ enum init_field InitField; // how to calculate initial field for the iterative s
 const char *infi_fnameY;   // names of files, defining the initial field (for two polarizations)
 const char *infi_fnameX;
 bool recalc_resid;         // whether to recalculate residual at the end of iterative solver
+int gmres_m;               // restart length of GMRES(m); also used in calculator.c
+int idr_s;                 // dimension of the shadow space of IDR(s); also used in calculator.c
+enum prec Precond;         // preconditioner of the iterative solver; also used in calculator.c and timing.c
+int recycle_k;             // number of recycled Krylov vectors (0 - no recycling); also used in calculator.c
+bool recycle_ref;          // whether to compare recycling with reference solves; also used in calculator.c and timing.c
 enum chpoint chp_type;     // type of checkpoint (to save)
 time_t chp_time;           // time of checkpoint (in sec)
 char const *chp_dir;       // directory name to save/load checkpoint
+#ifdef MIXED_PREC
+bool mixed_prec;           // whether to use single-precision MatVec inside the iterative solver; also used in fft.c
+#endif
 // used in make_particle.c
 enum sh shape;                   // particle shape definition
 int sh_Npars;                    // number of shape parameters
@@ -162,6 +161,8 @@ int gr_mat;                      // domain number to granulate
 double a_eq;                     // volume-equivalent radius of the particle
 enum shform sg_format;           // format for saving geometry files
 bool store_grans;                // whether to save granule positions to file
+// used in precond.c
+int prec_size; // size of cubical blocks of the preconditioner (in dipoles)
 
 // LOCAL VARIABLES
 
@@ -338,9 +339,16 @@ PARSE_FUNC(chpoint);
 PARSE_FUNC(Cpr);
 PARSE_FUNC(Csca);
 PARSE_FUNC(dir);
+#if !defined(SPARSE) && !defined(OPENCL)
+PARSE_FUNC(dmatrix_cache);
+#endif
 PARSE_FUNC(dpl);
 PARSE_FUNC(eps);
 PARSE_FUNC(eq_rad);
+#if defined(FFTW3) && !defined(OPENCL)
+PARSE_FUNC(fft_plan);
+PARSE_FUNC(fft_wisdom);
+#endif
 #ifdef OPENCL
 PARSE_FUNC(gpu);
 #endif
@@ -348,6 +356,9 @@ PARSE_FUNC(gpu);
 PARSE_FUNC(granul);
 #endif
 PARSE_FUNC(grid);
+#if !defined(SPARSE) && !defined(OPENCL)
+PARSE_FUNC(grid_tune);
+#endif
 PARSE_FUNC(h) ATT_NORETURN;
 PARSE_FUNC(init_field);
 PARSE_FUNC(int);
@@ -357,16 +368,24 @@ PARSE_FUNC(jagged);
 PARSE_FUNC(lambda);
 PARSE_FUNC(m);
 PARSE_FUNC(maxiter);
+#ifdef MIXED_PREC
+PARSE_FUNC(mixed_prec);
+#endif
 PARSE_FUNC(no_reduced_fft);
 PARSE_FUNC(no_vol_cor);
 PARSE_FUNC(ntheta);
+#if defined(OOC) && !defined(OPENCL)
+PARSE_FUNC(ooc);
+#endif
 PARSE_FUNC(opt);
 PARSE_FUNC(orient);
 PARSE_FUNC(phi_integr);
 PARSE_FUNC(pol);
+PARSE_FUNC(prec);
 PARSE_FUNC(prognosis);
 PARSE_FUNC(prop);
 PARSE_FUNC(recalc_resid);
+PARSE_FUNC(recycle);
 #ifndef SPARSE
 PARSE_FUNC(save_geom);
 #endif
@@ -379,6 +398,9 @@ PARSE_FUNC(sg_format);
 #endif
 PARSE_FUNC(shape);
 PARSE_FUNC(size);
+#if !defined(SPARSE) && !defined(OPENCL)
+PARSE_FUNC(slice_batch);
+#endif
 PARSE_FUNC(store_beam);
 PARSE_FUNC(store_dip_pol);
 PARSE_FUNC(store_force);
@@ -390,6 +412,9 @@ PARSE_FUNC(store_scat_grid);
 PARSE_FUNC(surf);
 PARSE_FUNC(sym);
 PARSE_FUNC(test);
+#ifdef OPENMP
+PARSE_FUNC(threads);
+#endif
 PARSE_FUNC(V) ATT_NORETURN;
 PARSE_FUNC(vec);
 PARSE_FUNC(yz);
@@ -422,6 +447,16 @@ static struct opt_struct options[]={
 	{PAR(Csca),"","Calculate scattering cross section (by integrating the scattered field)",0,NULL},
 	{PAR(dir),"<dirname>","Sets directory for output files.\n"
 		"Default: constructed automatically",1,NULL},
+#if !defined(SPARSE) && !defined(OPENCL)
+	{PAR(dmatrix_cache),"<dirname>","Sets directory for the cache of Fourier-transformed interaction matrices (for "
+		"particle and substrate). If a cache file matching the current grid, wavelength, dipole size, interaction "
+		"formulation, substrate, and number of processors exists, it is mapped into memory instead of computing "
+		"these matrices. Otherwise, the computed matrices are saved there. This is especially useful for series of "
+		"runs differing only by the incident beam or by refractive index of the particle. The latter is not the case "
+		"for '-int so', since this formulation depends on the refractive index (it is then a part of the cache key). "
+		"The directory is created if needed.\n"
+		"Default: not used",1,NULL},
+#endif
 	{PAR(dpl),"<arg>","Sets parameter 'dipoles per lambda', float.\n"
 		"Default: 10|m|, where |m| is the maximum of all given refractive indices.",1,NULL},
 	{PAR(eps),"<arg>","Specifies the stopping criterion for the iterative solver by setting the relative norm of the "
@@ -432,6 +467,17 @@ static struct opt_struct options[]={
 		"defined by some shapes themselves, then this option can be used to override the internal specification and "
 		"scale the shape.\n"
 		"Default: determined by the value of '-size' or by '-grid', '-dpl', and '-lambda'.",1,NULL},
+#if defined(FFTW3) && !defined(OPENCL)
+	{PAR(fft_plan),"{estimate|measure|patient|exhaustive}","Sets the level of planning of FFTW3 for Fourier transforms "
+		"in the matrix-vector product. Higher levels may produce faster transforms, but take (much) longer to plan. "
+		"This is especially relevant in combination with '-fft_wisdom'.\n"
+		"Default: measure",1,NULL},
+	{PAR(fft_wisdom),"<filename>","Specifies a file with FFTW3 wisdom. It is read before planning of Fourier "
+		"transforms (if exists) and then updated with newly gathered wisdom. Thus, subsequent runs with the same grid "
+		"and number of processors (and threads) perform planning almost instantly. The file is locked during access, "
+		"so it can be safely shared between simultaneous runs.\n"
+		"Default: not used",1,NULL},
+#endif
 #ifdef OPENCL
 	{PAR(gpu),"<index>","Specifies index of GPU that should be used (starting from 0). Relevant only for OpenCL "
 		"version of ADDA, running on a system with several GPUs.\n"
@@ -449,15 +495,33 @@ static struct opt_struct options[]={
 		"read'). If '-jagged' option is used the grid dimension is effectively multiplied by the specified number.\n"
 		"Default: 16 (if neither '-size' nor '-eq_rad' are specified) or defined by\n"
 		"         '-size' or '-eq_rad', '-lambda', and '-dpl'.",UNDEF,NULL},
+#if !defined(SPARSE) && !defined(OPENCL)
+	{PAR(grid_tune),"[<num>]","Selects the FFT grid by measuring the speed of Fourier transforms for <num> smallest "
+		"admissible sizes along each axis (instead of using the smallest one). The grid with the smallest predicted "
+		"time of the matrix-vector product is used; predictions for all candidates are shown in stdout and log. With "
+		"'-fft_wisdom <filename>' the selection is saved to and reused from '<filename>.grid'. <num> is from 1 to 8. "
+		"Can be used with '-prognosis'.\n"
+		"Default: not used (<num> = 3 if specified without argument)",UNDEF,NULL},
+#endif
 	{PAR(h),"[<opt> [<subopt>]]","Shows help. If used without arguments, ADDA shows a list of all available command "
 		"line options. If first argument is specified, help on specific command line option <opt> is shown (only the "
 		"name of the option should be given without preceding dash). For some options (e.g. '-beam' or '-shape') "
 		"specific help on a particular suboption <subopt> may be shown.\n"
 		"Example: shape coated",UNDEF,NULL},
-	{PAR(init_field),"{auto|inc|read <filenameY> [<filenameX>]|wkb|zero}",
+	{PAR(init_field),"{auto|file <filenameY> [<filenameX>]|inc|prev|prev_inc|read <filenameY> [<filenameX>]|wkb|zero}",
 		"Sets prescription to calculate initial (starting) field for the iterative solver.\n"
 		"'auto' - automatically choose from 'zero' and 'inc' based on the lower residual value.\n"
+		"'file' - the same as 'read', but the files should be in binary format, produced by '-store_int_field bin' "
+		"(e.g. in a previous run at a slightly different wavelength or refractive index),\n"
 		"'inc' - derived from the incident field,\n"
+		"'prev' - internal field for the same incident polarization, obtained for the previous orientation. Can be "
+		"used only with '-orient avg'; 'auto' is used for the first orientation,\n"
+		"'prev_inc' - the same as 'prev', but corrected for the change of the incident plane wave (the field at each "
+		"dipole is rotated together with the incident polarizations and multiplied by the change of the incident "
+		"phase), and scaled by a complex factor to minimize the initial residual. However, the internal fields for "
+		"successive orientations (even at small steps of the Euler angles) usually differ too much, so both 'prev' and "
+		"'prev_inc' usually do not decrease (and may even increase) the total number of iterations for orientation "
+		"averaging compared to 'auto',\n"
 		"'read' - defined by separate files, which names are given as arguments. Normally two files are required for "
 		"Y- and X-polarizations respectively, but a single filename is sufficient if only Y-polarization is used (e.g. "
 		"due to symmetry). Initial field should be specified in a particle reference frame in the same format as used "
@@ -508,8 +572,16 @@ static struct opt_struct options[]={
 		 * !!! If subarguments are added, second-to-last argument should be changed from 1 to UNDEF, and consistency
 		 * test for number of arguments should be implemented in PARSE_FUNC(int_surf) below.
 		 */
-	{PAR(iter),"{bcgs2|bicg|bicgstab|cgnr|csym|qmr|qmr2}","Sets the iterative solver.\n"
-		"Default: qmr",1,NULL},
+	{PAR(iter),"{bbicgstab|bcgs2|bicg|bicgstab|cgnr|csym|gmres [<m>]|idr [<s>]|pbicgstab|qmr|qmr2}","Sets the "
+		"iterative solver. 'bbicgstab' is a block version of 'bicgstab', which solves for both incident polarizations "
+		"simultaneously (for rotationally symmetric particles, when a single polarization is sufficient, it is "
+		"replaced by 'bicgstab'). 'gmres' is GMRES restarted after every <m> iterations (integer from 1 to 200), it "
+		"requires m+1 additional vectors. 'idr' is IDR(s) with the shadow space of dimension <s> (integer from 1 to "
+		"16), it requires 3s additional vectors and s+1 matrix-vector products per iteration. 'pbicgstab' is a "
+		"pipelined version of 'bicgstab', in which each global reduction is overlapped with a matrix-vector product "
+		"(in MPI mode with MPI 3.0 or newer); it requires 6 additional vectors and is intended for large number of "
+		"processors.\n"
+		"Default: qmr (m=30, s=4)",UNDEF,NULL},
 		/* TO ADD NEW ITERATIVE SOLVER
 		 * add the short name, used to define the new iterative solver in the command line, to the list "{...}" in the
 		 * alphabetical order.
@@ -528,6 +600,12 @@ static struct opt_struct options[]={
 		"Default: 1.5 0",UNDEF,NULL},
 	{PAR(maxiter),"<arg>","Sets the maximum number of iterations of the iterative solver, integer.\n"
 		"Default: very large, not realistic value",1,NULL},
+#ifdef MIXED_PREC
+	{PAR(mixed_prec),"","Use single-precision FFT-based MatVec (with single-precision copy of the Fourier-transformed "
+		"interaction matrix) inside the iterative solver. The solution is then refined by outer steps, which compute "
+		"the residual with double-precision MatVec and restart the iterative solver from the current solution, until "
+		"the relative residual satisfies '-eps'. Incompatible with checkpoints.",0,NULL},
+#endif
 	{PAR(no_reduced_fft),"","Do not use symmetry of the interaction matrix to reduce the storage space for the "
 		"Fourier-transformed matrix.",0,NULL},
 	{PAR(no_vol_cor),"","Do not use 'dpl (volume) correction'. If this option is given, ADDA will try to match size of "
@@ -539,8 +617,19 @@ static struct opt_struct options[]={
 		"orientation averaging is not used, the range is extended to 360 degrees (with the same length of elementary "
 		"interval, i.e. number of intervals is doubled).\n"
 		"Default: from 90 to 720 depending on the size of the computational grid.",1,NULL},
-	{PAR(opt),"{speed|mem}",
-		"Sets whether ADDA should optimize itself for maximum speed or for minimum memory usage.\n"
+#if defined(OOC) && !defined(OPENCL)
+	{PAR(ooc),"","Keep the Fourier-transformed interaction matrices (for particle and substrate) out of core, i.e. "
+		"only in the cache file (requires '-dmatrix_cache'). During each MatVec they are read from this file by a "
+		"separate thread in portions of several x-slices, overlapping with computations on the previous portion. This "
+		"decreases the memory for these matrices to two such portions, which is useful when they do not fit into RAM. "
+		"It is most effective in combination with '-opt lean'.",0,NULL},
+#endif
+	{PAR(opt),"{speed|mem|lean}",
+		"Sets whether ADDA should optimize itself for maximum speed or for minimum memory usage. 'lean' additionally "
+		"makes FFT-based MatVec (on CPU) to process the components of vectors one at a time, which decreases the "
+		"memory for the transformed vectors three times (six times for '-iter bbicgstab') at the cost of 9 forward "
+		"and 9 backward 3D FFTs per MatVec (for each incident polarization) instead of 3 and 3, i.e. MatVec becomes "
+		"about three times slower.\n"
 		"Default: speed",1,NULL},
 	{PAR(orient),"{<alpha> <beta> <gamma>|avg [<filename>]}","Either sets an orientation of the particle by three "
 		"Euler angles 'alpha','beta','gamma' (in degrees) or specifies that orientation averaging should be "
@@ -574,12 +663,33 @@ static struct opt_struct options[]={
 		 * Modify string constants after 'PAR(pol)': add new argument (possibly with additional sub-arguments) to list
 		 * {...} and its description to the next string.
 		 */
+	{PAR(prec),"{bjacobi [<size>]|none}","Sets the right preconditioner of the iterative solver. 'bjacobi' is a "
+		"near-field block-Jacobi preconditioner: local dipoles are grouped in cubes of <size>^3 dipoles (integer "
+		"from 1 to 3, default: 2), and the interaction matrix restricted to each cube is inverted (LU-factorized "
+		"once). It requires about 144*<size>^3 bytes per dipole. Only the iterative solvers, which do not rely on the "
+		"symmetry of the matrix, can be used: bbicgstab, bcgs2, bicgstab, gmres, idr, and pbicgstab.\n"
+		"Default: none",UNDEF,NULL},
 	{PAR(prognosis),"","Do not actually perform simulation (not even memory allocation) but only estimate the required "
 		"RAM. Implies '-test'.",0,NULL},
 	{PAR(prop),"<x> <y> <z>","Sets propagation direction of incident radiation, float. Normalization (to the unity "
 		"vector) is performed automatically. For point-dipole incident beam this determines its direction.\n"
 		"Default: 0 0 1",3,NULL},
 	{PAR(recalc_resid),"","Recalculate residual at the end of iterative solver.",0,NULL},
+	{PAR(recycle),"<k> [ref]","Keeps a subspace of <k> approximate invariant vectors (corresponding to the "
+		"eigenvalues of the matrix closest to zero) between the cycles of GMRES and between the successive runs of the "
+		"iterative solver within a single run of ADDA (incident polarizations and orientations), and uses it to "
+		"deflate the following iterations (GCRO-DR). Different wavelengths are simulated by separate runs of ADDA, "
+		"so the subspace is not reused between them. <k> is integer from 0 (no recycling) to m-1, where m is the "
+		"restart length of GMRES. It requires 4<k> additional vectors, and is currently implemented only for "
+		"'-iter gmres' (other iterative solvers are rejected). <k> larger than m/2 leaves few new Krylov vectors in "
+		"each cycle and usually increases the total number of MatVecs. The number of MatVecs is shown after each run "
+		"of the iterative solver.\n"
+		"If 'ref' is given, each run of the iterative solver is preceded by a reference solve of the same system by "
+		"GMRES without recycling (from the same initial field), and the number of MatVecs saved compared to it is "
+		"shown for each run, for each orientation (in the log of orientation averaging), and in total. This doubles "
+		"the computational time (the reference solves are included in the total number of MatVecs), and is "
+		"incompatible with checkpoints.\n"
+		"Default: 0",UNDEF,NULL},
 #ifndef SPARSE
 	{PAR(save_geom),"[<filename>]","Save dipole configuration to a file <filename> (a path relative to the output "
 		"directory). Can be used with '-prognosis'.\n"
@@ -622,13 +732,23 @@ static struct opt_struct options[]={
 		"'-eq_rad'. Size is defined by some shapes themselves, then this option can be used to override the internal "
 		"specification and scale the shape.\n"
 		"Default: determined by the value of '-eq_rad' or by '-grid', '-dpl', and '-lambda'.",1,NULL},
+#if !defined(SPARSE) && !defined(OPENCL)
+	{PAR(slice_batch),"<num>","Sets the number of consecutive x-slices, which are processed together (by each thread) "
+		"in the matrix-vector product. Larger values decrease the overhead of FFT calls for small and medium grids, "
+		"but require proportionally more memory for slices. Values larger than the local number of slices are "
+		"reduced to the latter.\n"
+		"Default: 1",1,NULL},
+#endif
 	{PAR(store_beam),"","Save incident beam to a file",0,NULL},
 	{PAR(store_dip_pol),"","Save dipole polarizations to a file",0,NULL},
 	{PAR(store_force),"","Calculate the radiation force on each dipole. Implies '-Cpr'",0,NULL},
 #ifndef SPARSE
 	{PAR(store_grans),"","Save granule coordinates (placed by '-granul' option) to a file",0,NULL},
 #endif
-	{PAR(store_int_field),"","Save internal fields to a file",0,NULL},
+	{PAR(store_int_field),"[bin]","Save internal fields to a file. If 'bin' is given, the fields are saved in a "
+		"compact binary format (without dipole coordinates), which can be used by '-init_field file'. Such files do "
+		"not depend on the number of processors, but are not portable between machines with different representation "
+		"of numbers.",UNDEF,NULL},
 	{PAR(store_scat_grid),"","Calculate Mueller matrix for a grid of scattering angles and save it to a file.",0,NULL},
 	{PAR(surf),"<h> {<mre> <mim>|inf}","Specifies that scatterer is located above the plane surface, parallel to the "
 		"xy-plane. <h> specifies the height of particle center above the surface (along the z-axis, in um). Particle "
@@ -640,6 +760,11 @@ static struct opt_struct options[]={
 		"('no'), or enforce them ('enf').\n"
 		"Default: auto",1,NULL},
 	{PAR(test),"","Begin name of the output directory with 'test' instead of 'run'",0,NULL},
+#ifdef OPENMP
+	{PAR(threads),"<num>","Sets the number of threads (per process) used in the matrix-vector product. In parallel "
+		"mode the total number of cores used is this number times the number of MPI processes.\n"
+		"Default: determined by the OpenMP runtime (e.g., by environmental variable OMP_NUM_THREADS)",1,NULL},
+#endif
 	{PAR(V),"","Show ADDA version, compiler used to build this executable, build options, and copyright information",
 		0,NULL},
 	{PAR(vec),"","Calculate the not-normalized asymmetry vector",0,NULL},
@@ -1027,6 +1152,12 @@ PARSE_FUNC(dir)
 {
 	directory=ScanStrError(argv[1],MAX_DIRNAME);
 }
+#if !defined(SPARSE) && !defined(OPENCL)
+PARSE_FUNC(dmatrix_cache)
+{
+	dmatrix_cache_dir=ScanStrError(argv[1],MAX_DIRNAME);
+}
+#endif
 PARSE_FUNC(dpl)
 {
 	ScanDoubleError(argv[1],&dpl);
@@ -1045,6 +1176,20 @@ PARSE_FUNC(eq_rad)
 	ScanDoubleError(argv[1],&a_eq);
 	TestPositive(a_eq,"dpl");
 }
+#if defined(FFTW3) && !defined(OPENCL)
+PARSE_FUNC(fft_plan)
+{
+	if (strcmp(argv[1],"estimate")==0) fft_plan=FP_ESTIMATE;
+	else if (strcmp(argv[1],"measure")==0) fft_plan=FP_MEASURE;
+	else if (strcmp(argv[1],"patient")==0) fft_plan=FP_PATIENT;
+	else if (strcmp(argv[1],"exhaustive")==0) fft_plan=FP_EXHAUSTIVE;
+	else NotSupported("FFT planning level",argv[1]);
+}
+PARSE_FUNC(fft_wisdom)
+{
+	fft_wisdom_fname=ScanStrError(argv[1],MAX_FNAME);
+}
+#endif
 #ifdef OPENCL
 PARSE_FUNC(gpu)
 {
@@ -1081,6 +1226,17 @@ PARSE_FUNC(grid)
 		TestRange_i(boxY,"gridY",1,BOX_MAX);
 	}
 }
+#if !defined(SPARSE) && !defined(OPENCL)
+PARSE_FUNC(grid_tune)
+{
+	if (Narg>1) NargError(Narg,"0 or 1");
+	if (Narg==1) {
+		ScanIntError(argv[1],&grid_tune);
+		TestRange_i(grid_tune,"number of candidate grid sizes",1,MAX_GRID_TUNE);
+	}
+	else grid_tune=3;
+}
+#endif
 PARSE_FUNC(h)
 {
 	int i,j;
@@ -1144,7 +1300,15 @@ PARSE_FUNC(init_field)
 
 	if (Narg<1 || Narg>3) NargError(Narg,"from 1 to 3");
 	if (strcmp(argv[1],"auto")==0) InitField=IF_AUTO;
+	else if (strcmp(argv[1],"file")==0) {
+		if (Narg!=2 && Narg!=3) NargErrorSub(Narg,"init_field file","1 or 2");
+		ScanFnamesError(Narg-1,FNAME_ARG_1_2,argv+2,&infi_fnameY,&infi_fnameX);
+		InitField=IF_FILE;
+		noExtraArgs=false;
+	}
 	else if (strcmp(argv[1],"inc")==0) InitField=IF_INC;
+	else if (strcmp(argv[1],"prev")==0) InitField=IF_PREV;
+	else if (strcmp(argv[1],"prev_inc")==0) InitField=IF_PREV_INC;
 	else if (strcmp(argv[1],"read")==0) {
 		if (Narg!=2 && Narg!=3) NargErrorSub(Narg,"init_field read","1 or 2");
 		ScanFnamesError(Narg-1,FNAME_ARG_1_2,argv+2,&infi_fnameY,&infi_fnameX);
@@ -1229,18 +1393,41 @@ PARSE_FUNC(int_surf)
 }
 PARSE_FUNC(iter)
 {
-	if (strcmp(argv[1],"bcgs2")==0) IterMethod=IT_BCGS2;
+	bool noExtraArgs=true;
+
+	if (Narg<1 || Narg>2) NargError(Narg,"1 or 2");
+	if (strcmp(argv[1],"bbicgstab")==0) IterMethod=IT_BICGSTAB_B;
+	else if (strcmp(argv[1],"bcgs2")==0) IterMethod=IT_BCGS2;
 	else if (strcmp(argv[1],"bicg")==0) IterMethod=IT_BICG_CS;
 	else if (strcmp(argv[1],"bicgstab")==0) IterMethod=IT_BICGSTAB;
 	else if (strcmp(argv[1],"cgnr")==0) IterMethod=IT_CGNR;
 	else if (strcmp(argv[1],"csym")==0) IterMethod=IT_CSYM;
+	else if (strcmp(argv[1],"gmres")==0) {
+		IterMethod=IT_GMRES;
+		if (Narg==2) {
+			ScanIntError(argv[2],&gmres_m);
+			TestRange_i(gmres_m,"restart length of GMRES",1,MAX_GMRES_M);
+		}
+		noExtraArgs=false;
+	}
+	else if (strcmp(argv[1],"idr")==0) {
+		IterMethod=IT_IDR;
+		if (Narg==2) {
+			ScanIntError(argv[2],&idr_s);
+			TestRange_i(idr_s,"dimension of the shadow space of IDR",1,MAX_IDR_S);
+		}
+		noExtraArgs=false;
+	}
+	else if (strcmp(argv[1],"pbicgstab")==0) IterMethod=IT_PBICGSTAB;
 	else if (strcmp(argv[1],"qmr")==0) IterMethod=IT_QMR_CS;
 	else if (strcmp(argv[1],"qmr2")==0) IterMethod=IT_QMR_CS_2;
 	/* TO ADD NEW ITERATIVE SOLVER
 	 * add the line to else-if sequence above in the alphabetical order, analogous to the ones already present. The
-	 * variable parts of the line are its name used in command line and its descriptor, defined in const.h
+	 * variable parts of the line are its name used in command line and its descriptor, defined in const.h. If
+	 * subarguments are used, process them and set noExtraArgs to false (see "gmres" for example).
 	 */
 	else NotSupported("Iterative method",argv[1]);
+	TestExtraNarg(Narg,noExtraArgs,argv[1]);
 }
 PARSE_FUNC(jagged)
 {
@@ -1274,6 +1461,12 @@ PARSE_FUNC(maxiter)
 	ScanIntError(argv[1],&maxiter);
 	TestPositive_i(maxiter,"maximum number of iterations");
 }
+#ifdef MIXED_PREC
+PARSE_FUNC(mixed_prec)
+{
+	mixed_prec=true;
+}
+#endif
 PARSE_FUNC(no_reduced_fft)
 {
 	reduced_FFT=false;
@@ -1288,10 +1481,20 @@ PARSE_FUNC(ntheta)
 	TestPositive_i(nTheta,"number of theta intervals");
 	nTheta++;
 }
+#if defined(OOC) && !defined(OPENCL)
+PARSE_FUNC(ooc)
+{
+	ooc_Dm=true;
+}
+#endif
 PARSE_FUNC(opt)
 {
-	if (strcmp(argv[1],"speed")==0) save_memory=false;
-	else if (strcmp(argv[1],"mem")==0) save_memory=true;
+	if (strcmp(argv[1],"speed")==0) save_memory=lean_matvec=false;
+	else if (strcmp(argv[1],"mem")==0) {
+		save_memory=true;
+		lean_matvec=false;
+	}
+	else if (strcmp(argv[1],"lean")==0) save_memory=lean_matvec=true;
 	else NotSupported("Optimization method",argv[1]);
 }
 PARSE_FUNC(orient)
@@ -1364,6 +1567,23 @@ PARSE_FUNC(pol)
 	else NotSupported("Polarizability relation",argv[1]);
 	TestExtraNarg(Narg,noExtraArgs,argv[1]);
 }
+PARSE_FUNC(prec)
+{
+	bool noExtraArgs=true;
+
+	if (Narg<1 || Narg>2) NargError(Narg,"1 or 2");
+	if (strcmp(argv[1],"bjacobi")==0) {
+		Precond=PREC_BJACOBI;
+		if (Narg==2) {
+			ScanIntError(argv[2],&prec_size);
+			TestRange_i(prec_size,"size of blocks of the preconditioner",1,MAX_PREC_SIZE);
+		}
+		noExtraArgs=false;
+	}
+	else if (strcmp(argv[1],"none")==0) Precond=PREC_NONE;
+	else NotSupported("Preconditioner",argv[1]);
+	TestExtraNarg(Narg,noExtraArgs,argv[1]);
+}
 PARSE_FUNC(prognosis)
 {
 	prognosis=true;
@@ -1385,6 +1605,16 @@ PARSE_FUNC(recalc_resid)
 {
 	recalc_resid=true;
 }
+PARSE_FUNC(recycle)
+{
+	if (Narg!=1 && Narg!=2) NargError(Narg,"1 or 2");
+	ScanIntError(argv[1],&recycle_k);
+	TestRange_i(recycle_k,"number of recycled vectors",0,MAX_GMRES_M-1);
+	if (Narg==2) {
+		if (strcmp(argv[2],"ref")==0) recycle_ref=true;
+		else NotSupported("Argument of Krylov recycling",argv[2]);
+	}
+}
 #ifndef SPARSE
 PARSE_FUNC(save_geom)
 {
@@ -1480,6 +1710,13 @@ PARSE_FUNC(size)
 	ScanDoubleError(argv[1],&sizeX);
 	TestPositive(sizeX,"particle size");
 }
+#if !defined(SPARSE) && !defined(OPENCL)
+PARSE_FUNC(slice_batch)
+{
+	ScanIntError(argv[1],&slice_batch);
+	TestPositive_i(slice_batch,"number of slices in a batch");
+}
+#endif
 PARSE_FUNC(store_beam)
 {
 	store_beam = true;
@@ -1501,7 +1738,12 @@ PARSE_FUNC(store_grans)
 #endif
 PARSE_FUNC(store_int_field)
 {
+	if (Narg>1) NargError(Narg,"0 or 1");
 	store_int_field=true;
+	if (Narg==1) {
+		if (strcmp(argv[1],"bin")==0) store_int_bin=true;
+		else NotSupported("Format of internal fields",argv[1]);
+	}
 }
 PARSE_FUNC(store_scat_grid)
 {
@@ -1537,6 +1779,13 @@ PARSE_FUNC(test)
 {
 	run_name="test";
 }
+#ifdef OPENMP
+PARSE_FUNC(threads)
+{
+	ScanIntError(argv[1],&nthreads);
+	TestPositive_i(nthreads,"number of threads");
+}
+#endif
 PARSE_FUNC(V)
 {
 	char copyright[]="\n\nCopyright (C) 2006-2014 ADDA contributors\n"
@@ -1670,6 +1919,9 @@ PARSE_FUNC(V)
 #ifdef FFT_TEMPERTON
 		"FFT_TEMPERTON, "
 #endif
+#ifdef FFT_BUILTIN
+		"FFT_BUILTIN, "
+#endif
 #ifdef PRECISE_TIMING
 		"PRECISE_TIMING, "
 #endif
@@ -1704,6 +1956,18 @@ PARSE_FUNC(V)
 #endif
 #ifdef NO_SVNREV
 		"NO_SVNREV, "
+#endif
+#ifdef OPENMP
+		"OPENMP, "
+#endif
+#ifdef FFTW_THREADS
+		"FFTW_THREADS, "
+#endif
+#ifdef MIXED_PREC
+		"MIXED_PREC, "
+#endif
+#ifdef OOC
+		"OOC, "
 #endif
 		"";
 		printf("Extra build options: ");
@@ -1750,80 +2014,6 @@ PARSE_FUNC(yz)
 // end of parsing functions
 //=============================================================
 
-static FILEHANDLE CreateLockFile(const char * restrict fname ONLY_FOR_LOCK)
-// create lock file; works only if USE_LOCK is enabled
-{
-#ifdef USE_LOCK
-	FILEHANDLE fd;
-	int i;
-
-#	ifdef WINDOWS
-	i=0;
-	while ((fd=CreateFile(fname,GENERIC_WRITE,FILE_SHARE_WRITE,NULL,CREATE_NEW,FILE_ATTRIBUTE_NORMAL,NULL))
-		    ==INVALID_HANDLE_VALUE) {
-		Sleep(LOCK_WAIT*1000);
-		if (i++ == MAX_LOCK_WAIT_CYCLES) LogError(ONE_POS,"Lock file %s permanently exists",fname);
-	}
-#	elif defined(POSIX)
-#		ifdef LOCK_FOR_NFS
-	struct flock lock;
-#		endif
-	// open file exclusively
-	i=0;
-	while ((fd=open(fname,O_WRONLY | O_CREAT | O_EXCL,0666))==-1) {
-		sleep(LOCK_WAIT);
-		if (i++ == MAX_LOCK_WAIT_CYCLES) LogError(ONE_POS,"Lock file %s permanently exists",fname);
-	}
-#		ifdef LOCK_FOR_NFS
-	// specify lock
-	lock.l_type=F_WRLCK;
-	lock.l_whence=SEEK_SET;
-	lock.l_start=0;
-	lock.l_len=0;
-	// obtain lock*/
-	i=0;
-	while (fcntl(fd,F_SETLK,&lock)==-1) {
-		// if locked by another process wait and try again
-		if (errno==EACCES || errno==EAGAIN) {
-			sleep(LOCK_WAIT);
-			if (i++ == MAX_LOCK_WAIT_CYCLES) LogError(ONE_POS,"Lock file %s permanently exists",fname);
-		}
-		else { // otherwise produce a message and continue
-			if (errno==EOPNOTSUPP || errno==ENOLCK || errno==ENOSYS)
-				LogWarning(EC_WARN,ONE_POS,"Advanced file locking is not supported by the file system");
-			else LogWarning(EC_WARN,ONE_POS,"Unknown problem with file locking ('%s').",strerror(errno));
-			break;
-		}
-	}
-#		endif
-#	endif
-	// return file handle
-	return fd;
-#else
-	return 0;
-#endif
-}
-
-//======================================================================================================================
-
-static void RemoveLockFile(FILEHANDLE fd ONLY_FOR_LOCK,const char * restrict fname ONLY_FOR_LOCK)
-// closes and remove lock file; works only if USE_LOCK is enabled
-{
-#ifdef USE_LOCK
-#	ifdef WINDOWS
-	// close file
-	CloseHandle(fd);
-#	elif defined(POSIX)
-	// close file; all locks are automatically released
-	close(fd);
-#	endif
-	// remove lock file
-	RemoveErr(fname,ONE_POS);
-#endif
-}
-
-//======================================================================================================================
-
 static void UpdateSymVec(const double a[static 3])
 // tests whether vector a satisfies a number of symmetries (with round-off errors) and cancels the failing symmetries
 {
@@ -1857,12 +2047,19 @@ void InitVariables(void)
 	shape=SH_SPHERE;
 	shapename="sphere";
 	store_int_field=false;
+	store_int_bin=false;
 	store_dip_pol=false;
 	PolRelation=POL_LDR;
 	avg_inc_pol=false;
 	ScatRelation=SQ_DRAINE;
 	IntRelation=G_POINT_DIP;
 	IterMethod=IT_QMR_CS;
+	gmres_m=30;
+	idr_s=4;
+	Precond=PREC_NONE;
+	prec_size=2;
+	recycle_k=0;
+	recycle_ref=false;
 	sym_type=SYM_AUTO;
 	prognosis=false;
 	maxiter=UNDEF;
@@ -1903,6 +2100,15 @@ void InitVariables(void)
 	symX=symY=symZ=symR=true;
 	anisotropy=false;
 	save_memory=false;
+	lean_matvec=false;
+	fft_plan=FP_MEASURE;
+	fft_wisdom_fname=NULL;
+	dmatrix_cache_dir=NULL;
+	grid_tune=0;
+	ooc_Dm=false;
+#ifdef MIXED_PREC
+	mixed_prec=false;
+#endif
 	sg_format=SF_TEXT;
 	memory=0;
 	memPeak=0;
@@ -1920,6 +2126,12 @@ void InitVariables(void)
 #ifdef OPENCL
 	gpuInd=0;
 #endif
+#ifdef OPENMP
+	nthreads=omp_get_max_threads();
+#else
+	nthreads=1;
+#endif
+	slice_batch=1;
 	/* TO ADD NEW COMMAND LINE OPTION
 	 * If you use some new variables, flags, etc. you should specify their default values here. This value will be used
 	 * if new option is not specified in the command line.
@@ -2060,9 +2272,27 @@ void VariablesInterconnect(void)
 		// TODO: this limitation should be removed in the future
 		if (orient_avg) PrintError("Currently checkpoint is incompatible with '-orient avg'");
 	}
+#ifdef MIXED_PREC
+	if (mixed_prec && (chp_type!=CHP_NONE || load_chpoint))
+		PrintError("Currently checkpoints are incompatible with '-mixed_prec'");
+#endif
+	if (IterMethod==IT_BICGSTAB_B) {
+#if defined(SPARSE) || defined(OPENCL)
+		PrintError("Block iterative solver ('-iter bbicgstab') is currently supported only in FFT mode on CPU");
+#endif
+#ifdef MIXED_PREC
+		if (mixed_prec) PrintError("'-iter bbicgstab' and '-mixed_prec' can not be used together");
+#endif
+		if (chp_type!=CHP_NONE || load_chpoint)
+			PrintError("Currently checkpoints are incompatible with block iterative solver ('-iter bbicgstab')");
+		if (InitField!=IF_AUTO && InitField!=IF_INC && InitField!=IF_ZERO) PrintError("Block iterative solver "
+			"('-iter bbicgstab') is compatible only with 'auto', 'inc', and 'zero' initial fields");
+	}
 	if (sizeX!=UNDEF && a_eq!=UNDEF) PrintError("'-size' and '-eq_rad' can not be used together");
 	if (calc_mat_force && beamtype!=B_PLANE)
 		PrintError("Currently radiation forces can not be calculated for non-plane incident wave");
+	if ((InitField==IF_PREV || InitField==IF_PREV_INC) && !orient_avg)
+		PrintError("'-init_field prev' and '-init_field prev_inc' can be used only together with '-orient avg'");
 	if (InitField==IF_WKB) {
 		if (prop_used) PrintError("Currently '-init_field wkb' and '-prop' can not be used together");
 		if (beamtype!=B_PLANE) PrintError("'-init_field wkb' is incompatible with non-plane incident wave");
@@ -2096,6 +2326,34 @@ void VariablesInterconnect(void)
 	 * of the matrix with vector (i.e. calls MatVec function with 'true' as the fourth argument)
 	 */
 #endif
+	/* Right preconditioner breaks the complex symmetry of the matrix, and its Hermitian transpose is not implemented.
+	 * TO ADD NEW ITERATIVE SOLVER
+	 * add the new iterative solver to the list below, if it relies on the symmetry of the matrix or calls MatVec with
+	 * 'true' as the fourth argument
+	 */
+	if (Precond!=PREC_NONE) {
+#ifdef OPENCL
+		PrintError("Preconditioner ('-prec') is currently not supported in OpenCL mode");
+#endif
+		if (IterMethod==IT_BICG_CS || IterMethod==IT_CGNR || IterMethod==IT_CSYM || IterMethod==IT_QMR_CS
+			|| IterMethod==IT_QMR_CS_2) PrintError("Preconditioner ('-prec') can be used only with iterative solvers, "
+			"which do not rely on the symmetry of the matrix: bbicgstab, bcgs2, bicgstab, gmres, idr, and pbicgstab");
+	}
+	if (recycle_k>0) {
+		if (IterMethod!=IT_GMRES) PrintError("Krylov subspace recycling ('-recycle') is currently implemented only "
+			"for '-iter gmres'");
+		if (recycle_k>=gmres_m) PrintError("Number of recycled vectors (%d) must be smaller than the restart length "
+			"of GMRES (%d)",recycle_k,gmres_m);
+		if (2*recycle_k>gmres_m) LogWarning(EC_WARN,ONE_POS,"Number of recycled vectors (%d) is larger than half of "
+			"the restart length of GMRES (%d). This leaves few new Krylov vectors in each cycle and usually increases "
+			"the total number of MatVecs",recycle_k,gmres_m);
+		if (recycle_ref && (chp_type!=CHP_NONE || load_chpoint))
+			PrintError("Reference solves for Krylov recycling ('-recycle ... ref') are incompatible with checkpoints");
+	}
+	else if (recycle_ref) {
+		LogWarning(EC_WARN,ONE_POS,"Argument 'ref' of '-recycle' is ignored, since recycling is turned off (k=0)");
+		recycle_ref=false;
+	}
 	// scale boxes by jagged; should be completely robust to overflows
 #define JAGGED_BOX(a) { \
 	if (a!=UNDEF) { \
@@ -2143,7 +2401,29 @@ void VariablesInterconnect(void)
 		UpdateSymVec(prop);
 		if (beam_asym) UpdateSymVec(beam_center);
 	}
-	ipr_required=(IterMethod==IT_BICGSTAB || IterMethod==IT_CGNR);
+	ipr_required=(IterMethod==IT_BICGSTAB_B || IterMethod==IT_CGNR || IterMethod==IT_IDR);
+	// block iterative solvers process both incident polarizations at once
+	nrhs = (IterMethod==IT_BICGSTAB_B) ? 2 : 1;
+	/* in lean mode the FFT-based MatVec on CPU processes a single component at a time (see MatVec_lean in
+	 * matvec.c), while in OpenCL and sparse modes '-opt lean' is equivalent to '-opt mem'
+	 */
+#if defined(OPENCL) || defined(SPARSE)
+	mv_ncomp=3*nrhs;
+#else
+	mv_ncomp = lean_matvec ? 1 : 3*nrhs;
+#	ifdef MIXED_PREC
+	if (mixed_prec && lean_matvec) PrintError("'-opt lean' and '-mixed_prec' can not be used together");
+	if (mixed_prec && ooc_Dm) PrintError("'-ooc' and '-mixed_prec' can not be used together");
+#	endif
+	if (ooc_Dm && dmatrix_cache_dir==NULL) PrintError("'-ooc' requires the cache file, specified by '-dmatrix_cache'");
+#endif
+	/* the matrix of the linear system must be the same for all right-hand sides, while the LDR polarizability depends
+	 * on the incident polarization (see CoupleConstant in calculator.c)
+	 */
+	if (nrhs>1 && PolRelation==POL_LDR && !avg_inc_pol
+		&& fabs(DotProdSquare(prop,incPolX)-DotProdSquare(prop,incPolY))>ROUND_ERR)
+		PrintError("Block iterative solver ('-iter bbicgstab') requires the same polarizability for both incident "
+			"polarizations. Use '-pol ldr avgpol' or other polarizability formulation, or incidence along the z-axis");
 	/* TO ADD NEW ITERATIVE SOLVER
 	 * add the new iterative solver to the above line, if it requires inner product calculation during matrix-vector
 	 * multiplication (i.e. calls MatVec function with non-NULL third argument)
@@ -2163,12 +2443,23 @@ void FinalizeSymmetry(void) {
 	else if (sym_type==SYM_ENF) symX=symY=symZ=symR=true;
 	// test based on SR^2 = SX*SY; uses handmade XOR
 	if (symR && ((symX&&!symY) || (symY&&!symX))) LogError(ONE_POS,"Inconsistency in internally defined symmetries");
+	/* a single incident polarization is computed in this case, while the block solver requires as many iterations per
+	 * column as the standard BiCGStab, so it would only double the number of MatVecs
+	 */
+	if (symR && !scat_grid && IterMethod==IT_BICGSTAB_B) {
+		LogWarning(EC_INFO,ONE_POS,"Particle is rotationally symmetric, so only one incident polarization is "
+			"calculated. Hence, block iterative solver ('-iter bbicgstab') is replaced by 'bicgstab'");
+		IterMethod=IT_BICGSTAB;
+		ipr_required=false;
+		nrhs=1;
+		if (mv_ncomp>1) mv_ncomp=3; // see VariablesInterconnect
+	}
 	// additional tests in case of two polarization runs
 	if (!(symR && !scat_grid)) {
 		if (beamtype==B_READ && beam_fnameX==NULL)
 			PrintError("Only one beam file is specified, while two incident polarizations need to be considered");
-		if (InitField==IF_READ && infi_fnameX==NULL) PrintError("Only one file with initial field is specified, while "
-			"two incident polarizations need to be considered");
+		if ((InitField==IF_READ || InitField==IF_FILE) && infi_fnameX==NULL) PrintError("Only one file with initial "
+			"field is specified, while two incident polarizations need to be considered");
 		// the following limitation should be removed in the future
 		if (chp_type!=CHP_NONE) PrintError("Currently checkpoints can be used when internal fields are calculated only "
 			"once, i.e. for a single incident polarization");
@@ -2446,6 +2737,8 @@ void PrintInfo(void)
 		fprintf(logfile,"FFTW3\n");
 #elif defined(FFT_TEMPERTON)
 		fprintf(logfile,"by C.Temperton\n");
+#elif defined(FFT_BUILTIN)
+		fprintf(logfile,"built-in (%s kernels)\n",fftbKernel());
 #elif defined(SPARSE)
 		fprintf(logfile,"none (sparse mode)\n");
 #endif
@@ -2463,8 +2756,12 @@ void PrintInfo(void)
 			case IT_BCGS2: fprintf(logfile,"Enhanced Bi-CG Stabilized(2)\n"); break;
 			case IT_BICG_CS: fprintf(logfile,"Bi-CG (complex symmetric)\n"); break;
 			case IT_BICGSTAB: fprintf(logfile,"Bi-CG Stabilized\n"); break;
+			case IT_BICGSTAB_B: fprintf(logfile,"Block Bi-CG Stabilized (both polarizations at once)\n"); break;
 			case IT_CGNR: fprintf(logfile,"CGNR\n"); break;
 			case IT_CSYM: fprintf(logfile,"CSYM\n"); break;
+			case IT_GMRES: fprintf(logfile,"GMRES(%d)\n",gmres_m); break;
+			case IT_IDR: fprintf(logfile,"IDR(%d)\n",idr_s); break;
+			case IT_PBICGSTAB: fprintf(logfile,"Pipelined Bi-CG Stabilized\n"); break;
 			case IT_QMR_CS: fprintf(logfile,"QMR (complex symmetric)\n"); break;
 			case IT_QMR_CS_2: fprintf(logfile,"2-term QMR (complex symmetric)\n"); break;
 		}
@@ -2472,6 +2769,9 @@ void PrintInfo(void)
 		 * add a case above in the alphabetical order, analogous to the ones already present. The variable parts of the
 		 * case are descriptor, defined in const.h, and its plain-text description (to be shown in log).
 		 */
+		if (Precond==PREC_BJACOBI) fprintf(logfile,"Preconditioner: block-Jacobi (cubes of %d^3 dipoles)\n",prec_size);
+		if (recycle_k>0) fprintf(logfile,"Krylov subspace recycling (GCRO-DR): %d vectors%s\n",recycle_k,
+			recycle_ref ? ", compared with reference solves without recycling" : "");
 		// log Symmetry options
 		switch (sym_type) {
 			case SYM_AUTO:
@@ -2487,8 +2787,29 @@ void PrintInfo(void)
 			case SYM_ENF: fprintf(logfile,"Symmetries: enforced by user (warning!)\n"); break;
 		}
 		// log optimization method
-		if (save_memory) fprintf(logfile,"Optimization is done for minimum memory usage\n");
+		if (lean_matvec) fprintf(logfile,"Optimization is done for minimum memory usage, FFT-based MatVec processes "
+			"a single component at a time (9+9 instead of 3+3 3D FFTs)\n");
+		else if (save_memory) fprintf(logfile,"Optimization is done for minimum memory usage\n");
 		else fprintf(logfile,"Optimization is done for maximum speed\n");
+		if (ooc_Dm) fprintf(logfile,"Interaction matrices are stored out of core (in the cache file)\n");
+#ifdef OPENMP
+		fprintf(logfile,"Number of threads (per process) in MatVec: %d\n",nthreads);
+#	ifdef FFTW_THREADS
+		fprintf(logfile,"FFTW3 plans for x-transforms and D-matrix are multithreaded\n");
+#	endif
+#endif
+#if defined(FFTW3) && !defined(OPENCL)
+		switch (fft_plan) {
+			case FP_ESTIMATE: fprintf(logfile,"FFTW3 planning: estimate\n"); break;
+			case FP_MEASURE: break; // default is not logged
+			case FP_PATIENT: fprintf(logfile,"FFTW3 planning: patient\n"); break;
+			case FP_EXHAUSTIVE: fprintf(logfile,"FFTW3 planning: exhaustive\n"); break;
+		}
+		if (fft_wisdom_fname!=NULL) fprintf(logfile,"FFTW3 wisdom file: %s\n",fft_wisdom_fname);
+#endif
+#ifdef MIXED_PREC
+		if (mixed_prec) fprintf(logfile,"Mixed-precision MatVec with double-precision refinement\n");
+#endif
 		// log Checkpoint options
 		if (load_chpoint) fprintf(logfile,"Simulation is continued from a checkpoint\n");
 		if (chp_type!=CHP_NONE) {
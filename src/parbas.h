@@ -68,6 +68,17 @@
 #	define RUN_MPI_SUBVER_REQ MPI_SUBVER_REQ
 #endif
 
+/* Non-blocking collective operations (MPI_Iallreduce) from MPI 3.0 are used to overlap reductions in the pipelined
+ * iterative solvers with MatVec. If not available, blocking reductions are used instead.
+ */
+#if MPI_PREREQ(3,0)
+#	define SUPPORT_MPI_IALLREDUCE
+#	undef RUN_MPI_VER_REQ
+#	undef RUN_MPI_SUBVER_REQ
+#	define RUN_MPI_VER_REQ 3
+#	define RUN_MPI_SUBVER_REQ 0
+#endif
+
 #ifdef SUPPORT_MPI_BOOL
 #	define mpi_bool MPI_C_BOOL
 #else
@@ -0,0 +1,325 @@
+/* File: precond.c
+ * Descr: near-field (block-Jacobi) preconditioner of the iterative solver
+ *
+ *        Local dipoles are grouped into blocks according to the cubes of n x n x n grid cells (n is given by
+ *        prec_size). The interaction matrix of the linear system (I+S.D.S, see IterativeSolver) restricted to each
+ *        block is LU-factorized, and the inverse of the resulting block-diagonal matrix M is used as a right
+ *        preconditioner, i.e. the iterative solver is applied to (A.M).z=b and then x=M.z. The blocks are formed only
+ *        from the dipoles owned by the current processor (cubes crossing the boundary between processors are split),
+ *        so no communication is required. The matrix elements are computed directly by the interaction routines, so
+ *        the same code works both in FFT and sparse modes, including interaction with a surface.
+ *
+ * Copyright (C) 2014 ADDA contributors
+ * This file is part of ADDA.
+ *
+ * ADDA is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * ADDA is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with ADDA. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#include "const.h" // keep this first
+#include "precond.h" // corresponding header
+// project headers
+#include "cmplx.h"
+#include "comm.h"
+#include "interaction.h"
+#include "io.h"
+#include "memory.h"
+#include "vars.h"
+// system headers
+#include <limits.h>
+#include <stdint.h> // for uint64_t
+#include <stdlib.h>
+#include <string.h>
+
+// SEMI-GLOBAL VARIABLES
+
+// defined and initialized in param.c
+extern const int prec_size;
+// defined and initialized in timing.c
+extern TIME_TYPE Timing_PrecSetup;
+
+// LOCAL VARIABLES
+
+#define MAX_BLOCK_DIM (3*MAX_PREC_SIZE*MAX_PREC_SIZE*MAX_PREC_SIZE) // maximum dimension of a block
+static size_t nBlocks;               // number of blocks (on the current processor)
+static size_t * restrict order;      // local dipoles, sorted by blocks
+static size_t * restrict blockStart; // start of each block in 'order' (nBlocks+1 elements)
+static size_t * restrict luStart;    // start of LU factors of each block in 'lu' (nBlocks+1 elements)
+static doublecomplex * restrict lu;  // LU factors of all blocks, each is stored by rows
+static unsigned char * restrict pivot; // pivot rows of LU factorizations, indexed as rows of the large vectors
+static doublecomplex ccUsed[MAX_NMAT][3]; // values of cc_sqrt, for which the current factors were computed
+static bool factored;                // whether the factors were computed at least once
+// number of component [mu,nu] in symmetric matrix, {xx,xy,xz,yy,yz,zz}
+static const int symComp[3][3]={{0,1,2},{1,3,4},{2,4,5}};
+
+struct blockKey { // used to sort dipoles by blocks
+	uint64_t key; // index of the block
+	size_t ind;   // index of the dipole
+};
+
+//======================================================================================================================
+
+static int CompareKeys(const void *a,const void *b)
+// compares two blockKeys, first by the block, then by the dipole (to keep the original order inside the block)
+{
+	const struct blockKey *x=a,*y=b;
+
+	if (x->key!=y->key) return (x->key<y->key) ? -1 : 1;
+	if (x->ind!=y->ind) return (x->ind<y->ind) ? -1 : 1;
+	return 0;
+}
+
+//======================================================================================================================
+
+double InitPreconditioner(void)
+/* groups local dipoles into blocks and allocates memory for the LU factors (the latter are computed afterwards in
+ * UpdatePreconditioner); returns the amount of memory used on the current processor. In prognosis mode only the memory
+ * is estimated. Should be called by all processors.
+ */
+{
+	size_t i,b,nd,luSize;
+	int k,p,pmin[3],pmax[3];
+	uint64_t nbx,nby;
+	struct blockKey * restrict keys;
+	double mem,memSum,memMax,blocksSum,tmp;
+	const int n=prec_size;
+
+	// bounding box of local dipoles
+	for (k=0;k<3;k++) {
+		pmin[k]=INT_MAX;
+		pmax[k]=INT_MIN;
+	}
+	for (i=0;i<local_nvoid_Ndip;i++) for (k=0;k<3;k++) {
+		p=position[3*i+k];
+		if (p<pmin[k]) pmin[k]=p;
+		if (p>pmax[k]) pmax[k]=p;
+	}
+	nbx=(uint64_t)((pmax[0]-pmin[0])/n+1);
+	nby=(uint64_t)((pmax[1]-pmin[1])/n+1);
+	// sort dipoles by blocks
+	keys=(struct blockKey *)voidVector(local_nvoid_Ndip*sizeof(struct blockKey),ALL_POS,"block keys");
+	for (i=0;i<local_nvoid_Ndip;i++) {
+		keys[i].key=((uint64_t)((position[3*i+2]-pmin[2])/n)*nby + (uint64_t)((position[3*i+1]-pmin[1])/n))*nbx
+			+ (uint64_t)((position[3*i]-pmin[0])/n);
+		keys[i].ind=i;
+	}
+	qsort(keys,local_nvoid_Ndip,sizeof(struct blockKey),CompareKeys);
+	nBlocks=0;
+	luSize=0;
+	for (i=0,nd=0;i<local_nvoid_Ndip;i++) {
+		nd++;
+		if (i==local_nvoid_Ndip-1 || keys[i+1].key!=keys[i].key) {
+			nBlocks++;
+			luSize+=9*nd*nd;
+			nd=0;
+		}
+	}
+	mem=luSize*sizeof(doublecomplex) + local_nvoid_Ndip*sizeof(size_t) + 2*(nBlocks+1)*sizeof(size_t) + local_nRows;
+	if (!prognosis) {
+		MALLOC_VECTOR(order,sizet,local_nvoid_Ndip,ALL);
+		MALLOC_VECTOR(blockStart,sizet,nBlocks+1,ALL);
+		MALLOC_VECTOR(luStart,sizet,nBlocks+1,ALL);
+		MALLOC_VECTOR(lu,complex,luSize,ALL);
+		MALLOC_VECTOR(pivot,uchar,local_nRows,ALL);
+		luStart[0]=0;
+		for (i=0,b=0;i<local_nvoid_Ndip;i++) {
+			order[i]=keys[i].ind;
+			if (i==0 || keys[i].key!=keys[i-1].key) {
+				if (b>0) luStart[b]=luStart[b-1]+9*(i-blockStart[b-1])*(i-blockStart[b-1]);
+				blockStart[b++]=i;
+			}
+		}
+		blockStart[nBlocks]=local_nvoid_Ndip;
+		luStart[nBlocks]=luSize;
+	}
+	Free_general(keys);
+	factored=false;
+	// print info
+	memSum=AccumulateMax(mem,&memMax);
+	blocksSum=AccumulateMax((double)nBlocks,&tmp);
+	if (IFROOT) PrintBoth(logfile,"Memory usage for preconditioner: "FFORMM" MB (%.0f blocks, %.2f dipoles per block "
+		"on average)\n",memSum/MBYTE,blocksSum,nvoid_Ndip/blocksSum);
+	return mem;
+}
+
+//======================================================================================================================
+
+static void FactorBlock(const size_t b)
+/* assembles the diagonal block b of the interaction matrix and computes its LU factorization with partial pivoting
+ * (in place). Elements of the matrix are A_ij=delta_ij-S_i.G_ij.S_j, where G_ij is the interaction tensor (zero for
+ * i=j) plus the reflected one (if surface), and S=cc_sqrt, same as in MatVec.
+ */
+{
+	size_t i1,i2;
+	int a1,a2,mu,nu,r,c,l,p,dx,dy;
+	double pmax;
+	doublecomplex G[6],R[6],Gval,tmp;
+	const size_t d0=blockStart[b];
+	const int nb=3*(int)(blockStart[b+1]-d0);
+	doublecomplex * restrict M=lu+luStart[b];
+	unsigned char * restrict piv=pivot+3*d0;
+
+	for (a1=0;3*a1<nb;a1++) {
+		i1=order[d0+a1];
+		for (a2=0;3*a2<nb;a2++) {
+			i2=order[d0+a2];
+			dx=(int)position[3*i1]-(int)position[3*i2];
+			dy=(int)position[3*i1+1]-(int)position[3*i2+1];
+			if (a1==a2) for (l=0;l<6;l++) G[l]=0;
+			else (*InterTerm_int)(dx,dy,(int)position[3*i1+2]-(int)position[3*i2+2],G);
+			// reflected tensor has the following symmetry: M21=M12, M31=-M13, M32=-M23 (see cReflMatrVec)
+			if (surface) (*ReflTerm_int)(dx,dy,(int)position[3*i1+2]+(int)position[3*i2+2],R);
+			for (mu=0;mu<3;mu++) for (nu=0;nu<3;nu++) {
+				Gval=G[symComp[mu][nu]];
+				if (surface) Gval+=(mu==2 && nu<2) ? -R[symComp[mu][nu]] : R[symComp[mu][nu]];
+				M[(3*a1+mu)*nb+3*a2+nu]=((a1==a2 && mu==nu) ? 1 : 0)
+					- cc_sqrt[material[i1]][mu]*Gval*cc_sqrt[material[i2]][nu];
+			}
+		}
+	}
+	for (c=0;c<nb;c++) {
+		// choose the pivot and swap the rows
+		p=c;
+		pmax=cabs(M[c*nb+c]);
+		for (r=c+1;r<nb;r++) if (cabs(M[r*nb+c])>pmax) {
+			p=r;
+			pmax=cabs(M[r*nb+c]);
+		}
+		if (pmax==0) LogError(ALL_POS,"Block %zu of the preconditioner is singular",b);
+		piv[c]=(unsigned char)p;
+		if (p!=c) for (l=0;l<nb;l++) {
+			tmp=M[c*nb+l];
+			M[c*nb+l]=M[p*nb+l];
+			M[p*nb+l]=tmp;
+		}
+		// eliminate the column below the pivot, the multipliers (L) are stored in place of the eliminated elements
+		for (r=c+1;r<nb;r++) {
+			tmp=M[r*nb+c]/=M[c*nb+c];
+			for (l=c+1;l<nb;l++) M[r*nb+l]-=tmp*M[c*nb+l];
+		}
+	}
+}
+
+//======================================================================================================================
+
+void UpdatePreconditioner(void)
+/* computes the LU factors of all blocks, unless they are already computed for the current values of cc_sqrt (the latter
+ * may change between incident polarizations or orientations, e.g. for LDR polarizability)
+ */
+{
+	size_t b;
+	TIME_TYPE tstart;
+
+	if (factored && memcmp(ccUsed,cc_sqrt,sizeof(ccUsed))==0) return;
+	tstart=GET_TIME();
+	memcpy(ccUsed,cc_sqrt,sizeof(ccUsed));
+	/* InterTerm_int is not thread-safe for some formulations (e.g., igt uses common blocks of Fortran code and the
+	 * memoization of symmetric elements); they are distinguished by InterTerm_row, same as in InitDmatrix
+	 */
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(dynamic) if(InterTerm_row!=NULL)
+#endif
+	for (b=0;b<nBlocks;b++) FactorBlock(b);
+	factored=true;
+	Timing_PrecSetup+=GET_TIME()-tstart;
+}
+
+//======================================================================================================================
+
+static void SolveBlock(const size_t b,doublecomplex *out,const doublecomplex *in)
+// solves the system with the block b for the corresponding part of vector in and stores the result in out
+{
+	int a,mu,r,l;
+	doublecomplex v[MAX_BLOCK_DIM],tmp;
+	const size_t d0=blockStart[b];
+	const int nb=3*(int)(blockStart[b+1]-d0);
+	const doublecomplex * restrict M=lu+luStart[b];
+	const unsigned char * restrict piv=pivot+3*d0;
+
+	for (a=0;3*a<nb;a++) for (mu=0;mu<3;mu++) v[3*a+mu]=in[3*order[d0+a]+mu];
+	// P.v
+	for (r=0;r<nb;r++) if (piv[r]!=r) {
+		tmp=v[r];
+		v[r]=v[piv[r]];
+		v[piv[r]]=tmp;
+	}
+	// forward (L has unit diagonal) and back substitution
+	for (r=1;r<nb;r++) for (l=0;l<r;l++) v[r]-=M[r*nb+l]*v[l];
+	for (r=nb-1;r>=0;r--) {
+		for (l=r+1;l<nb;l++) v[r]-=M[r*nb+l]*v[l];
+		v[r]/=M[r*nb+r];
+	}
+	for (a=0;3*a<nb;a++) for (mu=0;mu<3;mu++) out[3*order[d0+a]+mu]=v[3*a+mu];
+}
+
+//======================================================================================================================
+
+static void MultBlock(const size_t b,doublecomplex *vec)
+// multiplies the corresponding part of vec by the block b (in place), using its LU factors: A_b=P^T.L.U
+{
+	int a,mu,r,l;
+	doublecomplex v[MAX_BLOCK_DIM],tmp;
+	const size_t d0=blockStart[b];
+	const int nb=3*(int)(blockStart[b+1]-d0);
+	const doublecomplex * restrict M=lu+luStart[b];
+	const unsigned char * restrict piv=pivot+3*d0;
+
+	for (a=0;3*a<nb;a++) for (mu=0;mu<3;mu++) v[3*a+mu]=vec[3*order[d0+a]+mu];
+	// U.v, then L.v; both in place
+	for (r=0;r<nb;r++) {
+		tmp=0;
+		for (l=r;l<nb;l++) tmp+=M[r*nb+l]*v[l];
+		v[r]=tmp;
+	}
+	for (r=nb-1;r>0;r--) for (l=0;l<r;l++) v[r]+=M[r*nb+l]*v[l];
+	// P^T.v
+	for (r=nb-1;r>=0;r--) if (piv[r]!=r) {
+		tmp=v[r];
+		v[r]=v[piv[r]];
+		v[piv[r]]=tmp;
+	}
+	for (a=0;3*a<nb;a++) for (mu=0;mu<3;mu++) vec[3*order[d0+a]+mu]=v[3*a+mu];
+}
+
+//======================================================================================================================
+
+void PrecApply(doublecomplex *out,const doublecomplex *in)
+// out=M.in, where M is the preconditioner (inverse of the block-diagonal part of the matrix); out and in may coincide
+{
+	size_t b;
+
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+	for (b=0;b<nBlocks;b++) SolveBlock(b,out,in);
+}
+
+//======================================================================================================================
+
+void PrecApplyInverse(doublecomplex *vec)
+// vec=M^(-1).vec, i.e. multiplication by the block-diagonal part of the matrix; used to transform the initial vector
+{
+	size_t b;
+
+#ifdef OPENMP
+#	pragma omp parallel for num_threads(nthreads) schedule(static)
+#endif
+	for (b=0;b<nBlocks;b++) MultBlock(b,vec);
+}
+
+//======================================================================================================================
+
+void FreePreconditioner(void)
+// frees all the memory, allocated in InitPreconditioner
+{
+	Free_general(order);
+	Free_general(blockStart);
+	Free_general(luStart);
+	Free_cVector(lu);
+	Free_general(pivot);
+}
@@ -0,0 +1,29 @@
+/* File: precond.h
+ * Descr: definitions for the near-field (block-Jacobi) preconditioner of the iterative solver; see source (precond.c)
+ *        for details
+ *
+ * Copyright (C) 2014 ADDA contributors
+ * This file is part of ADDA.
+ *
+ * ADDA is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ *
+ * ADDA is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with ADDA. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#ifndef __precond_h
+#define __precond_h
+
+// project headers
+#include "types.h" // for doublecomplex
+
+double InitPreconditioner(void);
+void UpdatePreconditioner(void);
+void PrecApply(doublecomplex *out,const doublecomplex *in);
+void PrecApplyInverse(doublecomplex *vec);
+void FreePreconditioner(void);
+
+#endif // __precond_h
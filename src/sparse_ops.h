@@ -19,22 +19,31 @@
 #define __sparse_ops_h
 
 #include "cmplx.h"
+#include "function.h" // for ATT_TARGET and SIMD_DISPATCH
 #include "interaction.h"
 #include "vars.h"
+#ifdef SIMD_DISPATCH
+#	include <immintrin.h>
+#endif
 
 #ifdef USE_SSE3
 
 //=====================================================================================================================
 
-static inline void CcMul(doublecomplex * restrict argvec_src,doublecomplex * restrict argvec_dest, const size_t j)
-// Takes the j'th block in argvec_src, multiplies by cc_sqrt at that position and stores the result in argvec_dest.
+static inline void CcMul(doublecomplex * restrict argvec_src,doublecomplex * restrict argvec_dest,const size_t j,
+	const bool her)
+/* Takes the j'th block in argvec_src (conjugated, if her), multiplies by cc_sqrt at that position and stores the result
+ * in argvec_dest.
+ */
 {
 	const size_t j3=j*3;
-	*(__m128d *)&(argvec_dest[j3]) = cmul(*(__m128d *)&(argvec_src[j3]),
+	// multiplication by this vector changes the sign of imaginary part for her
+	const __m128d cj = her ? _mm_set_pd(-1.0,1.0) : _mm_set1_pd(1.0);
+	*(__m128d *)&(argvec_dest[j3]) = cmul(_mm_mul_pd(*(__m128d *)&(argvec_src[j3]),cj),
 		*(__m128d *)&(cc_sqrt[material[j]][0]));
-	*(__m128d *)&(argvec_dest[j3+1]) = cmul(*(__m128d *)&(argvec_src[j3+1]),
+	*(__m128d *)&(argvec_dest[j3+1]) = cmul(_mm_mul_pd(*(__m128d *)&(argvec_src[j3+1]),cj),
 		*(__m128d *)&(cc_sqrt[material[j]][1]));
-	*(__m128d *)&(argvec_dest[j3+2]) = cmul(*(__m128d *)&(argvec_src[j3+2]),
+	*(__m128d *)&(argvec_dest[j3+2]) = cmul(_mm_mul_pd(*(__m128d *)&(argvec_src[j3+2]),cj),
 		*(__m128d *)&(cc_sqrt[material[j]][2]));
 }
 
@@ -109,16 +118,18 @@ static inline void AijProd(doublecomplex * restrict argvec,doublecomplex * restr
 
 //=====================================================================================================================
 
-static inline void DiagProd(doublecomplex * restrict argvec,doublecomplex * restrict resultvec,const size_t i)
-/* Multiplies the result in the i'th block of resultvec by cc_sqrt at that block, subtracts the result from the i'th
- * block of argvec, and stores the result in the i'th block if resultvec.
+static inline void DiagProd(doublecomplex * restrict argvec,doublecomplex * restrict resultvec,const size_t i,
+	const bool her)
+/* Multiplies the result in the i'th block of resultvec by cc_sqrt at that block (and conjugates it, if her), subtracts
+ * the result from the i'th block of argvec, and stores the result in the i'th block if resultvec.
  */
 {
 	const size_t i3 = i*3;
+	const __m128d cj = her ? _mm_set_pd(-1.0,1.0) : _mm_set1_pd(1.0);
 
-	const __m128d tmp1 = cmul(*(__m128d *)&(resultvec[i3]),*(__m128d *)&(cc_sqrt[material[i]][0]));
-	const __m128d tmp2 = cmul(*(__m128d *)&(resultvec[i3+1]),*(__m128d *)&(cc_sqrt[material[i]][1]));
-	const __m128d tmp3 = cmul(*(__m128d *)&(resultvec[i3+2]),*(__m128d *)&(cc_sqrt[material[i]][2]));
+	const __m128d tmp1 = _mm_mul_pd(cmul(*(__m128d *)&(resultvec[i3]),*(__m128d *)&(cc_sqrt[material[i]][0])),cj);
+	const __m128d tmp2 = _mm_mul_pd(cmul(*(__m128d *)&(resultvec[i3+1]),*(__m128d *)&(cc_sqrt[material[i]][1])),cj);
+	const __m128d tmp3 = _mm_mul_pd(cmul(*(__m128d *)&(resultvec[i3+2]),*(__m128d *)&(cc_sqrt[material[i]][2])),cj);
 
 	*(__m128d *)&(resultvec[i3]) = _mm_sub_pd(*(__m128d *)&(argvec[i3]),tmp1);
 	*(__m128d *)&(resultvec[i3+1]) = _mm_sub_pd(*(__m128d *)&(argvec[i3+1]),tmp2);
@@ -129,14 +140,24 @@ static inline void DiagProd(doublecomplex * restrict argvec,doublecomplex * rest
 
 //=====================================================================================================================
 
-static inline void CcMul(doublecomplex * restrict argvec_src,doublecomplex * restrict argvec_dest, const size_t j)
-// Takes the j'th block in argvec_src, multiplies by cc_sqrt at that position and stores the result in argvec_dest.
+static inline void CcMul(doublecomplex * restrict argvec_src,doublecomplex * restrict argvec_dest,const size_t j,
+	const bool her)
+/* Takes the j'th block in argvec_src (conjugated, if her), multiplies by cc_sqrt at that position and stores the result
+ * in argvec_dest.
+ */
 {
 	const size_t j3 = j*3;
 
-	argvec_dest[j3]=argvec_src[j3]*cc_sqrt[material[j]][0];
-	argvec_dest[j3+1]=argvec_src[j3+1]*cc_sqrt[material[j]][1];
-	argvec_dest[j3+2]=argvec_src[j3+2]*cc_sqrt[material[j]][2];
+	if (her) {
+		argvec_dest[j3]=conj(argvec_src[j3])*cc_sqrt[material[j]][0];
+		argvec_dest[j3+1]=conj(argvec_src[j3+1])*cc_sqrt[material[j]][1];
+		argvec_dest[j3+2]=conj(argvec_src[j3+2])*cc_sqrt[material[j]][2];
+	}
+	else {
+		argvec_dest[j3]=argvec_src[j3]*cc_sqrt[material[j]][0];
+		argvec_dest[j3+1]=argvec_src[j3+1]*cc_sqrt[material[j]][1];
+		argvec_dest[j3+2]=argvec_src[j3+2]*cc_sqrt[material[j]][2];
+	}
 }
 
 //=====================================================================================================================
@@ -167,20 +188,319 @@ static inline void AijProd(doublecomplex * restrict argvec,doublecomplex * restr
 
 //=====================================================================================================================
 
-static inline void DiagProd(doublecomplex * restrict argvec,doublecomplex * restrict resultvec,const size_t i)
-/* Multiplies the result in the i'th block of resultvec by cc_sqrt at that block, subtracts the result from the i'th
- * block of argvec, and stores the result in the i'th block if resultvec.
+static inline void DiagProd(doublecomplex * restrict argvec,doublecomplex * restrict resultvec,const size_t i,
+	const bool her)
+/* Multiplies the result in the i'th block of resultvec by cc_sqrt at that block (and conjugates it, if her), subtracts
+ * the result from the i'th block of argvec, and stores the result in the i'th block if resultvec.
  */
 {
 	const size_t i3 = i*3;
 
-	resultvec[i3]   = argvec[i3]   - resultvec[i3]*cc_sqrt[material[i]][0];
-	resultvec[i3+1] = argvec[i3+1] - resultvec[i3+1]*cc_sqrt[material[i]][1];
-	resultvec[i3+2] = argvec[i3+2] - resultvec[i3+2]*cc_sqrt[material[i]][2];
+	if (her) {
+		resultvec[i3]   = argvec[i3]   - conj(resultvec[i3]*cc_sqrt[material[i]][0]);
+		resultvec[i3+1] = argvec[i3+1] - conj(resultvec[i3+1]*cc_sqrt[material[i]][1]);
+		resultvec[i3+2] = argvec[i3+2] - conj(resultvec[i3+2]*cc_sqrt[material[i]][2]);
+	}
+	else {
+		resultvec[i3]   = argvec[i3]   - resultvec[i3]*cc_sqrt[material[i]][0];
+		resultvec[i3+1] = argvec[i3+1] - resultvec[i3+1]*cc_sqrt[material[i]][1];
+		resultvec[i3+2] = argvec[i3+2] - resultvec[i3+2]*cc_sqrt[material[i]][2];
+	}
 }
 
 #endif // !USE_SSE3
 
+/* Point-dipole interaction can be evaluated for a whole row of the interaction matrix (fixed i, range of j) by vector
+ * kernels, which process 4 (AVX2) or 8 (AVX-512) pairs of dipoles at once. For that positions of all dipoles and the
+ * argument vector are additionally stored in structure-of-arrays form. For each pair only the direct term is computed
+ * as G.a=b*a+c*q*(q.a), where q is the unit distance vector, c=(3-(kR)^2-3ikR)exp(ikR)/R^3 and
+ * b=((kR)^2-1+ikR)exp(ikR)/R^3, which is equivalent to InterTerm_poi followed by cSymMatrVec. Imaginary exponent is
+ * obtained from the table of exp(2*pi*i*n/SINCOS_N) and the Taylor series for the small residual (similar to
+ * accImExp_pd in interaction.c).
+ */
+struct sparseSoA {
+	int * restrict pos[3];   // coordinates of all dipoles (copied from position_full)
+	double * restrict re[3]; // real parts of components of arg_full
+	double * restrict im[3]; // imaginary parts of components of arg_full
+};
+
+typedef void (*aijRowFunc)(const struct sparseSoA * restrict s,size_t i,size_t j0,size_t j1,
+	doublecomplex * restrict res);
+
+#define SINCOS_N 256 // number of tabulated imaginary exponents per period, must be a power of 2
+static double sincosTab[2][SINCOS_N]; // cos and sin
+static double sincosStep[2]; // 2*pi/SINCOS_N split into high (exactly representable multiples) and low parts
+
+//======================================================================================================================
+
+static void AijRow_c(const struct sparseSoA * restrict s,const size_t i,const size_t j0,const size_t j1,
+	doublecomplex * restrict res)
+/* adds G_ij.a_j to res (of size 3) for j0<=j<j1, where i and j are indices in position_full and arg_full; pair i=j must
+ * not be included. Generic version, used to process the remainders of rows
+ */
+{
+	size_t j;
+	int mu;
+	doublecomplex iterm[6],arg[3],tmp[3];
+	const int *p=position_full+3*i;
+
+	for (j=j0;j<j1;j++) {
+		(*InterTerm_int)(p[0]-s->pos[0][j],p[1]-s->pos[1][j],p[2]-s->pos[2][j],iterm);
+		for (mu=0;mu<3;mu++) arg[mu]=s->re[mu][j]+I*s->im[mu][j];
+		cSymMatrVec(iterm,arg,tmp);
+		cvAdd(tmp,res,res);
+	}
+}
+
+//======================================================================================================================
+
+static inline void ReflProd(doublecomplex * restrict argvec,doublecomplex * restrict resultvec,const size_t i,
+	const size_t j)
+// same as AijProd, but only the reflected (surface) term is added
+{
+	doublecomplex res[3],iterm[6];
+	const size_t i3=3*i,j3=3*j;
+
+	(*ReflTerm_int)(position[i3]-position_full[j3],position[i3+1]-position_full[j3+1],
+		position[i3+2]+position_full[j3+2],iterm);
+	cReflMatrVec(iterm,argvec+j3,res);
+	cvAdd(res,resultvec+i3,resultvec+i3);
+}
+
+#ifdef SIMD_DISPATCH
+
+//======================================================================================================================
+
+ATT_TARGET("avx2,fma") static inline void ImExp_avx2(const __m256d x,__m256d *c,__m256d *s)
+// computes cos(x) and sin(x) for four non-negative values of x
+{
+	const __m256d t=_mm256_round_pd(_mm256_mul_pd(x,_mm256_set1_pd(SINCOS_N/TWO_PI)),
+		_MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC);
+	const __m128i ind=_mm_and_si128(_mm256_cvtpd_epi32(t),_mm_set1_epi32(SINCOS_N-1));
+	const __m256d tc=_mm256_i32gather_pd(sincosTab[0],ind,8);
+	const __m256d ts=_mm256_i32gather_pd(sincosTab[1],ind,8);
+	// residual |r|<=pi/SINCOS_N, so Taylor series up to r^7 is accurate to machine precision
+	__m256d r=_mm256_fnmadd_pd(t,_mm256_set1_pd(sincosStep[0]),x);
+	r=_mm256_fnmadd_pd(t,_mm256_set1_pd(sincosStep[1]),r);
+	const __m256d r2=_mm256_mul_pd(r,r);
+	__m256d rc=_mm256_fmadd_pd(r2,_mm256_set1_pd(-1.0/720),_mm256_set1_pd(1.0/24));
+	rc=_mm256_fmadd_pd(r2,rc,_mm256_set1_pd(-0.5));
+	rc=_mm256_fmadd_pd(r2,rc,_mm256_set1_pd(1.0));
+	__m256d rs=_mm256_fmadd_pd(r2,_mm256_set1_pd(-1.0/5040),_mm256_set1_pd(1.0/120));
+	rs=_mm256_fmadd_pd(r2,rs,_mm256_set1_pd(-1.0/6));
+	rs=_mm256_fmadd_pd(r2,rs,_mm256_set1_pd(1.0));
+	rs=_mm256_mul_pd(r,rs);
+	*c=_mm256_fmsub_pd(tc,rc,_mm256_mul_pd(ts,rs));
+	*s=_mm256_fmadd_pd(ts,rc,_mm256_mul_pd(tc,rs));
+}
+
+//======================================================================================================================
+
+ATT_TARGET("avx2,fma") static inline double HSum_avx2(const __m256d a)
+// sum of four elements
+{
+	const __m128d t=_mm_add_pd(_mm256_castpd256_pd128(a),_mm256_extractf128_pd(a,1));
+	return _mm_cvtsd_f64(_mm_add_sd(t,_mm_unpackhi_pd(t,t)));
+}
+
+//======================================================================================================================
+
+ATT_TARGET("avx2,fma") static void AijRow_avx2(const struct sparseSoA * restrict s,const size_t i,const size_t j0,
+	const size_t j1,doublecomplex * restrict res)
+// same as AijRow_c, but using AVX2 and FMA instructions (only for point dipoles)
+{
+	size_t j;
+	int mu;
+	const int *p=position_full+3*i;
+	const __m256d one=_mm256_set1_pd(1.0),three=_mm256_set1_pd(3.0),gs=_mm256_set1_pd(gridspace),
+		wn=_mm256_set1_pd(WaveNum);
+	__m256d pi[3],q[3],ar[3],ai[3],accr[3],aci[3];
+	__m256d rn,inv,invr3,kr,kr2,ec,es,t1,t2,br,bi,cr,ci,pr,pim,vr,vi;
+
+	for (mu=0;mu<3;mu++) {
+		pi[mu]=_mm256_set1_pd(p[mu]);
+		accr[mu]=aci[mu]=_mm256_setzero_pd();
+	}
+	for (j=j0;j+4<=j1;j+=4) {
+		for (mu=0;mu<3;mu++) q[mu]=_mm256_sub_pd(pi[mu],_mm256_cvtepi32_pd(_mm_loadu_si128((__m128i *)(s->pos[mu]+j))));
+		rn=_mm256_mul_pd(q[0],q[0]);
+		rn=_mm256_fmadd_pd(q[1],q[1],rn);
+		rn=_mm256_sqrt_pd(_mm256_fmadd_pd(q[2],q[2],rn));
+		inv=_mm256_div_pd(one,rn);
+		for (mu=0;mu<3;mu++) q[mu]=_mm256_mul_pd(q[mu],inv);
+		kr=_mm256_mul_pd(rn,gs); // |R|
+		invr3=_mm256_div_pd(one,_mm256_mul_pd(_mm256_mul_pd(kr,kr),kr));
+		kr=_mm256_mul_pd(kr,wn);
+		kr2=_mm256_mul_pd(kr,kr);
+		ImExp_avx2(kr,&ec,&es);
+		ec=_mm256_mul_pd(ec,invr3);
+		es=_mm256_mul_pd(es,invr3);
+		// b=(kr2-1+i*kr)*exp(ikR)/R^3, c=(3-kr2-3i*kr)*exp(ikR)/R^3
+		t1=_mm256_sub_pd(kr2,one);
+		br=_mm256_fnmadd_pd(kr,es,_mm256_mul_pd(t1,ec));
+		bi=_mm256_fmadd_pd(kr,ec,_mm256_mul_pd(t1,es));
+		t1=_mm256_sub_pd(three,kr2);
+		t2=_mm256_mul_pd(three,kr);
+		cr=_mm256_fmadd_pd(t2,es,_mm256_mul_pd(t1,ec));
+		ci=_mm256_fnmadd_pd(t2,ec,_mm256_mul_pd(t1,es));
+		// q.a
+		for (mu=0;mu<3;mu++) {
+			ar[mu]=_mm256_loadu_pd(s->re[mu]+j);
+			ai[mu]=_mm256_loadu_pd(s->im[mu]+j);
+		}
+		pr=_mm256_mul_pd(q[0],ar[0]);
+		pr=_mm256_fmadd_pd(q[1],ar[1],pr);
+		pr=_mm256_fmadd_pd(q[2],ar[2],pr);
+		pim=_mm256_mul_pd(q[0],ai[0]);
+		pim=_mm256_fmadd_pd(q[1],ai[1],pim);
+		pim=_mm256_fmadd_pd(q[2],ai[2],pim);
+		// c*(q.a)
+		vr=_mm256_fmsub_pd(cr,pr,_mm256_mul_pd(ci,pim));
+		vi=_mm256_fmadd_pd(cr,pim,_mm256_mul_pd(ci,pr));
+		for (mu=0;mu<3;mu++) {
+			accr[mu]=_mm256_fmadd_pd(q[mu],vr,accr[mu]);
+			accr[mu]=_mm256_fmadd_pd(br,ar[mu],accr[mu]);
+			accr[mu]=_mm256_fnmadd_pd(bi,ai[mu],accr[mu]);
+			aci[mu]=_mm256_fmadd_pd(q[mu],vi,aci[mu]);
+			aci[mu]=_mm256_fmadd_pd(br,ai[mu],aci[mu]);
+			aci[mu]=_mm256_fmadd_pd(bi,ar[mu],aci[mu]);
+		}
+	}
+	for (mu=0;mu<3;mu++) res[mu]+=HSum_avx2(accr[mu])+I*HSum_avx2(aci[mu]);
+	if (j<j1) AijRow_c(s,i,j,j1,res);
+}
+
+//======================================================================================================================
+
+ATT_TARGET("avx512f") static inline void ImExp_avx512(const __m512d x,__m512d *c,__m512d *s)
+// computes cos(x) and sin(x) for eight non-negative values of x
+{
+	const __m512d t=_mm512_roundscale_pd(_mm512_mul_pd(x,_mm512_set1_pd(SINCOS_N/TWO_PI)),_MM_FROUND_TO_NEAREST_INT);
+	const __m256i ind=_mm256_and_si256(_mm512_cvtpd_epi32(t),_mm256_set1_epi32(SINCOS_N-1));
+	const __m512d tc=_mm512_i32gather_pd(ind,sincosTab[0],8);
+	const __m512d ts=_mm512_i32gather_pd(ind,sincosTab[1],8);
+	__m512d r=_mm512_fnmadd_pd(t,_mm512_set1_pd(sincosStep[0]),x);
+	r=_mm512_fnmadd_pd(t,_mm512_set1_pd(sincosStep[1]),r);
+	const __m512d r2=_mm512_mul_pd(r,r);
+	__m512d rc=_mm512_fmadd_pd(r2,_mm512_set1_pd(-1.0/720),_mm512_set1_pd(1.0/24));
+	rc=_mm512_fmadd_pd(r2,rc,_mm512_set1_pd(-0.5));
+	rc=_mm512_fmadd_pd(r2,rc,_mm512_set1_pd(1.0));
+	__m512d rs=_mm512_fmadd_pd(r2,_mm512_set1_pd(-1.0/5040),_mm512_set1_pd(1.0/120));
+	rs=_mm512_fmadd_pd(r2,rs,_mm512_set1_pd(-1.0/6));
+	rs=_mm512_fmadd_pd(r2,rs,_mm512_set1_pd(1.0));
+	rs=_mm512_mul_pd(r,rs);
+	*c=_mm512_fmsub_pd(tc,rc,_mm512_mul_pd(ts,rs));
+	*s=_mm512_fmadd_pd(ts,rc,_mm512_mul_pd(tc,rs));
+}
+
+//======================================================================================================================
+
+ATT_TARGET("avx512f") static void AijRow_avx512(const struct sparseSoA * restrict s,const size_t i,const size_t j0,
+	const size_t j1,doublecomplex * restrict res)
+// same as AijRow_c, but using AVX-512 instructions (only for point dipoles)
+{
+	size_t j;
+	int mu;
+	const int *p=position_full+3*i;
+	const __m512d one=_mm512_set1_pd(1.0),three=_mm512_set1_pd(3.0),gs=_mm512_set1_pd(gridspace),
+		wn=_mm512_set1_pd(WaveNum);
+	__m512d pi[3],q[3],ar[3],ai[3],accr[3],aci[3];
+	__m512d rn,inv,invr3,kr,kr2,ec,es,t1,t2,br,bi,cr,ci,pr,pim,vr,vi;
+
+	for (mu=0;mu<3;mu++) {
+		pi[mu]=_mm512_set1_pd(p[mu]);
+		accr[mu]=aci[mu]=_mm512_setzero_pd();
+	}
+	for (j=j0;j+8<=j1;j+=8) {
+		for (mu=0;mu<3;mu++)
+			q[mu]=_mm512_sub_pd(pi[mu],_mm512_cvtepi32_pd(_mm256_loadu_si256((__m256i *)(s->pos[mu]+j))));
+		rn=_mm512_mul_pd(q[0],q[0]);
+		rn=_mm512_fmadd_pd(q[1],q[1],rn);
+		rn=_mm512_sqrt_pd(_mm512_fmadd_pd(q[2],q[2],rn));
+		inv=_mm512_div_pd(one,rn);
+		for (mu=0;mu<3;mu++) q[mu]=_mm512_mul_pd(q[mu],inv);
+		kr=_mm512_mul_pd(rn,gs); // |R|
+		invr3=_mm512_div_pd(one,_mm512_mul_pd(_mm512_mul_pd(kr,kr),kr));
+		kr=_mm512_mul_pd(kr,wn);
+		kr2=_mm512_mul_pd(kr,kr);
+		ImExp_avx512(kr,&ec,&es);
+		ec=_mm512_mul_pd(ec,invr3);
+		es=_mm512_mul_pd(es,invr3);
+		// b=(kr2-1+i*kr)*exp(ikR)/R^3, c=(3-kr2-3i*kr)*exp(ikR)/R^3
+		t1=_mm512_sub_pd(kr2,one);
+		br=_mm512_fnmadd_pd(kr,es,_mm512_mul_pd(t1,ec));
+		bi=_mm512_fmadd_pd(kr,ec,_mm512_mul_pd(t1,es));
+		t1=_mm512_sub_pd(three,kr2);
+		t2=_mm512_mul_pd(three,kr);
+		cr=_mm512_fmadd_pd(t2,es,_mm512_mul_pd(t1,ec));
+		ci=_mm512_fnmadd_pd(t2,ec,_mm512_mul_pd(t1,es));
+		// q.a
+		for (mu=0;mu<3;mu++) {
+			ar[mu]=_mm512_loadu_pd(s->re[mu]+j);
+			ai[mu]=_mm512_loadu_pd(s->im[mu]+j);
+		}
+		pr=_mm512_mul_pd(q[0],ar[0]);
+		pr=_mm512_fmadd_pd(q[1],ar[1],pr);
+		pr=_mm512_fmadd_pd(q[2],ar[2],pr);
+		pim=_mm512_mul_pd(q[0],ai[0]);
+		pim=_mm512_fmadd_pd(q[1],ai[1],pim);
+		pim=_mm512_fmadd_pd(q[2],ai[2],pim);
+		// c*(q.a)
+		vr=_mm512_fmsub_pd(cr,pr,_mm512_mul_pd(ci,pim));
+		vi=_mm512_fmadd_pd(cr,pim,_mm512_mul_pd(ci,pr));
+		for (mu=0;mu<3;mu++) {
+			accr[mu]=_mm512_fmadd_pd(q[mu],vr,accr[mu]);
+			accr[mu]=_mm512_fmadd_pd(br,ar[mu],accr[mu]);
+			accr[mu]=_mm512_fnmadd_pd(bi,ai[mu],accr[mu]);
+			aci[mu]=_mm512_fmadd_pd(q[mu],vi,aci[mu]);
+			aci[mu]=_mm512_fmadd_pd(br,ai[mu],aci[mu]);
+			aci[mu]=_mm512_fmadd_pd(bi,ar[mu],aci[mu]);
+		}
+	}
+	for (mu=0;mu<3;mu++) res[mu]+=_mm512_reduce_add_pd(accr[mu])+I*_mm512_reduce_add_pd(aci[mu]);
+	if (j<j1) AijRow_c(s,i,j,j1,res);
+}
+
+#endif // SIMD_DISPATCH
+
+//======================================================================================================================
+
+static aijRowFunc SelectAijRow(const char **name)
+/* returns the best row kernel supported by the current processor (its name is stored in 'name') and initializes the
+ * table of exponents. Returns NULL, if there is no suitable kernel, then AijProd should be used. Currently, the kernels
+ * are implemented only for point dipoles
+ */
+{
+#ifdef SIMD_DISPATCH
+	aijRowFunc func=NULL;
+	int n;
+
+	if (IntRelation!=G_POINT_DIP) return NULL;
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		*name="AVX-512";
+		func=AijRow_avx512;
+	}
+	else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+		*name="AVX2";
+		func=AijRow_avx2;
+	}
+	if (func!=NULL) {
+		for (n=0;n<SINCOS_N;n++) {
+			sincosTab[0][n]=cos(TWO_PI*n/SINCOS_N);
+			sincosTab[1][n]=sin(TWO_PI*n/SINCOS_N);
+		}
+		// high part has only 24 significant bits, so its product with any reasonable integer is exact
+		sincosStep[0]=(float)(TWO_PI/SINCOS_N);
+		sincosStep[1]=TWO_PI/SINCOS_N-sincosStep[0];
+	}
+	return func;
+#else
+	*name="";
+	return NULL;
+#endif
+}
+
 #endif // __sparse_ops_h
 
 #endif // SPARSE
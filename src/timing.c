@@ -19,13 +19,14 @@
 // project headers
 #include "comm.h"
 #include "io.h"
+#include "memory.h"
 #include "vars.h"
 // system headers
 #include <math.h>
 #include <time.h>
 #include <stdio.h>
 
-#ifdef ADDA_MPI
+#if defined(ADDA_MPI) || defined(OPENMP)
 #	define TO_SEC(p) (p)
 #else
 #	define TO_SEC(p) ((p) / (double) CLOCKS_PER_SEC)
@@ -33,6 +34,10 @@
 
 // SEMI-GLOBAL VARIABLES
 
+// defined and initialized in param.c
+extern const enum prec Precond;
+extern const bool recycle_ref;
+
 // used in CalculateE.c
 TIME_TYPE Timing_EPlane,Timing_EPlaneComm,    // for Eplane calculation: total and comm
           Timing_IntField,Timing_IntFieldOne, // for internal fields: total & one calculation
@@ -64,11 +69,20 @@ TIME_TYPE Timing_OneIter,Timing_OneIterComm,       // for one iteration: total &
           Timing_MVP,Timing_MVPComm,               // total & comm time for MatVec during one run of iterative solver
           Timing_OneIterMVP,Timing_OneIterMVPComm; // total & comm time for MatVec during one iteration
 size_t TotalIter;                               // total number of iterations performed
+long TotalRecycleSaved; // total number of MatVecs saved by Krylov recycling compared to reference solves (may be <0)
 // used in make_particle.c
 TIME_TYPE Timing_Particle,                 // for particle construction
           Timing_Granul,Timing_GranulComm; // for granule generation: total & comm
 // used in matvec.c
-size_t TotalMatVec; // total number of matrix-vector products
+size_t TotalMatVec; // total number of matrix-vector products (block ones are counted once per right-hand side)
+// used in precond.c
+TIME_TYPE Timing_PrecSetup; // for computing the LU factors of the preconditioner (part of solver initialization)
+#ifdef OOC
+// used in ooc.c; these are wall times
+double Timing_OocRead, // for reading of interaction matrices (by a separate thread)
+       Timing_OocWait, // for waiting for the reading in MatVec, i.e. the part not overlapped with computations
+       TotalOocBytes;  // total number of bytes read
+#endif
 
 // LOCAL VARIABLES
 SYSTEM_TIME wt_start; // starting wall time
@@ -111,8 +125,12 @@ void InitTiming(void)
 // init timing variables and counters
 {
 	TotalIter=TotalMatVec=TotalEval=TotalEFieldPlane=0;
+	TotalRecycleSaved=0;
 	Timing_EField=Timing_FileIO=Timing_IntField=Timing_ScatQuan=Timing_Integration=0;
-	Timing_ScatQuanComm=Timing_InitDmComm=0;
+	Timing_ScatQuanComm=Timing_InitDmComm=Timing_PrecSetup=0;
+#ifdef OOC
+	Timing_OocRead=Timing_OocWait=TotalOocBytes=0;
+#endif
 #ifdef SPARSE
 	Timing_Dm_Init=Timing_Granul=Timing_FFT_Init=Timing_GranulComm=0;
 #endif	
@@ -143,9 +161,12 @@ void FinalStatistics(void)
 				"Total number of single particle evaluations: %zu\n",TotalEval);
 			fprintf(logfile,
 				"Total number of iterations: %zu\n"
-				"Total number of matrix-vector products: %zu\n"
-				"Total planes of E field calculation (each %d points): %zu\n\n",
-				TotalIter,TotalMatVec,nTheta,TotalEFieldPlane);
+				"Total number of matrix-vector products: %zu\n",TotalIter,TotalMatVec);
+			if (recycle_ref) fprintf(logfile,
+				"Total number of MatVecs saved by Krylov recycling (compared to reference solves): %ld\n",
+				TotalRecycleSaved);
+			fprintf(logfile,
+				"Total planes of E field calculation (each %d points): %zu\n\n",nTheta,TotalEFieldPlane);
 		}
 		fprintf(logfile,
 			"Total wall time:     "FFORMT"\n",totTime=DiffSystemTime(&wt_start,&wt_end));
@@ -153,6 +174,10 @@ void FinalStatistics(void)
 		fprintf(logfile,
 			"--Everything below is also wall times--\n"
 			"Time since MPI_Init: "FFORMT"\n",TO_SEC(Timing_TotalTime));
+#elif defined(OPENMP) // processor times are meaningless for a multithreaded program
+		fprintf(logfile,
+			"--Everything below is also wall times--\n"
+			"Total time:          "FFORMT"\n",TO_SEC(Timing_TotalTime));
 #else // standard clock
 		fprintf(logfile,
 			"--Everything below is processor times--\n");
@@ -196,10 +221,11 @@ void FinalStatistics(void)
 #endif
 		}
 		if (!prognosis) {
+			// for block solvers a single solution is obtained for both polarizations together
 			fprintf(logfile,
 				"  Internal fields:     "FFORMT"\n"
-				"    one solution:        "FFORMT"\n",
-				TO_SEC(Timing_IntField),TO_SEC(Timing_IntFieldOne));
+				"%s"FFORMT"\n",TO_SEC(Timing_IntField),
+				(nrhs>1) ? "    both polarizations:  " : "    one solution:        ",TO_SEC(Timing_IntFieldOne));
 #ifdef PARALLEL
 			fprintf(logfile,
 				"      communication:       "FFORMT"\n",TO_SEC(Timing_IntFieldOneComm));
@@ -218,6 +244,8 @@ void FinalStatistics(void)
 			fprintf(logfile,
 				"        communication:       "FFORMT"\n",TO_SEC(Timing_InitIterComm));
 #endif
+			if (Precond!=PREC_NONE) fprintf(logfile,
+				"        preconditioner:      "FFORMT"\n",TO_SEC(Timing_PrecSetup));
 			fprintf(logfile,
 				"      one iteration:       "FFORMT"\n",TO_SEC(Timing_OneIter));
 #ifdef PARALLEL
@@ -265,6 +293,11 @@ void FinalStatistics(void)
 		}
 		fprintf (logfile,
 				"File I/O:            "FFORMT"\n",TO_SEC(Timing_FileIO));
+#ifdef OOC
+		if (TotalOocBytes>0 && Timing_OocRead>0) fprintf(logfile,
+				"Out-of-core reading: "FFORMT"  (%.1f MB/s, wall time)\n"
+				"  not overlapped:      "FFORMT"\n",Timing_OocRead,TotalOocBytes/MBYTE/Timing_OocRead,Timing_OocWait);
+#endif
 		if (!prognosis) fprintf (logfile,
 				"Integration:         "FFORMT"\n",TO_SEC(Timing_Integration));
 		// close logfile
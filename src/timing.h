@@ -24,6 +24,10 @@
 #ifdef ADDA_MPI
 #	define TIME_TYPE double
 #	define GET_TIME() MPI_Wtime()
+#elif defined(OPENMP) // clock() sums processor time over all threads, so wall time is used instead
+#	include <omp.h>
+#	define TIME_TYPE double
+#	define GET_TIME() omp_get_wtime()
 #else
 #	include <time.h>
 #	define TIME_TYPE clock_t
@@ -28,6 +28,7 @@
  * instead of large cmplx.h
  */
 typedef double complex doublecomplex;
+typedef float complex floatcomplex; // used only in mixed-precision MatVec
 
 typedef struct	      // integration parameters
 {
@@ -56,6 +56,7 @@ bool beam_asym;     // whether the beam center is shifted relative to the origin
 bool sh_granul;     // whether to fill one domain with granules
 bool anisotropy;    // whether the scattering medium is anisotropic
 bool save_memory;   // whether to sacrifice some speed for memory
+bool lean_matvec;   // whether FFT-based MatVec processes a single component at a time ('-opt lean')
 bool ipr_required;  /* whether inner product in MatVec will be used by iterative solver (causes additional
                        initialization, e.g., for OpenCL) */
 double propAlongZ;  // equal 0 for general incidence, and +-1 for incidence along the z-axis (can be used as flag)
@@ -83,6 +84,10 @@ unsigned char * restrict material;  // material: index for cc
 // iterative solver
 enum iter IterMethod; // iterative method to use
 int maxiter;          // maximum number of iterations
+int nrhs;             /* number of right-hand sides (incident polarizations) solved simultaneously; 1 except for
+                         block iterative solvers. Then all vectors consist of nrhs columns of length local_nRows */
+int mv_ncomp;         /* number of components processed together by FFTs and transposes in MatVec (and stored in
+                         Xmatrix): 3*nrhs, or 1 in lean mode (see MatVec_lean in matvec.c) */
 	// the following two can't be declared restrict due to SwapPointers
 doublecomplex *xvec;  // total electric field on the dipoles
 doublecomplex *pvec;  // polarization of dipoles, also an auxiliary vector in iterative solvers
@@ -98,6 +103,8 @@ doublecomplex * restrict EgridX,* restrict EgridY;
 
 int nprocs;                        // total number of processes
 int ringid;                        // ID of current process
+int nthreads;                      // number of threads (per process) used in MatVec; 1 unless compiled with OpenMP
+int slice_batch;                   // number of x-slices processed together (by each thread) in MatVec
 
 size_t local_Ndip;                 // number of local total dipoles
 size_t local_nvoid_Ndip;           // number of local and ...
@@ -46,7 +46,7 @@ extern bool symX,symY,symZ,symR;
 
 // flags
 extern bool prognosis,yzplane,scat_plane,store_mueller,all_dir,scat_grid,phi_integr,sh_granul,reduced_FFT,orient_avg,
-	load_chpoint,beam_asym,anisotropy,save_memory,ipr_required;
+	load_chpoint,beam_asym,anisotropy,save_memory,lean_matvec,ipr_required;
 extern double propAlongZ;
 
 // 3D vectors
@@ -66,7 +66,7 @@ extern unsigned char * restrict material;
 
 // iterative solver
 extern enum iter IterMethod;
-extern int maxiter;
+extern int maxiter,nrhs,mv_ncomp;
 extern doublecomplex *xvec,*pvec,* restrict Einc;
 
 // scattering at different angles
@@ -76,7 +76,7 @@ extern angle_set alpha_int;
 extern scat_grid_angles angles;
 extern doublecomplex * restrict EgridX,* restrict EgridY;
 
-extern int nprocs,ringid;
+extern int nprocs,ringid,nthreads,slice_batch;
 
 extern size_t local_Ndip,local_nvoid_Ndip,local_nRows,local_nvoid_d0,local_nvoid_d1,nvoid_Ndip;
 